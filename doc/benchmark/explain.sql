@@ -0,0 +1,50 @@
+--
+-- One instance of each workload, with its plan and buffer usage.
+--
+-- Variables (psql -v name=value): id, obj, window, radius.
+--
+
+\echo '=== point_lookup'
+EXPLAIN (ANALYZE, BUFFERS)
+SELECT p.id
+  FROM bench_points AS p
+ WHERE p.location = (SELECT location FROM bench_points WHERE id = :id);
+
+\echo '=== window_points'
+EXPLAIN (ANALYZE, BUFFERS)
+SELECT count(*)
+  FROM bench_points AS p
+ WHERE p.location && (SELECT expand(location, :window) FROM bench_points WHERE id = :id);
+
+\echo '=== window_boxes'
+EXPLAIN (ANALYZE, BUFFERS)
+SELECT count(*)
+  FROM bench_boxes AS b
+ WHERE b.geom && (SELECT expand(location, :window) FROM bench_points WHERE id = :id);
+
+\echo '=== knn'
+EXPLAIN (ANALYZE, BUFFERS)
+SELECT p.id
+  FROM bench_points AS p,
+       (SELECT location FROM bench_points WHERE id = :id) AS q
+ WHERE dwithin(p.location, q.location, :radius)
+ ORDER BY distance(p.location, q.location)
+ LIMIT 10;
+
+\echo '=== contains'
+EXPLAIN (ANALYZE, BUFFERS)
+SELECT g.id
+  FROM bench_polygons AS g
+ WHERE contains(g.geom, (SELECT location FROM bench_points WHERE id = :id));
+
+\echo '=== trajectory_agg'
+EXPLAIN (ANALYZE, BUFFERS)
+SELECT array_trajectory_agg(t, location)
+  FROM bench_trajectories
+ WHERE obj_id = :obj;
+
+\echo '=== spatial_join'
+EXPLAIN (ANALYZE, BUFFERS)
+SELECT count(*)
+  FROM bench_polygons AS g
+  JOIN bench_points AS p ON contains(g.geom, p.location);
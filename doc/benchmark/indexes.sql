@@ -0,0 +1,43 @@
+--
+-- GiST indexes of the benchmark tables, with double or float4 keys, and
+-- their sizes.
+--
+-- Variables (psql -v name=value):
+--   keys  double: the default opclasses (gist_geo_point_ops, gist_gbox_ops,
+--                 gist_geo_polygon_ops): geo_box keys of 32 bytes, and
+--                 24-byte keys for the points (the points at the leaves)
+--         float4: geo_box4 keys (gist_geo_point4_ops, gist_geo_box4_ops,
+--                 gist_geo_polygon4_ops), 16 bytes each
+--
+-- The indexes keep the same names with both kinds of keys, so the
+-- workloads run unchanged. The output is one CSV line per index: keys,
+-- index name and size in bytes.
+--
+
+DROP INDEX IF EXISTS bench_points_gist_idx, bench_boxes_gist_idx, bench_polygons_gist_idx;
+
+SELECT :'keys' = 'float4' AS float4_keys, :'keys' = 'double' AS double_keys \gset
+
+\if :float4_keys
+CREATE INDEX bench_points_gist_idx ON bench_points USING gist (location gist_geo_point4_ops);
+CREATE INDEX bench_boxes_gist_idx ON bench_boxes USING gist (geom gist_geo_box4_ops);
+CREATE INDEX bench_polygons_gist_idx ON bench_polygons USING gist (geom gist_geo_polygon4_ops);
+\elif :double_keys
+CREATE INDEX bench_points_gist_idx ON bench_points USING gist (location gist_geo_point_ops);
+CREATE INDEX bench_boxes_gist_idx ON bench_boxes USING gist (geom gist_gbox_ops);
+CREATE INDEX bench_polygons_gist_idx ON bench_polygons USING gist (geom gist_geo_polygon_ops);
+\else
+\warn 'keys must be double or float4'
+\quit
+\endif
+
+ANALYZE bench_points, bench_boxes, bench_polygons;
+
+\pset format unaligned
+\pset fieldsep ','
+\pset tuples_only on
+
+SELECT :'keys', c.relname, pg_relation_size(c.oid)
+  FROM pg_class AS c
+ WHERE c.relname IN ('bench_points_gist_idx', 'bench_boxes_gist_idx', 'bench_polygons_gist_idx')
+ ORDER BY c.relname;
@@ -0,0 +1,171 @@
+#!/bin/sh
+#
+# Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+#
+# This file is part of pg_geoext, a simple PostgreSQL extension for
+# for teaching spatial database classes.
+#
+# pg_geoext is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License version 3 as
+# published by the Free Software Foundation.
+#
+# pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+# of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with pg_geoext. See LICENSE. If not, write to
+# Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+#
+# Author: Gilberto Ribeiro de Queiroz
+#         Fabiana Zioti
+#
+# Runs the SQL benchmark suite against a temporary local cluster.
+#
+# The extension must already be installed (make install) for the
+# PostgreSQL found in PG_BINDIR. The results go to OUTDIR:
+#   summary.csv      workload, keys, tps and latency percentiles in milliseconds
+#   index_sizes.csv  size in bytes of each GiST index
+#   explain-*.txt    EXPLAIN (ANALYZE, BUFFERS) of each workload
+#   *.log            raw pgbench output and per-transaction logs
+#
+# Settings (environment variables):
+#   PG_BINDIR  directory of initdb, pg_ctl, psql and pgbench (default: pg_config --bindir)
+#   SCALE      data size multiplier (default: 1 = 100k points)
+#   SKEW       fraction of clustered geometries, in [0, 1] (default: 0)
+#   NVERTICES  vertices per linestring and polygon (default: 32)
+#   CLIENTS    pgbench clients (default: 4)
+#   THREADS    pgbench threads (default: CLIENTS)
+#   DURATION   seconds per workload (default: 30)
+#   WORKLOADS  space separated list of workloads (default: all in workloads/)
+#   INDEX_KEYS space separated list of GiST key kinds, each one a run of
+#              all the workloads: double (geo_box) and/or float4 (geo_box4)
+#              (default: double)
+#   OUTDIR     where to write the results (default: ./results-<timestamp>)
+#   PGPORT     port of the temporary cluster (default: 54329)
+#
+
+set -eu
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+
+PG_BINDIR=${PG_BINDIR:-$(pg_config --bindir)}
+SCALE=${SCALE:-1}
+SKEW=${SKEW:-0}
+NVERTICES=${NVERTICES:-32}
+CLIENTS=${CLIENTS:-4}
+THREADS=${THREADS:-$CLIENTS}
+DURATION=${DURATION:-30}
+WORKLOADS=${WORKLOADS:-$(cd "$HERE/workloads" && ls *.sql | sed 's/\.sql$//')}
+INDEX_KEYS=${INDEX_KEYS:-double}
+OUTDIR=${OUTDIR:-$PWD/results-$(date +%Y%m%d-%H%M%S)}
+PGPORT=${PGPORT:-54329}
+
+for k in $INDEX_KEYS
+do
+  case $k in
+    double|float4) ;;
+    *) echo "unknown index keys: $k (double or float4)" >&2; exit 1 ;;
+  esac
+done
+
+NPOINTS=$((100000 * SCALE))
+NBOXES=$((100000 * SCALE))
+NLINES=$((10000 * SCALE))
+NPOLYS=$((10000 * SCALE))
+NOBJECTS=$((1000 * SCALE))
+NTIMES=100
+
+WINDOW=0.5
+RADIUS=0.5
+
+PGDATA=$(mktemp -d "${TMPDIR:-/tmp}/geoext-bench.XXXXXX")
+PGHOST=$PGDATA
+export PGPORT PGHOST
+
+cleanup()
+{
+  "$PG_BINDIR/pg_ctl" -D "$PGDATA" -m immediate stop >/dev/null 2>&1 || true
+  rm -rf "$PGDATA"
+}
+
+trap cleanup EXIT INT TERM
+
+mkdir -p "$OUTDIR"
+
+echo "creating a temporary cluster in $PGDATA"
+
+"$PG_BINDIR/initdb" -D "$PGDATA" -A trust -U postgres >"$OUTDIR/initdb.log" 2>&1
+
+cat >>"$PGDATA/postgresql.conf" <<CONF
+listen_addresses = ''
+unix_socket_directories = '$PGDATA'
+port = $PGPORT
+shared_buffers = 512MB
+max_wal_size = 4GB
+fsync = off
+synchronous_commit = off
+full_page_writes = off
+shared_preload_libraries = 'geoext'
+CONF
+
+"$PG_BINDIR/pg_ctl" -D "$PGDATA" -l "$OUTDIR/server.log" -w start >/dev/null
+
+PSQL="$PG_BINDIR/psql -X -q -v ON_ERROR_STOP=1 -U postgres -d geoext_bench"
+
+"$PG_BINDIR/createdb" -U postgres geoext_bench
+
+$PSQL -c "CREATE EXTENSION geoext"
+
+echo "generating data: scale $SCALE, skew $SKEW"
+
+$PSQL -v npoints=$NPOINTS -v nboxes=$NBOXES -v nlines=$NLINES -v npolys=$NPOLYS \
+      -v nobjects=$NOBJECTS -v nvertices=$NVERTICES -v ntimes=$NTIMES \
+      -v skew=$SKEW -v seed=0.2017 \
+      -f "$HERE/setup.sql"
+
+echo "workload,keys,clients,tps,latency_avg_ms,latency_p50_ms,latency_p95_ms,latency_p99_ms" >"$OUTDIR/summary.csv"
+echo "keys,index,bytes" >"$OUTDIR/index_sizes.csv"
+
+for k in $INDEX_KEYS
+do
+  echo "building the GiST indexes with $k keys"
+
+  $PSQL -v keys=$k -f "$HERE/indexes.sql" >>"$OUTDIR/index_sizes.csv"
+
+  for w in $WORKLOADS
+  do
+    echo "running $w ($k keys)"
+
+    rm -f "$OUTDIR/$w-$k".txn*
+
+    "$PG_BINDIR/pgbench" -n -U postgres -c "$CLIENTS" -j "$THREADS" -T "$DURATION" \
+                         -D npoints=$NPOINTS -D nobjects=$NOBJECTS \
+                         -D window=$WINDOW -D radius=$RADIUS \
+                         -l --log-prefix="$OUTDIR/$w-$k.txn" \
+                         -f "$HERE/workloads/$w.sql" geoext_bench >"$OUTDIR/$w-$k.log" 2>&1
+
+    tps=$(sed -n 's/^tps = \([0-9.]*\).*/\1/p' "$OUTDIR/$w-$k.log" | tail -1)
+
+# the third field of the per-transaction log is the latency in microseconds
+    cat "$OUTDIR/$w-$k".txn* | awk '{ print $3 }' | sort -n | awk -v w="$w" -v k="$k" -v c="$CLIENTS" -v tps="$tps" '
+      { lat[NR] = $1; sum += $1 }
+      END {
+        if (NR == 0) { printf "%s,%s,%s,%s,,,,\n", w, k, c, tps; exit }
+        p50 = lat[int(NR * 0.50 + 0.5) > 0 ? int(NR * 0.50 + 0.5) : 1]
+        p95 = lat[int(NR * 0.95 + 0.5) > 0 ? int(NR * 0.95 + 0.5) : 1]
+        p99 = lat[int(NR * 0.99 + 0.5) > 0 ? int(NR * 0.99 + 0.5) : 1]
+        printf "%s,%s,%s,%s,%.3f,%.3f,%.3f,%.3f\n", w, k, c, tps, sum / NR / 1000, p50 / 1000, p95 / 1000, p99 / 1000
+      }' >>"$OUTDIR/summary.csv"
+  done
+
+  $PSQL -v id=1 -v obj=1 -v window=$WINDOW -v radius=$RADIUS \
+        -f "$HERE/explain.sql" >"$OUTDIR/explain-$k.txt" 2>&1
+done
+
+column -s, -t "$OUTDIR/index_sizes.csv" 2>/dev/null || cat "$OUTDIR/index_sizes.csv"
+
+column -s, -t "$OUTDIR/summary.csv" 2>/dev/null || cat "$OUTDIR/summary.csv"
+
+echo "results in $OUTDIR"
@@ -0,0 +1,145 @@
+--
+-- Data generators for the pg_geoext benchmark suite.
+--
+-- Variables (psql -v name=value):
+--   npoints   number of points                 (bench_points)
+--   nboxes    number of boxes                  (bench_boxes)
+--   nlines    number of linestrings            (bench_lines)
+--   npolys    number of polygons               (bench_polygons)
+--   nobjects  number of moving objects         (bench_trajectories)
+--   nvertices vertices of each linestring and polygon
+--   ntimes    positions of each moving object
+--   skew      fraction of the geometries placed in 16 gaussian clusters
+--             (0 = uniform over the globe, 1 = fully clustered)
+--   seed      seed of random(), in [-1, 1]
+--
+-- All the generators are plain generate_series queries: the coordinates
+-- are drawn in SQL and the geometries are built from their WKT.
+--
+
+SELECT setseed(:seed);
+
+DROP TABLE IF EXISTS bench_points, bench_boxes, bench_lines, bench_polygons, bench_trajectories;
+
+
+--
+-- Position of the i-th geometry: with probability skew it falls around
+-- the center of cluster (i % 16) with a standard deviation of 2 degrees
+-- (Box-Muller), otherwise it is uniform over [-180, 180] x [-90, 90].
+--
+CREATE OR REPLACE FUNCTION pg_temp.bench_x(i int8, u float8, u1 float8, u2 float8, u3 float8, skew float8)
+RETURNS float8
+AS $$
+  SELECT CASE WHEN u < skew
+              THEN greatest(-180.0, least(180.0, -165.0 + 22.0 * (i % 16) + 2.0 * sqrt(-2.0 * ln(1.0 - u1)) * cos(2.0 * pi() * u2)))
+              ELSE 360.0 * u3 - 180.0
+         END
+$$ LANGUAGE sql IMMUTABLE;
+
+CREATE OR REPLACE FUNCTION pg_temp.bench_y(i int8, u float8, u1 float8, u2 float8, u3 float8, skew float8)
+RETURNS float8
+AS $$
+  SELECT CASE WHEN u < skew
+              THEN greatest(-90.0, least(90.0, -60.0 + 8.0 * (i % 16) + 2.0 * sqrt(-2.0 * ln(1.0 - u1)) * sin(2.0 * pi() * u2)))
+              ELSE 180.0 * u3 - 90.0
+         END
+$$ LANGUAGE sql IMMUTABLE;
+
+
+--
+-- Points
+--
+CREATE TABLE bench_points AS
+SELECT i AS id,
+       point_from_text(format('POINT(%s %s)', x, y)::cstring) AS location
+  FROM (SELECT i,
+               pg_temp.bench_x(i, u, u1, u2, ux, :skew) AS x,
+               pg_temp.bench_y(i, u, u1, u2, uy, :skew) AS y
+          FROM (SELECT i, random() AS u, random() AS u1, random() AS u2, random() AS ux, random() AS uy
+                  FROM generate_series(1, :npoints) AS i) AS r) AS c;
+
+
+--
+-- Boxes: 0.01 to 1 degree wide and high
+--
+CREATE TABLE bench_boxes AS
+SELECT i AS id,
+       box_from_text(format('BOX(%s %s, %s %s)', x + w, y + h, x, y)::cstring) AS geom
+  FROM (SELECT i,
+               pg_temp.bench_x(i, u, u1, u2, ux, :skew) AS x,
+               pg_temp.bench_y(i, u, u1, u2, uy, :skew) AS y,
+               0.01 + 0.99 * random() AS w,
+               0.01 + 0.99 * random() AS h
+          FROM (SELECT i, random() AS u, random() AS u1, random() AS u2, random() AS ux, random() AS uy
+                  FROM generate_series(1, :nboxes) AS i) AS r) AS c;
+
+
+--
+-- Linestrings: random walks with steps of up to 0.01 degree
+--
+CREATE TABLE bench_lines AS
+SELECT c.i AS id,
+       linestring_from_text(format('LINESTRING(%s)', v.coords)::cstring) AS geom
+  FROM (SELECT i,
+               pg_temp.bench_x(i, u, u1, u2, ux, :skew) AS x,
+               pg_temp.bench_y(i, u, u1, u2, uy, :skew) AS y
+          FROM (SELECT i, random() AS u, random() AS u1, random() AS u2, random() AS ux, random() AS uy
+                  FROM generate_series(1, :nlines) AS i) AS r) AS c,
+       LATERAL (SELECT string_agg(format('%s %s', c.x + dx, c.y + dy), ', ' ORDER BY k) AS coords
+                  FROM (SELECT k,
+                               sum(0.02 * random() - 0.01) OVER (ORDER BY k) AS dx,
+                               sum(0.02 * random() - 0.01) OVER (ORDER BY k) AS dy
+                          FROM generate_series(1, :nvertices) AS k
+                         WHERE c.i IS NOT NULL) AS w) AS v;
+
+
+--
+-- Polygons: star-shaped rings of radius 0.05 to 0.5 degree
+--
+CREATE TABLE bench_polygons AS
+SELECT c.i AS id,
+       polygon_from_text(format('POLYGON((%s, %s))', v.ring, v.first)::cstring) AS geom
+  FROM (SELECT i,
+               pg_temp.bench_x(i, u, u1, u2, ux, :skew) AS x,
+               pg_temp.bench_y(i, u, u1, u2, uy, :skew) AS y,
+               0.05 + 0.45 * random() AS radius
+          FROM (SELECT i, random() AS u, random() AS u1, random() AS u2, random() AS ux, random() AS uy
+                  FROM generate_series(1, :npolys) AS i) AS r) AS c,
+       LATERAL (SELECT string_agg(xy, ', ' ORDER BY k) AS ring,
+                       (array_agg(xy ORDER BY k))[1] AS first
+                  FROM (SELECT k,
+                               format('%s %s',
+                                      c.x + c.radius * (0.5 + 0.5 * random()) * cos(2.0 * pi() * k / (:nvertices - 1)),
+                                      c.y + c.radius * (0.5 + 0.5 * random()) * sin(2.0 * pi() * k / (:nvertices - 1))) AS xy
+                          FROM generate_series(0, :nvertices - 2) AS k) AS w) AS v;
+
+
+--
+-- Trajectories: one position per minute along a random walk
+--
+CREATE TABLE bench_trajectories AS
+SELECT c.i AS obj_id,
+       timestamp '2017-01-01 00:00:00' + w.k * interval '1 minute' AS t,
+       point_from_text(format('POINT(%s %s)', c.x + w.dx, c.y + w.dy)::cstring) AS location
+  FROM (SELECT i,
+               pg_temp.bench_x(i, u, u1, u2, ux, :skew) AS x,
+               pg_temp.bench_y(i, u, u1, u2, uy, :skew) AS y
+          FROM (SELECT i, random() AS u, random() AS u1, random() AS u2, random() AS ux, random() AS uy
+                  FROM generate_series(1, :nobjects) AS i) AS r) AS c,
+       LATERAL (SELECT k,
+                       sum(0.002 * random() - 0.001) OVER (ORDER BY k) AS dx,
+                       sum(0.002 * random() - 0.001) OVER (ORDER BY k) AS dy
+                  FROM generate_series(1, :ntimes) AS k
+                 WHERE c.i IS NOT NULL) AS w;
+
+
+--
+-- Indexes and statistics (the GiST indexes are built by indexes.sql)
+--
+ALTER TABLE bench_points ADD PRIMARY KEY (id);
+ALTER TABLE bench_polygons ADD PRIMARY KEY (id);
+
+CREATE INDEX bench_points_btree_idx ON bench_points USING btree (location btree_geo_point_ops);
+CREATE INDEX bench_trajectories_obj_idx ON bench_trajectories (obj_id);
+
+VACUUM ANALYZE bench_points, bench_boxes, bench_lines, bench_polygons, bench_trajectories;
@@ -0,0 +1,5 @@
+-- Polygons containing an existing point (GiST on geo_polygon + exact test).
+\set id random(1, :npoints)
+SELECT g.id
+  FROM bench_polygons AS g
+ WHERE contains(g.geom, (SELECT location FROM bench_points WHERE id = :id));
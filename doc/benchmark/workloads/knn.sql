@@ -0,0 +1,10 @@
+-- The 10 nearest points within a radius: there is no distance operator
+-- for index ordering yet, so the candidates come from dwithin() and are
+-- sorted by distance().
+\set id random(1, :npoints)
+SELECT p.id
+  FROM bench_points AS p,
+       (SELECT location FROM bench_points WHERE id = :id) AS q
+ WHERE dwithin(p.location, q.location, :radius)
+ ORDER BY distance(p.location, q.location)
+ LIMIT 10;
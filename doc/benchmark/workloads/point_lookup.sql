@@ -0,0 +1,5 @@
+-- Exact match of a point through the B-tree opclass.
+\set id random(1, :npoints)
+SELECT p.id
+  FROM bench_points AS p
+ WHERE p.location = (SELECT location FROM bench_points WHERE id = :id);
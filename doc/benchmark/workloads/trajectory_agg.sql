@@ -0,0 +1,5 @@
+-- Builds the trajectory of one moving object.
+\set obj random(1, :nobjects)
+SELECT array_trajectory_agg(t, location)
+  FROM bench_trajectories
+ WHERE obj_id = :obj;
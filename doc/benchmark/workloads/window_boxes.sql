@@ -0,0 +1,5 @@
+-- Boxes overlapping a window centered at an existing point (GiST on geo_box).
+\set id random(1, :npoints)
+SELECT count(*)
+  FROM bench_boxes AS b
+ WHERE b.geom && (SELECT expand(location, :window) FROM bench_points WHERE id = :id);
@@ -0,0 +1,5 @@
+-- Points inside a window centered at an existing point (GiST on geo_point).
+\set id random(1, :npoints)
+SELECT count(*)
+  FROM bench_points AS p
+ WHERE p.location && (SELECT expand(location, :window) FROM bench_points WHERE id = :id);
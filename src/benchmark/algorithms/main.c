@@ -0,0 +1,503 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file benchmark/algorithms/main.c
+ *
+ * \brief Micro-benchmarks for GeoExt algorithms.
+ *
+ * Usage: bench_algorithms [csv|json] [max_vertices] [min_time_ms]
+ *
+ * Each line of the output reports one kernel run over one shape: the
+ * number of vertices (or bytes), the number of timed calls, the mean
+ * time per call in nanoseconds and the throughput in items (vertices,
+ * segment pairs or bytes) per second.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+/* GeoExt */
+#include <geoext/algorithms.h>
+#include <geoext/hexutils.h>
+
+/* C Standard Library */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define BENCH_PI 3.14159265358979323846
+
+#define BENCH_DEFAULT_MAX_VERTICES 1000000
+
+#define BENCH_DEFAULT_MIN_TIME_MS 100
+
+
+enum output_format
+{
+  OUTPUT_CSV,
+  OUTPUT_JSON
+};
+
+
+/*
+ * The result of a benchmark run.
+ */
+struct bench_result
+{
+  const char *kernel;   /* The function being measured.                  */
+  const char *shape;    /* The kind of input.                            */
+  const char *unit;     /* What is counted in the throughput.            */
+  long n;               /* Input size: number of vertices or bytes.      */
+  long items;           /* Number of items processed by a single call.   */
+  long calls;           /* Number of timed calls.                        */
+  double ns_per_op;     /* Mean time of a call.                          */
+  double items_per_sec; /* Throughput.                                   */
+};
+
+
+/*
+ * A benchmark body: performs one call and returns a value that depends on
+ * its result, so the compiler cannot drop the work.
+ */
+typedef double (*bench_fn)(void *arg);
+
+
+static enum output_format output_format = OUTPUT_CSV;
+
+static double min_time_ns = BENCH_DEFAULT_MIN_TIME_MS * 1.0e6;
+
+static int num_results = 0;
+
+static volatile double sink = 0.0;
+
+
+static double now_ns(void);
+
+static double uniform(double lo, double hi);
+
+static void run_bench(const char *kernel, const char *shape, const char *unit,
+                      long n, long items, bench_fn fn, void *arg);
+
+static void print_result(const struct bench_result *r);
+
+static void make_star_polygon(struct coord2d *coords, int n);
+
+static void make_comb_polygon(struct coord2d *coords, int n);
+
+static void bench_polygon_kernels(const char *shape, struct coord2d *coords, int n,
+                                  struct coord2d *probe);
+
+static void bench_intersection(long npairs);
+
+static void bench_hex(long nbytes);
+
+
+/*
+ * Arguments of the benchmark bodies.
+ */
+struct coords_arg
+{
+  struct coord2d *coords;
+  int n;
+  struct coord2d *pt;
+};
+
+struct segments_arg
+{
+  struct coord2d *segs;   /* Four coordinates per pair: p1, p2, q1, q2. */
+  long npairs;
+};
+
+struct hex_arg
+{
+  char *bytes;
+  char *hex;
+  long nbytes;
+};
+
+
+static double body_length(void *arg)
+{
+  struct coords_arg *a = (struct coords_arg*) arg;
+
+  return length(a->coords, a->n);
+}
+
+
+static double body_area(void *arg)
+{
+  struct coords_arg *a = (struct coords_arg*) arg;
+
+  return area(a->coords, a->n);
+}
+
+
+static double body_point_in_polygon(void *arg)
+{
+  struct coords_arg *a = (struct coords_arg*) arg;
+
+  return point_in_polygon(a->pt, a->coords, a->n);
+}
+
+
+static double body_intersection(void *arg)
+{
+  struct segments_arg *a = (struct segments_arg*) arg;
+
+  struct coord2d ip1, ip2;
+
+  double count = 0.0;
+
+  for(long i = 0; i < a->npairs; ++i)
+  {
+    struct coord2d *s = a->segs + 4 * i;
+
+    count += compute_intersection(s, s + 1, s + 2, s + 3, &ip1, &ip2);
+  }
+
+  return count;
+}
+
+
+static double body_binary2hex(void *arg)
+{
+  struct hex_arg *a = (struct hex_arg*) arg;
+
+  binary2hex(a->bytes, (int) a->nbytes, a->hex);
+
+  return a->hex[a->nbytes];
+}
+
+
+static double body_hex2binary(void *arg)
+{
+  struct hex_arg *a = (struct hex_arg*) arg;
+
+  hex2binary(a->hex, (int) (2 * a->nbytes), a->bytes);
+
+  return a->bytes[a->nbytes / 2];
+}
+
+
+int main(int argc, char *argv[])
+{
+  long max_vertices = BENCH_DEFAULT_MAX_VERTICES;
+
+  static const long sizes[] = { 4, 16, 64, 256, 1024, 4096, 16384, 65536, 262144, 1000000 };
+
+  const int nsizes = sizeof(sizes) / sizeof(long);
+
+  if(argc > 1)
+  {
+    if(strcmp(argv[1], "json") == 0)
+      output_format = OUTPUT_JSON;
+    else if(strcmp(argv[1], "csv") != 0)
+    {
+      fprintf(stderr, "usage: %s [csv|json] [max_vertices] [min_time_ms]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if(argc > 2)
+    max_vertices = atol(argv[2]);
+
+  if(argc > 3)
+    min_time_ns = atof(argv[3]) * 1.0e6;
+
+/* a fixed seed makes the inputs the same from run to run */
+  srand(2017);
+
+  if(output_format == OUTPUT_CSV)
+    printf("kernel,shape,n,calls,ns_per_op,items_per_sec,unit\n");
+  else
+    printf("[\n");
+
+  for(int i = 0; i < nsizes && sizes[i] <= max_vertices; ++i)
+  {
+    int n = (int) sizes[i];
+
+    struct coord2d *coords = (struct coord2d*) malloc(n * sizeof(struct coord2d));
+
+    struct coord2d center = { 0.0, 0.0 };
+
+    struct coord2d tooth = { 0.5, 1.0 };
+
+    if(coords == NULL)
+    {
+      fprintf(stderr, "out of memory\n");
+      return EXIT_FAILURE;
+    }
+
+/* random: a simple star-shaped polygon, the probe is near its center */
+    make_star_polygon(coords, n);
+
+    bench_polygon_kernels("random", coords, n, &center);
+
+/* adversarial: every edge crosses the horizontal ray of the probe */
+    make_comb_polygon(coords, n);
+
+    bench_polygon_kernels("comb", coords, n, &tooth);
+
+    free(coords);
+
+    bench_intersection(sizes[i]);
+
+    bench_hex(sizes[i] * (long) sizeof(struct coord2d));
+  }
+
+  if(output_format == OUTPUT_JSON)
+    printf("\n]\n");
+
+  return (sink == 42.4242) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1.0e9 + ts.tv_nsec;
+}
+
+
+static double uniform(double lo, double hi)
+{
+  return lo + (hi - lo) * ((double) rand() / RAND_MAX);
+}
+
+
+/*
+  Calls fn in batches of growing size until a batch lasts at least
+  min_time_ns, then reports the mean of that batch.
+ */
+static void run_bench(const char *kernel, const char *shape, const char *unit,
+                      long n, long items, bench_fn fn, void *arg)
+{
+  struct bench_result r;
+
+  long calls = 1;
+
+  double elapsed;
+
+/* warm-up */
+  sink += fn(arg);
+
+  for(;;)
+  {
+    double start = now_ns();
+
+    for(long i = 0; i < calls; ++i)
+      sink += fn(arg);
+
+    elapsed = now_ns() - start;
+
+    if(elapsed >= min_time_ns || calls >= (1L << 30))
+      break;
+
+    calls *= 2;
+  }
+
+  r.kernel = kernel;
+  r.shape = shape;
+  r.unit = unit;
+  r.n = n;
+  r.items = items;
+  r.calls = calls;
+  r.ns_per_op = elapsed / calls;
+  r.items_per_sec = (elapsed > 0.0) ? (1.0e9 * items * calls) / elapsed : 0.0;
+
+  print_result(&r);
+}
+
+
+static void print_result(const struct bench_result *r)
+{
+  if(output_format == OUTPUT_CSV)
+  {
+    printf("%s,%s,%ld,%ld,%.2f,%.6e,%s\n",
+           r->kernel, r->shape, r->n, r->calls, r->ns_per_op, r->items_per_sec, r->unit);
+  }
+  else
+  {
+    printf("%s  {\"kernel\": \"%s\", \"shape\": \"%s\", \"n\": %ld, \"calls\": %ld, "
+           "\"ns_per_op\": %.2f, \"items_per_sec\": %.6e, \"unit\": \"%s\"}",
+           (num_results == 0) ? "" : ",\n",
+           r->kernel, r->shape, r->n, r->calls, r->ns_per_op, r->items_per_sec, r->unit);
+  }
+
+  fflush(stdout);
+
+  ++num_results;
+}
+
+
+/*
+  Random radii at increasing angles around the origin: a simple polygon
+  with n vertices, the last one repeating the first.
+ */
+static void make_star_polygon(struct coord2d *coords, int n)
+{
+  const int m = n - 1;
+
+  for(int i = 0; i < m; ++i)
+  {
+    double angle = (2.0 * BENCH_PI * i) / m;
+
+    double radius = uniform(50.0, 100.0);
+
+    coords[i].x = radius * cos(angle);
+    coords[i].y = radius * sin(angle);
+  }
+
+  coords[m] = coords[0];
+}
+
+
+/*
+  A comb whose teeth go from y = 0 to y = 2: a probe at y = 1 has all
+  the tooth edges straddling its ray, which is the worst case of the
+  crossing test.
+ */
+static void make_comb_polygon(struct coord2d *coords, int n)
+{
+  const int m = n - 1;
+
+  for(int i = 0; i < m - 2; ++i)
+  {
+    coords[i].x = (double) i;
+    coords[i].y = (i % 2 == 0) ? 0.0 : 2.0;
+  }
+
+/* close the comb with a base below the teeth */
+  coords[m - 2].x = (double) (m - 3);
+  coords[m - 2].y = -1.0;
+
+  coords[m - 1].x = 0.0;
+  coords[m - 1].y = -1.0;
+
+  coords[m] = coords[0];
+}
+
+
+static void bench_polygon_kernels(const char *shape, struct coord2d *coords, int n,
+                                  struct coord2d *probe)
+{
+  struct coords_arg arg = { coords, n, probe };
+
+  run_bench("length", shape, "vertices", n, n, body_length, &arg);
+
+  run_bench("area", shape, "vertices", n, n, body_area, &arg);
+
+  run_bench("point_in_polygon", shape, "vertices", n, n, body_point_in_polygon, &arg);
+}
+
+
+static void bench_intersection(long npairs)
+{
+  struct segments_arg arg;
+
+  arg.npairs = npairs;
+  arg.segs = (struct coord2d*) malloc(4 * npairs * sizeof(struct coord2d));
+
+  if(arg.segs == NULL)
+    return;
+
+/* random: short segments in a large square, mostly disjoint */
+  for(long i = 0; i < 4 * npairs; i += 2)
+  {
+    arg.segs[i].x = uniform(0.0, 1000.0);
+    arg.segs[i].y = uniform(0.0, 1000.0);
+    arg.segs[i + 1].x = arg.segs[i].x + uniform(-10.0, 10.0);
+    arg.segs[i + 1].y = arg.segs[i].y + uniform(-10.0, 10.0);
+  }
+
+  run_bench("compute_intersection", "random", "pairs", npairs, npairs, body_intersection, &arg);
+
+/* adversarial: the two diagonals of a random box, always crossing */
+  for(long i = 0; i < npairs; ++i)
+  {
+    struct coord2d *s = arg.segs + 4 * i;
+
+    double x0 = uniform(0.0, 1000.0), y0 = uniform(0.0, 1000.0);
+    double x1 = x0 + uniform(1.0, 10.0), y1 = y0 + uniform(1.0, 10.0);
+
+    s[0].x = x0; s[0].y = y0;
+    s[1].x = x1; s[1].y = y1;
+    s[2].x = x1; s[2].y = y0;
+    s[3].x = x0; s[3].y = y1;
+  }
+
+  run_bench("compute_intersection", "crossing", "pairs", npairs, npairs, body_intersection, &arg);
+
+/* adversarial: collinear overlapping segments */
+  for(long i = 0; i < npairs; ++i)
+  {
+    struct coord2d *s = arg.segs + 4 * i;
+
+    double x0 = uniform(0.0, 1000.0), y0 = uniform(0.0, 1000.0);
+
+    s[0].x = x0;       s[0].y = y0;
+    s[1].x = x0 + 2.0; s[1].y = y0 + 2.0;
+    s[2].x = x0 + 1.0; s[2].y = y0 + 1.0;
+    s[3].x = x0 + 3.0; s[3].y = y0 + 3.0;
+  }
+
+  run_bench("compute_intersection", "collinear", "pairs", npairs, npairs, body_intersection, &arg);
+
+  free(arg.segs);
+}
+
+
+static void bench_hex(long nbytes)
+{
+  struct hex_arg arg;
+
+  arg.nbytes = nbytes;
+  arg.bytes = (char*) malloc(nbytes);
+  arg.hex = (char*) malloc(2 * nbytes + 1);
+
+  if(arg.bytes && arg.hex)
+  {
+    for(long i = 0; i < nbytes; ++i)
+      arg.bytes[i] = (char) rand();
+
+    run_bench("binary2hex", "random", "bytes", nbytes, nbytes, body_binary2hex, &arg);
+
+    run_bench("hex2binary", "random", "bytes", nbytes, nbytes, body_hex2binary, &arg);
+  }
+
+  free(arg.bytes);
+  free(arg.hex);
+}
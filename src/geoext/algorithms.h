@@ -45,6 +45,11 @@
 #include "decls.h"
 
 
+/* C Standard Library */
+#include <stddef.h>
+#include <stdint.h>
+
+
 /*
  * \brief Tells if c1 and c2 are coincident.
  *
@@ -61,6 +66,177 @@ int equals(struct coord2d* c1, struct coord2d* c2);
 double euclidian_distance(struct coord2d* c1, struct coord2d* c2);
 
 
+/*
+ * Geodesic distances: the coordinates are longitude (x) and latitude (y)
+ * in degrees, and the results are in the units of the radius or axis.
+ *
+ */
+
+/* The mean radius of the Earth in meters (IUGG) */
+#define GEO_EARTH_MEAN_RADIUS 6371008.8
+
+/* The WGS84 ellipsoid */
+#define GEO_WGS84_A 6378137.0
+#define GEO_WGS84_F (1.0 / 298.257223563)
+
+
+/*
+ * \brief Computes the great-circle distance between two points on a sphere
+ *        with the haversine formula.
+ *
+ */
+double haversine_distance(const struct coord2d *c1, const struct coord2d *c2, double radius);
+
+
+/*
+ * \brief Computes the haversine distances from one point to many.
+ *
+ * The point i is at pts + i * stride bytes, so the coordinates can be read
+ * in place from an array of larger structs. The terms of the origin are
+ * computed once and the loop has no branches.
+ *
+ */
+void haversine_distances(const struct coord2d *origin,
+                         const void *pts, size_t stride, int npts,
+                         double radius, double *dist);
+
+
+/*
+ * \brief Computes the length of a line on a sphere.
+ *
+ */
+double haversine_length(const struct coord2d *c, int num_vertices, double radius);
+
+
+/*
+ * \brief Computes the geodesic distance between two points on an ellipsoid
+ *        with the method of Karney (2013).
+ *
+ * \param a The semi-major axis.
+ * \param f The flattening.
+ *
+ * \note Unlike the Vincenty inverse formula it converges for every pair of
+ *       points, the nearly antipodal ones included, and it is accurate to a
+ *       few nanometres on the WGS84 ellipsoid.
+ *
+ */
+double geodesic_distance(const struct coord2d *c1, const struct coord2d *c2, double a, double f);
+
+
+/*
+ * Map projections of the WGS84 longitude and latitude (SRID 4326):
+ *
+ *  - 3857: Web Mercator (spherical, latitudes clamped to +/-85.0511).
+ *  - 32601 to 32660 and 32701 to 32760: UTM zones, north and south.
+ *  - 4087: World Equidistant Cylindrical (equirectangular on the ellipsoid).
+ *
+ * The transverse Mercator uses the Krueger series to n^4, accurate to a
+ * few millimeters within the zones.
+ *
+ */
+enum geo_projection_kind
+{
+  GEO_PROJECTION_LONLAT,
+  GEO_PROJECTION_WEB_MERCATOR,
+  GEO_PROJECTION_TRANSVERSE_MERCATOR,
+  GEO_PROJECTION_EQUIDISTANT_CYLINDRICAL
+};
+
+struct geo_projection
+{
+  int srid;
+  enum geo_projection_kind kind;
+  double a;                /* Semi-major axis.                        */
+  double lon0;             /* Central meridian in radians.            */
+  double k0;               /* Scale factor on the central meridian.   */
+  double false_easting;
+  double false_northing;
+  double n;                /* Third flattening.                       */
+  double A;                /* Radius of the rectifying sphere.        */
+  double alpha[4];         /* Krueger series: forward.                */
+  double beta[4];          /* Krueger series: inverse.                */
+  double delta[4];         /* Conformal to geodetic latitude.         */
+  double mu[4];            /* Geodetic to rectifying latitude.        */
+  double phi[4];           /* Rectifying to geodetic latitude.        */
+};
+
+
+/*
+ * \brief Computes the parameters of the projection of an SRID.
+ *
+ * \return 0 if the SRID is not supported.
+ *
+ */
+int geo_projection_init(struct geo_projection *proj, int srid);
+
+
+/*
+ * \brief Projects longitude and latitude degrees, in place.
+ *
+ */
+void geo_projection_forward(const struct geo_projection *proj, struct coord2d *coords, int npts);
+
+
+/*
+ * \brief Converts projected coordinates back to longitude and latitude degrees, in place.
+ *
+ */
+void geo_projection_inverse(const struct geo_projection *proj, struct coord2d *coords, int npts);
+
+
+/*
+ * \brief Computes the convex hull of a set of points with Andrew's
+ *        monotone chain algorithm, in O(n log n).
+ *
+ * \param pts  The points. They are sorted and deduplicated in place.
+ * \param npts The number of points.
+ * \param hull The output, with room for npts + 1 points: the hull vertices
+ *             in counterclockwise order, without collinear points and
+ *             without repeating the first one.
+ *
+ * \return The number of hull vertices: less than 3 if all the points are
+ *         collinear.
+ *
+ */
+int convex_hull(struct coord2d *pts, int npts, struct coord2d *hull);
+
+
+/*
+ * \brief Computes the convex hull of a simple polygon with Melkman's
+ *        algorithm, in O(n).
+ *
+ * \param ring The closed ring of a simple polygon (the last vertex is the
+ *             first one). If it self-intersects the result may miss hull
+ *             vertices: use it only for rings known to be simple.
+ * \param npts The number of vertices of the ring, including the last one.
+ * \param hull The output, with room for 2 * npts points (the deque of the
+ *             algorithm): the hull vertices in counterclockwise order, as
+ *             in convex_hull.
+ *
+ * \return The number of hull vertices: less than 3 if all the vertices
+ *         are collinear.
+ *
+ */
+int convex_hull_simple_ring(const struct coord2d *ring, int npts, struct coord2d *hull);
+
+
+/*
+ * \brief Computes the minimum-area rectangle that encloses a convex
+ *        polygon with the rotating calipers, in O(n).
+ *
+ * One side of the rectangle is collinear with an edge of the polygon.
+ *
+ * \param hull  The vertices of a convex polygon in counterclockwise order,
+ *              without repeating the first one, as computed by convex_hull.
+ * \param nhull The number of vertices; at least 3.
+ * \param rect  The output: the corners in counterclockwise order.
+ *
+ * \return The area of the rectangle.
+ *
+ */
+double min_area_rect(const struct coord2d *hull, int nhull, struct coord2d *rect);
+
+
 /*
  * \brief Computes the length of a linestring defined by the given vertices.
  *
@@ -88,6 +264,37 @@ double perimeter(struct coord2d *coord, int num_vertices);
 double area(struct coord2d *coord, int num_vertices);
 
 
+/*
+ * \brief Computes the minimum bounding rectangle of the given vertices.
+ *
+ * \param coord        The array of vertices.
+ * \param num_vertices The number of vertices in the array.
+ * \param ll           The lower-left corner of the rectangle.
+ * \param ur           The upper-right corner of the rectangle.
+ *
+ * \pre num_vertices must be at least one.
+ *
+ */
+void mbr(struct coord2d *coord, int num_vertices,
+         struct coord2d *ll, struct coord2d *ur);
+
+
+/*
+ * \brief Computes the distance between a line segment and a rectangle.
+ *
+ * \param a    The first end point of the segment.
+ * \param b    The second end point; it may be equal to a.
+ * \param low  The lower-left corner of the rectangle.
+ * \param high The upper-right corner of the rectangle.
+ *
+ * \return Zero if the segment crosses or touches the rectangle, otherwise
+ *         the shortest euclidean distance between them.
+ *
+ */
+double segment_box_distance(const struct coord2d *a, const struct coord2d *b,
+                            const struct coord2d *low, const struct coord2d *high);
+
+
 /*
  * \brief Tells if a point is inside a polygon.
  *
@@ -106,6 +313,27 @@ int point_in_polygon(struct coord2d* pt,
                      int num_vertices);
 
 
+/*
+ * \brief Tells which of a batch of points are inside a polygon.
+ *
+ * Each edge of the polygon is visited once and only tested against the
+ * points whose +X ray it may cross, found by binary search, so a batch of
+ * k points costs O(n log k) plus the crossings instead of O(n k). The tests
+ * are the ones of point_in_polygon, so the results agree for finite
+ * coordinates.
+ *
+ * \param pts          The points, sorted by y, without NaN coordinates.
+ * \param npts         The number of points.
+ * \param poly         The vertices of the polygon ring.
+ * \param num_vertices The number of vertices, at least 4.
+ * \param inside       The output: 1 for each point inside, 0 otherwise.
+ *
+ */
+void points_in_polygon(const struct coord2d *pts, int npts,
+                       const struct coord2d *poly, int num_vertices,
+                       unsigned char *inside);
+
+
 /*
  * \brief Computes the intersection point(s) between two line segments.
  *
@@ -131,4 +359,227 @@ compute_intersection(struct coord2d* p1, struct coord2d* p2,
                      struct coord2d* q1, struct coord2d* q2,
                      struct coord2d* ip1, struct coord2d* ip2);
 
+
+/*
+ * \brief Computes the position of a cell along a Hilbert curve.
+ *
+ * The curve fills a grid of 2^order x 2^order cells. The position of a cell
+ * at a given order is the position, shifted right by two bits, of any of
+ * its four children at the next order.
+ *
+ * \param order The order of the curve, at most 31.
+ * \param x     The column of the cell, in [0, 2^order).
+ * \param y     The row of the cell, in [0, 2^order).
+ *
+ * \note Based on the iterative algorithm of the Wikipedia article "Hilbert curve".
+ *
+ */
+uint64_t hilbert_xy2d(int order, uint32_t x, uint32_t y);
+
+
+/*
+ * \brief Computes the cell at a given position of a Hilbert curve.
+ *
+ * It is the inverse of hilbert_xy2d.
+ *
+ */
+void hilbert_d2xy(int order, uint64_t d, uint32_t *x, uint32_t *y);
+
+
+/*
+ * \brief Encodes a longitude/latitude pair as a geohash.
+ *
+ * \param lon       The longitude, in [-180, 180].
+ * \param lat       The latitude, in [-90, 90].
+ * \param precision The number of characters of the hash, from 1 to GEOHASH_MAX_PRECISION.
+ * \param hash      The output, with room for precision + 1 characters.
+ *
+ */
+void geohash_encode(double lon, double lat, int precision, char *hash);
+
+#define GEOHASH_MAX_PRECISION 12
+
+
+/*
+ * \brief Rounds a double to the largest float not greater than it.
+ *
+ * Together with float4_round_up it gives a float box that contains the
+ * double one: a compact but conservative key.
+ *
+ */
+float float4_round_down(double v);
+
+
+/*
+ * \brief Rounds a double to the smallest float not less than it.
+ *
+ */
+float float4_round_up(double v);
+
+
+/*
+ * \brief The cost of inserting a box into an R-tree node, for GiST penalty.
+ *
+ * It follows the R*-tree choose-subtree criteria that can be computed from
+ * the node box alone (the siblings are not visible to a GiST penalty), in
+ * three ranked bands packed into a single float:
+ *
+ *   - the area enlargement, if the area grows;
+ *   - otherwise the margin (half perimeter) enlargement, which still ranks
+ *     degenerate keys such as points and axis-aligned lines;
+ *   - otherwise, when the node already covers the box, the node area, so
+ *     that the tightest node is chosen.
+ *
+ * Any value of a band is greater than all the values of the bands below it.
+ *
+ */
+float box_insert_penalty(const struct coord2d *orig_low, const struct coord2d *orig_high,
+                         const struct coord2d *new_low, const struct coord2d *new_high);
+
+
+/*
+ * \brief Simplifies a line with the Douglas-Peucker algorithm.
+ *
+ * A vertex is removed when its Euclidean distance to the segment of the
+ * simplified line that replaces it is at most the tolerance, as in the
+ * classic algorithm. The farthest vertex of a range is found on a tree of
+ * the convex hulls of the vertex ranges: the hulls of O(log n) nodes give,
+ * by binary search, the vertices farthest across and past the ends of the
+ * segment, which bound the distance of every vertex of their node. A node
+ * is only opened when that bound is beaten, which needs vertices past an
+ * end of the segment. Without them, it runs in O(n log^2 n) time even when
+ * every split is lopsided, with no assumption on the line (it may cross
+ * itself).
+ *
+ * \param coords       The vertices of the line.
+ * \param num_vertices The number of vertices, at least 2.
+ * \param tolerance    The maximum distance of a removed vertex to its
+ *                     segment of the result.
+ * \param result       The output, with room for num_vertices coordinates.
+ * \param scratch      A buffer of douglas_peucker_scratch_size(num_vertices)
+ *                     bytes (about 4 + log2(num_vertices / 32) ints per
+ *                     vertex), aligned for an int.
+ *
+ * \return The number of vertices written to result. The first and the
+ *         last vertices are always kept.
+ *
+ */
+int douglas_peucker(const struct coord2d *coords, int num_vertices,
+                    double tolerance,
+                    struct coord2d *result, void *scratch);
+
+size_t douglas_peucker_scratch_size(int num_vertices);
+
+
+/*
+ * \brief Simplifies a line or a ring with the Visvalingam-Whyatt algorithm.
+ *
+ * The vertex with the smallest effective area (the area of the triangle
+ * it forms with its neighbours) is removed until all the remaining ones
+ * have an area of at least min_area. A heap keeps the areas, so it runs in
+ * O(n log n).
+ *
+ * When preserve_topology is set, a vertex is kept if removing it would
+ * make the line cross itself, i.e. if any other vertex lies in its
+ * triangle. The vertices are bucketed in a uniform grid for this test.
+ *
+ * \param coords            The vertices of the line or ring.
+ * \param num_vertices      The number of vertices, at least 2 for a line and
+ *                          4 for a ring.
+ * \param min_area          The minimum effective area of a kept vertex.
+ * \param is_ring           Non-zero if coords is a closed ring: the first
+ *                          vertex is then also a candidate for removal and at
+ *                          least three distinct vertices are kept.
+ * \param preserve_topology Non-zero to avoid self-intersections.
+ * \param result            The output, with room for num_vertices coordinates.
+ * \param scratch           A buffer of visvalingam_whyatt_scratch_size(num_vertices)
+ *                          bytes, aligned for a double.
+ *
+ * \return The number of vertices written to result. A ring is closed.
+ *
+ */
+int visvalingam_whyatt(const struct coord2d *coords, int num_vertices,
+                       double min_area, int is_ring, int preserve_topology,
+                       struct coord2d *result, void *scratch);
+
+size_t visvalingam_whyatt_scratch_size(int num_vertices);
+
+/*
+ * \brief A packed (static) R-tree, built bottom-up over Hilbert-sorted boxes.
+ *
+ * The tree lives in two flat arrays, so it can be copied to shared memory
+ * as is: boxes, with a low and a high corner per slot, and indices. The
+ * first num_items slots are the items, sorted by the Hilbert position of
+ * their centres, and indices gives their original number. Each following
+ * level groups node_size consecutive slots of the level below, and indices
+ * gives the position of its first child. The root is the last slot.
+ *
+ */
+#define PACKED_RTREE_MAX_LEVELS 32
+#define PACKED_RTREE_MAX_NODE_SIZE 64
+
+struct packed_rtree
+{
+  int32_t num_items;                          /* Number of indexed boxes.          */
+  int32_t node_size;                          /* Maximum number of children.       */
+  int32_t num_boxes;                          /* Number of slots: items and nodes. */
+  int32_t num_levels;                         /* The items are the level 0.        */
+  int32_t level_end[PACKED_RTREE_MAX_LEVELS]; /* End slot of each level.           */
+};
+
+typedef void (*packed_rtree_visitor)(int32_t item, void *arg);
+
+
+/*
+ * \brief Computes the shape of a tree.
+ *
+ * \param node_size From 2 to PACKED_RTREE_MAX_NODE_SIZE.
+ *
+ * \return The number of slots of the boxes and indices arrays.
+ *
+ */
+int32_t packed_rtree_init(struct packed_rtree *tree, int32_t num_items, int32_t node_size);
+
+size_t packed_rtree_scratch_size(int32_t num_items);
+
+
+/*
+ * \brief Builds a tree initialized by packed_rtree_init.
+ *
+ * \param items   A low and a high corner for each item.
+ * \param boxes   The output, with room for 2 * num_boxes coordinates.
+ * \param indices The output, with room for num_boxes values.
+ * \param scratch A buffer of packed_rtree_scratch_size(num_items) bytes,
+ *                aligned for an uint64_t.
+ *
+ */
+void packed_rtree_build(const struct packed_rtree *tree,
+                        const struct coord2d *items,
+                        struct coord2d *boxes, int32_t *indices,
+                        void *scratch);
+
+
+/*
+ * \brief Calls visit for each item whose box intersects the query box.
+ *
+ */
+void packed_rtree_search(const struct packed_rtree *tree,
+                         const struct coord2d *boxes, const int32_t *indices,
+                         const struct coord2d *qlow, const struct coord2d *qhigh,
+                         packed_rtree_visitor visit, void *arg);
+
+
+/*
+ * \brief Point in polygon test on a ring whose edges are in a packed R-tree.
+ *
+ * Item i of the tree is the edge from ring[i] to ring[i + 1]. Only the
+ * edges that may cross the +X ray from pt are tested, with the same rule
+ * as point_in_polygon, so the results agree.
+ *
+ */
+int packed_point_in_ring(const struct packed_rtree *tree,
+                         const struct coord2d *boxes, const int32_t *indices,
+                         const struct coord2d *ring, const struct coord2d *pt);
+
+
 #endif  /* __GEOEXT_ALGORITHMS_H__ */
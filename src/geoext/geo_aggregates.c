@@ -0,0 +1,668 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_aggregates.c
+ *
+ * \brief Aggregate functions over the geometry types.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExt */
+#include "geo_aggregates.h"
+#include "algorithms.h"
+#include "geo_box.h"
+#include "geo_hull.h"
+#include "geo_linestring.h"
+#include "geo_point.h"
+#include "geo_polygon.h"
+
+
+/* PostgreSQL */
+#include <libpq/pqformat.h>
+
+
+/* C Standard Library */
+#include <math.h>
+#include <string.h>
+
+
+/* The initial number of candidate points of convex_hull_agg */
+#define GEO_HULL_BUFFER_SIZE 4096
+
+
+static MemoryContext
+geo_agg_context(FunctionCallInfo fcinfo, const char *fname)
+{
+  MemoryContext agg_context;
+
+  if (!AggCheckCallContext(fcinfo, &agg_context))
+    elog(ERROR, "%s called in non-aggregate context", fname);
+
+  return agg_context;
+}
+
+
+/*
+ * extent
+ */
+
+static Datum
+geo_extent_add(FunctionCallInfo fcinfo, const struct coord2d *low, const struct coord2d *high)
+{
+  struct geo_box *state;
+
+  geo_agg_context(fcinfo, "extent");
+
+/* the first value: the new state is copied to the aggregate context */
+  if (PG_ARGISNULL(0))
+  {
+    state = (struct geo_box*) palloc(sizeof(struct geo_box));
+
+    state->low = *low;
+    state->high = *high;
+
+    PG_RETURN_GEOBOX_TYPE_P(state);
+  }
+
+  state = PG_GETARG_GEOBOX_TYPE_P(0);
+
+  state->low.x = Min(state->low.x, low->x);
+  state->low.y = Min(state->low.y, low->y);
+  state->high.x = Max(state->high.x, high->x);
+  state->high.y = Max(state->high.y, high->y);
+
+  PG_RETURN_GEOBOX_TYPE_P(state);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_extent_point_transfn);
+
+Datum
+geo_extent_point_transfn(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt;
+
+  if (PG_ARGISNULL(1))
+  {
+    if (PG_ARGISNULL(0))
+      PG_RETURN_NULL();
+
+    PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+  }
+
+  pt = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  return geo_extent_add(fcinfo, &pt->coord, &pt->coord);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_extent_box_transfn);
+
+Datum
+geo_extent_box_transfn(PG_FUNCTION_ARGS)
+{
+  struct geo_box *box;
+
+  if (PG_ARGISNULL(1))
+  {
+    if (PG_ARGISNULL(0))
+      PG_RETURN_NULL();
+
+    PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+  }
+
+  box = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  return geo_extent_add(fcinfo, &box->low, &box->high);
+}
+
+
+/* geo_linestring and geo_polygon share their layout */
+static Datum
+geo_extent_coords_transfn(FunctionCallInfo fcinfo)
+{
+  struct geo_linestring *geom;
+
+  struct coord2d low, high;
+
+  if (PG_ARGISNULL(1))
+  {
+    if (PG_ARGISNULL(0))
+      PG_RETURN_NULL();
+
+    PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+  }
+
+  geom = PG_GETARG_GEOLINESTRING_TYPE_P(1);
+
+  if (geom->npts == 0)
+  {
+    if (PG_ARGISNULL(0))
+      PG_RETURN_NULL();
+
+    PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+  }
+
+  mbr(geom->coords, geom->npts, &low, &high);
+
+  return geo_extent_add(fcinfo, &low, &high);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_extent_linestring_transfn);
+
+Datum
+geo_extent_linestring_transfn(PG_FUNCTION_ARGS)
+{
+  return geo_extent_coords_transfn(fcinfo);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_extent_polygon_transfn);
+
+Datum
+geo_extent_polygon_transfn(PG_FUNCTION_ARGS)
+{
+  return geo_extent_coords_transfn(fcinfo);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_extent_combine);
+
+Datum
+geo_extent_combine(PG_FUNCTION_ARGS)
+{
+  struct geo_box *other;
+
+  if (PG_ARGISNULL(1))
+  {
+    if (PG_ARGISNULL(0))
+      PG_RETURN_NULL();
+
+    PG_RETURN_DATUM(PG_GETARG_DATUM(0));
+  }
+
+  other = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  return geo_extent_add(fcinfo, &other->low, &other->high);
+}
+
+
+/*
+ * centroid_agg
+ *
+ * The sums use Neumaier's compensation, so that the mean of hundreds of
+ * millions of coordinates keeps its precision.
+ */
+
+struct geo_centroid_state
+{
+  int64 count;
+  int32 srid;
+  float8 sum_x;
+  float8 comp_x;
+  float8 sum_y;
+  float8 comp_y;
+};
+
+
+static inline void
+neumaier_add(float8 *sum, float8 *comp, float8 v)
+{
+  float8 t = *sum + v;
+
+  if (fabs(*sum) >= fabs(v))
+    *comp += (*sum - t) + v;
+  else
+    *comp += (v - t) + *sum;
+
+  *sum = t;
+}
+
+
+static void
+geo_centroid_check_srid(struct geo_centroid_state *state, int32 srid)
+{
+  if (state->count == 0)
+    state->srid = srid;
+  else if (state->srid != srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The point arguments have different SRIDs: %d e %d .", state->srid, srid)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_centroid_transfn);
+
+Datum
+geo_centroid_transfn(PG_FUNCTION_ARGS)
+{
+  MemoryContext agg_context = geo_agg_context(fcinfo, "centroid_agg");
+
+  struct geo_centroid_state *state;
+
+  struct geo_point *pt;
+
+  if (PG_ARGISNULL(0))
+    state = (struct geo_centroid_state*) MemoryContextAllocZero(agg_context, sizeof(struct geo_centroid_state));
+  else
+    state = (struct geo_centroid_state*) PG_GETARG_POINTER(0);
+
+  if (PG_ARGISNULL(1))
+    PG_RETURN_POINTER(state);
+
+  pt = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  geo_centroid_check_srid(state, pt->srid);
+
+  neumaier_add(&state->sum_x, &state->comp_x, pt->coord.x);
+  neumaier_add(&state->sum_y, &state->comp_y, pt->coord.y);
+
+  state->count++;
+
+  PG_RETURN_POINTER(state);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_centroid_combine);
+
+Datum
+geo_centroid_combine(PG_FUNCTION_ARGS)
+{
+  MemoryContext agg_context = geo_agg_context(fcinfo, "centroid_agg");
+
+  struct geo_centroid_state *state;
+
+  struct geo_centroid_state *other;
+
+  if (PG_ARGISNULL(1))
+  {
+    if (PG_ARGISNULL(0))
+      PG_RETURN_NULL();
+
+    PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+  }
+
+  other = (struct geo_centroid_state*) PG_GETARG_POINTER(1);
+
+/* the state must live in the aggregate context */
+  if (PG_ARGISNULL(0))
+  {
+    state = (struct geo_centroid_state*) MemoryContextAlloc(agg_context, sizeof(struct geo_centroid_state));
+
+    *state = *other;
+
+    PG_RETURN_POINTER(state);
+  }
+
+  state = (struct geo_centroid_state*) PG_GETARG_POINTER(0);
+
+  if (other->count == 0)
+    PG_RETURN_POINTER(state);
+
+  geo_centroid_check_srid(state, other->srid);
+
+  neumaier_add(&state->sum_x, &state->comp_x, other->sum_x);
+  neumaier_add(&state->sum_y, &state->comp_y, other->sum_y);
+
+  state->comp_x += other->comp_x;
+  state->comp_y += other->comp_y;
+  state->count += other->count;
+
+  PG_RETURN_POINTER(state);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_centroid_serialize);
+
+Datum
+geo_centroid_serialize(PG_FUNCTION_ARGS)
+{
+  struct geo_centroid_state *state = (struct geo_centroid_state*) PG_GETARG_POINTER(0);
+
+  StringInfoData buf;
+
+  geo_agg_context(fcinfo, "centroid_agg");
+
+  pq_begintypsend(&buf);
+
+  pq_sendint64(&buf, state->count);
+  pq_sendint32(&buf, state->srid);
+  pq_sendfloat8(&buf, state->sum_x);
+  pq_sendfloat8(&buf, state->comp_x);
+  pq_sendfloat8(&buf, state->sum_y);
+  pq_sendfloat8(&buf, state->comp_y);
+
+  PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_centroid_deserialize);
+
+Datum
+geo_centroid_deserialize(PG_FUNCTION_ARGS)
+{
+  bytea *data = PG_GETARG_BYTEA_PP(0);
+
+  struct geo_centroid_state *state;
+
+  StringInfoData buf;
+
+  geo_agg_context(fcinfo, "centroid_agg");
+
+/* the current context is the aggregate one */
+  state = (struct geo_centroid_state*) palloc(sizeof(struct geo_centroid_state));
+
+  initStringInfo(&buf);
+  appendBinaryStringInfo(&buf, VARDATA_ANY(data), VARSIZE_ANY_EXHDR(data));
+
+  state->count = pq_getmsgint64(&buf);
+  state->srid = pq_getmsgint(&buf, sizeof(int32));
+  state->sum_x = pq_getmsgfloat8(&buf);
+  state->comp_x = pq_getmsgfloat8(&buf);
+  state->sum_y = pq_getmsgfloat8(&buf);
+  state->comp_y = pq_getmsgfloat8(&buf);
+
+  pq_getmsgend(&buf);
+  pfree(buf.data);
+
+  PG_RETURN_POINTER(state);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_centroid_final);
+
+Datum
+geo_centroid_final(PG_FUNCTION_ARGS)
+{
+  struct geo_centroid_state *state;
+
+  struct geo_point *result;
+
+  if (PG_ARGISNULL(0))
+    PG_RETURN_NULL();
+
+  state = (struct geo_centroid_state*) PG_GETARG_POINTER(0);
+
+  if (state->count == 0)
+    PG_RETURN_NULL();
+
+  result = (struct geo_point*) palloc(sizeof(struct geo_point));
+
+  result->coord.x = (state->sum_x + state->comp_x) / state->count;
+  result->coord.y = (state->sum_y + state->comp_y) / state->count;
+  result->srid = state->srid;
+  result->dummy = 0;
+
+  PG_RETURN_GEOPOINT_TYPE_P(result);
+}
+
+
+/*
+ * convex_hull_agg
+ *
+ * The points are buffered; when the buffer is full it is replaced by the
+ * hull of its points (Andrew's monotone chain), and it only grows if the
+ * hull itself fills more than half of it. So the memory is bounded by the
+ * size of the hull, not by the number of rows.
+ */
+
+struct geo_hull_state
+{
+  int32 srid;
+  int32 npts;
+  int32 capacity;
+  struct coord2d *pts;
+};
+
+
+static struct geo_hull_state*
+geo_hull_state_create(MemoryContext agg_context, int32 srid, int32 capacity)
+{
+  struct geo_hull_state *state;
+
+  state = (struct geo_hull_state*) MemoryContextAlloc(agg_context, sizeof(struct geo_hull_state));
+
+  state->srid = srid;
+  state->npts = 0;
+  state->capacity = capacity;
+  state->pts = (struct coord2d*) MemoryContextAlloc(agg_context, capacity * sizeof(struct coord2d));
+
+  return state;
+}
+
+
+/* replaces the points by their hull */
+static void
+geo_hull_compact(struct geo_hull_state *state)
+{
+  struct coord2d *hull;
+
+  if (state->npts < 3)
+    return;
+
+  hull = (struct coord2d*) palloc((state->npts + 1) * sizeof(struct coord2d));
+
+  state->npts = convex_hull(state->pts, state->npts, hull);
+
+  memcpy(state->pts, hull, state->npts * sizeof(struct coord2d));
+
+  pfree(hull);
+}
+
+
+static void
+geo_hull_add(struct geo_hull_state *state, const struct coord2d *pts, int32 npts)
+{
+  for (int32 i = 0; i < npts; ++i)
+  {
+    if (state->npts == state->capacity)
+    {
+      geo_hull_compact(state);
+
+      if (state->npts > state->capacity / 2)
+      {
+        state->capacity *= 2;
+        state->pts = (struct coord2d*) repalloc(state->pts, state->capacity * sizeof(struct coord2d));
+      }
+    }
+
+    state->pts[state->npts++] = pts[i];
+  }
+}
+
+
+PG_FUNCTION_INFO_V1(geo_hull_transfn);
+
+Datum
+geo_hull_transfn(PG_FUNCTION_ARGS)
+{
+  MemoryContext agg_context = geo_agg_context(fcinfo, "convex_hull_agg");
+
+  struct geo_hull_state *state = PG_ARGISNULL(0) ? NULL : (struct geo_hull_state*) PG_GETARG_POINTER(0);
+
+  struct geo_point *pt;
+
+  if (PG_ARGISNULL(1))
+  {
+    if (state == NULL)
+      PG_RETURN_NULL();
+
+    PG_RETURN_POINTER(state);
+  }
+
+  pt = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  if (state == NULL)
+    state = geo_hull_state_create(agg_context, pt->srid, GEO_HULL_BUFFER_SIZE);
+  else if (state->srid != pt->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The point arguments have different SRIDs: %d e %d .", state->srid, pt->srid)));
+
+/* repalloc keeps the buffer in the aggregate context */
+  geo_hull_add(state, &pt->coord, 1);
+
+  PG_RETURN_POINTER(state);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_hull_combine);
+
+Datum
+geo_hull_combine(PG_FUNCTION_ARGS)
+{
+  MemoryContext agg_context = geo_agg_context(fcinfo, "convex_hull_agg");
+
+  struct geo_hull_state *state = PG_ARGISNULL(0) ? NULL : (struct geo_hull_state*) PG_GETARG_POINTER(0);
+
+  struct geo_hull_state *other;
+
+  if (PG_ARGISNULL(1))
+  {
+    if (state == NULL)
+      PG_RETURN_NULL();
+
+    PG_RETURN_POINTER(state);
+  }
+
+  other = (struct geo_hull_state*) PG_GETARG_POINTER(1);
+
+  if (state == NULL)
+    state = geo_hull_state_create(agg_context, other->srid, Max(other->capacity, GEO_HULL_BUFFER_SIZE));
+  else if (state->srid != other->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The point arguments have different SRIDs: %d e %d .", state->srid, other->srid)));
+
+  geo_hull_add(state, other->pts, other->npts);
+
+  PG_RETURN_POINTER(state);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_hull_serialize);
+
+Datum
+geo_hull_serialize(PG_FUNCTION_ARGS)
+{
+  struct geo_hull_state *state = (struct geo_hull_state*) PG_GETARG_POINTER(0);
+
+  StringInfoData buf;
+
+  geo_agg_context(fcinfo, "convex_hull_agg");
+
+/* only the hull is sent to the leader */
+  geo_hull_compact(state);
+
+  pq_begintypsend(&buf);
+
+  pq_sendint32(&buf, state->srid);
+  pq_sendint32(&buf, state->npts);
+
+  for (int32 i = 0; i < state->npts; ++i)
+  {
+    pq_sendfloat8(&buf, state->pts[i].x);
+    pq_sendfloat8(&buf, state->pts[i].y);
+  }
+
+  PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_hull_deserialize);
+
+Datum
+geo_hull_deserialize(PG_FUNCTION_ARGS)
+{
+  bytea *data = PG_GETARG_BYTEA_PP(0);
+
+  struct geo_hull_state *state;
+
+  StringInfoData buf;
+
+  int32 srid, npts;
+
+  geo_agg_context(fcinfo, "convex_hull_agg");
+
+  initStringInfo(&buf);
+  appendBinaryStringInfo(&buf, VARDATA_ANY(data), VARSIZE_ANY_EXHDR(data));
+
+  srid = pq_getmsgint(&buf, sizeof(int32));
+  npts = pq_getmsgint(&buf, sizeof(int32));
+
+  if ((npts < 0) || (npts > (int32) (VARSIZE_ANY_EXHDR(data) / (2 * sizeof(float8)))))
+    elog(ERROR, "invalid convex_hull_agg state");
+
+/* the current context is the aggregate one */
+  state = geo_hull_state_create(CurrentMemoryContext, srid, Max(2 * npts, GEO_HULL_BUFFER_SIZE));
+
+  for (int32 i = 0; i < npts; ++i)
+  {
+    state->pts[i].x = pq_getmsgfloat8(&buf);
+    state->pts[i].y = pq_getmsgfloat8(&buf);
+  }
+
+  state->npts = npts;
+
+  pq_getmsgend(&buf);
+  pfree(buf.data);
+
+  PG_RETURN_POINTER(state);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_hull_final);
+
+Datum
+geo_hull_final(PG_FUNCTION_ARGS)
+{
+  struct geo_hull_state *state;
+
+  struct coord2d *pts;
+  struct coord2d *hull;
+
+  int npts;
+
+  if (PG_ARGISNULL(0))
+    PG_RETURN_NULL();
+
+  state = (struct geo_hull_state*) PG_GETARG_POINTER(0);
+
+/* the final function may be called again on the same state: use a copy */
+  pts = (struct coord2d*) palloc(Max(state->npts, 1) * sizeof(struct coord2d));
+  hull = (struct coord2d*) palloc((state->npts + 1) * sizeof(struct coord2d));
+
+  memcpy(pts, state->pts, state->npts * sizeof(struct coord2d));
+
+  npts = convex_hull(pts, state->npts, hull);
+
+/* collinear or fewer than three distinct points: no polygon */
+  if (npts < 3)
+    PG_RETURN_NULL();
+
+  PG_RETURN_GEOPOLYGON_TYPE_P(geo_polygon_from_open_ring(hull, npts, state->srid));
+}
@@ -0,0 +1,77 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_aggregates.h
+ *
+ * \brief Aggregate functions over the geometry types.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_AGGREGATES_H__
+#define __GEOEXT_GEO_AGGREGATES_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+
+/*
+ * extent(): the state is the geo_box itself, updated in place.
+ *
+ */
+extern Datum geo_extent_point_transfn(PG_FUNCTION_ARGS);
+extern Datum geo_extent_box_transfn(PG_FUNCTION_ARGS);
+extern Datum geo_extent_linestring_transfn(PG_FUNCTION_ARGS);
+extern Datum geo_extent_polygon_transfn(PG_FUNCTION_ARGS);
+extern Datum geo_extent_combine(PG_FUNCTION_ARGS);
+
+
+/*
+ * centroid_agg(): compensated sums of the coordinates.
+ *
+ */
+extern Datum geo_centroid_transfn(PG_FUNCTION_ARGS);
+extern Datum geo_centroid_combine(PG_FUNCTION_ARGS);
+extern Datum geo_centroid_serialize(PG_FUNCTION_ARGS);
+extern Datum geo_centroid_deserialize(PG_FUNCTION_ARGS);
+extern Datum geo_centroid_final(PG_FUNCTION_ARGS);
+
+
+/*
+ * convex_hull_agg(): a buffer of candidate points, reduced to their hull
+ * whenever it fills up.
+ *
+ */
+extern Datum geo_hull_transfn(PG_FUNCTION_ARGS);
+extern Datum geo_hull_combine(PG_FUNCTION_ARGS);
+extern Datum geo_hull_serialize(PG_FUNCTION_ARGS);
+extern Datum geo_hull_deserialize(PG_FUNCTION_ARGS);
+extern Datum geo_hull_final(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_AGGREGATES_H__ */
@@ -0,0 +1,78 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_array.c
+ *
+ * \brief Direct access to the coordinates stored in float8 arrays.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_array.h"
+
+
+/* PostgreSQL */
+#include <catalog/pg_type.h>
+
+
+const float8*
+geo_float8_array_data(ArrayType *array, int *nelems, const char *fname)
+{
+  if(ARR_ELEMTYPE(array) != FLOAT8OID)
+    ereport(ERROR,
+            (errcode(ERRCODE_DATATYPE_MISMATCH),
+             errmsg("%s expects float8 arrays", fname)));
+
+  if(ARR_NDIM(array) > 1)
+    ereport(ERROR,
+            (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+             errmsg("%s expects one-dimensional arrays", fname)));
+
+/* float8 has no holes: without a null bitmap the data is a plain C array */
+  if(array_contains_nulls(array))
+    ereport(ERROR,
+            (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+             errmsg("%s does not accept null coordinates", fname)));
+
+  *nelems = ArrayGetNItems(ARR_NDIM(array), ARR_DIMS(array));
+
+  return (const float8*) ARR_DATA_PTR(array);
+}
+
+
+void
+geo_coords_from_xy(const float8 *x, const float8 *y, int npts,
+                   struct coord2d *coords)
+{
+  for(int i = 0; i < npts; ++i)
+  {
+    coords[i].x = x[i];
+    coords[i].y = y[i];
+  }
+}
@@ -0,0 +1,68 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_array.h
+ *
+ * \brief Direct access to the coordinates stored in float8 arrays.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_ARRAY_H__
+#define __GEOEXT_GEO_ARRAY_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <utils/array.h>
+
+/* GeoExt */
+#include "decls.h"
+
+
+/*
+ * Returns a pointer to the elements of a float8 array and their number.
+ *
+ * The pointer refers to the array data itself (ARR_DATA_PTR), so no Datum
+ * or null arrays are built. An array with a NULL element is an error.
+ *
+ */
+extern const float8* geo_float8_array_data(ArrayType *array,
+                                           int *nelems,
+                                           const char *fname);
+
+
+/*
+ * Interleaves two coordinate vectors of npts elements into coords.
+ *
+ */
+extern void geo_coords_from_xy(const float8 *x,
+                               const float8 *y,
+                               int npts,
+                               struct coord2d *coords);
+
+#endif  /* __GEOEXT_GEO_ARRAY_H__ */
@@ -38,6 +38,8 @@ Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
  * R-Tree Bibliography
  * [1] A. Guttman. R-tree: a dynamic index structure for spatial searching.
  *    Proceedings of the ACM SIGMOD Conference, pp 47-57, June 1984.
+ * [2] C.H. Ang and T.C. Tan. New linear node splitting algorithm for R-trees.
+ *    Proceedings of the 5th International Symposium on Spatial Databases, pp 339-349, 1997.
  */
 
 
@@ -75,6 +77,26 @@ struct geo_box
 #define PG_GETARG_GEOBOX_TYPE_P(n)  DatumGetGeoBoxTypeP(PG_GETARG_DATUM(n))
 #define PG_RETURN_GEOBOX_TYPE_P(x)  PG_RETURN_POINTER(x)
 
+
+/*
+* A geo_box4 is a geo_box rounded outward to single precision.
+*
+* It is the 16-byte key of the compact GiST opclasses: it always contains
+* the box it was made from, so the searches on it are lossy (recheck).
+*
+*/
+struct geo_box4
+{
+ float4 high_x;
+ float4 high_y;
+ float4 low_x;
+ float4 low_y;
+};
+
+#define DatumGetGeoBox4TypeP(X)      ((struct geo_box4*) DatumGetPointer(X))
+#define PG_GETARG_GEOBOX4_TYPE_P(n)  DatumGetGeoBox4TypeP(PG_GETARG_DATUM(n))
+#define PG_RETURN_GEOBOX4_TYPE_P(x)  PG_RETURN_POINTER(x)
+
 /*
  * geo_box operations.
  *
@@ -101,11 +123,9 @@ extern Datum geo_box_below(PG_FUNCTION_ARGS);
 extern Datum geo_box_above(PG_FUNCTION_ARGS);
 extern Datum geo_box_overlap(PG_FUNCTION_ARGS);
 extern Datum geo_box_overleft(PG_FUNCTION_ARGS);
-/*
 extern Datum geo_box_overright(PG_FUNCTION_ARGS);
 extern Datum geo_box_overbelow(PG_FUNCTION_ARGS);
 extern Datum geo_box_overabove(PG_FUNCTION_ARGS);
-*/
 // extern Datum geo_box_below_eq(PG_FUNCTION_ARGS); // Is obsolete
 // extern Datum geo_box_above_eq(PG_FUNCTION_ARGS); // Is obsolete
 
@@ -152,6 +172,15 @@ extern Datum geo_box_compress(PG_FUNCTION_ARGS);
 extern Datum geo_box_decompress(PG_FUNCTION_ARGS);
 
 
+/*
+ * \brief GiST Fetch method for geo_box
+ * \note The leaf keys are stored as is, so they are returned unchanged.
+ *       It allows index-only scans on geo_box columns.
+ */
+
+extern Datum geo_box_fetch(PG_FUNCTION_ARGS);
+
+
 /*
  * \brief GiST Penalty method for geo_box
  * \note Returns a value indicating the "cost" of inserting the new entry into a particular branch of the tree.
@@ -177,6 +206,31 @@ extern Datum geo_box_picksplit(PG_FUNCTION_ARGS);
 extern Datum g_box_same(PG_FUNCTION_ARGS);
 
 
+/*
+ * GiST support for the compact geo_box4 keys (see geo_box4_gist.c)
+ *
+ */
+
+/* rounds a box outward to a geo_box4 */
+extern void geo_box4_from_coords(const struct coord2d *low, const struct coord2d *high,
+                                 struct geo_box4 *key);
+
+/* widens a geo_box4 back to a geo_box, exactly */
+extern void geo_box4_to_box(const struct geo_box4 *key, struct geo_box *box);
+
+extern Datum geo_box4_in(PG_FUNCTION_ARGS);
+extern Datum geo_box4_out(PG_FUNCTION_ARGS);
+
+extern Datum geo_box4_gist_consistent(PG_FUNCTION_ARGS);
+extern Datum geo_box4_gist_compress(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_compress4(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_gist_compress4(PG_FUNCTION_ARGS);
+extern Datum geo_box4_gist_union(PG_FUNCTION_ARGS);
+extern Datum geo_box4_gist_penalty(PG_FUNCTION_ARGS);
+extern Datum geo_box4_gist_picksplit(PG_FUNCTION_ARGS);
+extern Datum geo_box4_gist_same(PG_FUNCTION_ARGS);
+
+
 
 
 #endif  /* __GEOEXT_H__ */
@@ -0,0 +1,436 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_box4_gist.c
+ *
+ * \brief R-tree GiST opclasses with compact single precision keys.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_box.h"
+#include "algorithms.h"
+#include "geo_counters.h"
+#include "geo_point.h"
+#include "geo_polygon.h"
+#include "hexutils.h"
+
+
+/* PostgreSQL */
+#include <access/gist.h>
+#include <access/stratnum.h>
+#include <utils/builtins.h>
+
+
+/*
+ * The keys of these opclasses are geo_box4: boxes of floats rounded outward,
+ * half the size of a geo_box. A leaf key contains the indexed value, and an
+ * internal key contains all the keys below it, so the same consistent test
+ * serves both levels and the heap value is always rechecked.
+ *
+ */
+
+#define GEOEXT_GEOBOX4_SIZE ( sizeof(struct geo_box4) )
+#define GEOEXT_GEOBOX4_HEX_LEN ( ( 2 * GEOEXT_GEOBOX4_SIZE ) )
+
+
+/*
+ * Utility functions.
+ *
+ */
+
+void
+geo_box4_from_coords(const struct coord2d *low, const struct coord2d *high,
+                     struct geo_box4 *key)
+{
+  key->high_x = float4_round_up(high->x);
+  key->high_y = float4_round_up(high->y);
+  key->low_x = float4_round_down(low->x);
+  key->low_y = float4_round_down(low->y);
+}
+
+
+void
+geo_box4_to_box(const struct geo_box4 *key, struct geo_box *box)
+{
+/* a float is exactly representable as a double */
+  box->high.x = key->high_x;
+  box->high.y = key->high_y;
+  box->low.x = key->low_x;
+  box->low.y = key->low_y;
+}
+
+
+static inline GISTENTRY*
+geo_box4_leaf_entry(GISTENTRY *entry, struct geo_box4 *key)
+{
+  GISTENTRY *retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+
+  gistentryinit(*retval, PointerGetDatum(key),
+                entry->rel, entry->page, entry->offset, false);
+
+  return retval;
+}
+
+
+static inline void
+geo_box4_union(struct geo_box4 *n, const struct geo_box4 *a, const struct geo_box4 *b)
+{
+  n->high_x = Max(a->high_x, b->high_x);
+  n->high_y = Max(a->high_y, b->high_y);
+  n->low_x = Min(a->low_x, b->low_x);
+  n->low_y = Min(a->low_y, b->low_y);
+}
+
+
+/*
+ * I/O Functions for the geo_box4 data type
+ *
+ */
+
+PG_FUNCTION_INFO_V1(geo_box4_in);
+
+Datum
+geo_box4_in(PG_FUNCTION_ARGS)
+{
+  char *str = PG_GETARG_CSTRING(0);
+
+  struct geo_box4 *key = (struct geo_box4*) palloc(sizeof(struct geo_box4));
+
+  if (strlen(str) != GEOEXT_GEOBOX4_HEX_LEN)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+            errmsg("invalid input syntax for type %s: \"%s\"",
+            "geo_box4", str)));
+
+  hex2binary(str, GEOEXT_GEOBOX4_HEX_LEN, (char*)key);
+
+  PG_RETURN_GEOBOX4_TYPE_P(key);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box4_out);
+
+Datum
+geo_box4_out(PG_FUNCTION_ARGS)
+{
+  struct geo_box4 *key = PG_GETARG_GEOBOX4_TYPE_P(0);
+
+/* alloc a buffer for hex-string plus a trailing '\0' */
+  char *hstr = palloc(GEOEXT_GEOBOX4_HEX_LEN + 1);
+
+  binary2hex((char*)key, GEOEXT_GEOBOX4_SIZE, hstr);
+
+  PG_RETURN_CSTRING(hstr);
+}
+
+
+/*
+ * GiST methods
+ *
+ */
+
+PG_FUNCTION_INFO_V1(geo_box4_gist_consistent);
+
+Datum
+geo_box4_gist_consistent(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_box *query = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  StrategyNumber strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+
+  bool *recheck = (bool *) PG_GETARG_POINTER(4);
+
+  struct geo_box4 *key = DatumGetGeoBox4TypeP(entry->key);
+
+  bool overlap;
+
+  bool retval;
+
+  instr_time start;
+
+  geo_counter_start(&start);
+
+/* the keys are larger than the values: the heap value decides */
+  *recheck = true;
+
+  overlap = key->low_x <= query->high.x && key->high_x >= query->low.x &&
+            key->low_y <= query->high.y && key->high_y >= query->low.y;
+
+/*
+ * Each test below holds for the key if it holds for any box contained
+ * in it, so it never rejects a match.
+ */
+  switch (strategy)
+  {
+    case RTLeftStrategyNumber:
+      retval = key->low_x < query->low.x;
+      break;
+    case RTOverLeftStrategyNumber:
+      retval = key->low_x <= query->high.x;
+      break;
+    case RTOverRightStrategyNumber:
+      retval = key->high_x >= query->low.x;
+      break;
+    case RTRightStrategyNumber:
+      retval = key->high_x > query->high.x;
+      break;
+    case RTBelowStrategyNumber:
+      retval = key->low_y < query->low.y;
+      break;
+    case RTOverBelowStrategyNumber:
+      retval = key->low_y <= query->high.y;
+      break;
+    case RTOverAboveStrategyNumber:
+      retval = key->high_y >= query->low.y;
+      break;
+    case RTAboveStrategyNumber:
+      retval = key->high_y > query->high.y;
+      break;
+    case RTSameStrategyNumber:
+    case RTContainsStrategyNumber:
+    case RTOldContainsStrategyNumber:
+      retval = key->low_x <= query->low.x && key->high_x >= query->high.x &&
+               key->low_y <= query->low.y && key->high_y >= query->high.y;
+      break;
+    case RTOverlapStrategyNumber:
+    case RTContainedByStrategyNumber:
+    case RTOldContainedByStrategyNumber:
+      retval = overlap;
+      break;
+    default:
+      elog(ERROR, "unrecognized strategy number: %d", strategy);
+      retval = false;
+  }
+
+  geo_counter_stop(GEO_COUNTER_GIST_CONSISTENT, &start);
+
+  PG_RETURN_BOOL(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box4_gist_compress);
+
+Datum
+geo_box4_gist_compress(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  if (entry->leafkey)
+  {
+    struct geo_box *box = DatumGetGeoBoxTypeP(entry->key);
+
+    struct geo_box4 *key = (struct geo_box4*) palloc(sizeof(struct geo_box4));
+
+    geo_box4_from_coords(&box->low, &box->high, key);
+
+    PG_RETURN_POINTER(geo_box4_leaf_entry(entry, key));
+  }
+
+  PG_RETURN_POINTER(entry);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_compress4);
+
+Datum
+geo_point_gist_compress4(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  if (entry->leafkey)
+  {
+    struct geo_point *pt = DatumGetGeoPointTypeP(entry->key);
+
+    struct geo_box4 *key = (struct geo_box4*) palloc(sizeof(struct geo_box4));
+
+    geo_box4_from_coords(&pt->coord, &pt->coord, key);
+
+    PG_RETURN_POINTER(geo_box4_leaf_entry(entry, key));
+  }
+
+  PG_RETURN_POINTER(entry);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_gist_compress4);
+
+Datum
+geo_polygon_gist_compress4(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  if (entry->leafkey)
+  {
+    struct geo_polygon *poly = DatumGetGeoPolygonTypeP(entry->key);
+
+    struct geo_box4 *key = (struct geo_box4*) palloc(sizeof(struct geo_box4));
+
+    struct geo_box box;
+
+    mbr(poly->coords, poly->npts, &box.low, &box.high);
+
+    if ((Pointer) poly != DatumGetPointer(entry->key))
+      pfree(poly);
+
+    geo_box4_from_coords(&box.low, &box.high, key);
+
+    PG_RETURN_POINTER(geo_box4_leaf_entry(entry, key));
+  }
+
+  PG_RETURN_POINTER(entry);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box4_gist_union);
+
+Datum
+geo_box4_gist_union(PG_FUNCTION_ARGS)
+{
+  GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+
+  int *sizep = (int *) PG_GETARG_POINTER(1);
+
+  struct geo_box4 *pageunion = (struct geo_box4*) palloc(sizeof(struct geo_box4));
+
+  geo_counter_add(GEO_COUNTER_GIST_UNION, 1);
+
+  *pageunion = *DatumGetGeoBox4TypeP(entryvec->vector[0].key);
+
+  for(int i = 1; i < entryvec->n; ++i)
+    geo_box4_union(pageunion, pageunion, DatumGetGeoBox4TypeP(entryvec->vector[i].key));
+
+  *sizep = sizeof(struct geo_box4);
+
+  PG_RETURN_POINTER(pageunion);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box4_gist_penalty);
+
+Datum
+geo_box4_gist_penalty(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *origentry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  GISTENTRY *newentry = (GISTENTRY *) PG_GETARG_POINTER(1);
+
+  float *result = (float *) PG_GETARG_POINTER(2);
+
+  struct geo_box4 *orig = DatumGetGeoBox4TypeP(origentry->key);
+
+  struct geo_box obox;
+  struct geo_box nbox;
+
+  geo_counter_add(GEO_COUNTER_GIST_PENALTY, 1);
+
+  geo_box4_to_box(orig, &obox);
+  geo_box4_to_box(DatumGetGeoBox4TypeP(newentry->key), &nbox);
+
+/* the same penalty as for the geo_box keys */
+  *result = box_insert_penalty(&obox.low, &obox.high, &nbox.low, &nbox.high);
+
+  PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box4_gist_picksplit);
+
+Datum
+geo_box4_gist_picksplit(PG_FUNCTION_ARGS)
+{
+  GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+
+  GIST_SPLITVEC *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1);
+
+  OffsetNumber maxoff = entryvec->n - 1;
+
+  GistEntryVector *boxvec;
+
+  struct geo_box *boxes;
+
+  struct geo_box *side;
+
+  struct geo_box4 *lkey;
+  struct geo_box4 *rkey;
+
+/*
+ * The keys are widened to geo_box, which is exact, and split by the
+ * geo_box picksplit. Its unions are unions of floats, so they narrow back
+ * without rounding.
+ */
+  boxvec = (GistEntryVector *) palloc(GEVHDRSZ + entryvec->n * sizeof(GISTENTRY));
+  boxvec->n = entryvec->n;
+
+  boxes = (struct geo_box *) palloc(entryvec->n * sizeof(struct geo_box));
+
+  for(OffsetNumber i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+  {
+    geo_box4_to_box(DatumGetGeoBox4TypeP(entryvec->vector[i].key), &boxes[i]);
+
+    boxvec->vector[i] = entryvec->vector[i];
+    boxvec->vector[i].key = PointerGetDatum(&boxes[i]);
+  }
+
+  DirectFunctionCall2(geo_box_picksplit, PointerGetDatum(boxvec), PointerGetDatum(v));
+
+  lkey = (struct geo_box4*) palloc(sizeof(struct geo_box4));
+  rkey = (struct geo_box4*) palloc(sizeof(struct geo_box4));
+
+  side = DatumGetGeoBoxTypeP(v->spl_ldatum);
+  geo_box4_from_coords(&side->low, &side->high, lkey);
+
+  side = DatumGetGeoBoxTypeP(v->spl_rdatum);
+  geo_box4_from_coords(&side->low, &side->high, rkey);
+
+  v->spl_ldatum = PointerGetDatum(lkey);
+  v->spl_rdatum = PointerGetDatum(rkey);
+
+  PG_RETURN_POINTER(v);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box4_gist_same);
+
+Datum
+geo_box4_gist_same(PG_FUNCTION_ARGS)
+{
+  struct geo_box4 *first = PG_GETARG_GEOBOX4_TYPE_P(0);
+
+  struct geo_box4 *second = PG_GETARG_GEOBOX4_TYPE_P(1);
+
+  bool *result = (bool *) PG_GETARG_POINTER(2);
+
+  *result = first->high_x == second->high_x && first->high_y == second->high_y &&
+            first->low_x == second->low_x && first->low_y == second->low_y;
+
+  PG_RETURN_POINTER(result);
+}
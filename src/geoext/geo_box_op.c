@@ -185,7 +185,6 @@ geo_box_overlap(PG_FUNCTION_ARGS)
   PG_RETURN_BOOL(!geo_box_cmp_internal_overlap(first, second));
 }
 
-/*
 PG_FUNCTION_INFO_V1(geo_box_overleft);
 
 Datum
@@ -194,10 +193,41 @@ geo_box_overleft(PG_FUNCTION_ARGS)
   struct geo_box *first = PG_GETARG_GEOBOX_TYPE_P(0);
   struct geo_box *second = PG_GETARG_GEOBOX_TYPE_P(1);
 
-  if(DatumGetBool(DirectFunctionCall2(geo_box_overlap, PointerGetDatum(first), PointerGetDatum(second))))
-  {
+  PG_RETURN_BOOL(float8_cmp_internal(first->high.x, second->high.x) <= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box_overright);
+
+Datum
+geo_box_overright(PG_FUNCTION_ARGS)
+{
+  struct geo_box *first = PG_GETARG_GEOBOX_TYPE_P(0);
+  struct geo_box *second = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  PG_RETURN_BOOL(float8_cmp_internal(first->low.x, second->low.x) >= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box_overbelow);
 
-  }
+Datum
+geo_box_overbelow(PG_FUNCTION_ARGS)
+{
+  struct geo_box *first = PG_GETARG_GEOBOX_TYPE_P(0);
+  struct geo_box *second = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  PG_RETURN_BOOL(float8_cmp_internal(first->high.y, second->high.y) <= 0);
 }
 
-*/
+
+PG_FUNCTION_INFO_V1(geo_box_overabove);
+
+Datum
+geo_box_overabove(PG_FUNCTION_ARGS)
+{
+  struct geo_box *first = PG_GETARG_GEOBOX_TYPE_P(0);
+  struct geo_box *second = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  PG_RETURN_BOOL(float8_cmp_internal(first->low.y, second->low.y) >= 0);
+}
@@ -42,6 +42,7 @@
 
 /* GeoExtension */
 #include "geo_box.h"
+#include "geo_counters.h"
 
 /* PostgreSQL */
 #include <utils/builtins.h>
@@ -55,51 +56,6 @@
 #define MIN(a,b) (((a)<(b)) ? (a):(b))
 #define MAX(a,b) (((a)>(b)) ? (a):(b))
 
-/*
- * Auxiliar function for penalty
- */
-
- /* Size of a BOX for penalty-calculation purposes */
-
-static inline double
-size_gbox (const struct geo_box *gbox)
-{
-
-  if(gbox == NULL || gbox->high.x <= gbox->low.x || gbox->high.y <= gbox->low.y){
-    return 0.0;
- 	}
- 	else{
- 		return (gbox->high.x - gbox->low.x) * (gbox->high.y - gbox->low.y);
- 	}
-
-}
-
-
-/*
- * Calculates union of two boxes, a and b. The result is stored in *n.
- */
-
-static inline void
-rt_gbox_union(struct geo_box *n, const struct geo_box *a, const struct geo_box *b)
-{
- 	n->high.x = Max(a->high.x, b->high.x);
- 	n->high.y = Max(a->high.y, b->high.y);
- 	n->low.x = Min(a->low.x, b->low.x);
- 	n->low.y = Min(a->low.y, b->low.y);
-}
-
-
-/* Return amount by which the union of the two boxes is larger than the original geo_box's area.*/
-static inline double
-penalty_geo_box(struct geo_box *orig, const struct geo_box *new)
-{
-  struct geo_box unionbox;
-
-  rt_gbox_union(&unionbox, orig, new);
-	return size_gbox(&unionbox) - size_gbox(orig);
-
-}
-
 /*
  * Auxiliar function for union
  * Increase geo_box pageunion to include tmp
@@ -125,6 +81,11 @@ adjustGeoBox(struct geo_box *pageunion, const struct geo_box *tmp) {
 
 
 
+/* Calls a geo_box operator on key and query */
+#define GBOX_OP(op, key, query) \
+  DatumGetBool(DirectFunctionCall2(op, PointerGetDatum(key), PointerGetDatum(query)))
+
+
 /*	Leaf-level consistency for geo_box with geo_box: just apply the query operator */
 
 static inline bool
@@ -132,33 +93,45 @@ gbox_leaf_consistent(struct geo_box *key, struct geo_box *query, StrategyNumber
 {
   bool retval;
 
-  elog(NOTICE, "gbox_leaf_consistent");
-
 	switch (strategy)
   {
     case RTLeftStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_left, PointerGetDatum(key), PointerGetDatum(query)));
+			retval = GBOX_OP(geo_box_left, key, query);
+			break;
+		case RTOverLeftStrategyNumber:
+			retval = GBOX_OP(geo_box_overleft, key, query);
 			break;
-		// case RTOverLeftStrategyNumber:
-		// 	retval = DatumGetBool(DirectFunctionCall2(geo_box_overleft, PointerGetDatum(key), PointerGetDatum(query)));
-		// 	break;
 		case RTOverlapStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_overlap, PointerGetDatum(key), PointerGetDatum(query)));
+			retval = GBOX_OP(geo_box_overlap, key, query);
+			break;
+		case RTOverRightStrategyNumber:
+			retval = GBOX_OP(geo_box_overright, key, query);
 			break;
-		// case RTOverRightStrategyNumber:
-		// 	retval = DatumGetBool(DirectFunctionCall2(geo_box_overright, PointerGetDatum(key), PointerGetDatum(query)));
-		// 	break;
 		case RTRightStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_right, PointerGetDatum(key), PointerGetDatum(query)));
+			retval = GBOX_OP(geo_box_right, key, query);
 			break;
 		case RTSameStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_same, PointerGetDatum(key), PointerGetDatum(query)));
+			retval = GBOX_OP(geo_box_same, key, query);
 			break;
 		case RTContainsStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_contain, PointerGetDatum(key), PointerGetDatum(query)));
+		case RTOldContainsStrategyNumber:
+			retval = GBOX_OP(geo_box_contain, key, query);
 			break;
 		case RTContainedByStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_contained, PointerGetDatum(key), PointerGetDatum(query)));
+		case RTOldContainedByStrategyNumber:
+			retval = GBOX_OP(geo_box_contained, key, query);
+			break;
+		case RTOverBelowStrategyNumber:
+			retval = GBOX_OP(geo_box_overbelow, key, query);
+			break;
+		case RTBelowStrategyNumber:
+			retval = GBOX_OP(geo_box_below, key, query);
+			break;
+		case RTAboveStrategyNumber:
+			retval = GBOX_OP(geo_box_above, key, query);
+			break;
+		case RTOverAboveStrategyNumber:
+			retval = GBOX_OP(geo_box_overabove, key, query);
 			break;
 		default:
 			elog(ERROR, "Unrecognized strategy number: %d", strategy);
@@ -177,6 +150,11 @@ gbox_leaf_consistent(struct geo_box *key, struct geo_box *query, StrategyNumber
 *
 * We can use the same function since these geo_types use bounding boxes both as the
 * internal-page representation and also for the query.
+*
+* The key bounds all the boxes below it, so each test asks whether some box
+* inside the key may satisfy the operator. E.g. a box strictly to the left
+* of the query (high.x < query.low.x) exists below the key only if the key
+* does not lie entirely over or to the right of it (key.low.x >= query.low.x).
 */
 
 static inline bool
@@ -187,24 +165,43 @@ rtree_internal_consistent(struct geo_box *key, struct geo_box *query, StrategyNu
 	switch (strategy)
 	{
 		case RTLeftStrategyNumber:
+			retval = !GBOX_OP(geo_box_overright, key, query);
+			break;
 		case RTOverLeftStrategyNumber:
-			// retval = DatumGetBool(DirectFunctionCall2(geo_box_overleft, PointerGetDatum(key), PointerGetDatum(query)));
-			// break;
+			retval = !GBOX_OP(geo_box_right, key, query);
+			break;
 		case RTOverlapStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_overlap, PointerGetDatum(key), PointerGetDatum(query)));
+			retval = GBOX_OP(geo_box_overlap, key, query);
 			break;
 		case RTOverRightStrategyNumber:
+			retval = !GBOX_OP(geo_box_left, key, query);
+			break;
 		case RTRightStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_right, PointerGetDatum(key), PointerGetDatum(query)));
+			retval = !GBOX_OP(geo_box_overleft, key, query);
 			break;
 		case RTSameStrategyNumber:
 		case RTContainsStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_contain, PointerGetDatum(key), PointerGetDatum(query)));
+		case RTOldContainsStrategyNumber:
+			retval = GBOX_OP(geo_box_contain, key, query);
 			break;
 		case RTContainedByStrategyNumber:
-			retval = DatumGetBool(DirectFunctionCall2(geo_box_overlap, PointerGetDatum(key), PointerGetDatum(query)));
+		case RTOldContainedByStrategyNumber:
+			retval = GBOX_OP(geo_box_overlap, key, query);
+			break;
+		case RTOverBelowStrategyNumber:
+			retval = !GBOX_OP(geo_box_above, key, query);
+			break;
+		case RTBelowStrategyNumber:
+			retval = !GBOX_OP(geo_box_overabove, key, query);
+			break;
+		case RTAboveStrategyNumber:
+			retval = !GBOX_OP(geo_box_overbelow, key, query);
+			break;
+		case RTOverAboveStrategyNumber:
+			retval = !GBOX_OP(geo_box_below, key, query);
 			break;
 		default:
+			elog(ERROR, "Unrecognized strategy number: %d", strategy);
 			retval = FALSE;
 	}
 	return (retval);
@@ -230,6 +227,10 @@ geo_box_consistent(PG_FUNCTION_ARGS)
 
   bool retval;
 
+  instr_time start;
+
+  geo_counter_start(&start);
+
   /* elog(NOTICE, "geo_box_consistent CALL"); */
 
   /* All cases served by this function are exact */
@@ -237,7 +238,10 @@ geo_box_consistent(PG_FUNCTION_ARGS)
 
 
   if (!(DatumGetPointer(entry->key) != NULL && query))
+  {
+    geo_counter_stop(GEO_COUNTER_GIST_CONSISTENT, &start);
     PG_RETURN_BOOL(FALSE);
+  }
 
 	/* If the value is on the final page, then it's exact comparison. */
   /* If it is inside, we should return true if the values ​​in the later pages (children) can satisfy the condition */
@@ -248,6 +252,8 @@ geo_box_consistent(PG_FUNCTION_ARGS)
     retval = rtree_internal_consistent((struct geo_box *) DatumGetPointer(entry->key), query, strategy);
   }
 
+  geo_counter_stop(GEO_COUNTER_GIST_CONSISTENT, &start);
+
   PG_RETURN_BOOL(retval);
 
 }
@@ -268,6 +274,8 @@ geo_box_union(PG_FUNCTION_ARGS)
 	struct geo_box *tmp, *pageunion;
 
 
+  geo_counter_add(GEO_COUNTER_GIST_UNION, 1);
+
   numranges = entryvec->n;
 
 	pageunion = (struct geo_box *) palloc(sizeof(struct geo_box));
@@ -308,6 +316,16 @@ geo_box_decompress(PG_FUNCTION_ARGS)
 }
 
 
+PG_FUNCTION_INFO_V1(geo_box_fetch);
+
+Datum
+geo_box_fetch(PG_FUNCTION_ARGS)
+{
+/* leaf keys are the indexed geo_box values themselves */
+  PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+}
+
+
 PG_FUNCTION_INFO_V1(g_box_same);
 
 Datum
@@ -346,32 +364,183 @@ geo_box_penalty(PG_FUNCTION_ARGS)
   struct geo_box *orig = DatumGetGeoBoxTypeP(origentry->key);
   struct geo_box *new = DatumGetGeoBoxTypeP(newentry->key);
 
-  *penalty = (float) penalty_geo_box(orig, new);
+  geo_counter_add(GEO_COUNTER_GIST_PENALTY, 1);
+
+  *penalty = box_insert_penalty(&orig->low, &orig->high, &new->low, &new->high);
 
   PG_RETURN_POINTER(penalty);
 
 }
 
 
-/*Uses linear algorithm from Ang & Tan */
-
-// PG_FUNCTION_INFO_V1(geo_box_picksplit);
-//
-// Datum
-// geo_box_picksplit(PG_FUNCTION_ARGS)
-// {
-//   bytea	   *entryvec = (bytea *) PG_GETARG_POINTER(0);
-//   GIST_SPLITVEC *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1); /*This is the Split Vector to be returned by the PickSplit method*/
-//   OffsetNumber maxoff; /* Number of nodes in the tree*/
-// 	OffsetNumber i;
-//   /*  rectangles that are nearer to a border than to its opposite */
-// 	OffsetNumber *listL, *listR, *listB, *listT;
-//   struct geo_box *unionL, *unionR, *unionB, *unionT;
-//   int	posL, posR,	posB,	posT;
-//
-//
-//   posL = posR = posB = posT = 0;
-//   maxoff = ((VARSIZE(entryvec) - VARHDRSZ) / sizeof(GISTENTRY)) - 1;
-//
-//
-// }
+/*
+ * Auxiliar functions for picksplit
+ */
+
+/* Area of the intersection of two boxes, zero if they are disjoint */
+static inline double
+overlap_area_gbox(const struct geo_box *a, const struct geo_box *b)
+{
+  double dx = Min(a->high.x, b->high.x) - Max(a->low.x, b->low.x);
+  double dy = Min(a->high.y, b->high.y) - Max(a->low.y, b->low.y);
+
+  if (dx <= 0.0 || dy <= 0.0)
+    return 0.0;
+
+  return dx * dy;
+}
+
+
+/* Computes the union of the entries listed in list into *unionbox */
+static void
+union_gbox_list(GistEntryVector *entryvec, OffsetNumber *list, int n,
+                struct geo_box *unionbox)
+{
+  memcpy(unionbox, DatumGetGeoBoxTypeP(entryvec->vector[list[0]].key), sizeof(struct geo_box));
+
+  for (int i = 1; i < n; ++i)
+    adjustGeoBox(unionbox, DatumGetGeoBoxTypeP(entryvec->vector[list[i]].key));
+}
+
+
+/* Fills one side of the split vector */
+static Datum
+make_split_side(GistEntryVector *entryvec, OffsetNumber *list, int n)
+{
+  struct geo_box *unionbox = (struct geo_box *) palloc(sizeof(struct geo_box));
+
+  union_gbox_list(entryvec, list, n, unionbox);
+
+  return PointerGetDatum(unionbox);
+}
+
+
+/*
+ * Uses linear algorithm from Ang & Tan [2]:
+ * each entry goes to the side of the page union it is nearer to,
+ * once along the x-axis (left/right) and once along the y-axis (bottom/top).
+ * We keep the axis with the most even distribution, breaking ties by the
+ * smallest overlap between the two resulting boxes.
+ */
+
+PG_FUNCTION_INFO_V1(geo_box_picksplit);
+
+Datum
+geo_box_picksplit(PG_FUNCTION_ARGS)
+{
+  GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+
+  /* This is the Split Vector to be returned by the PickSplit method */
+  GIST_SPLITVEC *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1);
+
+  OffsetNumber maxoff = entryvec->n - 1;
+
+  /* rectangles that are nearer to a border than to its opposite */
+  OffsetNumber *listL, *listR, *listB, *listT;
+
+  int posL = 0, posR = 0, posB = 0, posT = 0;
+
+  OffsetNumber *left, *right;
+
+  int nleft, nright;
+
+  struct geo_box pageunion;
+
+  OffsetNumber i;
+
+  instr_time start;
+
+  geo_counter_start(&start);
+
+  Size nbytes = (maxoff + 2) * sizeof(OffsetNumber);
+
+  listL = (OffsetNumber *) palloc(nbytes);
+  listR = (OffsetNumber *) palloc(nbytes);
+  listB = (OffsetNumber *) palloc(nbytes);
+  listT = (OffsetNumber *) palloc(nbytes);
+
+  memcpy(&pageunion, DatumGetGeoBoxTypeP(entryvec->vector[FirstOffsetNumber].key), sizeof(struct geo_box));
+
+  for (i = OffsetNumberNext(FirstOffsetNumber); i <= maxoff; i = OffsetNumberNext(i))
+    adjustGeoBox(&pageunion, DatumGetGeoBoxTypeP(entryvec->vector[i].key));
+
+  for (i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+  {
+    struct geo_box *cur = DatumGetGeoBoxTypeP(entryvec->vector[i].key);
+
+    if ((cur->low.x - pageunion.low.x) < (pageunion.high.x - cur->high.x))
+      listL[posL++] = i;
+    else
+      listR[posR++] = i;
+
+    if ((cur->low.y - pageunion.low.y) < (pageunion.high.y - cur->high.y))
+      listB[posB++] = i;
+    else
+      listT[posT++] = i;
+  }
+
+  if (Max(posL, posR) < Max(posB, posT))
+  {
+    left = listL; nleft = posL;
+    right = listR; nright = posR;
+  }
+  else if (Max(posL, posR) > Max(posB, posT))
+  {
+    left = listB; nleft = posB;
+    right = listT; nright = posT;
+  }
+  else if (posL == 0 || posR == 0)
+  {
+    left = listL; nleft = posL;
+    right = listR; nright = posR;
+  }
+  else
+  {
+    struct geo_box ul, ur, ub, ut;
+
+    union_gbox_list(entryvec, listL, posL, &ul);
+    union_gbox_list(entryvec, listR, posR, &ur);
+    union_gbox_list(entryvec, listB, posB, &ub);
+    union_gbox_list(entryvec, listT, posT, &ut);
+
+    if (overlap_area_gbox(&ul, &ur) <= overlap_area_gbox(&ub, &ut))
+    {
+      left = listL; nleft = posL;
+      right = listR; nright = posR;
+    }
+    else
+    {
+      left = listB; nleft = posB;
+      right = listT; nright = posT;
+    }
+  }
+
+/* all the entries are identical or nested: just split them in half */
+  if (nleft == 0 || nright == 0)
+  {
+    nleft = nright = 0;
+
+    left = listL;
+    right = listR;
+
+    for (i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+    {
+      if (i <= (maxoff + 1) / 2)
+        left[nleft++] = i;
+      else
+        right[nright++] = i;
+    }
+  }
+
+  v->spl_left = left;
+  v->spl_nleft = nleft;
+  v->spl_ldatum = make_split_side(entryvec, left, nleft);
+
+  v->spl_right = right;
+  v->spl_nright = nright;
+  v->spl_rdatum = make_split_side(entryvec, right, nright);
+
+  geo_counter_stop(GEO_COUNTER_GIST_PICKSPLIT, &start);
+
+  PG_RETURN_POINTER(v);
+}
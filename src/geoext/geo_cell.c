@@ -0,0 +1,580 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_cell.c
+ *
+ * \brief Hilbert cell keys and geohashes for geo_point.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_cell.h"
+#include "geo_box.h"
+#include "geo_point.h"
+#include "algorithms.h"
+
+
+/* PostgreSQL */
+#include <funcapi.h>
+#include <libpq/pqformat.h>
+#include <port/pg_bitutils.h>
+#include <utils/builtins.h>
+
+
+/* C Standard Library */
+#include <math.h>
+#include <stdio.h>
+
+
+/*
+ * The domain of the grid.
+ */
+#define GEO_CELL_XMIN (-180.0)
+#define GEO_CELL_YMIN (-90.0)
+#define GEO_CELL_WIDTH 360.0
+#define GEO_CELL_HEIGHT 180.0
+
+/* number of leaf cells along each axis */
+#define GEO_CELL_GRID_SIZE (UINT64CONST(1) << GEO_CELL_MAX_LEVEL)
+
+
+/*
+ * Maximum number of cells visited by cells_covering.
+ *
+ * Only the cells crossed by the border of the box are refined, so it is
+ * only reached for large boxes at fine levels.
+ *
+ */
+#define GEO_CELL_COVERING_MAX_CELLS (1 << 20)
+
+
+/*
+ * Auxiliary functions.
+ *
+ */
+static inline int64
+geo_cell_make(int level, uint64 pos)
+{
+  return (int64) (((pos << 1) | 1) << (2 * (GEO_CELL_MAX_LEVEL - level)));
+}
+
+
+static inline bool
+geo_cell_is_valid(int64 cell)
+{
+  return (cell > 0) &&
+         (cell < geo_cell_make(0, 1)) &&
+         ((pg_rightmost_one_pos64((uint64) cell) & 1) == 0);
+}
+
+
+static inline int
+geo_cell_level_i(int64 cell)
+{
+  return GEO_CELL_MAX_LEVEL - pg_rightmost_one_pos64((uint64) cell) / 2;
+}
+
+
+static inline uint64
+geo_cell_pos(int64 cell, int level)
+{
+  return ((uint64) cell) >> (2 * (GEO_CELL_MAX_LEVEL - level) + 1);
+}
+
+
+static inline void
+geo_cell_check(int64 cell)
+{
+  if(!geo_cell_is_valid(cell))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("invalid geo_cell value: " INT64_FORMAT, cell)));
+}
+
+
+static inline void
+geo_cell_check_level(int level)
+{
+  if((level < 0) || (level > GEO_CELL_MAX_LEVEL))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("cell level must be between 0 and %d: %d",
+                           GEO_CELL_MAX_LEVEL, level)));
+}
+
+
+/*
+ * Maps a coordinate to a leaf column (or row), clamping it to the domain.
+ */
+static inline uint32
+geo_cell_grid_index(double v, double vmin, double extent)
+{
+  double t = (v - vmin) / extent * (double) GEO_CELL_GRID_SIZE;
+
+  if(t <= 0.0)
+    return 0;
+
+  if(t >= (double) GEO_CELL_GRID_SIZE)
+    return (uint32) (GEO_CELL_GRID_SIZE - 1);
+
+  return (uint32) t;
+}
+
+
+static void
+geo_cell_bbox_i(int level, uint32 x, uint32 y, struct geo_box *box)
+{
+  double w = GEO_CELL_WIDTH / (double) (UINT64CONST(1) << level);
+  double h = GEO_CELL_HEIGHT / (double) (UINT64CONST(1) << level);
+
+  box->low.x = GEO_CELL_XMIN + x * w;
+  box->low.y = GEO_CELL_YMIN + y * h;
+  box->high.x = GEO_CELL_XMIN + (x + 1) * w;
+  box->high.y = GEO_CELL_YMIN + (y + 1) * h;
+}
+
+
+/*
+ * I/O functions
+ *
+ * The text representation is "level/position", where position is the
+ * order of the cell along the Hilbert curve of its level.
+ *
+ */
+PG_FUNCTION_INFO_V1(geo_cell_in);
+
+Datum
+geo_cell_in(PG_FUNCTION_ARGS)
+{
+  char *str = PG_GETARG_CSTRING(0);
+
+  int level = -1;
+  long long pos = -1;
+  int nchars = 0;
+
+  if((sscanf(str, " %d/%lld %n", &level, &pos, &nchars) != 2) ||
+     (str[nchars] != '\0') ||
+     (level < 0) || (level > GEO_CELL_MAX_LEVEL) ||
+     (pos < 0) || ((uint64) pos >= (UINT64CONST(1) << (2 * level))))
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+            errmsg("invalid input syntax for type %s: \"%s\"",
+            "geo_cell", str)));
+
+  PG_RETURN_GEOCELL(geo_cell_make(level, (uint64) pos));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_out);
+
+Datum
+geo_cell_out(PG_FUNCTION_ARGS)
+{
+  int64 cell = PG_GETARG_GEOCELL(0);
+
+  int level = geo_cell_level_i(cell);
+
+  PG_RETURN_CSTRING(psprintf("%d/" UINT64_FORMAT, level, geo_cell_pos(cell, level)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_recv);
+
+Datum
+geo_cell_recv(PG_FUNCTION_ARGS)
+{
+  StringInfo buf = (StringInfo) PG_GETARG_POINTER(0);
+
+  int64 cell = pq_getmsgint64(buf);
+
+  geo_cell_check(cell);
+
+  PG_RETURN_GEOCELL(cell);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_send);
+
+Datum
+geo_cell_send(PG_FUNCTION_ARGS)
+{
+  int64 cell = PG_GETARG_GEOCELL(0);
+
+  StringInfoData buf;
+
+  pq_begintypsend(&buf);
+
+  pq_sendint64(&buf, cell);
+
+  PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+
+/*
+ * Cell properties
+ *
+ */
+PG_FUNCTION_INFO_V1(geo_cell_level);
+
+Datum
+geo_cell_level(PG_FUNCTION_ARGS)
+{
+  int64 cell = PG_GETARG_GEOCELL(0);
+
+  PG_RETURN_INT32(geo_cell_level_i(cell));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_bbox);
+
+Datum
+geo_cell_bbox(PG_FUNCTION_ARGS)
+{
+  int64 cell = PG_GETARG_GEOCELL(0);
+
+  int level = geo_cell_level_i(cell);
+
+  uint32 x, y;
+
+  struct geo_box *box = (struct geo_box*) palloc(sizeof(struct geo_box));
+
+  hilbert_d2xy(level, geo_cell_pos(cell, level), &x, &y);
+
+  geo_cell_bbox_i(level, x, y, box);
+
+  PG_RETURN_GEOBOX_TYPE_P(box);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_range_min);
+
+Datum
+geo_cell_range_min(PG_FUNCTION_ARGS)
+{
+  int64 cell = PG_GETARG_GEOCELL(0);
+
+  int64 lsb = cell & -cell;
+
+  PG_RETURN_GEOCELL(cell - lsb + 1);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_range_max);
+
+Datum
+geo_cell_range_max(PG_FUNCTION_ARGS)
+{
+  int64 cell = PG_GETARG_GEOCELL(0);
+
+  int64 lsb = cell & -cell;
+
+  PG_RETURN_GEOCELL(cell + lsb - 1);
+}
+
+
+/*
+ * Keys of a geo_point
+ *
+ */
+PG_FUNCTION_INFO_V1(geo_point_hilbert_key);
+
+Datum
+geo_point_hilbert_key(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  int level = PG_GETARG_INT32(1);
+
+  uint32 x, y;
+
+  uint64 pos;
+
+  geo_cell_check_level(level);
+
+  if(isnan(pt->coord.x) || isnan(pt->coord.y))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("can not compute the cell of a point with NaN coordinates")));
+
+/* points outside the domain fall into the cells along its border */
+  x = geo_cell_grid_index(pt->coord.x, GEO_CELL_XMIN, GEO_CELL_WIDTH);
+  y = geo_cell_grid_index(pt->coord.y, GEO_CELL_YMIN, GEO_CELL_HEIGHT);
+
+  pos = hilbert_xy2d(GEO_CELL_MAX_LEVEL, x, y) >> (2 * (GEO_CELL_MAX_LEVEL - level));
+
+  PG_RETURN_GEOCELL(geo_cell_make(level, pos));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_geohash);
+
+Datum
+geo_point_geohash(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  int precision = PG_GETARG_INT32(1);
+
+  char hash[GEOHASH_MAX_PRECISION + 1];
+
+  if((precision < 1) || (precision > GEOHASH_MAX_PRECISION))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("geohash precision must be between 1 and %d: %d",
+                           GEOHASH_MAX_PRECISION, precision)));
+
+  if(!(pt->coord.x >= -180.0 && pt->coord.x <= 180.0 &&
+       pt->coord.y >= -90.0 && pt->coord.y <= 90.0))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("geohash requires longitude/latitude coordinates: (%g, %g)",
+                           pt->coord.x, pt->coord.y)));
+
+  geohash_encode(pt->coord.x, pt->coord.y, precision, hash);
+
+  PG_RETURN_TEXT_P(cstring_to_text(hash));
+}
+
+
+/*
+ * Covering of a box by ranges of leaf cells
+ *
+ */
+struct geo_cell_covering
+{
+  const struct geo_box *box;
+  int max_level;
+  int nvisited;
+  bool has_range;     /* range_min and range_max hold a pending range. */
+  int64 range_min;
+  int64 range_max;
+  ReturnSetInfo *rsinfo;
+};
+
+
+static void
+geo_cell_covering_flush(struct geo_cell_covering *st)
+{
+  Datum values[2];
+  bool nulls[2] = { false, false };
+
+  if(!st->has_range)
+    return;
+
+  values[0] = GeoCellGetDatum(st->range_min);
+  values[1] = GeoCellGetDatum(st->range_max);
+
+  tuplestore_putvalues(st->rsinfo->setResult, st->rsinfo->setDesc, values, nulls);
+
+  st->has_range = false;
+}
+
+
+static void
+geo_cell_covering_emit(struct geo_cell_covering *st, int64 cell)
+{
+  int64 lsb = cell & -cell;
+
+  int64 rmin = cell - lsb + 1;
+  int64 rmax = cell + lsb - 1;
+
+/* the cells come in Hilbert order: merge the ones that touch the last range */
+  if(st->has_range && (rmin <= st->range_max + 2))
+  {
+    st->range_max = rmax;
+    return;
+  }
+
+  geo_cell_covering_flush(st);
+
+  st->has_range = true;
+  st->range_min = rmin;
+  st->range_max = rmax;
+}
+
+
+static void
+geo_cell_covering_visit(struct geo_cell_covering *st, int level, uint64 pos)
+{
+  const struct geo_box *box = st->box;
+
+  struct geo_box cbox;
+
+  uint32 x, y;
+
+  if(++st->nvisited > GEO_CELL_COVERING_MAX_CELLS)
+    ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                    errmsg("cells_covering visited more than %d cells",
+                           GEO_CELL_COVERING_MAX_CELLS),
+                    errhint("Use a lower level.")));
+
+  hilbert_d2xy(level, pos, &x, &y);
+
+  geo_cell_bbox_i(level, x, y, &cbox);
+
+  if((box->high.x < cbox.low.x) || (box->low.x > cbox.high.x) ||
+     (box->high.y < cbox.low.y) || (box->low.y > cbox.high.y))
+    return;
+
+  if((level == st->max_level) ||
+     ((box->low.x <= cbox.low.x) && (box->high.x >= cbox.high.x) &&
+      (box->low.y <= cbox.low.y) && (box->high.y >= cbox.high.y)))
+  {
+    geo_cell_covering_emit(st, geo_cell_make(level, pos));
+    return;
+  }
+
+/* the children of a cell are the next four positions of the finer curve */
+  for(uint64 k = 0; k < 4; ++k)
+    geo_cell_covering_visit(st, level + 1, 4 * pos + k);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box_cells_covering);
+
+Datum
+geo_box_cells_covering(PG_FUNCTION_ARGS)
+{
+  struct geo_box *box = PG_GETARG_GEOBOX_TYPE_P(0);
+
+  int level = PG_GETARG_INT32(1);
+
+  struct geo_box clamped;
+
+  struct geo_cell_covering st;
+
+  geo_cell_check_level(level);
+
+  if(isnan(box->low.x) || isnan(box->low.y) ||
+     isnan(box->high.x) || isnan(box->high.y))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("can not cover a box with NaN coordinates")));
+
+/*
+  as hilbert_key puts the points outside the domain into the cells along
+  its border, the box is clamped the same way: a box wholly outside the
+  domain is covered by the border cells its points fall into
+*/
+  clamped.low.x = Min(Max(box->low.x, GEO_CELL_XMIN), GEO_CELL_XMIN + GEO_CELL_WIDTH);
+  clamped.low.y = Min(Max(box->low.y, GEO_CELL_YMIN), GEO_CELL_YMIN + GEO_CELL_HEIGHT);
+  clamped.high.x = Min(Max(box->high.x, GEO_CELL_XMIN), GEO_CELL_XMIN + GEO_CELL_WIDTH);
+  clamped.high.y = Min(Max(box->high.y, GEO_CELL_YMIN), GEO_CELL_YMIN + GEO_CELL_HEIGHT);
+
+  InitMaterializedSRF(fcinfo, 0);
+
+  st.box = &clamped;
+  st.max_level = level;
+  st.nvisited = 0;
+  st.has_range = false;
+  st.range_min = 0;
+  st.range_max = 0;
+  st.rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+  geo_cell_covering_visit(&st, 0, 0);
+
+  geo_cell_covering_flush(&st);
+
+  return (Datum) 0;
+}
+
+
+/*
+ * B-tree operators for geo_cell
+ *
+ * The order is the one of the int64 representation.
+ *
+ */
+static inline int
+geo_cell_cmp_i(int64 first, int64 second)
+{
+  if(first < second)
+    return -1;
+  else if(first > second)
+    return 1;
+  else
+    return 0;
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_cmp);
+
+Datum
+geo_cell_cmp(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_INT32(geo_cell_cmp_i(PG_GETARG_GEOCELL(0), PG_GETARG_GEOCELL(1)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_eq);
+
+Datum
+geo_cell_eq(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(PG_GETARG_GEOCELL(0) == PG_GETARG_GEOCELL(1));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_ne);
+
+Datum
+geo_cell_ne(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(PG_GETARG_GEOCELL(0) != PG_GETARG_GEOCELL(1));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_lt);
+
+Datum
+geo_cell_lt(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(PG_GETARG_GEOCELL(0) < PG_GETARG_GEOCELL(1));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_gt);
+
+Datum
+geo_cell_gt(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(PG_GETARG_GEOCELL(0) > PG_GETARG_GEOCELL(1));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_le);
+
+Datum
+geo_cell_le(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(PG_GETARG_GEOCELL(0) <= PG_GETARG_GEOCELL(1));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cell_ge);
+
+Datum
+geo_cell_ge(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(PG_GETARG_GEOCELL(0) >= PG_GETARG_GEOCELL(1));
+}
@@ -0,0 +1,109 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_cell.h
+ *
+ * \brief A geo_cell is a cell of a hierarchical grid over the longitude/latitude domain.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_CELL_H__
+#define __GEOEXT_GEO_CELL_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+
+/*
+ * The domain [-180, 180] x [-90, 90] is split into a quadtree of
+ * GEO_CELL_MAX_LEVEL levels. At level l there are 2^l x 2^l cells,
+ * numbered along a Hilbert curve of order l.
+ *
+ * A cell of level l with Hilbert position d is stored in an int64 as:
+ *
+ *   ((d << 1) | 1) << 2 * (GEO_CELL_MAX_LEVEL - l)
+ *
+ * The lowest set bit tells the level and the leaf cells (level
+ * GEO_CELL_MAX_LEVEL) are odd numbers. The leaf cells of a cell c form the
+ * contiguous range [c - lsb + 1, c + lsb - 1], where lsb is the lowest set
+ * bit of c, so the integer order of the keys is the Hilbert order and a
+ * B-tree over leaf keys can answer window queries as a few range scans.
+ *
+ */
+#define GEO_CELL_MAX_LEVEL 30
+
+
+/*
+ * geo_cell is a fixed-size pass-by-value type.
+ *
+ * Below we have the fmgr interface macros for dealing with a geo_cell.
+ *
+ */
+#define DatumGetGeoCell(X)      DatumGetInt64(X)
+#define GeoCellGetDatum(X)      Int64GetDatum(X)
+#define PG_GETARG_GEOCELL(n)    PG_GETARG_INT64(n)
+#define PG_RETURN_GEOCELL(x)    PG_RETURN_INT64(x)
+
+
+/*
+ * geo_cell operations.
+ *
+ */
+extern Datum geo_cell_in(PG_FUNCTION_ARGS);
+extern Datum geo_cell_out(PG_FUNCTION_ARGS);
+
+extern Datum geo_cell_recv(PG_FUNCTION_ARGS);
+extern Datum geo_cell_send(PG_FUNCTION_ARGS);
+
+extern Datum geo_cell_level(PG_FUNCTION_ARGS);
+extern Datum geo_cell_parent(PG_FUNCTION_ARGS);
+extern Datum geo_cell_bbox(PG_FUNCTION_ARGS);
+extern Datum geo_cell_range_min(PG_FUNCTION_ARGS);
+extern Datum geo_cell_range_max(PG_FUNCTION_ARGS);
+
+extern Datum geo_point_hilbert_key(PG_FUNCTION_ARGS);
+extern Datum geo_point_geohash(PG_FUNCTION_ARGS);
+
+extern Datum geo_box_cells_covering(PG_FUNCTION_ARGS);
+
+
+/*
+ * B-tree index support
+ *
+ */
+extern Datum geo_cell_cmp(PG_FUNCTION_ARGS);
+extern Datum geo_cell_eq(PG_FUNCTION_ARGS);
+extern Datum geo_cell_ne(PG_FUNCTION_ARGS);
+extern Datum geo_cell_lt(PG_FUNCTION_ARGS);
+extern Datum geo_cell_gt(PG_FUNCTION_ARGS);
+extern Datum geo_cell_le(PG_FUNCTION_ARGS);
+extern Datum geo_cell_ge(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_CELL_H__ */
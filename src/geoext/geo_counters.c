@@ -0,0 +1,312 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_counters.c
+ *
+ * \brief Per-backend counters for the hot paths of GeoExt.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExt */
+#include "geo_counters.h"
+#include "geo_fence.h"
+
+
+/* PostgreSQL */
+#include <access/xact.h>
+#include <funcapi.h>
+#include <miscadmin.h>
+#include <port/atomics.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/builtins.h>
+#include <utils/timestamp.h>
+
+
+/*
+ * The counters in shared memory.
+ */
+struct geo_counters_shared
+{
+  pg_atomic_uint64 calls[GEO_COUNTER_NUM];
+  pg_atomic_uint64 time_ns[GEO_COUNTER_NUM];
+  pg_atomic_uint64 reset_time;        /* A TimestampTz. */
+};
+
+
+/*
+ * Name of each counter and whether it is ever timed.
+ */
+static const struct
+{
+  const char *name;
+  bool timed;
+} geo_counter_info[GEO_COUNTER_NUM] =
+{
+  { "gist_consistent",    true  },
+  { "gist_union",         false },
+  { "gist_penalty",       false },
+  { "gist_picksplit",     true  },
+  { "detoast",            false },
+  { "point_in_polygon",   true  },
+  { "pip_edge_tests",     false },
+  { "wkt_parse",          true  },
+  { "wkt_output",         true  },
+  { "trajectory_add",     true  },
+  { "trajectory_final",   true  },
+  { "prepared_cache_hit",  false },
+  { "prepared_cache_miss", false },
+  { "fence_hits",          true  }
+};
+
+
+struct geo_counters geo_counters_pending;
+
+bool geoext_track_counters = true;
+
+bool geoext_track_timing = false;
+
+
+/* NULL unless the library was preloaded */
+static struct geo_counters_shared *geo_counters_shared = NULL;
+
+/* the totals when there is no shared memory */
+static struct geo_counters geo_counters_local;
+
+static TimestampTz geo_counters_local_reset_time = 0;
+
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+/*
+ * Adds the pending counts to the totals.
+ */
+static void
+geo_counters_flush(void)
+{
+  for (int c = 0; c < GEO_COUNTER_NUM; ++c)
+  {
+    uint64 calls = geo_counters_pending.calls[c];
+    uint64 time_ns = geo_counters_pending.time_ns[c];
+
+    if (calls == 0 && time_ns == 0)
+      continue;
+
+    if (geo_counters_shared != NULL)
+    {
+      pg_atomic_fetch_add_u64(&geo_counters_shared->calls[c], (int64) calls);
+      pg_atomic_fetch_add_u64(&geo_counters_shared->time_ns[c], (int64) time_ns);
+    }
+    else
+    {
+      geo_counters_local.calls[c] += calls;
+      geo_counters_local.time_ns[c] += time_ns;
+    }
+
+    geo_counters_pending.calls[c] = 0;
+    geo_counters_pending.time_ns[c] = 0;
+  }
+}
+
+
+static void
+geo_counters_xact_callback(XactEvent event, void *arg)
+{
+  switch (event)
+  {
+    case XACT_EVENT_COMMIT:
+    case XACT_EVENT_PARALLEL_COMMIT:
+    case XACT_EVENT_ABORT:
+    case XACT_EVENT_PARALLEL_ABORT:
+      geo_counters_flush();
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+static void
+geo_counters_shmem_request(void)
+{
+  if (prev_shmem_request_hook)
+    prev_shmem_request_hook();
+
+  RequestAddinShmemSpace(MAXALIGN(sizeof(struct geo_counters_shared)));
+}
+
+
+static void
+geo_counters_shmem_startup(void)
+{
+  bool found;
+
+  if (prev_shmem_startup_hook)
+    prev_shmem_startup_hook();
+
+  LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+  geo_counters_shared = (struct geo_counters_shared*)
+    ShmemInitStruct("geoext counters", sizeof(struct geo_counters_shared), &found);
+
+  if (!found)
+  {
+    for (int c = 0; c < GEO_COUNTER_NUM; ++c)
+    {
+      pg_atomic_init_u64(&geo_counters_shared->calls[c], 0);
+      pg_atomic_init_u64(&geo_counters_shared->time_ns[c], 0);
+    }
+
+    pg_atomic_init_u64(&geo_counters_shared->reset_time, (uint64) GetCurrentTimestamp());
+  }
+
+  LWLockRelease(AddinShmemInitLock);
+}
+
+
+void
+geo_counters_init(void)
+{
+  if (process_shared_preload_libraries_in_progress)
+  {
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = geo_counters_shmem_request;
+
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = geo_counters_shmem_startup;
+  }
+
+  geo_counters_local_reset_time = GetCurrentTimestamp();
+
+  RegisterXactCallback(geo_counters_xact_callback, NULL);
+}
+
+
+PG_FUNCTION_INFO_V1(geoext_stats);
+
+Datum
+geoext_stats(PG_FUNCTION_ARGS)
+{
+  ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+
+  TimestampTz reset_time;
+
+  InitMaterializedSRF(fcinfo, 0);
+
+/* include the counts of the current transaction */
+  geo_counters_flush();
+
+  reset_time = (geo_counters_shared != NULL) ?
+               (TimestampTz) pg_atomic_read_u64(&geo_counters_shared->reset_time) :
+               geo_counters_local_reset_time;
+
+  for (int c = 0; c < GEO_COUNTER_NUM; ++c)
+  {
+    Datum values[4];
+    bool nulls[4] = { false, false, false, false };
+
+    uint64 calls, time_ns;
+
+    if (geo_counters_shared != NULL)
+    {
+      calls = pg_atomic_read_u64(&geo_counters_shared->calls[c]);
+      time_ns = pg_atomic_read_u64(&geo_counters_shared->time_ns[c]);
+    }
+    else
+    {
+      calls = geo_counters_local.calls[c];
+      time_ns = geo_counters_local.time_ns[c];
+    }
+
+    values[0] = CStringGetTextDatum(geo_counter_info[c].name);
+    values[1] = Int64GetDatum((int64) calls);
+
+/* total time in milliseconds */
+    if (geo_counter_info[c].timed)
+      values[2] = Float8GetDatum(time_ns / 1.0e6);
+    else
+      nulls[2] = true;
+
+    values[3] = TimestampTzGetDatum(reset_time);
+
+    tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+  }
+
+/* a gauge: the memory used by the pinned geofences */
+  {
+    Datum values[4];
+    bool nulls[4] = { false, false, true, false };
+
+    int64 bytes = 0;
+    int32 nfences = 0;
+
+    geo_fence_memory(&bytes, &nfences);
+
+    values[0] = CStringGetTextDatum("fence_index_bytes");
+    values[1] = Int64GetDatum(bytes);
+    values[2] = (Datum) 0;
+    values[3] = TimestampTzGetDatum(reset_time);
+
+    tuplestore_putvalues(rsinfo->setResult, rsinfo->setDesc, values, nulls);
+  }
+
+  return (Datum) 0;
+}
+
+
+PG_FUNCTION_INFO_V1(geoext_stats_reset);
+
+Datum
+geoext_stats_reset(PG_FUNCTION_ARGS)
+{
+  memset(&geo_counters_pending, 0, sizeof(struct geo_counters));
+
+  if (geo_counters_shared != NULL)
+  {
+    for (int c = 0; c < GEO_COUNTER_NUM; ++c)
+    {
+      pg_atomic_write_u64(&geo_counters_shared->calls[c], 0);
+      pg_atomic_write_u64(&geo_counters_shared->time_ns[c], 0);
+    }
+
+    pg_atomic_write_u64(&geo_counters_shared->reset_time, (uint64) GetCurrentTimestamp());
+  }
+  else
+  {
+    memset(&geo_counters_local, 0, sizeof(struct geo_counters));
+
+    geo_counters_local_reset_time = GetCurrentTimestamp();
+  }
+
+  PG_RETURN_VOID();
+}
@@ -0,0 +1,184 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_counters.h
+ *
+ * \brief Per-backend counters for the hot paths of GeoExt.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_COUNTERS_H__
+#define __GEOEXT_GEO_COUNTERS_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+#include <portability/instr_time.h>
+
+
+/*
+ * The counted events.
+ *
+ * Each backend counts them in local memory (a plain increment). The counts
+ * are added to shared memory at the end of each transaction, and shown by
+ * the geoext_stats view. Timing is only collected for some of the events,
+ * and only when geoext.track_timing is on.
+ *
+ * Keep the names in geo_counters.c in the same order.
+ *
+ */
+enum geo_counter
+{
+  GEO_COUNTER_GIST_CONSISTENT,     /* GiST consistent calls (timed).                 */
+  GEO_COUNTER_GIST_UNION,          /* GiST union calls.                              */
+  GEO_COUNTER_GIST_PENALTY,        /* GiST penalty calls.                            */
+  GEO_COUNTER_GIST_PICKSPLIT,      /* GiST picksplit calls (timed).                  */
+  GEO_COUNTER_DETOAST,             /* Compressed or out-of-line geometries read.     */
+  GEO_COUNTER_POINT_IN_POLYGON,    /* Point in polygon tests (timed in contains).    */
+  GEO_COUNTER_PIP_EDGE_TESTS,      /* Edges visited by the point in polygon tests.   */
+  GEO_COUNTER_WKT_PARSE,           /* WKT strings decoded (timed).                   */
+  GEO_COUNTER_WKT_OUTPUT,          /* WKT strings encoded (timed).                   */
+  GEO_COUNTER_TRAJECTORY_ADD,      /* Positions added to trajectories (timed).       */
+  GEO_COUNTER_TRAJECTORY_FINAL,    /* Trajectories finalized (timed).                */
+  GEO_COUNTER_PREPARED_HIT,        /* Polygons found in the prepared cache.          */
+  GEO_COUNTER_PREPARED_MISS,       /* Polygons added to the prepared cache.          */
+  GEO_COUNTER_FENCE_HITS,          /* Points looked up in the geofence index (timed). */
+  GEO_COUNTER_NUM
+};
+
+
+/*
+ * The counts of a backend not yet added to shared memory.
+ */
+struct geo_counters
+{
+  uint64 calls[GEO_COUNTER_NUM];
+  uint64 time_ns[GEO_COUNTER_NUM];
+};
+
+
+extern struct geo_counters geo_counters_pending;
+
+
+/* GUC geoext.track_counters */
+extern bool geoext_track_counters;
+
+/* GUC geoext.track_timing */
+extern bool geoext_track_timing;
+
+
+/*
+ * \brief Counts n occurrences of an event.
+ *
+ */
+static inline void
+geo_counter_add(enum geo_counter c, uint64 n)
+{
+  if (geoext_track_counters)
+    geo_counters_pending.calls[c] += n;
+}
+
+
+/*
+ * \brief Starts timing an event: a no-op unless geoext.track_timing is on.
+ *
+ */
+static inline void
+geo_counter_start(instr_time *start)
+{
+  if (geoext_track_counters && geoext_track_timing)
+    INSTR_TIME_SET_CURRENT(*start);
+  else
+    INSTR_TIME_SET_ZERO(*start);
+}
+
+
+/*
+ * \brief Counts an event started by geo_counter_start, adding its duration when timed.
+ *
+ */
+static inline void
+geo_counter_stop(enum geo_counter c, instr_time *start)
+{
+  if (!geoext_track_counters)
+    return;
+
+  geo_counters_pending.calls[c]++;
+
+  if (!INSTR_TIME_IS_ZERO(*start))
+  {
+    instr_time duration;
+
+    INSTR_TIME_SET_CURRENT(duration);
+    INSTR_TIME_SUBTRACT(duration, *start);
+
+    geo_counters_pending.time_ns[c] += (uint64) (INSTR_TIME_GET_DOUBLE(duration) * 1.0e9);
+  }
+}
+
+
+/*
+ * \brief Detoasts a geometry, counting it if it was compressed or out-of-line.
+ *
+ */
+static inline struct varlena *
+geo_detoast_datum(Datum d)
+{
+  struct varlena *v = (struct varlena *) DatumGetPointer(d);
+
+  if (VARATT_IS_EXTENDED(v))
+  {
+    geo_counter_add(GEO_COUNTER_DETOAST, 1);
+
+    return pg_detoast_datum(v);
+  }
+
+  return v;
+}
+
+
+/*
+ * \brief Sets up the shared counters and the end of transaction flush.
+ *
+ * It must be called from _PG_init. The shared counters are only available
+ * when the library is in shared_preload_libraries. Otherwise, the view
+ * shows the counts of the current backend only.
+ *
+ */
+void geo_counters_init(void);
+
+
+/*
+ * SQL interface.
+ *
+ */
+extern Datum geoext_stats(PG_FUNCTION_ARGS);
+extern Datum geoext_stats_reset(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_COUNTERS_H__ */
@@ -0,0 +1,488 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_cpoint.c
+ *
+ * \brief A geo_cpoint is a geo_point whose SRID is the typmod of its column.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_point.h"
+#include "geo_box.h"
+#include "algorithms.h"
+#include "hexutils.h"
+
+
+/* PostgreSQL */
+#include <access/gist.h>
+#include <libpq/pqformat.h>
+#include <nodes/nodeFuncs.h>
+#include <utils/builtins.h>
+#include <utils/float.h>
+
+
+/* C Standard Library */
+#include <string.h>
+
+
+/*
+ * Utility macros.
+ */
+#define GEOEXT_GEOCPOINT_HEX_LEN ( 2 * sizeof(struct geo_cpoint) )
+
+/* The text of a geo_point (coordinates and SRID) is also accepted */
+#define GEOEXT_GEOPOINT_HEX_LEN ( 2 * ( sizeof(struct geo_point) - sizeof(int32) ) )
+
+
+/*
+ * The values do not carry their SRID: a cast takes it from the typmod of
+ * its argument, as in a column reference, or -1 if it is not known, e.g.
+ * for the result of a function.
+ */
+static int32
+geo_cpoint_arg_typmod(FunctionCallInfo fcinfo)
+{
+  Node *expr = (fcinfo->flinfo != NULL) ? fcinfo->flinfo->fn_expr : NULL;
+
+  if ((expr == NULL) || !IsA(expr, FuncExpr) || (((FuncExpr*) expr)->args == NIL))
+    return -1;
+
+  return exprTypmod((Node*) linitial(((FuncExpr*) expr)->args));
+}
+
+
+/*
+ * The values of a geo_cpoint(a) and of a geo_cpoint(b) column cannot be
+ * compared if a != b. The SRIDs are the typmods of the arguments; a value
+ * whose SRID is not known is taken to share the one of the other argument.
+ */
+void
+geo_cpoint_check_args(List *args)
+{
+  int32 srid1, srid2;
+
+  if (list_length(args) != 2)
+    return;
+
+  srid1 = exprTypmod((Node*) linitial(args));
+  srid2 = exprTypmod((Node*) lsecond(args));
+
+  if ((srid1 >= 0) && (srid2 >= 0) && (srid1 != srid2))
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("The point arguments have different SRIDs: %d e %d .", srid1, srid2)));
+}
+
+
+/* the check of a call from an expression; index scans are checked by the planner */
+static void
+geo_cpoint_check_call(FunctionCallInfo fcinfo)
+{
+  Node *expr = (fcinfo->flinfo != NULL) ? fcinfo->flinfo->fn_expr : NULL;
+
+  if (expr == NULL)
+    return;
+
+  if (IsA(expr, FuncExpr))
+    geo_cpoint_check_args(((FuncExpr*) expr)->args);
+  else if (IsA(expr, OpExpr))
+    geo_cpoint_check_args(((OpExpr*) expr)->args);
+}
+
+
+/* the SRID is never guessed */
+static void
+geo_cpoint_unknown_srid(void)
+{
+  ereport(ERROR,
+          (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+           errmsg("the SRID of the geo_cpoint value is not known"),
+           errhint("Cast the value to geo_cpoint(srid).")));
+}
+
+
+/*
+ * I/O Functions for the geo_cpoint data type
+ */
+
+PG_FUNCTION_INFO_V1(geo_cpoint_in);
+
+Datum
+geo_cpoint_in(PG_FUNCTION_ARGS)
+{
+  char *str = PG_GETARG_CSTRING(0);
+
+  int32 typmod = PG_GETARG_INT32(2);
+
+  struct geo_cpoint *pt = (struct geo_cpoint*) palloc(sizeof(struct geo_cpoint));
+
+  size_t len = strlen(str);
+
+  if (len == GEOEXT_GEOCPOINT_HEX_LEN)
+  {
+    hex2binary(str, GEOEXT_GEOCPOINT_HEX_LEN, (char*) pt);
+  }
+  else if (len == GEOEXT_GEOPOINT_HEX_LEN)
+  {
+    struct geo_point gpt;
+
+    hex2binary(str, GEOEXT_GEOPOINT_HEX_LEN, (char*) &gpt);
+
+    geo_srid_check_typmod(gpt.srid, typmod);
+
+    pt->coord = gpt.coord;
+  }
+  else
+  {
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+             errmsg("invalid input syntax for type %s: \"%s\"",
+                    "geo_cpoint", str)));
+  }
+
+  PG_RETURN_GEOCPOINT_TYPE_P(pt);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_out);
+
+Datum
+geo_cpoint_out(PG_FUNCTION_ARGS)
+{
+  struct geo_cpoint *pt = PG_GETARG_GEOCPOINT_TYPE_P(0);
+
+/* alloc a buffer for hex-string plus a trailing '\0' */
+  char *hstr = palloc(GEOEXT_GEOCPOINT_HEX_LEN + 1);
+
+  binary2hex((char*) pt, sizeof(struct geo_cpoint), hstr);
+
+  PG_RETURN_CSTRING(hstr);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_recv);
+
+Datum
+geo_cpoint_recv(PG_FUNCTION_ARGS)
+{
+  StringInfo buf = (StringInfo) PG_GETARG_POINTER(0);
+
+  struct geo_cpoint *result = (struct geo_cpoint*) palloc(sizeof(struct geo_cpoint));
+
+  result->coord.x = pq_getmsgfloat8(buf);
+  result->coord.y = pq_getmsgfloat8(buf);
+
+  PG_RETURN_GEOCPOINT_TYPE_P(result);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_send);
+
+Datum
+geo_cpoint_send(PG_FUNCTION_ARGS)
+{
+  struct geo_cpoint *pt = PG_GETARG_GEOCPOINT_TYPE_P(0);
+
+  StringInfoData buf;
+
+  pq_begintypsend(&buf);
+
+  pq_sendfloat8(&buf, pt->coord.x);
+  pq_sendfloat8(&buf, pt->coord.y);
+
+  PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+
+/*
+ * Casts
+ */
+
+/*
+ * The length coercion cast: a geo_cpoint(a) is stored in a geo_cpoint(b)
+ * column only if a = b. A value of unknown SRID only gets one from an
+ * explicit cast, as in value::geo_cpoint(4326); an implicit or assignment
+ * coercion is an error. The third argument tells if the cast is explicit:
+ * the FuncExpr of the call can not tell it, as the planner rebuilds it as
+ * a plain call when it folds a constant.
+ */
+
+PG_FUNCTION_INFO_V1(geo_cpoint_enforce_typmod);
+
+Datum
+geo_cpoint_enforce_typmod(PG_FUNCTION_ARGS)
+{
+  struct geo_cpoint *pt = PG_GETARG_GEOCPOINT_TYPE_P(0);
+
+  int32 typmod = PG_GETARG_INT32(1);
+
+  bool is_explicit = PG_GETARG_BOOL(2);
+
+  int32 srid = geo_cpoint_arg_typmod(fcinfo);
+
+  if (srid >= 0)
+    geo_srid_check_typmod(srid, typmod);
+  else if ((typmod >= 0) && !is_explicit)
+    geo_cpoint_unknown_srid();
+
+  PG_RETURN_GEOCPOINT_TYPE_P(pt);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_from_geo_point);
+
+Datum
+geo_cpoint_from_geo_point(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  int32 typmod = PG_GETARG_INT32(1);
+
+  struct geo_cpoint *result = (struct geo_cpoint*) palloc(sizeof(struct geo_cpoint));
+
+  geo_srid_check_typmod(pt->srid, typmod);
+
+  result->coord = pt->coord;
+
+  PG_RETURN_GEOCPOINT_TYPE_P(result);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_to_geo_point);
+
+Datum
+geo_cpoint_to_geo_point(PG_FUNCTION_ARGS)
+{
+  struct geo_cpoint *pt = PG_GETARG_GEOCPOINT_TYPE_P(0);
+
+  int32 srid = geo_cpoint_arg_typmod(fcinfo);
+
+  struct geo_point *result = (struct geo_point*) palloc(sizeof(struct geo_point));
+
+  if (srid < 0)
+    geo_cpoint_unknown_srid();
+
+  result->coord = pt->coord;
+  result->srid = srid;
+  result->dummy = 0;
+
+  PG_RETURN_GEOPOINT_TYPE_P(result);
+}
+
+
+/*
+ * geo_cpoint operations
+ */
+
+PG_FUNCTION_INFO_V1(geo_cpoint_distance);
+
+Datum
+geo_cpoint_distance(PG_FUNCTION_ARGS)
+{
+  struct geo_cpoint *pt1 = PG_GETARG_GEOCPOINT_TYPE_P(0);
+
+  struct geo_cpoint *pt2 = PG_GETARG_GEOCPOINT_TYPE_P(1);
+
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_FLOAT8(euclidian_distance(&(pt1->coord), &(pt2->coord)));
+}
+
+
+/*
+ * B-tree operators for geo_cpoint: the same order as geo_point.
+ */
+
+static inline int
+geo_cpoint_cmp_i(const struct geo_cpoint *first,
+                 const struct geo_cpoint *second)
+{
+  if(first->coord.x < second->coord.x)
+    return -1;
+  else if(first->coord.x > second->coord.x)
+    return 1;
+  else if(first->coord.y < second->coord.y)
+    return -1;
+  else if(first->coord.y > second->coord.y)
+    return 1;
+  else
+    return 0;
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_cmp);
+
+Datum
+geo_cpoint_cmp(PG_FUNCTION_ARGS)
+{
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_INT32(geo_cpoint_cmp_i(PG_GETARG_GEOCPOINT_TYPE_P(0), PG_GETARG_GEOCPOINT_TYPE_P(1)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_eq);
+
+Datum
+geo_cpoint_eq(PG_FUNCTION_ARGS)
+{
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_BOOL(geo_cpoint_cmp_i(PG_GETARG_GEOCPOINT_TYPE_P(0), PG_GETARG_GEOCPOINT_TYPE_P(1)) == 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_ne);
+
+Datum
+geo_cpoint_ne(PG_FUNCTION_ARGS)
+{
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_BOOL(geo_cpoint_cmp_i(PG_GETARG_GEOCPOINT_TYPE_P(0), PG_GETARG_GEOCPOINT_TYPE_P(1)) != 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_lt);
+
+Datum
+geo_cpoint_lt(PG_FUNCTION_ARGS)
+{
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_BOOL(geo_cpoint_cmp_i(PG_GETARG_GEOCPOINT_TYPE_P(0), PG_GETARG_GEOCPOINT_TYPE_P(1)) < 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_gt);
+
+Datum
+geo_cpoint_gt(PG_FUNCTION_ARGS)
+{
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_BOOL(geo_cpoint_cmp_i(PG_GETARG_GEOCPOINT_TYPE_P(0), PG_GETARG_GEOCPOINT_TYPE_P(1)) > 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_le);
+
+Datum
+geo_cpoint_le(PG_FUNCTION_ARGS)
+{
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_BOOL(geo_cpoint_cmp_i(PG_GETARG_GEOCPOINT_TYPE_P(0), PG_GETARG_GEOCPOINT_TYPE_P(1)) <= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_ge);
+
+Datum
+geo_cpoint_ge(PG_FUNCTION_ARGS)
+{
+  geo_cpoint_check_call(fcinfo);
+
+  PG_RETURN_BOOL(geo_cpoint_cmp_i(PG_GETARG_GEOCPOINT_TYPE_P(0), PG_GETARG_GEOCPOINT_TYPE_P(1)) >= 0);
+}
+
+
+/*
+ * GiST operators for geo_cpoint
+ */
+
+/*
+ * The keys are the ones of geo_point (see geo_point_gist.c): a leaf key is
+ * the point with a zero SRID, so the opclass shares all the other support
+ * functions of gist_geo_point_ops. The key holds the whole value, so the
+ * index also has a fetch method and can be used by index-only scans.
+ */
+
+PG_FUNCTION_INFO_V1(geo_cpoint_box_overlap);
+
+Datum
+geo_cpoint_box_overlap(PG_FUNCTION_ARGS)
+{
+  struct geo_cpoint *pt = PG_GETARG_GEOCPOINT_TYPE_P(0);
+
+  struct geo_box *box = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  PG_RETURN_BOOL(float8_cmp_internal(pt->coord.x, box->low.x) >= 0 &&
+                 float8_cmp_internal(pt->coord.x, box->high.x) <= 0 &&
+                 float8_cmp_internal(pt->coord.y, box->low.y) >= 0 &&
+                 float8_cmp_internal(pt->coord.y, box->high.y) <= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_gist_compress);
+
+Datum
+geo_cpoint_gist_compress(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  GISTENTRY *retval = entry;
+
+  if (entry->leafkey)
+  {
+    struct geo_point *pt = (struct geo_point*) palloc(sizeof(struct geo_point));
+
+    pt->coord = DatumGetGeoCPointTypeP(entry->key)->coord;
+    pt->srid = 0;
+    pt->dummy = 0;
+
+    retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+
+    gistentryinit(*retval, PointerGetDatum(pt),
+                  entry->rel, entry->page, entry->offset, false);
+  }
+
+  PG_RETURN_POINTER(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_gist_fetch);
+
+Datum
+geo_cpoint_gist_fetch(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_cpoint *pt = (struct geo_cpoint*) palloc(sizeof(struct geo_cpoint));
+
+  GISTENTRY *retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+
+  pt->coord = DatumGetGeoPointTypeP(entry->key)->coord;
+
+  gistentryinit(*retval, PointerGetDatum(pt),
+                entry->rel, entry->page, entry->offset, false);
+
+  PG_RETURN_POINTER(retval);
+}
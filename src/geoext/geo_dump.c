@@ -0,0 +1,156 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_dump.c
+ *
+ * \brief Set-returning functions that dump the vertices and segments of a geometry.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_dump.h"
+#include "geo_linestring.h"
+#include "geo_point.h"
+
+
+/* PostgreSQL */
+#include <access/htup_details.h> /* for heap_form_tuple() */
+#include <funcapi.h>
+
+
+/*
+ * State kept across the calls of a dump.
+ *
+ * geo_polygon has the same layout as geo_linestring, so both are read
+ * through a geo_linestring.
+ *
+ */
+struct geo_dump_state
+{
+  struct geo_linestring *geom;  /* The detoasted geometry. */
+  bool segments;                /* Dump segments instead of points. */
+};
+
+
+static Datum
+geo_dump(FunctionCallInfo fcinfo, bool segments)
+{
+  FuncCallContext *funcctx;
+
+  struct geo_dump_state *st;
+
+  if(SRF_IS_FIRSTCALL())
+  {
+    MemoryContext oldcontext;
+
+    TupleDesc tupdesc;
+
+    funcctx = SRF_FIRSTCALL_INIT();
+
+    oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+
+    if(get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+      ereport(ERROR,
+              (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+               errmsg("function returning record called in context "
+                      "that cannot accept type record")));
+
+    funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+
+    st = (struct geo_dump_state*) palloc(sizeof(struct geo_dump_state));
+
+/* the geometry is detoasted once, in the memory that lasts for all the calls */
+    st->geom = PG_GETARG_GEOLINESTRING_TYPE_P(0);
+    st->segments = segments;
+
+    funcctx->user_fctx = st;
+
+    funcctx->max_calls = segments ? Max(st->geom->npts - 1, 0) : st->geom->npts;
+
+    MemoryContextSwitchTo(oldcontext);
+  }
+
+  funcctx = SRF_PERCALL_SETUP();
+
+  st = (struct geo_dump_state*) funcctx->user_fctx;
+
+  if(funcctx->call_cntr < funcctx->max_calls)
+  {
+    int i = (int) funcctx->call_cntr;
+
+    Datum values[3];
+    bool nulls[3] = { false, false, false };
+
+/* heap_form_tuple copies the points, so they can live on the stack */
+    struct geo_point pts[2];
+
+    HeapTuple tuple;
+
+    values[0] = Int32GetDatum(i + 1);
+
+    pts[0].coord = st->geom->coords[i];
+    pts[0].srid = st->geom->srid;
+    pts[0].dummy = 0;
+
+    values[1] = PointerGetDatum(&pts[0]);
+
+    if(st->segments)
+    {
+      pts[1].coord = st->geom->coords[i + 1];
+      pts[1].srid = st->geom->srid;
+      pts[1].dummy = 0;
+
+      values[2] = PointerGetDatum(&pts[1]);
+    }
+
+    tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
+
+    SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
+  }
+
+  SRF_RETURN_DONE(funcctx);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_dump_points);
+
+Datum
+geo_dump_points(PG_FUNCTION_ARGS)
+{
+  return geo_dump(fcinfo, false);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_dump_segments);
+
+Datum
+geo_dump_segments(PG_FUNCTION_ARGS)
+{
+  return geo_dump(fcinfo, true);
+}
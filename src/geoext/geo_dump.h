@@ -0,0 +1,53 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_dump.h
+ *
+ * \brief Set-returning functions that dump the vertices and segments of a geometry.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_DUMP_H__
+#define __GEOEXT_GEO_DUMP_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+
+/*
+ * They accept a geo_linestring or a geo_polygon and return one row per
+ * call, built from binary Datums: (path int4, pt geo_point) for the points
+ * and (path int4, first geo_point, second geo_point) for the segments.
+ *
+ */
+extern Datum geo_dump_points(PG_FUNCTION_ARGS);
+extern Datum geo_dump_segments(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_DUMP_H__ */
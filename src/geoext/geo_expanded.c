@@ -0,0 +1,236 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_expanded.c
+ *
+ * \brief Expanded (in-memory) representation for geo_linestring and geo_polygon.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_expanded.h"
+#include "geo_linestring.h"
+#include "geo_polygon.h"
+
+
+/* PostgreSQL */
+#include <nodes/supportnodes.h>
+#include <utils/memutils.h>
+
+
+/* C Standard Library */
+#include <string.h>
+
+
+/*
+ * Utility macros.
+ */
+
+/* initial number of vertices reserved for a new expanded object */
+#define GEOEXT_EXPANDED_MIN_CAPACITY 8
+
+/* geo_linestring and geo_polygon must share the same flat layout */
+#define GEOEXT_EXPANDED_FLAT_HDRSZ offsetof(struct geo_linestring, coords)
+
+
+/*
+ * Expanded object methods.
+ */
+static Size geo_expanded_get_flat_size(ExpandedObjectHeader *eohptr);
+
+static void geo_expanded_flatten_into(ExpandedObjectHeader *eohptr,
+                                      void *result, Size allocated_size);
+
+static const ExpandedObjectMethods geo_expanded_methods =
+{
+  geo_expanded_get_flat_size,
+  geo_expanded_flatten_into
+};
+
+
+static Size
+geo_expanded_get_flat_size(ExpandedObjectHeader *eohptr)
+{
+  struct geo_expanded *eo = (struct geo_expanded*) eohptr;
+
+  Assert(eo->magic == GEOEXT_EXPANDED_MAGIC);
+
+  return GEOEXT_EXPANDED_FLAT_HDRSZ + eo->npts * sizeof(struct coord2d);
+}
+
+
+static void
+geo_expanded_flatten_into(ExpandedObjectHeader *eohptr,
+                          void *result, Size allocated_size)
+{
+  struct geo_expanded *eo = (struct geo_expanded*) eohptr;
+
+  struct geo_linestring *flat = (struct geo_linestring*) result;
+
+  Assert(eo->magic == GEOEXT_EXPANDED_MAGIC);
+  Assert(allocated_size == geo_expanded_get_flat_size(eohptr));
+
+  SET_VARSIZE(flat, allocated_size);
+
+/*
+  prevent instability in unused pad bytes!
+  the DBMS may do wrong decisions if we don't zero all fields!
+ */
+  flat->dummy = 0;
+  flat->srid = eo->srid;
+  flat->npts = eo->npts;
+
+  memcpy(flat->coords, eo->coords, eo->npts * sizeof(struct coord2d));
+}
+
+
+Datum
+geo_expanded_from_datum(Datum d, MemoryContext parentcontext)
+{
+  MemoryContext objcxt;
+
+  struct geo_expanded *eo = NULL;
+
+  StaticAssertStmt(offsetof(struct geo_linestring, coords) == offsetof(struct geo_polygon, coords),
+                   "geo_linestring and geo_polygon must have the same layout");
+
+  objcxt = AllocSetContextCreate(parentcontext,
+                                 "expanded geo_linestring/geo_polygon",
+                                 ALLOCSET_START_SMALL_SIZES);
+
+  eo = (struct geo_expanded*) MemoryContextAlloc(objcxt, sizeof(struct geo_expanded));
+
+  EOH_init_header(&eo->hdr, &geo_expanded_methods, objcxt);
+
+  eo->magic = GEOEXT_EXPANDED_MAGIC;
+
+  if (VARATT_IS_EXTERNAL_EXPANDED(DatumGetPointer(d)) &&
+      ((struct geo_expanded*) DatumGetEOHP(d))->magic == GEOEXT_EXPANDED_MAGIC)
+  {
+/* a read-only expanded object: copy its vertices without flattening it */
+    struct geo_expanded *src = (struct geo_expanded*) DatumGetEOHP(d);
+
+    eo->srid = src->srid;
+    eo->npts = src->npts;
+    eo->capacity = Max(src->npts, GEOEXT_EXPANDED_MIN_CAPACITY);
+    eo->coords = (struct coord2d*) MemoryContextAlloc(objcxt, eo->capacity * sizeof(struct coord2d));
+
+    memcpy(eo->coords, src->coords, src->npts * sizeof(struct coord2d));
+  }
+  else
+  {
+    struct geo_linestring *flat = DatumGetGeoLineStringTypeP(d);
+
+    eo->srid = flat->srid;
+    eo->npts = flat->npts;
+    eo->capacity = Max(flat->npts, GEOEXT_EXPANDED_MIN_CAPACITY);
+    eo->coords = (struct coord2d*) MemoryContextAlloc(objcxt, eo->capacity * sizeof(struct coord2d));
+
+    memcpy(eo->coords, flat->coords, flat->npts * sizeof(struct coord2d));
+
+/* release the detoasted copy, if any */
+    if ((Pointer) flat != DatumGetPointer(d))
+      pfree(flat);
+  }
+
+  return EOHPGetRWDatum(&eo->hdr);
+}
+
+
+struct geo_expanded*
+DatumGetGeoExpanded(Datum d)
+{
+  if (VARATT_IS_EXTERNAL_EXPANDED_RW(DatumGetPointer(d)))
+  {
+    struct geo_expanded *eo = (struct geo_expanded*) DatumGetEOHP(d);
+
+    if (eo->magic == GEOEXT_EXPANDED_MAGIC)
+      return eo;
+  }
+
+  d = geo_expanded_from_datum(d, CurrentMemoryContext);
+
+  return (struct geo_expanded*) DatumGetEOHP(d);
+}
+
+
+void
+geo_expanded_reserve(struct geo_expanded *eo, int32 npts)
+{
+  int32 capacity = eo->capacity;
+
+  if (npts <= capacity)
+    return;
+
+  while (capacity < npts)
+    capacity *= 2;
+
+  if ((Size) capacity * sizeof(struct coord2d) > MaxAllocSize)
+    ereport(ERROR, (errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+                    errmsg("geometry can not have more than %d points",
+                           (int) (MaxAllocSize / sizeof(struct coord2d)))));
+
+  eo->coords = (struct coord2d*) repalloc(eo->coords, capacity * sizeof(struct coord2d));
+  eo->capacity = capacity;
+}
+
+
+/*
+ * Planner support: from PostgreSQL 18 on, PL/pgSQL asks whether an
+ * assignment like "line := add_point(line, pt)" can hand the variable's
+ * read-write expanded object to the function. Our editing functions only
+ * modify their first argument, so we allow it when that argument is the
+ * variable being assigned.
+ */
+
+PG_FUNCTION_INFO_V1(geo_expanded_support);
+
+Datum
+geo_expanded_support(PG_FUNCTION_ARGS)
+{
+  Node *ret = NULL;
+
+#if PG_VERSION_NUM >= 180000
+  Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+  if (IsA(rawreq, SupportRequestModifyInPlace))
+  {
+    SupportRequestModifyInPlace *req = (SupportRequestModifyInPlace *) rawreq;
+
+    Param *arg = (Param *) linitial(req->args);
+
+    if (arg && IsA(arg, Param) &&
+        arg->paramkind == PARAM_EXTERN &&
+        arg->paramid == req->paramid)
+      ret = (Node *) arg;
+  }
+#endif
+
+  PG_RETURN_POINTER(ret);
+}
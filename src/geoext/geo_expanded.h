@@ -0,0 +1,122 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_expanded.h
+ *
+ * \brief Expanded (in-memory) representation for geo_linestring and geo_polygon.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_EXPANDED_H__
+#define __GEOEXT_GEO_EXPANDED_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+#include <utils/expandeddatum.h>
+
+/* GeoExt */
+#include "decls.h"
+
+
+/*
+ * Tells if an expanded object was built by GeoExt.
+ */
+#define GEOEXT_EXPANDED_MAGIC 0x47454F58
+
+
+/*
+ * A geo_expanded is the expanded form of a geo_linestring or a geo_polygon.
+ *
+ * Both types share the same flat layout (srid, npts, coords), so a single
+ * expanded representation serves them. The vertex array is kept with some
+ * spare capacity, so that vertex insertions done by PL/pgSQL loops do not
+ * need to copy the whole geometry at each step. The flat varlena is only
+ * built when the value is stored (see flatten_into).
+ *
+ */
+struct geo_expanded
+{
+  ExpandedObjectHeader hdr;  /* Standard header for expanded objects.   */
+  int magic;                 /* Must be GEOEXT_EXPANDED_MAGIC.          */
+  int32 srid;                /* The Spatial Reference System ID.        */
+  int32 npts;                /* Number of vertices in use.              */
+  int32 capacity;            /* Number of vertices allocated in coords. */
+  struct coord2d *coords;    /* The array of vertices.                  */
+};
+
+
+/*
+ * Below we have the fmgr interface macros for dealing with a geo_expanded.
+ *
+ * PG_GETARG_GEOEXPANDED_P returns the argument itself if it is a read-write
+ * expanded object, otherwise it builds a new expanded object in the
+ * current memory context.
+ *
+ */
+#define PG_GETARG_GEOEXPANDED_P(n)  DatumGetGeoExpanded(PG_GETARG_DATUM(n))
+#define PG_RETURN_GEOEXPANDED_P(x)  PG_RETURN_DATUM(EOHPGetRWDatum(&(x)->hdr))
+
+
+/*
+ * \brief Build an expanded object from a flat, toasted or expanded geometry.
+ *
+ * \param d             A geo_linestring or geo_polygon datum.
+ * \param parentcontext The memory context that will own the new object.
+ *
+ * \return A read-write pointer to the new expanded object.
+ *
+ */
+Datum geo_expanded_from_datum(Datum d, MemoryContext parentcontext);
+
+
+/*
+ * \brief Returns the expanded object behind a datum, building one if needed.
+ *
+ */
+struct geo_expanded* DatumGetGeoExpanded(Datum d);
+
+
+/*
+ * \brief Assure that the expanded object has room for npts vertices.
+ *
+ * \note The vertex array grows geometrically, so a sequence of n
+ *       insertions costs O(n) amortized.
+ *
+ */
+void geo_expanded_reserve(struct geo_expanded *eo, int32 npts);
+
+
+/*
+ * \brief Planner support for functions that edit an expanded geometry in place.
+ *
+ */
+extern Datum geo_expanded_support(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_EXPANDED_H__ */
@@ -0,0 +1,786 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_fence.c
+ *
+ * \brief A geofence index in shared memory, used by all the backends.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExt */
+#include "geo_fence.h"
+#include "algorithms.h"
+#include "geo_counters.h"
+#include "geo_point.h"
+#include "geo_polygon.h"
+
+
+/* PostgreSQL */
+#include <access/xact.h>
+#include <catalog/pg_type.h>
+#include <commands/async.h>
+#include <commands/trigger.h>
+#include <executor/spi.h>
+#include <lib/stringinfo.h>
+#include <miscadmin.h>
+#include <port/atomics.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/dsa.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/snapmgr.h>
+
+
+/* Fan-out of the packed R-trees */
+#define GEO_FENCE_NODE_SIZE 16
+
+/* Name of the LWLock tranche and of the notification channel */
+#define GEO_FENCE_TRANCHE "geoext_fences"
+
+
+/*
+ * A pinned polygon.
+ */
+struct geo_fence
+{
+  int64 id;                   /* The id column of the row.                     */
+  int32 first_vertex;         /* Position of the ring in the vertex array.     */
+  int32 first_edge_slot;      /* Position of the edge tree in the edge arrays. */
+  struct packed_rtree edges;  /* The tree over the npts - 1 edges of the ring. */
+};
+
+
+/*
+ * The index: a single chunk of the shared area, with offsets instead of
+ * pointers, as each backend maps the area at its own address.
+ */
+struct geo_fence_index
+{
+  Size size;                    /* Total size in bytes.               */
+  int32 nfences;
+  int32 nvertices;
+  int32 nedge_slots;
+  struct packed_rtree fences;   /* The tree over the polygon boxes.   */
+
+  Size fence_off;               /* struct geo_fence[nfences]          */
+  Size fence_boxes_off;         /* struct coord2d[2 * fences.num_boxes] */
+  Size fence_indices_off;       /* int32[fences.num_boxes]            */
+  Size vertices_off;            /* struct coord2d[nvertices]          */
+  Size edge_boxes_off;          /* struct coord2d[2 * nedge_slots]    */
+  Size edge_indices_off;        /* int32[nedge_slots]                 */
+};
+
+#define GEO_FENCE_ARRAY(index, off, type) ((type*) ((char*) (index) + (index)->off))
+
+
+/*
+ * The state in the main shared memory segment.
+ */
+struct geo_fence_shared
+{
+  int dsa_tranche;              /* Tranche of the locks of the area.      */
+  dsa_handle dsa;               /* DSA_HANDLE_INVALID until the first pin. */
+  dsa_pointer index;            /* InvalidDsaPointer if nothing is pinned. */
+  Oid dbid;                     /* The database of the pinned table.      */
+  Oid relid;                    /* The pinned table and its columns.      */
+  Oid owner;                    /* The role that pinned it reloads it.    */
+  NameData id_column;
+  NameData geom_column;
+  int64 bytes;
+  int32 nfences;
+  pg_atomic_uint32 changes;     /* Committed changes to the table.        */
+  pg_atomic_uint32 loaded;      /* The changes seen by the index.         */
+  pg_atomic_uint32 rebuilding;  /* A backend is reloading the index.      */
+};
+
+
+/* NULL unless the library was preloaded */
+static struct geo_fence_shared *geo_fence_shared = NULL;
+
+/* Protects the fields of geo_fence_shared and the index it points to */
+static LWLock *geo_fence_lock = NULL;
+
+/* The mapping of the area in this backend */
+static dsa_area *geo_fence_area = NULL;
+
+/* The pinned table was changed by the current transaction */
+static bool geo_fence_changed = false;
+
+static shmem_request_hook_type prev_shmem_request_hook = NULL;
+
+static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
+
+
+static void
+geo_fence_shmem_request(void)
+{
+  if (prev_shmem_request_hook)
+    prev_shmem_request_hook();
+
+  RequestAddinShmemSpace(MAXALIGN(sizeof(struct geo_fence_shared)));
+
+  RequestNamedLWLockTranche(GEO_FENCE_TRANCHE, 1);
+}
+
+
+static void
+geo_fence_shmem_startup(void)
+{
+  bool found;
+
+  if (prev_shmem_startup_hook)
+    prev_shmem_startup_hook();
+
+  LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+
+  geo_fence_shared = (struct geo_fence_shared*)
+    ShmemInitStruct("geoext fences", sizeof(struct geo_fence_shared), &found);
+
+  if (!found)
+  {
+    geo_fence_shared->dsa_tranche = LWLockNewTrancheId();
+    geo_fence_shared->dsa = DSA_HANDLE_INVALID;
+    geo_fence_shared->index = InvalidDsaPointer;
+    geo_fence_shared->dbid = InvalidOid;
+    geo_fence_shared->relid = InvalidOid;
+    geo_fence_shared->owner = InvalidOid;
+    geo_fence_shared->bytes = 0;
+    geo_fence_shared->nfences = 0;
+
+    pg_atomic_init_u32(&geo_fence_shared->changes, 0);
+    pg_atomic_init_u32(&geo_fence_shared->loaded, 0);
+    pg_atomic_init_u32(&geo_fence_shared->rebuilding, 0);
+  }
+
+  geo_fence_lock = &(GetNamedLWLockTranche(GEO_FENCE_TRANCHE))->lock;
+
+  LWLockRelease(AddinShmemInitLock);
+}
+
+
+static void
+geo_fence_xact_callback(XactEvent event, void *arg)
+{
+  switch (event)
+  {
+    case XACT_EVENT_COMMIT:
+    case XACT_EVENT_PARALLEL_COMMIT:
+/* the commit is already visible to new snapshots when it is counted */
+      if (geo_fence_changed && geo_fence_shared != NULL)
+        pg_atomic_fetch_add_u32(&geo_fence_shared->changes, 1);
+
+      geo_fence_changed = false;
+      break;
+
+    case XACT_EVENT_ABORT:
+    case XACT_EVENT_PARALLEL_ABORT:
+      geo_fence_changed = false;
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+void
+geo_fence_init(void)
+{
+  if (process_shared_preload_libraries_in_progress)
+  {
+    prev_shmem_request_hook = shmem_request_hook;
+    shmem_request_hook = geo_fence_shmem_request;
+
+    prev_shmem_startup_hook = shmem_startup_hook;
+    shmem_startup_hook = geo_fence_shmem_startup;
+  }
+
+  RegisterXactCallback(geo_fence_xact_callback, NULL);
+}
+
+
+static void
+geo_fence_check_shared(void)
+{
+  if (geo_fence_shared == NULL)
+    ereport(ERROR,
+            (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+             errmsg("the geofence index requires geoext in shared_preload_libraries")));
+}
+
+
+/*
+ * Maps the area in this backend, creating it if needed. The caller holds
+ * the lock, in exclusive mode if create is true.
+ *
+ */
+static dsa_area*
+geo_fence_attach(bool create)
+{
+  MemoryContext old_context;
+
+  if (geo_fence_area != NULL)
+    return geo_fence_area;
+
+  if (geo_fence_shared->dsa == DSA_HANDLE_INVALID && !create)
+    return NULL;
+
+/* the mapping lasts for the whole session */
+  old_context = MemoryContextSwitchTo(TopMemoryContext);
+
+  LWLockRegisterTranche(geo_fence_shared->dsa_tranche, GEO_FENCE_TRANCHE);
+
+  if (geo_fence_shared->dsa == DSA_HANDLE_INVALID)
+  {
+    geo_fence_area = dsa_create(geo_fence_shared->dsa_tranche);
+
+    dsa_pin(geo_fence_area);
+
+    geo_fence_shared->dsa = dsa_get_handle(geo_fence_area);
+  }
+  else
+  {
+    geo_fence_area = dsa_attach(geo_fence_shared->dsa);
+  }
+
+  dsa_pin_mapping(geo_fence_area);
+
+  MemoryContextSwitchTo(old_context);
+
+  return geo_fence_area;
+}
+
+
+/*
+ * Reads the polygons of a table and builds the index in local memory.
+ *
+ */
+static struct geo_fence_index*
+geo_fence_load(Oid relid, const char *id_column, const char *geom_column)
+{
+  MemoryContext caller_context = CurrentMemoryContext;
+
+  char *relname = get_rel_name(relid);
+
+  StringInfoData sql;
+
+  int64 *ids;
+  struct geo_polygon **polys;
+
+  int32 nfences = 0;
+  int32 nvertices = 0;
+  int32 nedge_slots = 0;
+  int32 max_edges = 0;
+
+  struct packed_rtree fences;
+
+  int32 fence_slots;
+
+  Size size;
+
+  struct geo_fence_index *index;
+
+  struct geo_fence *fence;
+  struct coord2d *vertices;
+  struct coord2d *edge_boxes;
+  int32 *edge_indices;
+
+  struct coord2d *items;
+  void *scratch;
+
+  if (relname == NULL)
+    ereport(ERROR,
+            (errcode(ERRCODE_UNDEFINED_TABLE),
+             errmsg("relation with OID %u does not exist", relid)));
+
+  initStringInfo(&sql);
+
+  appendStringInfo(&sql, "SELECT (%s)::int8, %s FROM %s",
+                   quote_identifier(id_column),
+                   quote_identifier(geom_column),
+                   quote_qualified_identifier(get_namespace_name(get_rel_namespace(relid)),
+                                              relname));
+
+  SPI_connect();
+
+/*
+  the index is shared by all the backends: it is read with a new snapshot,
+  not the one of the caller, which may predate the last committed change
+ */
+  PushActiveSnapshot(GetLatestSnapshot());
+
+  if (SPI_execute(sql.data, true, 0) != SPI_OK_SELECT)
+    elog(ERROR, "could not read the geofences from \"%s\"", relname);
+
+  PopActiveSnapshot();
+
+  if (strcmp(SPI_gettype(SPI_tuptable->tupdesc, 2), "geo_polygon") != 0)
+    ereport(ERROR,
+            (errcode(ERRCODE_DATATYPE_MISMATCH),
+             errmsg("column \"%s\" of \"%s\" is not a geo_polygon", geom_column, relname)));
+
+  ids = (int64*) palloc(Max(SPI_processed, 1) * sizeof(int64));
+  polys = (struct geo_polygon**) palloc(Max(SPI_processed, 1) * sizeof(struct geo_polygon*));
+
+/* the rows with a NULL id or polygon are skipped */
+  for (uint64 r = 0; r < SPI_processed; ++r)
+  {
+    HeapTuple tuple = SPI_tuptable->vals[r];
+
+    bool id_null, geom_null;
+
+    Datum id = SPI_getbinval(tuple, SPI_tuptable->tupdesc, 1, &id_null);
+    Datum geom = SPI_getbinval(tuple, SPI_tuptable->tupdesc, 2, &geom_null);
+
+    struct packed_rtree edges;
+
+    if (id_null || geom_null)
+      continue;
+
+    ids[nfences] = DatumGetInt64(id);
+    polys[nfences] = DatumGetGeoPolygonTypeP(geom);
+
+    nvertices += polys[nfences]->npts;
+    nedge_slots += packed_rtree_init(&edges, polys[nfences]->npts - 1, GEO_FENCE_NODE_SIZE);
+    max_edges = Max(max_edges, polys[nfences]->npts - 1);
+
+    ++nfences;
+  }
+
+  fence_slots = packed_rtree_init(&fences, nfences, GEO_FENCE_NODE_SIZE);
+
+/* lay out the arrays after the header */
+  size = MAXALIGN(sizeof(struct geo_fence_index));
+
+  index = (struct geo_fence_index*) palloc0(sizeof(struct geo_fence_index));
+
+  index->fence_off = size;
+  size += MAXALIGN(nfences * sizeof(struct geo_fence));
+
+  index->fence_boxes_off = size;
+  size += MAXALIGN(2 * fence_slots * sizeof(struct coord2d));
+
+  index->fence_indices_off = size;
+  size += MAXALIGN(fence_slots * sizeof(int32));
+
+  index->vertices_off = size;
+  size += MAXALIGN(nvertices * sizeof(struct coord2d));
+
+  index->edge_boxes_off = size;
+  size += MAXALIGN(2 * nedge_slots * sizeof(struct coord2d));
+
+  index->edge_indices_off = size;
+  size += MAXALIGN(nedge_slots * sizeof(int32));
+
+  index->size = size;
+  index->nfences = nfences;
+  index->nvertices = nvertices;
+  index->nedge_slots = nedge_slots;
+  index->fences = fences;
+
+/* the result outlives SPI_finish */
+  index = (struct geo_fence_index*) memcpy(MemoryContextAllocHuge(caller_context, size),
+                                           index, sizeof(struct geo_fence_index));
+
+  fence = GEO_FENCE_ARRAY(index, fence_off, struct geo_fence);
+  vertices = GEO_FENCE_ARRAY(index, vertices_off, struct coord2d);
+  edge_boxes = GEO_FENCE_ARRAY(index, edge_boxes_off, struct coord2d);
+  edge_indices = GEO_FENCE_ARRAY(index, edge_indices_off, int32);
+
+  items = (struct coord2d*) palloc(2 * Max(max_edges, nfences) * sizeof(struct coord2d));
+  scratch = palloc(packed_rtree_scratch_size(Max(max_edges, nfences)));
+
+  nvertices = 0;
+  nedge_slots = 0;
+
+  for (int32 f = 0; f < nfences; ++f)
+  {
+    struct geo_polygon *poly = polys[f];
+
+    int32 nedges = poly->npts - 1;
+
+    fence[f].id = ids[f];
+    fence[f].first_vertex = nvertices;
+    fence[f].first_edge_slot = nedge_slots;
+
+    memcpy(&vertices[nvertices], poly->coords, poly->npts * sizeof(struct coord2d));
+
+    for (int32 e = 0; e < nedges; ++e)
+    {
+      items[2 * e].x = Min(poly->coords[e].x, poly->coords[e + 1].x);
+      items[2 * e].y = Min(poly->coords[e].y, poly->coords[e + 1].y);
+      items[2 * e + 1].x = Max(poly->coords[e].x, poly->coords[e + 1].x);
+      items[2 * e + 1].y = Max(poly->coords[e].y, poly->coords[e + 1].y);
+    }
+
+    nedge_slots += packed_rtree_init(&fence[f].edges, nedges, GEO_FENCE_NODE_SIZE);
+
+    packed_rtree_build(&fence[f].edges, items,
+                       &edge_boxes[2 * fence[f].first_edge_slot],
+                       &edge_indices[fence[f].first_edge_slot],
+                       scratch);
+
+    nvertices += poly->npts;
+  }
+
+/* the tree over the bounding boxes of the polygons */
+  for (int32 f = 0; f < nfences; ++f)
+    mbr(polys[f]->coords, polys[f]->npts, &items[2 * f], &items[2 * f + 1]);
+
+  packed_rtree_build(&index->fences, items,
+                     GEO_FENCE_ARRAY(index, fence_boxes_off, struct coord2d),
+                     GEO_FENCE_ARRAY(index, fence_indices_off, int32),
+                     scratch);
+
+  SPI_finish();
+
+  return index;
+}
+
+
+/*
+ * Copies an index to the shared area and makes it the current one, owned
+ * by the given role of the current database. changes is the count of
+ * committed changes read before the table was loaded.
+ *
+ */
+static void
+geo_fence_publish(struct geo_fence_index *local, Oid relid, Oid owner,
+                  const char *id_column, const char *geom_column,
+                  uint32 changes)
+{
+  dsa_area *area;
+
+  dsa_pointer ptr;
+
+  dsa_pointer old;
+
+  LWLockAcquire(geo_fence_lock, LW_EXCLUSIVE);
+
+  area = geo_fence_attach(true);
+
+  LWLockRelease(geo_fence_lock);
+
+/* the readers keep using the current index during the copy */
+  ptr = dsa_allocate_extended(area, local->size, DSA_ALLOC_HUGE);
+
+  memcpy(dsa_get_address(area, ptr), local, local->size);
+
+  LWLockAcquire(geo_fence_lock, LW_EXCLUSIVE);
+
+  old = geo_fence_shared->index;
+
+  geo_fence_shared->index = ptr;
+  geo_fence_shared->dbid = MyDatabaseId;
+  geo_fence_shared->relid = relid;
+  geo_fence_shared->owner = owner;
+  namestrcpy(&geo_fence_shared->id_column, id_column);
+  namestrcpy(&geo_fence_shared->geom_column, geom_column);
+  geo_fence_shared->bytes = (int64) local->size;
+  geo_fence_shared->nfences = local->nfences;
+
+  pg_atomic_write_u32(&geo_fence_shared->loaded, changes);
+
+  if (DsaPointerIsValid(old))
+    dsa_free(area, old);
+
+  LWLockRelease(geo_fence_lock);
+}
+
+
+/*
+ * Reloads the index if a committed change made it stale. Only one backend
+ * reloads it; the others keep using the previous one meanwhile. The table
+ * is read with the privileges of the role that pinned it, as in a
+ * security-restricted operation, and only by the backends connected to
+ * its database.
+ *
+ */
+static void
+geo_fence_refresh(void)
+{
+  Oid dbid;
+  Oid relid;
+  Oid owner;
+
+  NameData id_column;
+  NameData geom_column;
+
+  Oid save_userid;
+  int save_sec_context;
+
+  uint32 changes = pg_atomic_read_u32(&geo_fence_shared->changes);
+
+  if (changes == pg_atomic_read_u32(&geo_fence_shared->loaded) || IsInParallelMode())
+    return;
+
+  LWLockAcquire(geo_fence_lock, LW_SHARED);
+
+  dbid = geo_fence_shared->dbid;
+  relid = geo_fence_shared->relid;
+  owner = geo_fence_shared->owner;
+  id_column = geo_fence_shared->id_column;
+  geom_column = geo_fence_shared->geom_column;
+
+  LWLockRelease(geo_fence_lock);
+
+  if (!OidIsValid(relid) || dbid != MyDatabaseId)
+    return;
+
+  if (pg_atomic_exchange_u32(&geo_fence_shared->rebuilding, 1) != 0)
+    return;
+
+  GetUserIdAndSecContext(&save_userid, &save_sec_context);
+
+  PG_TRY();
+  {
+    SetUserIdAndSecContext(owner,
+                           save_sec_context | SECURITY_LOCAL_USERID_CHANGE |
+                           SECURITY_RESTRICTED_OPERATION);
+
+/*
+  changes was read before the snapshot of the load was taken, so all of
+  them are in the new index; the ones committed meanwhile make it stale
+  again
+ */
+    geo_fence_publish(geo_fence_load(relid, NameStr(id_column), NameStr(geom_column)),
+                      relid, owner, NameStr(id_column), NameStr(geom_column), changes);
+
+    SetUserIdAndSecContext(save_userid, save_sec_context);
+  }
+  PG_CATCH();
+  {
+    SetUserIdAndSecContext(save_userid, save_sec_context);
+
+    pg_atomic_write_u32(&geo_fence_shared->rebuilding, 0);
+
+    PG_RE_THROW();
+  }
+  PG_END_TRY();
+
+  pg_atomic_write_u32(&geo_fence_shared->rebuilding, 0);
+}
+
+
+bool
+geo_fence_memory(int64 *bytes, int32 *nfences)
+{
+  bool pinned;
+
+  if (geo_fence_shared == NULL)
+    return false;
+
+  LWLockAcquire(geo_fence_lock, LW_SHARED);
+
+  pinned = DsaPointerIsValid(geo_fence_shared->index);
+
+  *bytes = geo_fence_shared->bytes;
+  *nfences = geo_fence_shared->nfences;
+
+  LWLockRelease(geo_fence_lock);
+
+  return pinned;
+}
+
+
+PG_FUNCTION_INFO_V1(geoext_pin_fences);
+
+Datum
+geoext_pin_fences(PG_FUNCTION_ARGS)
+{
+  Oid relid = PG_GETARG_OID(0);
+
+  Name id_column = PG_GETARG_NAME(1);
+
+  Name geom_column = PG_GETARG_NAME(2);
+
+  struct geo_fence_index *index;
+
+  uint32 changes;
+
+  geo_fence_check_shared();
+
+  changes = pg_atomic_read_u32(&geo_fence_shared->changes);
+
+  index = geo_fence_load(relid, NameStr(*id_column), NameStr(*geom_column));
+
+  geo_fence_publish(index, relid, GetUserId(), NameStr(*id_column), NameStr(*geom_column),
+                    changes);
+
+  PG_RETURN_INT32(index->nfences);
+}
+
+
+PG_FUNCTION_INFO_V1(geoext_unpin_fences);
+
+Datum
+geoext_unpin_fences(PG_FUNCTION_ARGS)
+{
+  dsa_area *area;
+
+  geo_fence_check_shared();
+
+  LWLockAcquire(geo_fence_lock, LW_EXCLUSIVE);
+
+  area = geo_fence_attach(false);
+
+  if (area != NULL && DsaPointerIsValid(geo_fence_shared->index))
+    dsa_free(area, geo_fence_shared->index);
+
+  geo_fence_shared->index = InvalidDsaPointer;
+  geo_fence_shared->dbid = InvalidOid;
+  geo_fence_shared->relid = InvalidOid;
+  geo_fence_shared->owner = InvalidOid;
+  geo_fence_shared->bytes = 0;
+  geo_fence_shared->nfences = 0;
+
+  LWLockRelease(geo_fence_lock);
+
+  PG_RETURN_VOID();
+}
+
+
+PG_FUNCTION_INFO_V1(geoext_fences_changed);
+
+Datum
+geoext_fences_changed(PG_FUNCTION_ARGS)
+{
+  TriggerData *trigdata = (TriggerData *) fcinfo->context;
+
+  if (!CALLED_AS_TRIGGER(fcinfo))
+    ereport(ERROR,
+            (errcode(ERRCODE_E_R_I_E_TRIGGER_PROTOCOL_VIOLATED),
+             errmsg("geoext_fences_changed: not called by trigger manager")));
+
+/* the index is marked stale when the transaction commits */
+  if (geo_fence_shared != NULL &&
+      geo_fence_shared->dbid == MyDatabaseId &&
+      RelationGetRelid(trigdata->tg_relation) == geo_fence_shared->relid)
+  {
+    geo_fence_changed = true;
+
+    Async_Notify(GEO_FENCE_TRANCHE, RelationGetRelationName(trigdata->tg_relation));
+  }
+
+  return PointerGetDatum(NULL);
+}
+
+
+/*
+ * Collects the ids of the polygons that contain a point.
+ */
+struct geo_fence_hits_state
+{
+  const struct geo_fence_index *index;
+  const struct coord2d *pt;
+  Datum *ids;
+  int nids;
+  int capacity;
+};
+
+
+static void
+geo_fence_hits_visit(int32 f, void *arg)
+{
+  struct geo_fence_hits_state *st = (struct geo_fence_hits_state*) arg;
+
+  const struct geo_fence *fence = &GEO_FENCE_ARRAY(st->index, fence_off, const struct geo_fence)[f];
+
+  if (!packed_point_in_ring(&fence->edges,
+                            &GEO_FENCE_ARRAY(st->index, edge_boxes_off, const struct coord2d)[2 * fence->first_edge_slot],
+                            &GEO_FENCE_ARRAY(st->index, edge_indices_off, const int32)[fence->first_edge_slot],
+                            &GEO_FENCE_ARRAY(st->index, vertices_off, const struct coord2d)[fence->first_vertex],
+                            st->pt))
+    return;
+
+  if (st->nids == st->capacity)
+  {
+    st->capacity *= 2;
+    st->ids = (Datum*) repalloc(st->ids, st->capacity * sizeof(Datum));
+  }
+
+  st->ids[st->nids++] = Int64GetDatum(fence->id);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_fence_hits);
+
+Datum
+geo_fence_hits(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  struct geo_fence_hits_state st;
+
+  dsa_area *area;
+
+  instr_time start;
+
+  geo_fence_check_shared();
+
+  geo_fence_refresh();
+
+  geo_counter_start(&start);
+
+  st.pt = &pt->coord;
+  st.nids = 0;
+  st.capacity = 8;
+  st.ids = (Datum*) palloc(st.capacity * sizeof(Datum));
+
+  LWLockAcquire(geo_fence_lock, LW_SHARED);
+
+/* the index of another database is not visible */
+  if (!DsaPointerIsValid(geo_fence_shared->index) ||
+      geo_fence_shared->dbid != MyDatabaseId)
+    ereport(ERROR,
+            (errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+             errmsg("no geofences are pinned in this database"),
+             errhint("Use geoext_pin_fences() to load them.")));
+
+  area = geo_fence_attach(false);
+
+  st.index = (const struct geo_fence_index*) dsa_get_address(area, geo_fence_shared->index);
+
+  packed_rtree_search(&st.index->fences,
+                      GEO_FENCE_ARRAY(st.index, fence_boxes_off, const struct coord2d),
+                      GEO_FENCE_ARRAY(st.index, fence_indices_off, const int32),
+                      &pt->coord, &pt->coord,
+                      geo_fence_hits_visit, &st);
+
+  LWLockRelease(geo_fence_lock);
+
+  geo_counter_stop(GEO_COUNTER_FENCE_HITS, &start);
+
+  PG_RETURN_ARRAYTYPE_P(construct_array(st.ids, st.nids, INT8OID,
+                                        sizeof(int64), FLOAT8PASSBYVAL, TYPALIGN_DOUBLE));
+}
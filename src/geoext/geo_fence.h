@@ -0,0 +1,82 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_fence.h
+ *
+ * \brief A geofence index in shared memory, used by all the backends.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_FENCE_H__
+#define __GEOEXT_GEO_FENCE_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+
+/*
+ * The polygons of a table can be "pinned": they are loaded once into a
+ * dynamic shared memory area, as a packed R-tree over their bounding boxes
+ * and, for each polygon, a packed R-tree over its edges. fence_hits() then
+ * answers from any backend without detoasting or preparing the polygons.
+ *
+ * A statement trigger on the table marks the index stale when a change is
+ * committed (and sends a notification on the geoext_fences channel); the
+ * next fence_hits() call in the database of the table reloads it, as the
+ * role that pinned it.
+ *
+ */
+
+
+/*
+ * \brief Sets up the shared state of the index.
+ *
+ * It must be called from _PG_init. The index is only available when the
+ * library is in shared_preload_libraries.
+ *
+ */
+void geo_fence_init(void);
+
+
+/*
+ * \brief Returns the size in bytes and the number of polygons of the index.
+ *
+ * \return false if no polygons are pinned.
+ *
+ */
+bool geo_fence_memory(int64 *bytes, int32 *nfences);
+
+
+extern Datum geoext_pin_fences(PG_FUNCTION_ARGS);
+extern Datum geoext_unpin_fences(PG_FUNCTION_ARGS);
+extern Datum geoext_fences_changed(PG_FUNCTION_ARGS);
+extern Datum geo_fence_hits(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_FENCE_H__ */
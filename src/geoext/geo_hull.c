@@ -0,0 +1,191 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_hull.c
+ *
+ * \brief Convex hull and minimum-area rectangle of geo_linestring and geo_polygon.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExt */
+#include "geo_hull.h"
+#include "algorithms.h"
+#include "geo_linestring.h"
+
+
+/* C Standard Library */
+#include <string.h>
+
+
+struct geo_polygon*
+geo_polygon_from_open_ring(const struct coord2d *ring, int n, int32 srid)
+{
+  int size = offsetof(struct geo_polygon, coords) + (n + 1) * sizeof(struct coord2d);
+
+  struct geo_polygon *poly = (struct geo_polygon*) palloc(size);
+
+  SET_VARSIZE(poly, size);
+
+  poly->dummy = 0;
+  poly->srid = srid;
+  poly->npts = n + 1;
+
+  memcpy(poly->coords, ring, n * sizeof(struct coord2d));
+
+  poly->coords[n] = ring[0];
+
+  return poly;
+}
+
+
+/*
+ * The hull of any set of vertices: they are copied, as the monotone chain
+ * sorts them in place. Polygons also use it by default: nothing guarantees
+ * that their ring is simple, and Melkman's algorithm may miss hull vertices
+ * if it is not.
+ */
+static int
+geo_hull_of_coords(const struct coord2d *coords, int npts, struct coord2d **hull)
+{
+  struct coord2d *pts = (struct coord2d*) palloc(Max(npts, 1) * sizeof(struct coord2d));
+
+  int n;
+
+  memcpy(pts, coords, npts * sizeof(struct coord2d));
+
+  *hull = (struct coord2d*) palloc((npts + 1) * sizeof(struct coord2d));
+
+  n = convex_hull(pts, npts, *hull);
+
+  pfree(pts);
+
+  return n;
+}
+
+
+/*
+ * The hull of the ring of a polygon: in O(n) with Melkman's algorithm if
+ * the caller tells that the ring is simple (the optional "simple" argument
+ * of the SQL functions), in O(n log n) otherwise.
+ */
+static int
+geo_hull_of_polygon(FunctionCallInfo fcinfo, const struct geo_polygon *poly, struct coord2d **hull)
+{
+  bool simple = (PG_NARGS() > 1) ? PG_GETARG_BOOL(1) : false;
+
+  if (!simple)
+    return geo_hull_of_coords(poly->coords, poly->npts, hull);
+
+  *hull = (struct coord2d*) palloc(2 * Max(poly->npts, 1) * sizeof(struct coord2d));
+
+  return convex_hull_simple_ring(poly->coords, poly->npts, *hull);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_linestring_convex_hull);
+
+Datum
+geo_linestring_convex_hull(PG_FUNCTION_ARGS)
+{
+  struct geo_linestring *line = PG_GETARG_GEOLINESTRING_TYPE_P(0);
+
+  struct coord2d *hull;
+
+  int n = geo_hull_of_coords(line->coords, line->npts, &hull);
+
+  if (n < 3)
+    PG_RETURN_NULL();
+
+  PG_RETURN_GEOPOLYGON_TYPE_P(geo_polygon_from_open_ring(hull, n, line->srid));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_convex_hull);
+
+Datum
+geo_polygon_convex_hull(PG_FUNCTION_ARGS)
+{
+  struct geo_polygon *poly = PG_GETARG_GEOPOLYGON_TYPE_P(0);
+
+  struct coord2d *hull;
+
+  int n = geo_hull_of_polygon(fcinfo, poly, &hull);
+
+  if (n < 3)
+    PG_RETURN_NULL();
+
+  PG_RETURN_GEOPOLYGON_TYPE_P(geo_polygon_from_open_ring(hull, n, poly->srid));
+}
+
+
+/*
+ * The rectangle of a geometry is the one of its hull (rotating calipers).
+ */
+static Datum
+geo_min_area_rect_of_hull(FunctionCallInfo fcinfo, const struct coord2d *hull, int n, int32 srid)
+{
+  struct coord2d rect[4];
+
+  if (n < 3)
+    PG_RETURN_NULL();
+
+  min_area_rect(hull, n, rect);
+
+  PG_RETURN_GEOPOLYGON_TYPE_P(geo_polygon_from_open_ring(rect, 4, srid));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_linestring_min_area_rect);
+
+Datum
+geo_linestring_min_area_rect(PG_FUNCTION_ARGS)
+{
+  struct geo_linestring *line = PG_GETARG_GEOLINESTRING_TYPE_P(0);
+
+  struct coord2d *hull;
+
+  int n = geo_hull_of_coords(line->coords, line->npts, &hull);
+
+  return geo_min_area_rect_of_hull(fcinfo, hull, n, line->srid);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_min_area_rect);
+
+Datum
+geo_polygon_min_area_rect(PG_FUNCTION_ARGS)
+{
+  struct geo_polygon *poly = PG_GETARG_GEOPOLYGON_TYPE_P(0);
+
+  struct coord2d *hull;
+
+  int n = geo_hull_of_polygon(fcinfo, poly, &hull);
+
+  return geo_min_area_rect_of_hull(fcinfo, hull, n, poly->srid);
+}
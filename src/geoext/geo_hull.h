@@ -0,0 +1,70 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_hull.h
+ *
+ * \brief Convex hull and minimum-area rectangle of geo_linestring and geo_polygon.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_HULL_H__
+#define __GEOEXT_GEO_HULL_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+/* GeoExt */
+#include "decls.h"
+#include "geo_polygon.h"
+
+
+/*
+ * \brief Makes a geo_polygon from the n vertices of a ring that is not
+ *        closed yet: the first vertex is repeated at the end.
+ *
+ */
+struct geo_polygon* geo_polygon_from_open_ring(const struct coord2d *ring, int n, int32 srid);
+
+
+/*
+ * The hull uses the O(n log n) monotone chain: the ring of a geo_polygon,
+ * as a linestring, may cross itself. The geo_polygon functions take an
+ * optional bool: if true the ring is trusted to be simple and Melkman's
+ * O(n) algorithm is used instead. Both return NULL if all the vertices
+ * are collinear.
+ *
+ */
+extern Datum geo_linestring_convex_hull(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_convex_hull(PG_FUNCTION_ARGS);
+
+extern Datum geo_linestring_min_area_rect(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_min_area_rect(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_HULL_H__ */
@@ -36,6 +36,8 @@
 /* GeoExtension */
 #include "geo_linestring.h"
 #include "algorithms.h"
+#include "geo_array.h"
+#include "geo_expanded.h"
 #include "geo_point.h"
 #include "hexutils.h"
 #include "wkt.h"
@@ -58,6 +60,7 @@
 #include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <math.h>
 #include <string.h>
 
 
@@ -315,6 +318,102 @@ geo_linestring_length(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * The length of a line of longitude and latitude coordinates on a sphere
+ * of the given radius (the mean Earth radius in meters by default).
+ */
+
+PG_FUNCTION_INFO_V1(geo_linestring_length_sphere);
+
+Datum
+geo_linestring_length_sphere(PG_FUNCTION_ARGS)
+{
+  struct geo_linestring *line = PG_GETARG_GEOLINESTRING_TYPE_P(0);
+
+  float8 radius = PG_GETARG_FLOAT8(1);
+
+  PG_RETURN_FLOAT8(haversine_length(line->coords, line->npts, radius));
+}
+
+
+/*
+ * Line simplification.
+ *
+ * The result is allocated for all the input vertices and then trimmed
+ * by its varlena header, so the only other allocation is the scratch
+ * buffer of the algorithm.
+ *
+ */
+static struct geo_linestring*
+geo_linestring_simplify_i(struct geo_linestring *line, float8 tolerance,
+                          bool visvalingam)
+{
+  struct geo_linestring *result = NULL;
+
+  int size = offsetof(struct geo_linestring, coords) +
+             line->npts * sizeof(struct coord2d);
+
+  if(isnan(tolerance) || (tolerance < 0.0))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("simplification tolerance must be a non-negative number")));
+
+  result = (struct geo_linestring*) palloc(size);
+
+  result->dummy = 0;
+  result->srid = line->srid;
+
+  if(visvalingam)
+  {
+    void *scratch = palloc(visvalingam_whyatt_scratch_size(line->npts));
+
+    result->npts = visvalingam_whyatt(line->coords, line->npts, tolerance,
+                                      0, 0, result->coords, scratch);
+
+    pfree(scratch);
+  }
+  else
+  {
+    void *scratch = palloc_extended(douglas_peucker_scratch_size(line->npts), MCXT_ALLOC_HUGE);
+
+    result->npts = douglas_peucker(line->coords, line->npts, tolerance,
+                                   result->coords, scratch);
+
+    pfree(scratch);
+  }
+
+  SET_VARSIZE(result, offsetof(struct geo_linestring, coords) +
+                      result->npts * sizeof(struct coord2d));
+
+  return result;
+}
+
+
+PG_FUNCTION_INFO_V1(geo_linestring_simplify);
+
+Datum
+geo_linestring_simplify(PG_FUNCTION_ARGS)
+{
+  struct geo_linestring *line = PG_GETARG_GEOLINESTRING_TYPE_P(0);
+
+  float8 tolerance = PG_GETARG_FLOAT8(1);
+
+  PG_RETURN_GEOLINESTRING_TYPE_P(geo_linestring_simplify_i(line, tolerance, false));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_linestring_simplify_vw);
+
+Datum
+geo_linestring_simplify_vw(PG_FUNCTION_ARGS)
+{
+  struct geo_linestring *line = PG_GETARG_GEOLINESTRING_TYPE_P(0);
+
+  float8 min_area = PG_GETARG_FLOAT8(1);
+
+  PG_RETURN_GEOLINESTRING_TYPE_P(geo_linestring_simplify_i(line, min_area, true));
+}
+
+
 PG_FUNCTION_INFO_V1(geo_linestring_make_v2);
 
 Datum
@@ -572,91 +671,95 @@ PG_FUNCTION_INFO_V1(geo_linestring_make);
 Datum
 geo_linestring_make(PG_FUNCTION_ARGS)
 {
-  ArrayType *array_x;
+  ArrayType *array_x = PG_GETARG_ARRAYTYPE_P(0);
 
-  ArrayType *array_y;
+  ArrayType *array_y = PG_GETARG_ARRAYTYPE_P(1);
 
-  /* variables for "deconstructed" array*/
-  Datum *datums_x;
-  Datum *datums_y;
-  bool *nulls_x;
-  bool *nulls_y;
+  const float8 *x;
+  const float8 *y;
   int count_x, count_y;
 
-  int16 typlen;
+  struct geo_linestring *line = NULL;
 
-  bool typbyval;
+  int32 npts;
 
-  char typalign;
+  int size;
 
-  struct geo_linestring *line = NULL;
+/* the coordinates are read in place: no Datum or null arrays are built */
+  x = geo_float8_array_data(array_x, &count_x, "geo_linestring_make");
+  y = geo_float8_array_data(array_y, &count_y, "geo_linestring_make");
 
-  int32 npts;
+  if(count_x != count_y)
+    ereport(ERROR, (errcode (ERRCODE_INVALID_PARAMETER_VALUE),
+                  errmsg("different dimension of arrays geo_linestring_make")));
 
-  int32 srid = 0;
+  npts = count_x;
 
-  int base_size;
+  if(npts < 2)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("a geo_linestring needs at least two points")));
 
-  int size;
+  size = offsetof(struct geo_linestring, coords) + npts * sizeof(struct coord2d);
+
+  line = (struct geo_linestring*) palloc(size);
 
-  /*elog(NOTICE, "geo_linestring_from_array called);*/
+  SET_VARSIZE(line, size);
 
-  array_x = PG_GETARG_ARRAYTYPE_P(0);
-  array_y = PG_GETARG_ARRAYTYPE_P(1);
+  line->dummy = 0;
+  line->npts = npts;
+  line->srid = 0;
 
+  geo_coords_from_xy(x, y, npts, line->coords);
 
-  if (!PointerIsValid(array_x))
-    ereport(ERROR, (errcode (ERRCODE_INVALID_PARAMETER_VALUE),
-                    errmsg("missing argument one for geo_linestring_from_array")));
+  PG_RETURN_GEOLINESTRING_TYPE_P(line);
+}
 
 
-  if (!PointerIsValid(array_y))
-    ereport(ERROR, (errcode (ERRCODE_INVALID_PARAMETER_VALUE),
-                    errmsg("missing argument two for geo_linestring_from_array")));
+PG_FUNCTION_INFO_V1(geo_linestring_make_interleaved);
 
+Datum
+geo_linestring_make_interleaved(PG_FUNCTION_ARGS)
+{
+  ArrayType *array_xy = PG_GETARG_ARRAYTYPE_P(0);
 
-  /*elog(NOTICE, "geo_linestring_from_array insert numbers in line");*/
+  const float8 *xy;
+  int count;
 
-  /*values found in table pg_type*/
-  get_typlenbyvalalign(FLOAT8OID, &typlen, &typbyval, &typalign);
+  struct geo_linestring *line = NULL;
 
-  deconstruct_array(array_x, FLOAT8OID, typlen, typbyval, typalign , &datums_x, &nulls_x, &count_x);
-  deconstruct_array(array_y, FLOAT8OID, typlen, typbyval, typalign , &datums_y, &nulls_y, &count_y);
+  int32 npts;
 
-  /* elog(NOTICE, "dimension of arrays %d", count_x); */
-  if(count_x != count_y)
-    ereport(ERROR, (errcode (ERRCODE_INVALID_PARAMETER_VALUE),
-                  errmsg("different dimension of arrays geo_linestring_from_array")));
+  int size;
 
-  npts = count_x;
+  xy = geo_float8_array_data(array_xy, &count, "make_linestring");
 
-  base_size = npts * sizeof(struct coord2d);
+  if(count % 2 != 0)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("make_linestring expects an even number of coordinates")));
 
-  size = offsetof(struct geo_linestring, coords) + base_size;
+  npts = count / 2;
 
   if(npts < 2)
     ereport(ERROR,
-            (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
-            errmsg("invalid syntax for geo_linestring! ")));
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("a geo_linestring needs at least two points")));
+
+  size = offsetof(struct geo_linestring, coords) + npts * sizeof(struct coord2d);
 
   line = (struct geo_linestring*) palloc(size);
 
   SET_VARSIZE(line, size);
 
+  line->dummy = 0;
   line->npts = npts;
-  line->srid = srid;
+  line->srid = 0;
 
-  for(int i = 0; i < npts; i++)
-  {
-    line->coords[i].x = DatumGetFloat8(datums_x[i]);
-    /*elog(NOTICE, "geo_linestring x %g",line->coords[i].x );*/
-
-    line->coords[i].y = DatumGetFloat8(datums_y[i]);
-    /*elog(NOTICE, "geo_linestring y %g",line->coords[i].y );*/
-  }
+/* x1, y1, x2, y2, ... already has the layout of the coord2d array */
+  memcpy(line->coords, xy, npts * sizeof(struct coord2d));
 
   PG_RETURN_GEOLINESTRING_TYPE_P(line);
-
 }
 
 
@@ -666,19 +769,13 @@ Datum
 geo_linestring_intersection(PG_FUNCTION_ARGS)
 {
     FuncCallContext     *funcctx;
-    int                  call_cntr;
-    int                  max_calls;
-    TupleDesc            tupdesc;
-    AttInMetadata       *attinmeta;
-    struct geo_linestring *line = PG_GETARG_GEOLINESTRING_TYPE_P(0);
-    // struct geo_linestring *line2;
-
-    /* elog(NOTICE, "geo_linestring_intersection_points_v1 called");*/
+    struct geo_linestring *line;
 
     /* stuff done only on the first call of the function */
     if (SRF_IS_FIRSTCALL())
     {
         MemoryContext   oldcontext;
+        TupleDesc       tupdesc;
 
         /* create a function context for cross-call persistence */
         funcctx = SRF_FIRSTCALL_INIT();
@@ -686,6 +783,11 @@ geo_linestring_intersection(PG_FUNCTION_ARGS)
         /* switch to memory context appropriate for multiple function calls */
         oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
 
+        /* detoast once, not on every call */
+        line = PG_GETARG_GEOLINESTRING_TYPE_P(0);
+
+        funcctx->user_fctx = line;
+
         /* total number of tuples to be returned */
         funcctx->max_calls = line->npts;
 
@@ -696,12 +798,7 @@ geo_linestring_intersection(PG_FUNCTION_ARGS)
                      errmsg("function returning record called in context "
                             "that cannot accept type record")));
 
-        /*
-         * generate attribute metadata needed later to produce tuples from raw
-         * C strings
-         */
-        attinmeta = TupleDescGetAttInMetadata(tupdesc);
-        funcctx->attinmeta = attinmeta;
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
 
         MemoryContextSwitchTo(oldcontext);
     }
@@ -709,33 +806,110 @@ geo_linestring_intersection(PG_FUNCTION_ARGS)
     /* stuff done on every call of the function */
     funcctx = SRF_PERCALL_SETUP();
 
-    call_cntr = funcctx->call_cntr;
-    max_calls = funcctx->max_calls;
-    attinmeta = funcctx->attinmeta;
+    line = (struct geo_linestring *) funcctx->user_fctx;
 
-    if (call_cntr < max_calls)    /* do when there is more left to send */
+    if (funcctx->call_cntr < funcctx->max_calls)    /* do when there is more left to send */
     {
-        char       **values;
+        Datum        values[2];
+        bool         nulls[2] = { false, false };
         HeapTuple    tuple;
-        Datum        result;
-
-        values = (char **) palloc(2 * sizeof(char *));
-        values[0] = (char *) palloc(8 * sizeof(char));
-        values[1] = (char *) palloc(8 * sizeof(char));
-
-        snprintf(values[0], 8, "%g", line->coords[call_cntr].x);
-        snprintf(values[1], 8, "%g", line->coords[call_cntr].y);
 
-        /* build a tuple */
-        tuple = BuildTupleFromCStrings(attinmeta, values);
+        /* the coordinates go out in binary form, without any loss of precision */
+        values[0] = Float8GetDatum(line->coords[funcctx->call_cntr].x);
+        values[1] = Float8GetDatum(line->coords[funcctx->call_cntr].y);
 
-        /* make the tuple into a datum */
-        result = HeapTupleGetDatum(tuple);
+        tuple = heap_form_tuple(funcctx->tuple_desc, values, nulls);
 
-        SRF_RETURN_NEXT(funcctx, result);
+        SRF_RETURN_NEXT(funcctx, HeapTupleGetDatum(tuple));
     }
     else    /* do when there is no more left */
     {
         SRF_RETURN_DONE(funcctx);
     }
 }
+
+
+/*
+ * Vertex editing functions.
+ *
+ * They work on the expanded representation: when called with a read-write
+ * expanded object (e.g. a PL/pgSQL variable being assigned) the vertices
+ * are changed in place, otherwise a new expanded object is built.
+ */
+
+PG_FUNCTION_INFO_V1(geo_linestring_add_point);
+
+Datum
+geo_linestring_add_point(PG_FUNCTION_ARGS)
+{
+  struct geo_expanded *line = PG_GETARG_GEOEXPANDED_P(0);
+
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  if(line->srid != pt->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The LineString and point arguments have different SRIDs: %d e %d .",
+                          line->srid, pt->srid)));
+
+  geo_expanded_reserve(line, line->npts + 1);
+
+  line->coords[line->npts] = pt->coord;
+
+  ++(line->npts);
+
+  PG_RETURN_GEOEXPANDED_P(line);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_linestring_set_point);
+
+Datum
+geo_linestring_set_point(PG_FUNCTION_ARGS)
+{
+  struct geo_expanded *line = PG_GETARG_GEOEXPANDED_P(0);
+
+  int32 pos = PG_GETARG_INT32(1);
+
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(2);
+
+  if(line->srid != pt->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The LineString and point arguments have different SRIDs: %d e %d .",
+                          line->srid, pt->srid)));
+
+  if((pos < 0) || (pos >= line->npts))
+    ereport(ERROR, (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+                   errmsg("point index %d out of range: LineString has %d points.",
+                          pos, line->npts)));
+
+  line->coords[pos] = pt->coord;
+
+  PG_RETURN_GEOEXPANDED_P(line);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_linestring_remove_point);
+
+Datum
+geo_linestring_remove_point(PG_FUNCTION_ARGS)
+{
+  struct geo_expanded *line = PG_GETARG_GEOEXPANDED_P(0);
+
+  int32 pos = PG_GETARG_INT32(1);
+
+  if((pos < 0) || (pos >= line->npts))
+    ereport(ERROR, (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+                   errmsg("point index %d out of range: LineString has %d points.",
+                          pos, line->npts)));
+
+  if(line->npts <= 2)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("a LineString must have at least two points")));
+
+  memmove(&(line->coords[pos]), &(line->coords[pos + 1]),
+          (line->npts - pos - 1) * sizeof(struct coord2d));
+
+  --(line->npts);
+
+  PG_RETURN_GEOEXPANDED_P(line);
+}
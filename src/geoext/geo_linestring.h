@@ -42,6 +42,7 @@
 
 /* GeoExt */
 #include "decls.h"
+#include "geo_counters.h"
 
 
 /*
@@ -66,7 +67,7 @@ struct geo_linestring
  * Below we have the fmgr interface macros for dealing with a geo_linestring.
  *
  */
-#define DatumGetGeoLineStringTypeP(X)      ((struct geo_linestring*) PG_DETOAST_DATUM(X))
+#define DatumGetGeoLineStringTypeP(X)      ((struct geo_linestring*) geo_detoast_datum(X))
 #define PG_GETARG_GEOLINESTRING_TYPE_P(n)  DatumGetGeoLineStringTypeP(PG_GETARG_DATUM(n))
 #define PG_RETURN_GEOLINESTRING_TYPE_P(x)  PG_RETURN_POINTER(x)
 
@@ -86,6 +87,11 @@ extern Datum geo_linestring_to_str(PG_FUNCTION_ARGS);
 
 extern Datum geo_linestring_is_closed(PG_FUNCTION_ARGS);
 extern Datum geo_linestring_length(PG_FUNCTION_ARGS);
+extern Datum geo_linestring_length_sphere(PG_FUNCTION_ARGS);
+
+/* Douglas-Peucker and Visvalingam-Whyatt simplification */
+extern Datum geo_linestring_simplify(PG_FUNCTION_ARGS);
+extern Datum geo_linestring_simplify_vw(PG_FUNCTION_ARGS);
 
 /* create a geo_linestring from a pair of points represented by a composite */
 extern Datum geo_linestring_make_v1(PG_FUNCTION_ARGS);
@@ -106,7 +112,16 @@ extern Datum geo_linestring_boundary_points(PG_FUNCTION_ARGS);
 
 extern Datum geo_linestring_make(PG_FUNCTION_ARGS);
 
+/* create a geo_linestring from an array of interleaved x and y coordinates */
+extern Datum geo_linestring_make_interleaved(PG_FUNCTION_ARGS);
+
 extern Datum geo_linestring_intersection(PG_FUNCTION_ARGS);
 
 
+/* vertex editing on the expanded representation (see geo_expanded.h) */
+extern Datum geo_linestring_add_point(PG_FUNCTION_ARGS);
+extern Datum geo_linestring_set_point(PG_FUNCTION_ARGS);
+extern Datum geo_linestring_remove_point(PG_FUNCTION_ARGS);
+
+
 #endif  /* __GEOEXT_GEO_LINESTRING_H__ */
@@ -35,13 +35,16 @@
 
 /* GeoExtension */
 #include "geo_point.h"
+#include "geo_box.h"
 #include "algorithms.h"
 #include "hexutils.h"
 #include "wkt.h"
 
 
 /* PostgreSQL */
+#include <catalog/pg_type.h>
 #include <libpq/pqformat.h>
+#include <utils/array.h>
 #include <utils/builtins.h>
 #include <executor/executor.h>	/* for GetAttributeByName() */
 
@@ -61,6 +64,19 @@
 #define GEOEXT_GEOPOINT_SIZE ( sizeof(struct geo_point) - sizeof(int32) )
 #define GEOEXT_GEOPOINT_HEX_LEN ( ( 2 * GEOEXT_GEOPOINT_SIZE ) )
 
+/* The largest SRID accepted as a typmod */
+#define GEOEXT_MAX_SRID 999999
+
+
+void
+geo_srid_check_typmod(int32 srid, int32 typmod)
+{
+  if ((typmod >= 0) && (srid != typmod))
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("geometry SRID (%d) does not match column SRID (%d)", srid, typmod)));
+}
+
 
 /*
  * I/O Functions for the geo_point data type
@@ -73,6 +89,8 @@ geo_point_in(PG_FUNCTION_ARGS)
 {
   char *str = PG_GETARG_CSTRING(0);
 
+  int32 typmod = (PG_NARGS() > 2) ? PG_GETARG_INT32(2) : -1;
+
   struct geo_point *pt = (struct geo_point*) palloc(sizeof(struct geo_point));
 
   /*elog(NOTICE, "geo_point_in called for: %s", str);*/
@@ -95,6 +113,8 @@ geo_point_in(PG_FUNCTION_ARGS)
  */
   pt->dummy = 0;
 
+  geo_srid_check_typmod(pt->srid, typmod);
+
   PG_RETURN_GEOPOINT_TYPE_P(pt);
 }
 
@@ -128,6 +148,8 @@ geo_point_recv(PG_FUNCTION_ARGS)
 {
   StringInfo buf = (StringInfo) PG_GETARG_POINTER(0);
 
+  int32 typmod = (PG_NARGS() > 2) ? PG_GETARG_INT32(2) : -1;
+
   struct geo_point *result = (struct geo_point*) palloc(sizeof(struct geo_point));
 
   /*elog(NOTICE, "geo_point_recv called");*/
@@ -146,6 +168,8 @@ geo_point_recv(PG_FUNCTION_ARGS)
  */
   result->dummy = 0;
 
+  geo_srid_check_typmod(result->srid, typmod);
+
   PG_RETURN_GEOPOINT_TYPE_P(result);
 }
 
@@ -175,6 +199,71 @@ geo_point_send(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Type modifier: geo_point(srid)
+ */
+
+PG_FUNCTION_INFO_V1(geo_srid_typmod_in);
+
+Datum
+geo_srid_typmod_in(PG_FUNCTION_ARGS)
+{
+  ArrayType *arr = PG_GETARG_ARRAYTYPE_P(0);
+
+  int32 *mods;
+
+  int n;
+
+  mods = ArrayGetIntegerTypmods(arr, &n);
+
+  if (n != 1)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("invalid type modifier: only the SRID can be given")));
+
+  if ((mods[0] < 0) || (mods[0] > GEOEXT_MAX_SRID))
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("SRID %d is out of range [0, %d]", mods[0], GEOEXT_MAX_SRID)));
+
+  PG_RETURN_INT32(mods[0]);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_srid_typmod_out);
+
+Datum
+geo_srid_typmod_out(PG_FUNCTION_ARGS)
+{
+  int32 typmod = PG_GETARG_INT32(0);
+
+  if (typmod < 0)
+    PG_RETURN_CSTRING(pstrdup(""));
+
+  PG_RETURN_CSTRING(psprintf("(%d)", typmod));
+}
+
+
+/*
+ * The length coercion cast of geo_point: a value is stored in a
+ * geo_point(srid) column only if it has the same SRID.
+ */
+
+PG_FUNCTION_INFO_V1(geo_point_enforce_typmod);
+
+Datum
+geo_point_enforce_typmod(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  int32 typmod = PG_GETARG_INT32(1);
+
+  geo_srid_check_typmod(pt->srid, typmod);
+
+  PG_RETURN_GEOPOINT_TYPE_P(pt);
+}
+
+
 /*
  * geo_point operations
  */
@@ -248,6 +337,203 @@ geo_point_distance(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Geodesic distances: x is the longitude and y the latitude, in degrees.
+ * The results are in the units of the radius (or of the WGS84 axes, meters).
+ */
+
+PG_FUNCTION_INFO_V1(geo_point_distance_sphere);
+
+Datum
+geo_point_distance_sphere(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt1 = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  struct geo_point *pt2 = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  float8 radius = PG_GETARG_FLOAT8(2);
+
+  if(pt1->srid != pt2->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The point arguments have different SRIDs: %d e %d .", pt1->srid, pt2->srid)));
+
+  PG_RETURN_FLOAT8(haversine_distance(&(pt1->coord), &(pt2->coord), radius));
+}
+
+
+/*
+ * The distances from a point to each point of an array, in one call.
+ *
+ * The elements are read in place; the NULL elements give NULL distances.
+ */
+
+PG_FUNCTION_INFO_V1(geo_point_distance_sphere_array);
+
+Datum
+geo_point_distance_sphere_array(PG_FUNCTION_ARGS)
+{
+  struct geo_point *origin = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  ArrayType *pts = PG_GETARG_ARRAYTYPE_P(1);
+
+  float8 radius = PG_GETARG_FLOAT8(2);
+
+  int npts = ArrayGetNItems(ARR_NDIM(pts), ARR_DIMS(pts));
+
+  ArrayType *result;
+
+  float8 *dist;
+
+  if(ARR_NDIM(pts) > 1)
+    ereport(ERROR,
+            (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+             errmsg("distance_sphere expects a one-dimensional array")));
+
+  if(npts == 0)
+    PG_RETURN_ARRAYTYPE_P(construct_empty_array(FLOAT8OID));
+
+  if(!ARR_HASNULL(pts))
+  {
+/* the geo_point elements are contiguous: no Datum arrays are built */
+    const struct geo_point *elems = (const struct geo_point*) ARR_DATA_PTR(pts);
+
+    for(int i = 0; i < npts; ++i)
+      if(elems[i].srid != origin->srid)
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                       errmsg("The point arguments have different SRIDs: %d e %d .", origin->srid, elems[i].srid)));
+
+/* a float8 array without nulls, filled in place by the kernel */
+    {
+      int nbytes = ARR_OVERHEAD_NONULLS(1) + npts * sizeof(float8);
+
+      result = (ArrayType*) palloc0(nbytes);
+
+      SET_VARSIZE(result, nbytes);
+      result->ndim = 1;
+      result->dataoffset = 0;
+      result->elemtype = FLOAT8OID;
+      ARR_DIMS(result)[0] = npts;
+      ARR_LBOUND(result)[0] = ARR_LBOUND(pts)[0];
+    }
+
+    dist = (float8*) ARR_DATA_PTR(result);
+
+    haversine_distances(&(origin->coord), &(elems[0].coord), sizeof(struct geo_point),
+                        npts, radius, dist);
+  }
+  else
+  {
+    Datum *elems;
+    bool *nulls;
+
+    int lbound = ARR_LBOUND(pts)[0];
+
+    Datum *values = (Datum*) palloc(npts * sizeof(Datum));
+
+    deconstruct_array(pts, ARR_ELEMTYPE(pts), sizeof(struct geo_point), false, TYPALIGN_DOUBLE,
+                      &elems, &nulls, &npts);
+
+    for(int i = 0; i < npts; ++i)
+    {
+      struct geo_point *pt;
+
+      if(nulls[i])
+        continue;
+
+      pt = DatumGetGeoPointTypeP(elems[i]);
+
+      if(pt->srid != origin->srid)
+        ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                       errmsg("The point arguments have different SRIDs: %d e %d .", origin->srid, pt->srid)));
+
+      values[i] = Float8GetDatum(haversine_distance(&(origin->coord), &(pt->coord), radius));
+    }
+
+    result = construct_md_array(values, nulls, 1, &npts, &lbound,
+                                FLOAT8OID, sizeof(float8), FLOAT8PASSBYVAL, TYPALIGN_DOUBLE);
+  }
+
+  PG_RETURN_ARRAYTYPE_P(result);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_distance_spheroid);
+
+Datum
+geo_point_distance_spheroid(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt1 = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  struct geo_point *pt2 = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  if(pt1->srid != pt2->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The point arguments have different SRIDs: %d e %d .", pt1->srid, pt2->srid)));
+
+  PG_RETURN_FLOAT8(geodesic_distance(&(pt1->coord), &(pt2->coord), GEO_WGS84_A, GEO_WGS84_F));
+}
+
+
+/*
+ * dwithin(a, b, r) is the same as distance(a, b) <= r, but the planner
+ * can turn it into an index condition (see geo_supportfn.c).
+ */
+
+PG_FUNCTION_INFO_V1(geo_point_dwithin);
+
+Datum
+geo_point_dwithin(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt1 = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  struct geo_point *pt2 = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  float8 r = PG_GETARG_FLOAT8(2);
+
+  if(pt1->srid != pt2->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The point arguments have different SRIDs: %d e %d .", pt1->srid, pt2->srid)));
+
+  PG_RETURN_BOOL(euclidian_distance(&(pt1->coord), &(pt2->coord)) <= r);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_bbox);
+
+Datum
+geo_point_bbox(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  struct geo_box *box = (struct geo_box*) palloc(sizeof(struct geo_box));
+
+  box->high = pt->coord;
+  box->low = pt->coord;
+
+  PG_RETURN_GEOBOX_TYPE_P(box);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_expand);
+
+Datum
+geo_point_expand(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  float8 r = PG_GETARG_FLOAT8(1);
+
+  struct geo_box *box = (struct geo_box*) palloc(sizeof(struct geo_box));
+
+  box->high.x = pt->coord.x + r;
+  box->high.y = pt->coord.y + r;
+  box->low.x = pt->coord.x - r;
+  box->low.y = pt->coord.y - r;
+
+  PG_RETURN_GEOBOX_TYPE_P(box);
+}
+
+
 
 PG_FUNCTION_INFO_V1(geo_point_same_position);
 
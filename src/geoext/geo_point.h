@@ -39,6 +39,7 @@
 /* PostgreSQL */
 #include <postgres.h>
 #include <fmgr.h>
+#include <nodes/pg_list.h>
 
 /* GeoExt */
 #include "decls.h"
@@ -69,6 +70,31 @@ struct geo_point
 #define PG_RETURN_GEOPOINT_TYPE_P(x)  PG_RETURN_POINTER(x)
 
 
+/*
+ * A geo_cpoint is the compact form of a geo_point: it only stores the
+ * coordinates and the SRID is the typmod of the column, as in geo_cpoint(4326).
+ *
+ * It is a fixed-size data type in PostgreSQL with a double-alignment.
+ *
+ */
+struct geo_cpoint
+{
+  struct coord2d coord;  /* 2D coordinate. */
+};
+
+#define DatumGetGeoCPointTypeP(X)      ((struct geo_cpoint*) DatumGetPointer(X))
+#define PG_GETARG_GEOCPOINT_TYPE_P(n)  DatumGetGeoCPointTypeP(PG_GETARG_DATUM(n))
+#define PG_RETURN_GEOCPOINT_TYPE_P(x)  PG_RETURN_POINTER(x)
+
+
+/*
+ * \brief Raises an error if the SRID of a value does not match the typmod
+ *        of a column. A negative typmod accepts any SRID.
+ *
+ */
+void geo_srid_check_typmod(int32 srid, int32 typmod);
+
+
 /*
  * geo_point operations.
  *
@@ -79,11 +105,25 @@ extern Datum geo_point_out(PG_FUNCTION_ARGS);
 extern Datum geo_point_recv(PG_FUNCTION_ARGS);
 extern Datum geo_point_send(PG_FUNCTION_ARGS);
 
+/* the typmod of the geometry columns is their SRID */
+extern Datum geo_srid_typmod_in(PG_FUNCTION_ARGS);
+extern Datum geo_srid_typmod_out(PG_FUNCTION_ARGS);
+extern Datum geo_point_enforce_typmod(PG_FUNCTION_ARGS);
+
 extern Datum geo_point_from_text(PG_FUNCTION_ARGS);
 extern Datum geo_point_to_str(PG_FUNCTION_ARGS);
 
 extern Datum geo_point_distance(PG_FUNCTION_ARGS);
 
+/* geodesic distances between longitude and latitude coordinates */
+extern Datum geo_point_distance_sphere(PG_FUNCTION_ARGS);
+extern Datum geo_point_distance_sphere_array(PG_FUNCTION_ARGS);
+extern Datum geo_point_distance_spheroid(PG_FUNCTION_ARGS);
+extern Datum geo_point_dwithin(PG_FUNCTION_ARGS);
+
+extern Datum geo_point_bbox(PG_FUNCTION_ARGS);
+extern Datum geo_point_expand(PG_FUNCTION_ARGS);
+
 extern Datum geo_point_same_position(PG_FUNCTION_ARGS);
 
 
@@ -99,4 +139,58 @@ extern Datum geo_point_gt(PG_FUNCTION_ARGS);
 extern Datum geo_point_le(PG_FUNCTION_ARGS);
 extern Datum geo_point_ge(PG_FUNCTION_ARGS);
 
+
+/*
+ * R-tree GiST index support (see geo_point_gist.c for the keys)
+ *
+ */
+extern Datum geo_point_box_overlap(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_consistent(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_compress(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_fetch(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_union(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_penalty(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_picksplit(PG_FUNCTION_ARGS);
+extern Datum geo_point_gist_same(PG_FUNCTION_ARGS);
+
+
+/*
+ * \brief Raises an error if the two arguments of a call on geo_cpoint
+ *        values have different known SRIDs, i.e. typmods.
+ *
+ */
+void geo_cpoint_check_args(List *args);
+
+
+/*
+ * geo_cpoint operations: the values carry no SRID, so the comparisons and
+ * distance() check the typmods of their arguments instead, when they are
+ * called from an expression and again at plan time (geo_cpoint_support).
+ *
+ */
+extern Datum geo_cpoint_in(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_out(PG_FUNCTION_ARGS);
+
+extern Datum geo_cpoint_recv(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_send(PG_FUNCTION_ARGS);
+
+extern Datum geo_cpoint_enforce_typmod(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_from_geo_point(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_to_geo_point(PG_FUNCTION_ARGS);
+
+extern Datum geo_cpoint_distance(PG_FUNCTION_ARGS);
+
+extern Datum geo_cpoint_cmp(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_eq(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_ne(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_lt(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_gt(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_le(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_ge(PG_FUNCTION_ARGS);
+
+/* R-tree GiST index support (the keys are the ones of geo_point, and hold the whole value) */
+extern Datum geo_cpoint_box_overlap(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_gist_compress(PG_FUNCTION_ARGS);
+extern Datum geo_cpoint_gist_fetch(PG_FUNCTION_ARGS);
+
 #endif  /* __GEOEXT_H__ */
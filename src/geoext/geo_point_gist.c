@@ -20,9 +20,9 @@
 
 /*!
  *
- * \file geoext/geo_point_btree.c
+ * \file geoext/geo_point_gist.c
  *
- * \brief Extension interface to PostgreSQL B-tree.
+ * \brief Extension interface to PostgreSQL R-tree GiST for geo_point.
  *
  * \author Gilberto Ribeiro de Queiroz
  * \author Fabiana Zioti
@@ -35,10 +35,14 @@
 
 /* GeoExtension */
 #include "geo_point.h"
+#include "geo_box.h"
+#include "geo_counters.h"
 #include "algorithms.h"
 
 
 /* PostgreSQL */
+#include <access/gist.h>
+#include <access/stratnum.h>
 #include <utils/builtins.h>
 
 
@@ -55,3 +59,283 @@
  * GiST operators for geo_point
  */
 
+/*
+ * The keys have the size and the alignment of a geo_point, the storage
+ * type of the opclass. A leaf key is the indexed point itself, with its
+ * SRID, so it is exact and the fetch method gives it back for index-only
+ * scans. An internal key is the union of the keys below it: a geo_box4,
+ * rounded outward, and a tag in the place of the dummy field of a point,
+ * which is 0 in a leaf key.
+ */
+struct geo_point_gist_key
+{
+  struct geo_box4 box;
+  int32 unused;
+  int32 tag;
+};
+
+#define GEOEXT_POINT_GIST_INTERNAL 1
+
+StaticAssertDecl(sizeof(struct geo_point_gist_key) == sizeof(struct geo_point),
+                 "a geo_point GiST key must have the size of a geo_point");
+
+
+static inline bool
+geo_point_gist_is_internal(Datum key)
+{
+  return ((struct geo_point_gist_key*) DatumGetPointer(key))->tag == GEOEXT_POINT_GIST_INTERNAL;
+}
+
+
+/* the box of a key: degenerate for a point */
+static inline void
+geo_point_gist_key_box(Datum key, struct geo_box *box)
+{
+  if (geo_point_gist_is_internal(key))
+  {
+    geo_box4_to_box(&((struct geo_point_gist_key*) DatumGetPointer(key))->box, box);
+  }
+  else
+  {
+    box->low = DatumGetGeoPointTypeP(key)->coord;
+    box->high = box->low;
+  }
+}
+
+
+static inline struct geo_point_gist_key*
+geo_point_gist_internal_key(const struct geo_box *box)
+{
+  struct geo_point_gist_key *key = (struct geo_point_gist_key*) palloc0(sizeof(struct geo_point_gist_key));
+
+  geo_box4_from_coords(&box->low, &box->high, &key->box);
+
+  key->tag = GEOEXT_POINT_GIST_INTERNAL;
+
+  return key;
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_box_overlap);
+
+Datum
+geo_point_box_overlap(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  struct geo_box *box = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  PG_RETURN_BOOL(float8_cmp_internal(pt->coord.x, box->low.x) >= 0 &&
+                 float8_cmp_internal(pt->coord.x, box->high.x) <= 0 &&
+                 float8_cmp_internal(pt->coord.y, box->low.y) >= 0 &&
+                 float8_cmp_internal(pt->coord.y, box->high.y) <= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_consistent);
+
+Datum
+geo_point_gist_consistent(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_box *query = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  StrategyNumber strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+
+  bool *recheck = (bool *) PG_GETARG_POINTER(4);
+
+  bool retval;
+
+  instr_time start;
+
+  if (strategy != RTOverlapStrategyNumber)
+    elog(ERROR, "unrecognized strategy number: %d", strategy);
+
+  geo_counter_start(&start);
+
+/* a leaf key is the point: the test is the one of the operator */
+  *recheck = false;
+
+  if (geo_point_gist_is_internal(entry->key))
+  {
+    struct geo_box4 *key = &((struct geo_point_gist_key*) DatumGetPointer(entry->key))->box;
+
+    retval = key->low_x <= query->high.x && key->high_x >= query->low.x &&
+             key->low_y <= query->high.y && key->high_y >= query->low.y;
+  }
+  else
+  {
+    retval = DatumGetBool(DirectFunctionCall2(geo_point_box_overlap,
+                                              entry->key, PointerGetDatum(query)));
+  }
+
+  geo_counter_stop(GEO_COUNTER_GIST_CONSISTENT, &start);
+
+  PG_RETURN_BOOL(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_compress);
+
+Datum
+geo_point_gist_compress(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  GISTENTRY *retval = entry;
+
+  if (entry->leafkey)
+  {
+    struct geo_point *pt = (struct geo_point*) palloc(sizeof(struct geo_point));
+
+    *pt = *DatumGetGeoPointTypeP(entry->key);
+
+    pt->dummy = 0;
+
+    retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+
+    gistentryinit(*retval, PointerGetDatum(pt),
+                  entry->rel, entry->page, entry->offset, false);
+  }
+
+  PG_RETURN_POINTER(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_fetch);
+
+Datum
+geo_point_gist_fetch(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_point *pt = (struct geo_point*) palloc(sizeof(struct geo_point));
+
+  GISTENTRY *retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+
+  *pt = *DatumGetGeoPointTypeP(entry->key);
+
+  gistentryinit(*retval, PointerGetDatum(pt),
+                entry->rel, entry->page, entry->offset, false);
+
+  PG_RETURN_POINTER(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_union);
+
+Datum
+geo_point_gist_union(PG_FUNCTION_ARGS)
+{
+  GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+
+  int *sizep = (int *) PG_GETARG_POINTER(1);
+
+  struct geo_box pageunion;
+
+  geo_counter_add(GEO_COUNTER_GIST_UNION, 1);
+
+  geo_point_gist_key_box(entryvec->vector[0].key, &pageunion);
+
+  for(int i = 1; i < entryvec->n; ++i)
+  {
+    struct geo_box box;
+
+    geo_point_gist_key_box(entryvec->vector[i].key, &box);
+
+    pageunion.high.x = Max(pageunion.high.x, box.high.x);
+    pageunion.high.y = Max(pageunion.high.y, box.high.y);
+    pageunion.low.x = Min(pageunion.low.x, box.low.x);
+    pageunion.low.y = Min(pageunion.low.y, box.low.y);
+  }
+
+  *sizep = sizeof(struct geo_point_gist_key);
+
+  PG_RETURN_POINTER(geo_point_gist_internal_key(&pageunion));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_penalty);
+
+Datum
+geo_point_gist_penalty(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *origentry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  GISTENTRY *newentry = (GISTENTRY *) PG_GETARG_POINTER(1);
+
+  float *result = (float *) PG_GETARG_POINTER(2);
+
+  struct geo_box obox;
+  struct geo_box nbox;
+
+  geo_counter_add(GEO_COUNTER_GIST_PENALTY, 1);
+
+  geo_point_gist_key_box(origentry->key, &obox);
+  geo_point_gist_key_box(newentry->key, &nbox);
+
+/* the same penalty as for the geo_box keys */
+  *result = box_insert_penalty(&obox.low, &obox.high, &nbox.low, &nbox.high);
+
+  PG_RETURN_POINTER(result);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_picksplit);
+
+Datum
+geo_point_gist_picksplit(PG_FUNCTION_ARGS)
+{
+  GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+
+  GIST_SPLITVEC *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1);
+
+  OffsetNumber maxoff = entryvec->n - 1;
+
+  GistEntryVector *boxvec;
+
+  struct geo_box *boxes;
+
+/*
+ * The keys are widened to geo_box, which is exact, and split by the
+ * geo_box picksplit. Its unions are rounded outward to the internal keys.
+ */
+  boxvec = (GistEntryVector *) palloc(GEVHDRSZ + entryvec->n * sizeof(GISTENTRY));
+  boxvec->n = entryvec->n;
+
+  boxes = (struct geo_box *) palloc(entryvec->n * sizeof(struct geo_box));
+
+  for(OffsetNumber i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+  {
+    geo_point_gist_key_box(entryvec->vector[i].key, &boxes[i]);
+
+    boxvec->vector[i] = entryvec->vector[i];
+    boxvec->vector[i].key = PointerGetDatum(&boxes[i]);
+  }
+
+  DirectFunctionCall2(geo_box_picksplit, PointerGetDatum(boxvec), PointerGetDatum(v));
+
+  v->spl_ldatum = PointerGetDatum(geo_point_gist_internal_key(DatumGetGeoBoxTypeP(v->spl_ldatum)));
+  v->spl_rdatum = PointerGetDatum(geo_point_gist_internal_key(DatumGetGeoBoxTypeP(v->spl_rdatum)));
+
+  PG_RETURN_POINTER(v);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_gist_same);
+
+Datum
+geo_point_gist_same(PG_FUNCTION_ARGS)
+{
+  struct geo_point_gist_key *first = (struct geo_point_gist_key*) PG_GETARG_POINTER(0);
+
+  struct geo_point_gist_key *second = (struct geo_point_gist_key*) PG_GETARG_POINTER(1);
+
+  bool *result = (bool *) PG_GETARG_POINTER(2);
+
+/* the keys are fully initialized, a leaf key included */
+  *result = memcmp(first, second, sizeof(struct geo_point_gist_key)) == 0;
+
+  PG_RETURN_POINTER(result);
+}
@@ -37,7 +37,11 @@
 /* GeoExtension */
 #include "geo_polygon.h"
 #include "algorithms.h"
+#include "geo_array.h"
+#include "geo_box.h"
+#include "geo_expanded.h"
 #include "geo_point.h"
+#include "geo_prepared.h"
 #include "hexutils.h"
 #include "wkt.h"
 
@@ -250,6 +254,65 @@ geo_polygon_to_str(PG_FUNCTION_ARGS)
 }
 
 
+PG_FUNCTION_INFO_V1(geo_polygon_make);
+
+Datum
+geo_polygon_make(PG_FUNCTION_ARGS)
+{
+  ArrayType *array_x = PG_GETARG_ARRAYTYPE_P(0);
+
+  ArrayType *array_y = PG_GETARG_ARRAYTYPE_P(1);
+
+  const float8 *x;
+  const float8 *y;
+  int count_x, count_y;
+
+  struct geo_polygon *poly = NULL;
+
+  bool closed;
+
+  int32 npts;
+
+  int size;
+
+/* the coordinates are read in place: no Datum or null arrays are built */
+  x = geo_float8_array_data(array_x, &count_x, "geo_polygon_make");
+  y = geo_float8_array_data(array_y, &count_y, "geo_polygon_make");
+
+  if(count_x != count_y)
+    ereport(ERROR, (errcode (ERRCODE_INVALID_PARAMETER_VALUE),
+                  errmsg("different dimension of arrays geo_polygon_make")));
+
+/* an open ring is closed by repeating its first vertex */
+  closed = (count_x > 0) &&
+           (x[0] == x[count_x - 1]) && (y[0] == y[count_x - 1]);
+
+  npts = closed ? count_x : count_x + 1;
+
+  if(npts < 4)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("a polygon must have at least four points")));
+
+  size = offsetof(struct geo_polygon, coords) + npts * sizeof(struct coord2d);
+
+  poly = (struct geo_polygon*) palloc(size);
+
+  SET_VARSIZE(poly, size);
+
+  poly->dummy = 0;
+  poly->npts = npts;
+  poly->srid = 0;
+
+  geo_coords_from_xy(x, y, count_x, poly->coords);
+
+  if(!closed)
+    poly->coords[npts - 1] = poly->coords[0];
+
+  PG_RETURN_GEOPOLYGON_TYPE_P(poly);
+}
+
+
 PG_FUNCTION_INFO_V1(geo_polygon_area);
 
 Datum
@@ -276,15 +339,197 @@ geo_polygon_perimeter(PG_FUNCTION_ARGS)
 }
 
 
+PG_FUNCTION_INFO_V1(geo_polygon_simplify_preserve_topology);
+
+Datum
+geo_polygon_simplify_preserve_topology(PG_FUNCTION_ARGS)
+{
+  struct geo_polygon *poly = PG_GETARG_GEOPOLYGON_TYPE_P(0);
+
+  float8 min_area = PG_GETARG_FLOAT8(1);
+
+  struct geo_polygon *result = NULL;
+
+  void *scratch = NULL;
+
+  int size = VARSIZE(poly);
+
+  if(isnan(min_area) || (min_area < 0.0))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("simplification tolerance must be a non-negative number")));
+
+/* a triangle has nothing left to remove */
+  if(poly->npts <= 4)
+    PG_RETURN_GEOPOLYGON_TYPE_P(poly);
+
+  result = (struct geo_polygon*) palloc(size);
+
+  result->dummy = 0;
+  result->srid = poly->srid;
+
+  scratch = palloc(visvalingam_whyatt_scratch_size(poly->npts));
+
+  result->npts = visvalingam_whyatt(poly->coords, poly->npts, min_area,
+                                    1, 1, result->coords, scratch);
+
+  pfree(scratch);
+
+  SET_VARSIZE(result, offsetof(struct geo_polygon, coords) +
+                      result->npts * sizeof(struct coord2d));
+
+  PG_RETURN_GEOPOLYGON_TYPE_P(result);
+}
+
+
 PG_FUNCTION_INFO_V1(geo_polygon_contains_point);
 
 Datum
 geo_polygon_contains_point(PG_FUNCTION_ARGS)
 {
-  struct geo_polygon *poly = PG_GETARG_GEOPOLYGON_TYPE_P(0);
+  struct geo_prepared_polygon *prep = geo_prepared_polygon_get(fcinfo->flinfo, PG_GETARG_DATUM(0));
   struct geo_point *point = PG_GETARG_GEOPOINT_TYPE_P(1);
+  struct geo_polygon *poly;
+
+  instr_time start;
 
-  int result = point_in_polygon(&point->coord, poly->coords, poly->npts);
+  int result;
+
+  if (prep != NULL)
+  {
+/* a cached polygon has its bounding box at hand: try it first */
+    if (!(point->coord.x >= prep->box.low.x && point->coord.x <= prep->box.high.x &&
+          point->coord.y >= prep->box.low.y && point->coord.y <= prep->box.high.y))
+      PG_RETURN_BOOL(false);
+
+    poly = prep->poly;
+  }
+  else
+    poly = PG_GETARG_GEOPOLYGON_TYPE_P(0);
+
+  geo_counter_start(&start);
+
+  result = point_in_polygon(&point->coord, poly->coords, poly->npts);
+
+  geo_counter_stop(GEO_COUNTER_POINT_IN_POLYGON, &start);
+  geo_counter_add(GEO_COUNTER_PIP_EDGE_TESTS, poly->npts - 1);
 
   PG_RETURN_BOOL(result);
 }
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_bbox);
+
+Datum
+geo_polygon_bbox(PG_FUNCTION_ARGS)
+{
+  struct geo_polygon *poly = PG_GETARG_GEOPOLYGON_TYPE_P(0);
+
+  struct geo_box *box = (struct geo_box*) palloc(sizeof(struct geo_box));
+
+  mbr(poly->coords, poly->npts, &box->low, &box->high);
+
+  PG_FREE_IF_COPY(poly, 0);
+
+  PG_RETURN_GEOBOX_TYPE_P(box);
+}
+
+
+/*
+ * Vertex editing functions.
+ *
+ * They work on the expanded representation (see geo_linestring.c).
+ * The ring is kept closed: the last vertex is always a copy of the first one.
+ */
+
+PG_FUNCTION_INFO_V1(geo_polygon_add_point);
+
+Datum
+geo_polygon_add_point(PG_FUNCTION_ARGS)
+{
+  struct geo_expanded *poly = PG_GETARG_GEOEXPANDED_P(0);
+
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(1);
+
+  if(poly->srid != pt->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The Polygon and point arguments have different SRIDs: %d e %d .",
+                          poly->srid, pt->srid)));
+
+  geo_expanded_reserve(poly, poly->npts + 1);
+
+/* the new vertex goes right before the closing one */
+  poly->coords[poly->npts] = poly->coords[poly->npts - 1];
+  poly->coords[poly->npts - 1] = pt->coord;
+
+  ++(poly->npts);
+
+  PG_RETURN_GEOEXPANDED_P(poly);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_set_point);
+
+Datum
+geo_polygon_set_point(PG_FUNCTION_ARGS)
+{
+  struct geo_expanded *poly = PG_GETARG_GEOEXPANDED_P(0);
+
+  int32 pos = PG_GETARG_INT32(1);
+
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(2);
+
+  if(poly->srid != pt->srid)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("The Polygon and point arguments have different SRIDs: %d e %d .",
+                          poly->srid, pt->srid)));
+
+  if((pos < 0) || (pos >= poly->npts))
+    ereport(ERROR, (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+                   errmsg("point index %d out of range: Polygon has %d points.",
+                          pos, poly->npts)));
+
+  poly->coords[pos] = pt->coord;
+
+/* keep the ring closed */
+  if(pos == 0)
+    poly->coords[poly->npts - 1] = pt->coord;
+  else if(pos == (poly->npts - 1))
+    poly->coords[0] = pt->coord;
+
+  PG_RETURN_GEOEXPANDED_P(poly);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_remove_point);
+
+Datum
+geo_polygon_remove_point(PG_FUNCTION_ARGS)
+{
+  struct geo_expanded *poly = PG_GETARG_GEOEXPANDED_P(0);
+
+  int32 pos = PG_GETARG_INT32(1);
+
+  if((pos < 0) || (pos >= poly->npts))
+    ereport(ERROR, (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+                   errmsg("point index %d out of range: Polygon has %d points.",
+                          pos, poly->npts)));
+
+  if(poly->npts <= 4)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                   errmsg("a polygon must have at least four points")));
+
+/* the closing vertex is the same as the first one */
+  if(pos == (poly->npts - 1))
+    pos = 0;
+
+  memmove(&(poly->coords[pos]), &(poly->coords[pos + 1]),
+          (poly->npts - pos - 1) * sizeof(struct coord2d));
+
+  --(poly->npts);
+
+/* if the first vertex was removed, close the ring with the new one */
+  if(pos == 0)
+    poly->coords[poly->npts - 1] = poly->coords[0];
+
+  PG_RETURN_GEOEXPANDED_P(poly);
+}
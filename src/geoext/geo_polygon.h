@@ -43,6 +43,7 @@
 
 /* GeoExt */
 #include "decls.h"
+#include "geo_counters.h"
 
 
 /*
@@ -67,7 +68,7 @@ struct geo_polygon
  * Below we have the fmgr interface macros for dealing with a geo_polygon.
  *
  */
-#define DatumGetGeoPolygonTypeP(X)      ((struct geo_polygon*) PG_DETOAST_DATUM(X))
+#define DatumGetGeoPolygonTypeP(X)      ((struct geo_polygon*) geo_detoast_datum(X))
 #define PG_GETARG_GEOPOLYGON_TYPE_P(n)  DatumGetGeoPolygonTypeP(PG_GETARG_DATUM(n))
 #define PG_RETURN_GEOPOLYGON_TYPE_P(x)  PG_RETURN_POINTER(x)
 
@@ -85,9 +86,28 @@ extern Datum geo_polygon_send(PG_FUNCTION_ARGS);
 extern Datum geo_polygon_from_text(PG_FUNCTION_ARGS);
 extern Datum geo_polygon_to_str(PG_FUNCTION_ARGS);
 
+/* create a geo_polygon from the arrays of x and y coordinates */
+extern Datum geo_polygon_make(PG_FUNCTION_ARGS);
+
 extern Datum geo_polygon_area(PG_FUNCTION_ARGS);
 extern Datum geo_polygon_perimeter(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_simplify_preserve_topology(PG_FUNCTION_ARGS);
 extern Datum geo_polygon_contains_point(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_bbox(PG_FUNCTION_ARGS);
+
+
+/* vertex editing on the expanded representation (see geo_expanded.h) */
+extern Datum geo_polygon_add_point(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_set_point(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_remove_point(PG_FUNCTION_ARGS);
+
+
+/*
+ * R-tree GiST index support (the keys are geo_box)
+ *
+ */
+extern Datum geo_polygon_box_overlap(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_gist_compress(PG_FUNCTION_ARGS);
 
 
 #endif  /* __GEOEXT_GEO_POLYGON_H__ */
@@ -0,0 +1,101 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for 
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_polygon_gist.c
+ *
+ * \brief Extension interface to PostgreSQL R-tree GiST for geo_polygon.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_polygon.h"
+#include "geo_box.h"
+#include "algorithms.h"
+
+
+/* PostgreSQL */
+#include <access/gist.h>
+#include <utils/builtins.h>
+
+
+/*
+ * A geo_polygon is indexed by its bounding box, so the other GiST methods
+ * are the ones of the geo_box opclass.
+ */
+
+PG_FUNCTION_INFO_V1(geo_polygon_box_overlap);
+
+Datum
+geo_polygon_box_overlap(PG_FUNCTION_ARGS)
+{
+  struct geo_polygon *poly = PG_GETARG_GEOPOLYGON_TYPE_P(0);
+
+  struct geo_box *box = PG_GETARG_GEOBOX_TYPE_P(1);
+
+  struct geo_box pbox;
+
+  mbr(poly->coords, poly->npts, &pbox.low, &pbox.high);
+
+  PG_FREE_IF_COPY(poly, 0);
+
+  PG_RETURN_BOOL(float8_cmp_internal(pbox.low.x, box->high.x) <= 0 &&
+                 float8_cmp_internal(pbox.high.x, box->low.x) >= 0 &&
+                 float8_cmp_internal(pbox.low.y, box->high.y) <= 0 &&
+                 float8_cmp_internal(pbox.high.y, box->low.y) >= 0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_gist_compress);
+
+Datum
+geo_polygon_gist_compress(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  GISTENTRY *retval = entry;
+
+  if (entry->leafkey)
+  {
+    struct geo_polygon *poly = DatumGetGeoPolygonTypeP(entry->key);
+
+    struct geo_box *box = (struct geo_box*) palloc(sizeof(struct geo_box));
+
+    mbr(poly->coords, poly->npts, &box->low, &box->high);
+
+    if ((Pointer) poly != DatumGetPointer(entry->key))
+      pfree(poly);
+
+    retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+
+    gistentryinit(*retval, PointerGetDatum(box),
+                  entry->rel, entry->page, entry->offset, false);
+  }
+
+  PG_RETURN_POINTER(retval);
+}
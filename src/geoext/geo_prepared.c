@@ -0,0 +1,170 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_prepared.c
+ *
+ * \brief A per-call-site cache of detoasted polygons.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExt */
+#include "geo_prepared.h"
+#include "geo_counters.h"
+#include "algorithms.h"
+
+
+/* PostgreSQL */
+#include <access/detoast.h>
+#include <utils/memutils.h>
+
+
+int geoext_prepared_cache_size = 4;
+
+
+/*
+ * The cache of a call site.
+ */
+struct geo_prepared_cache
+{
+  int size;         /* Number of slots: geoext_prepared_cache_size at creation. */
+  int nentries;     /* Number of used slots.                                    */
+  uint64 clock;     /* Incremented at each lookup.                              */
+  struct geo_prepared_polygon entries[FLEXIBLE_ARRAY_MEMBER];
+};
+
+
+static struct geo_prepared_cache *
+geo_prepared_cache_create(FmgrInfo *flinfo, int size)
+{
+  struct geo_prepared_cache *cache = (struct geo_prepared_cache *)
+    MemoryContextAllocZero(flinfo->fn_mcxt,
+                           offsetof(struct geo_prepared_cache, entries) +
+                           size * sizeof(struct geo_prepared_polygon));
+
+  cache->size = size;
+
+  flinfo->fn_extra = cache;
+
+  return cache;
+}
+
+
+static void
+geo_prepared_cache_free(struct geo_prepared_cache *cache)
+{
+  for (int i = 0; i < cache->nentries; ++i)
+    pfree(cache->entries[i].poly);
+
+  pfree(cache);
+}
+
+
+struct geo_prepared_polygon *
+geo_prepared_polygon_get(FmgrInfo *flinfo, Datum d)
+{
+  struct varlena *attr = (struct varlena *) DatumGetPointer(d);
+
+  struct geo_prepared_cache *cache = (struct geo_prepared_cache *) flinfo->fn_extra;
+
+  struct geo_prepared_polygon *entry;
+
+  struct geo_polygon *poly;
+
+  struct varatt_external toast_pointer;
+
+  MemoryContext old_context;
+
+  if (geoext_prepared_cache_size <= 0 || !VARATT_IS_EXTERNAL_ONDISK(attr))
+    return NULL;
+
+/* the size may have been changed since the cache was created */
+  if (cache != NULL && cache->size != geoext_prepared_cache_size)
+  {
+    geo_prepared_cache_free(cache);
+    cache = NULL;
+  }
+
+  if (cache == NULL)
+    cache = geo_prepared_cache_create(flinfo, geoext_prepared_cache_size);
+
+  VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+  ++(cache->clock);
+
+  for (int i = 0; i < cache->nentries; ++i)
+  {
+    entry = &cache->entries[i];
+
+    if (entry->valueid == toast_pointer.va_valueid &&
+        entry->toastrelid == toast_pointer.va_toastrelid)
+    {
+      geo_counter_add(GEO_COUNTER_PREPARED_HIT, 1);
+
+      entry->last_used = cache->clock;
+
+      return entry;
+    }
+  }
+
+  geo_counter_add(GEO_COUNTER_PREPARED_MISS, 1);
+
+/* detoast before touching the cache, in case of error */
+  old_context = MemoryContextSwitchTo(flinfo->fn_mcxt);
+
+  poly = (struct geo_polygon *) geo_detoast_datum(d);
+
+  MemoryContextSwitchTo(old_context);
+
+/* use a free slot or replace the least recently used one */
+  if (cache->nentries < cache->size)
+  {
+    entry = &cache->entries[cache->nentries];
+
+    ++(cache->nentries);
+  }
+  else
+  {
+    entry = &cache->entries[0];
+
+    for (int i = 1; i < cache->nentries; ++i)
+      if (cache->entries[i].last_used < entry->last_used)
+        entry = &cache->entries[i];
+
+    pfree(entry->poly);
+  }
+
+  entry->poly = poly;
+  entry->valueid = toast_pointer.va_valueid;
+  entry->toastrelid = toast_pointer.va_toastrelid;
+  entry->last_used = cache->clock;
+
+  mbr(entry->poly->coords, entry->poly->npts, &entry->box.low, &entry->box.high);
+
+  return entry;
+}
@@ -0,0 +1,80 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_prepared.h
+ *
+ * \brief A per-call-site cache of detoasted polygons.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_PREPARED_H__
+#define __GEOEXT_GEO_PREPARED_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+/* GeoExt */
+#include "geo_box.h"
+#include "geo_polygon.h"
+
+
+/*
+ * A polygon kept by the cache: its detoasted copy and its bounding box.
+ */
+struct geo_prepared_polygon
+{
+  Oid valueid;                /* The TOAST pointer of the polygon: the cache key. */
+  Oid toastrelid;
+  struct geo_polygon *poly;   /* The detoasted polygon.                           */
+  struct geo_box box;         /* The bounding box of the polygon.                 */
+  uint64 last_used;           /* For the LRU replacement.                         */
+};
+
+
+/* GUC geoext.prepared_cache_size: number of polygons per call site, 0 disables the cache */
+extern int geoext_prepared_cache_size;
+
+
+/*
+ * \brief Looks up a polygon argument in the cache of a call site.
+ *
+ * Only polygons stored out-of-line are cached, keyed by their TOAST
+ * pointer. They are the ones that cost a fetch and a decompression for
+ * each call, as when a large polygon is compared with many points in a
+ * nested loop. The cache lives in flinfo->fn_extra, for the duration of
+ * the query.
+ *
+ * \return NULL if the cache is disabled or the polygon is not out-of-line:
+ *         the caller must detoast it as usual.
+ *
+ */
+struct geo_prepared_polygon *geo_prepared_polygon_get(FmgrInfo *flinfo, Datum d);
+
+#endif  /* __GEOEXT_GEO_PREPARED_H__ */
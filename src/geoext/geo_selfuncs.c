@@ -0,0 +1,848 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_selfuncs.c
+ *
+ * \brief Statistics collection and selectivity estimation for spatial operators.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/*
+ * How the estimation works:
+ *
+ * ANALYZE collects a 2D grid histogram of the bounding box centers of the
+ * sampled values, plus the average width and height of the boxes.
+ *
+ * Two boxes a and q overlap iff the center of a lies inside q enlarged by
+ * the half extents of a. So, taking the average extents, the fraction of
+ * rows overlapping q is the mass of the histogram inside the enlarged q.
+ * The other operators are reduced to a window (or a half-plane) over the
+ * centers in the same way. The mass of a partially covered cell is taken
+ * proportional to the covered area.
+ *
+ */
+
+/* GeoExtension */
+#include "geo_selfuncs.h"
+#include "geo_point.h"
+#include "geo_polygon.h"
+#include "algorithms.h"
+
+
+/* PostgreSQL */
+#include <access/htup_details.h>
+#include <catalog/pg_statistic.h>
+#include <catalog/pg_type.h>
+#include <commands/vacuum.h>
+#include <utils/inval.h>
+#include <utils/lsyscache.h>
+#include <utils/syscache.h>
+
+
+/* C Standard Library */
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+
+/*
+ * Auxiliary functions.
+ */
+
+/* Round a double to the greatest float4 not greater than it */
+static inline float4
+float4_round_down(double v)
+{
+  float4 f = (float4) v;
+
+  if ((double) f > v)
+    f = nextafterf(f, -FLT_MAX);
+
+  return f;
+}
+
+
+/* Round a double to the smallest float4 not less than it */
+static inline float4
+float4_round_up(double v)
+{
+  float4 f = (float4) v;
+
+  if ((double) f < v)
+    f = nextafterf(f, FLT_MAX);
+
+  return f;
+}
+
+
+/*
+ * Fraction of the interval [lo, hi] covered by [qlo, qhi].
+ * A degenerate interval is either fully covered or not covered at all.
+ */
+static inline double
+overlap_fraction(double lo, double hi, double qlo, double qhi)
+{
+  double ov;
+
+  if (hi <= lo)
+    return ((qlo <= lo) && (lo <= qhi)) ? 1.0 : 0.0;
+
+  ov = Min(hi, qhi) - Max(lo, qlo);
+
+  if (ov <= 0.0)
+    return 0.0;
+
+  return Min(1.0, ov / (hi - lo));
+}
+
+
+/*
+ * Mass of the grid histogram inside the window [xlo, xhi] x [ylo, yhi].
+ * The window bounds may be infinite, so half-planes are also supported.
+ */
+static double
+grid_mass(const float4 *numbers,
+          double xlo, double ylo, double xhi, double yhi)
+{
+  double xmin = numbers[GEO_STATS_XMIN];
+  double ymin = numbers[GEO_STATS_YMIN];
+  double xmax = numbers[GEO_STATS_XMAX];
+  double ymax = numbers[GEO_STATS_YMAX];
+
+  int nx = (int) numbers[GEO_STATS_NX];
+  int ny = (int) numbers[GEO_STATS_NY];
+
+  double cw = (xmax - xmin) / nx;
+  double ch = (ymax - ymin) / ny;
+
+  const float4 *cells = numbers + GEO_STATS_HDR_SIZE;
+
+  double mass = 0.0;
+
+  if ((xlo > xhi) || (ylo > yhi))
+    return 0.0;
+
+  for (int j = 0; j < ny; ++j)
+  {
+    double fy = overlap_fraction(ymin + j * ch, ymin + (j + 1) * ch, ylo, yhi);
+
+    if (fy == 0.0)
+      continue;
+
+    for (int i = 0; i < nx; ++i)
+    {
+      double v = cells[j * nx + i];
+
+      if (v == 0.0)
+        continue;
+
+      mass += v * fy * overlap_fraction(xmin + i * cw, xmin + (i + 1) * cw, xlo, xhi);
+    }
+  }
+
+  return mass;
+}
+
+
+/*
+ * Mass of the grid histogram satisfying "value op query", where the values
+ * have the given average extents (aw, ah).
+ */
+static double
+grid_strategy_mass(const float4 *numbers, StrategyNumber strategy,
+                   const struct geo_box *q, double aw, double ah)
+{
+  double hw = aw / 2.0;
+  double hh = ah / 2.0;
+
+  switch (strategy)
+  {
+    case RTOverlapStrategyNumber:
+      return grid_mass(numbers, q->low.x - hw, q->low.y - hh, q->high.x + hw, q->high.y + hh);
+
+    case RTSameStrategyNumber:
+      return grid_mass(numbers, q->low.x, q->low.y, q->high.x, q->high.y);
+
+    case RTContainsStrategyNumber:
+      return grid_mass(numbers, q->high.x - hw, q->high.y - hh, q->low.x + hw, q->low.y + hh);
+
+    case RTContainedByStrategyNumber:
+      return grid_mass(numbers, q->low.x + hw, q->low.y + hh, q->high.x - hw, q->high.y - hh);
+
+    case RTLeftStrategyNumber:
+      return grid_mass(numbers, -HUGE_VAL, -HUGE_VAL, q->low.x - hw, HUGE_VAL);
+
+    case RTRightStrategyNumber:
+      return grid_mass(numbers, q->high.x + hw, -HUGE_VAL, HUGE_VAL, HUGE_VAL);
+
+    case RTBelowStrategyNumber:
+      return grid_mass(numbers, -HUGE_VAL, -HUGE_VAL, HUGE_VAL, q->low.y - hh);
+
+    case RTAboveStrategyNumber:
+      return grid_mass(numbers, -HUGE_VAL, q->high.y + hh, HUGE_VAL, HUGE_VAL);
+
+    case RTOverLeftStrategyNumber:
+      return grid_mass(numbers, -HUGE_VAL, -HUGE_VAL, q->high.x - hw, HUGE_VAL);
+
+    case RTOverRightStrategyNumber:
+      return grid_mass(numbers, q->low.x + hw, -HUGE_VAL, HUGE_VAL, HUGE_VAL);
+
+    case RTOverBelowStrategyNumber:
+      return grid_mass(numbers, -HUGE_VAL, -HUGE_VAL, HUGE_VAL, q->high.y - hh);
+
+    case RTOverAboveStrategyNumber:
+      return grid_mass(numbers, -HUGE_VAL, q->low.y + hh, HUGE_VAL, HUGE_VAL);
+
+    default:
+      return GEOEXT_DEFAULT_SEL;
+  }
+}
+
+
+/*
+ * The OIDs of our types, looked up in the schema of the extension the first
+ * time they are needed. Any change to pg_type drops them, so that they are
+ * looked up again after the extension is dropped and created again.
+ */
+struct geo_datum_type
+{
+  const char *name;            /* The type name.                       */
+  enum geo_datum_kind kind;    /* Its kind.                            */
+  Oid oid;                     /* Its OID in the extension schema.     */
+};
+
+static struct geo_datum_type geo_datum_types[] =
+{
+  { "geo_point",      GEO_DATUM_POINT,   InvalidOid },
+  { "geo_cpoint",     GEO_DATUM_CPOINT,  InvalidOid },
+  { "geo_box",        GEO_DATUM_BOX,     InvalidOid },
+  { "geo_box4",       GEO_DATUM_BOX4,    InvalidOid },
+  { "geo_polygon",    GEO_DATUM_POLYGON, InvalidOid },
+  { "geo_linestring", GEO_DATUM_POLYGON, InvalidOid }
+};
+
+#define GEO_DATUM_NTYPES (sizeof(geo_datum_types) / sizeof(geo_datum_types[0]))
+
+static bool geo_datum_types_valid = false;
+
+static bool geo_datum_types_registered = false;
+
+
+static void
+geo_datum_types_invalidate(Datum arg, int cacheid, uint32 hashvalue)
+{
+  geo_datum_types_valid = false;
+}
+
+
+static void
+geo_datum_types_load(Oid sibling)
+{
+  Oid nsp = get_func_namespace(sibling);
+
+  if (!geo_datum_types_registered)
+  {
+    CacheRegisterSyscacheCallback(TYPEOID, geo_datum_types_invalidate, (Datum) 0);
+    geo_datum_types_registered = true;
+  }
+
+/* set first: an invalidation during the lookups must not be lost */
+  geo_datum_types_valid = true;
+
+  for (size_t i = 0; i < GEO_DATUM_NTYPES; ++i)
+    geo_datum_types[i].oid = GetSysCacheOid2(TYPENAMENSP, Anum_pg_type_oid,
+                                             CStringGetDatum(geo_datum_types[i].name),
+                                             ObjectIdGetDatum(nsp));
+}
+
+
+enum geo_datum_kind
+geo_datum_kind(Oid typid, Oid sibling)
+{
+  if (!geo_datum_types_valid)
+    geo_datum_types_load(sibling);
+
+  for (size_t i = 0; i < GEO_DATUM_NTYPES; ++i)
+    if (geo_datum_types[i].oid == typid)
+      return geo_datum_types[i].kind;
+
+  return GEO_DATUM_UNKNOWN;
+}
+
+
+bool
+geo_datum_bbox(Datum d, enum geo_datum_kind kind, struct geo_box *box)
+{
+  switch (kind)
+  {
+    case GEO_DATUM_POINT:
+    {
+      struct geo_point *pt = DatumGetGeoPointTypeP(d);
+
+      box->high = pt->coord;
+      box->low = pt->coord;
+
+      return true;
+    }
+
+    case GEO_DATUM_CPOINT:
+    {
+      struct geo_cpoint *pt = DatumGetGeoCPointTypeP(d);
+
+      box->high = pt->coord;
+      box->low = pt->coord;
+
+      return true;
+    }
+
+    case GEO_DATUM_BOX:
+      *box = *DatumGetGeoBoxTypeP(d);
+      return true;
+
+    case GEO_DATUM_BOX4:
+      geo_box4_to_box(DatumGetGeoBox4TypeP(d), box);
+      return true;
+
+    case GEO_DATUM_POLYGON:
+    {
+      struct geo_polygon *poly = DatumGetGeoPolygonTypeP(d);
+
+      mbr(poly->coords, poly->npts, &box->low, &box->high);
+
+      if ((Pointer) poly != DatumGetPointer(d))
+        pfree(poly);
+
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+
+/*
+ * Statistics collection.
+ */
+
+/*
+ * The standard typanalyze still computes null fraction, width and, for
+ * geo_point, the B-tree statistics. We keep its compute_stats function
+ * and add our grid histogram in a free slot afterwards.
+ */
+struct geo_analyze_extra
+{
+  AnalyzeAttrComputeStatsFunc std_compute_stats;  /* compute_stats set by std_typanalyze. */
+  void *std_extra_data;                           /* extra_data set by std_typanalyze.    */
+  enum geo_datum_kind kind;                       /* The analyzed type.                   */
+};
+
+
+static void
+geo_compute_stats(VacAttrStats *stats,
+                  AnalyzeAttrFetchFunc fetchfunc,
+                  int samplerows,
+                  double totalrows)
+{
+  struct geo_analyze_extra *extra = (struct geo_analyze_extra*) stats->extra_data;
+
+  struct coord2d *centers = NULL;
+
+  int ncenters = 0;
+
+  double sum_width = 0.0;
+  double sum_height = 0.0;
+
+  double xmin = DBL_MAX, ymin = DBL_MAX, xmax = -DBL_MAX, ymax = -DBL_MAX;
+
+  int slot = 0;
+
+  int nx = GEOEXT_STATS_GRID_SIZE;
+  int ny = GEOEXT_STATS_GRID_SIZE;
+
+  float4 *numbers = NULL;
+
+  double gxmin, gymin, gxmax, gymax;
+
+  MemoryContext old_context;
+
+/* let the standard code do its job */
+  stats->extra_data = extra->std_extra_data;
+  extra->std_compute_stats(stats, fetchfunc, samplerows, totalrows);
+  stats->extra_data = extra;
+
+  if (!stats->stats_valid)
+    return;
+
+  while ((slot < STATISTIC_NUM_SLOTS) && (stats->stakind[slot] != 0))
+    ++slot;
+
+  if (slot == STATISTIC_NUM_SLOTS)
+    return;
+
+/* compute the centers and the average extents of the sampled values */
+  centers = (struct coord2d*) palloc(samplerows * sizeof(struct coord2d));
+
+  for (int i = 0; i < samplerows; ++i)
+  {
+    bool isnull;
+
+    Datum value;
+
+    struct coord2d c;
+
+    double w = 0.0;
+    double h = 0.0;
+
+#if PG_VERSION_NUM >= 180000
+    vacuum_delay_point(true);
+#else
+    vacuum_delay_point();
+#endif
+
+    value = fetchfunc(stats, i, &isnull);
+
+    if (isnull)
+      continue;
+
+    if (extra->kind == GEO_DATUM_POINT)
+    {
+      c = DatumGetGeoPointTypeP(value)->coord;
+    }
+    else if (extra->kind == GEO_DATUM_CPOINT)
+    {
+      c = DatumGetGeoCPointTypeP(value)->coord;
+    }
+    else
+    {
+      struct geo_box box;
+
+      geo_datum_bbox(value, extra->kind, &box);
+
+      c.x = (box.high.x + box.low.x) / 2.0;
+      c.y = (box.high.y + box.low.y) / 2.0;
+
+      w = fabs(box.high.x - box.low.x);
+      h = fabs(box.high.y - box.low.y);
+    }
+
+    if (!isfinite(c.x) || !isfinite(c.y) || !isfinite(w) || !isfinite(h))
+      continue;
+
+    centers[ncenters++] = c;
+
+    sum_width += w;
+    sum_height += h;
+
+    xmin = Min(xmin, c.x);
+    ymin = Min(ymin, c.y);
+    xmax = Max(xmax, c.x);
+    ymax = Max(ymax, c.y);
+  }
+
+  if (ncenters == 0)
+  {
+    pfree(centers);
+    return;
+  }
+
+  old_context = MemoryContextSwitchTo(stats->anl_context);
+
+  numbers = (float4*) palloc0((GEO_STATS_HDR_SIZE + nx * ny) * sizeof(float4));
+
+  MemoryContextSwitchTo(old_context);
+
+  numbers[GEO_STATS_XMIN] = float4_round_down(xmin);
+  numbers[GEO_STATS_YMIN] = float4_round_down(ymin);
+  numbers[GEO_STATS_XMAX] = float4_round_up(xmax);
+  numbers[GEO_STATS_YMAX] = float4_round_up(ymax);
+  numbers[GEO_STATS_AVG_WIDTH] = (float4) (sum_width / ncenters);
+  numbers[GEO_STATS_AVG_HEIGHT] = (float4) (sum_height / ncenters);
+  numbers[GEO_STATS_NX] = (float4) nx;
+  numbers[GEO_STATS_NY] = (float4) ny;
+
+/* bin the centers using the same (float4) extent the estimator will see */
+  gxmin = numbers[GEO_STATS_XMIN];
+  gymin = numbers[GEO_STATS_YMIN];
+  gxmax = numbers[GEO_STATS_XMAX];
+  gymax = numbers[GEO_STATS_YMAX];
+
+  for (int i = 0; i < ncenters; ++i)
+  {
+    int ix = (gxmax > gxmin) ? (int) ((centers[i].x - gxmin) / (gxmax - gxmin) * nx) : 0;
+    int iy = (gymax > gymin) ? (int) ((centers[i].y - gymin) / (gymax - gymin) * ny) : 0;
+
+    ix = Max(0, Min(nx - 1, ix));
+    iy = Max(0, Min(ny - 1, iy));
+
+    numbers[GEO_STATS_HDR_SIZE + iy * nx + ix] += 1.0;
+  }
+
+  for (int i = 0; i < nx * ny; ++i)
+    numbers[GEO_STATS_HDR_SIZE + i] /= (float4) ncenters;
+
+  stats->stakind[slot] = GEOEXT_STATISTIC_KIND_2D_GRID;
+  stats->staop[slot] = InvalidOid;
+  stats->stacoll[slot] = InvalidOid;
+  stats->stanumbers[slot] = numbers;
+  stats->numnumbers[slot] = GEO_STATS_HDR_SIZE + nx * ny;
+
+  pfree(centers);
+}
+
+
+static bool
+geo_typanalyze_internal(VacAttrStats *stats, Oid funcid)
+{
+  struct geo_analyze_extra *extra = NULL;
+
+  enum geo_datum_kind kind = geo_datum_kind(stats->attrtypid, funcid);
+
+  if (kind == GEO_DATUM_UNKNOWN)
+    elog(ERROR, "unexpected type %u in geo_typanalyze", stats->attrtypid);
+
+  if (!std_typanalyze(stats))
+    return false;
+
+  extra = (struct geo_analyze_extra*) palloc(sizeof(struct geo_analyze_extra));
+
+  extra->std_compute_stats = stats->compute_stats;
+  extra->std_extra_data = stats->extra_data;
+  extra->kind = kind;
+
+  stats->compute_stats = geo_compute_stats;
+  stats->extra_data = extra;
+
+  return true;
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box_analyze);
+
+Datum
+geo_box_analyze(PG_FUNCTION_ARGS)
+{
+  VacAttrStats *stats = (VacAttrStats *) PG_GETARG_POINTER(0);
+
+  PG_RETURN_BOOL(geo_typanalyze_internal(stats, fcinfo->flinfo->fn_oid));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_analyze);
+
+Datum
+geo_point_analyze(PG_FUNCTION_ARGS)
+{
+  VacAttrStats *stats = (VacAttrStats *) PG_GETARG_POINTER(0);
+
+  PG_RETURN_BOOL(geo_typanalyze_internal(stats, fcinfo->flinfo->fn_oid));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_analyze);
+
+Datum
+geo_polygon_analyze(PG_FUNCTION_ARGS)
+{
+  VacAttrStats *stats = (VacAttrStats *) PG_GETARG_POINTER(0);
+
+  PG_RETURN_BOOL(geo_typanalyze_internal(stats, fcinfo->flinfo->fn_oid));
+}
+
+
+/*
+ * Selectivity estimation.
+ */
+
+StrategyNumber
+geo_operator_strategy(Oid opno)
+{
+  char *opname = get_opname(opno);
+
+  StrategyNumber strategy = InvalidStrategy;
+
+  if (opname == NULL)
+    return InvalidStrategy;
+
+  if (strcmp(opname, "&&") == 0)
+    strategy = RTOverlapStrategyNumber;
+  else if (strcmp(opname, "~=") == 0)
+    strategy = RTSameStrategyNumber;
+  else if (strcmp(opname, "@>") == 0)
+    strategy = RTContainsStrategyNumber;
+  else if (strcmp(opname, "<@") == 0)
+    strategy = RTContainedByStrategyNumber;
+  else if (strcmp(opname, "<<") == 0)
+    strategy = RTLeftStrategyNumber;
+  else if (strcmp(opname, ">>") == 0)
+    strategy = RTRightStrategyNumber;
+  else if (strcmp(opname, "<<|") == 0)
+    strategy = RTBelowStrategyNumber;
+  else if (strcmp(opname, "|>>") == 0)
+    strategy = RTAboveStrategyNumber;
+  else if (strcmp(opname, "&<") == 0)
+    strategy = RTOverLeftStrategyNumber;
+  else if (strcmp(opname, "&>") == 0)
+    strategy = RTOverRightStrategyNumber;
+  else if (strcmp(opname, "&<|") == 0)
+    strategy = RTOverBelowStrategyNumber;
+  else if (strcmp(opname, "|&>") == 0)
+    strategy = RTOverAboveStrategyNumber;
+  else if (strcmp(opname, "~") == 0)
+    strategy = RTContainsStrategyNumber;
+  else if (strcmp(opname, "@") == 0)
+    strategy = RTContainedByStrategyNumber;
+
+  pfree(opname);
+
+  return strategy;
+}
+
+
+StrategyNumber
+geo_commute_strategy(StrategyNumber strategy)
+{
+  switch (strategy)
+  {
+    case RTContainsStrategyNumber:
+      return RTContainedByStrategyNumber;
+    case RTContainedByStrategyNumber:
+      return RTContainsStrategyNumber;
+    case RTLeftStrategyNumber:
+      return RTRightStrategyNumber;
+    case RTRightStrategyNumber:
+      return RTLeftStrategyNumber;
+    case RTBelowStrategyNumber:
+      return RTAboveStrategyNumber;
+    case RTAboveStrategyNumber:
+      return RTBelowStrategyNumber;
+/* "a &< b" is not "b op a" for any operator: there is no estimate */
+    case RTOverLeftStrategyNumber:
+    case RTOverRightStrategyNumber:
+    case RTOverBelowStrategyNumber:
+    case RTOverAboveStrategyNumber:
+      return InvalidStrategy;
+    default:
+      return strategy;
+  }
+}
+
+
+Selectivity
+geo_estimate_selectivity(VariableStatData *vardata,
+                         StrategyNumber strategy,
+                         const struct geo_box *query)
+{
+  AttStatsSlot sslot;
+
+  Selectivity selec;
+
+  double nullfrac;
+
+  if (!HeapTupleIsValid(vardata->statsTuple))
+    return GEOEXT_DEFAULT_SEL;
+
+  nullfrac = ((Form_pg_statistic) GETSTRUCT(vardata->statsTuple))->stanullfrac;
+
+  if (!get_attstatsslot(&sslot, vardata->statsTuple,
+                        GEOEXT_STATISTIC_KIND_2D_GRID, InvalidOid,
+                        ATTSTATSSLOT_NUMBERS))
+    return GEOEXT_DEFAULT_SEL;
+
+  if (sslot.nnumbers < GEO_STATS_HDR_SIZE)
+  {
+    free_attstatsslot(&sslot);
+    return GEOEXT_DEFAULT_SEL;
+  }
+
+  selec = grid_strategy_mass(sslot.numbers, strategy, query,
+                             sslot.numbers[GEO_STATS_AVG_WIDTH],
+                             sslot.numbers[GEO_STATS_AVG_HEIGHT]);
+
+  free_attstatsslot(&sslot);
+
+  selec *= (1.0 - nullfrac);
+
+  CLAMP_PROBABILITY(selec);
+
+  return selec;
+}
+
+
+PG_FUNCTION_INFO_V1(geo_box_sel);
+
+Datum
+geo_box_sel(PG_FUNCTION_ARGS)
+{
+  PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+
+  Oid operator = PG_GETARG_OID(1);
+
+  List *args = (List *) PG_GETARG_POINTER(2);
+
+  int varRelid = PG_GETARG_INT32(3);
+
+  VariableStatData vardata;
+
+  Node *other = NULL;
+
+  bool varonleft = true;
+
+  StrategyNumber strategy = geo_operator_strategy(operator);
+
+  Selectivity selec = GEOEXT_DEFAULT_SEL;
+
+  if (strategy == InvalidStrategy)
+    PG_RETURN_FLOAT8(selec);
+
+/* we can only estimate "var op constant" */
+  if (!get_restriction_variable(root, args, varRelid, &vardata, &other, &varonleft))
+    PG_RETURN_FLOAT8(selec);
+
+  if (!IsA(other, Const))
+  {
+    ReleaseVariableStats(vardata);
+    PG_RETURN_FLOAT8(selec);
+  }
+
+  if (((Const *) other)->constisnull)
+  {
+    ReleaseVariableStats(vardata);
+    PG_RETURN_FLOAT8(0.0);
+  }
+
+  if (!varonleft)
+    strategy = geo_commute_strategy(strategy);
+
+  {
+    struct geo_box query;
+
+    if (geo_datum_bbox(((Const *) other)->constvalue,
+                       geo_datum_kind(((Const *) other)->consttype,
+                                      fcinfo->flinfo->fn_oid), &query))
+      selec = geo_estimate_selectivity(&vardata, strategy, &query);
+  }
+
+  ReleaseVariableStats(vardata);
+
+  PG_RETURN_FLOAT8(selec);
+}
+
+
+/*
+ * Join selectivity: only the overlap operator is estimated from the
+ * histograms. For each cell of the first histogram, we take its mass at the
+ * cell center and look for the mass of the second histogram inside a window
+ * enlarged by the average half extents of both sides.
+ */
+
+PG_FUNCTION_INFO_V1(geo_box_joinsel);
+
+Datum
+geo_box_joinsel(PG_FUNCTION_ARGS)
+{
+  PlannerInfo *root = (PlannerInfo *) PG_GETARG_POINTER(0);
+
+  Oid operator = PG_GETARG_OID(1);
+
+  List *args = (List *) PG_GETARG_POINTER(2);
+
+  SpecialJoinInfo *sjinfo = (SpecialJoinInfo *) PG_GETARG_POINTER(4);
+
+  VariableStatData vardata1;
+  VariableStatData vardata2;
+
+  bool join_is_reversed = false;
+
+  AttStatsSlot sslot1;
+  AttStatsSlot sslot2;
+
+  Selectivity selec = GEOEXT_DEFAULT_SEL;
+
+  if (geo_operator_strategy(operator) != RTOverlapStrategyNumber)
+    PG_RETURN_FLOAT8(selec);
+
+  get_join_variables(root, args, sjinfo, &vardata1, &vardata2, &join_is_reversed);
+
+  if (HeapTupleIsValid(vardata1.statsTuple) && HeapTupleIsValid(vardata2.statsTuple))
+  {
+    double nullfrac1 = ((Form_pg_statistic) GETSTRUCT(vardata1.statsTuple))->stanullfrac;
+    double nullfrac2 = ((Form_pg_statistic) GETSTRUCT(vardata2.statsTuple))->stanullfrac;
+
+    if (get_attstatsslot(&sslot1, vardata1.statsTuple, GEOEXT_STATISTIC_KIND_2D_GRID,
+                         InvalidOid, ATTSTATSSLOT_NUMBERS))
+    {
+      if (get_attstatsslot(&sslot2, vardata2.statsTuple, GEOEXT_STATISTIC_KIND_2D_GRID,
+                           InvalidOid, ATTSTATSSLOT_NUMBERS))
+      {
+        const float4 *n1 = sslot1.numbers;
+
+        int nx = (int) n1[GEO_STATS_NX];
+        int ny = (int) n1[GEO_STATS_NY];
+
+        double cw = (n1[GEO_STATS_XMAX] - n1[GEO_STATS_XMIN]) / nx;
+        double ch = (n1[GEO_STATS_YMAX] - n1[GEO_STATS_YMIN]) / ny;
+
+        double hw = (n1[GEO_STATS_AVG_WIDTH] + sslot2.numbers[GEO_STATS_AVG_WIDTH]) / 2.0;
+        double hh = (n1[GEO_STATS_AVG_HEIGHT] + sslot2.numbers[GEO_STATS_AVG_HEIGHT]) / 2.0;
+
+        selec = 0.0;
+
+        for (int j = 0; j < ny; ++j)
+        {
+          for (int i = 0; i < nx; ++i)
+          {
+            double v = n1[GEO_STATS_HDR_SIZE + j * nx + i];
+
+            double cx = n1[GEO_STATS_XMIN] + (i + 0.5) * cw;
+            double cy = n1[GEO_STATS_YMIN] + (j + 0.5) * ch;
+
+            if (v == 0.0)
+              continue;
+
+            selec += v * grid_mass(sslot2.numbers, cx - hw, cy - hh, cx + hw, cy + hh);
+          }
+        }
+
+        selec *= (1.0 - nullfrac1) * (1.0 - nullfrac2);
+
+        CLAMP_PROBABILITY(selec);
+
+        free_attstatsslot(&sslot2);
+      }
+
+      free_attstatsslot(&sslot1);
+    }
+  }
+
+  ReleaseVariableStats(vardata1);
+  ReleaseVariableStats(vardata2);
+
+  PG_RETURN_FLOAT8(selec);
+}
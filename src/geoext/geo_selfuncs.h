@@ -0,0 +1,191 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_selfuncs.h
+ *
+ * \brief Statistics collection and selectivity estimation for spatial operators.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_SELFUNCS_H__
+#define __GEOEXT_GEO_SELFUNCS_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+#include <access/stratnum.h>
+#include <utils/selfuncs.h>
+
+/* GeoExt */
+#include "geo_box.h"
+
+
+/*
+ * The pg_statistic kind used to store our 2D grid histogram.
+ *
+ * Kinds from 10000 on are reserved for private use.
+ *
+ */
+#define GEOEXT_STATISTIC_KIND_2D_GRID 10100
+
+
+/*
+ * Number of cells along each axis of the grid histogram.
+ */
+#define GEOEXT_STATS_GRID_SIZE 32
+
+
+/*
+ * Default selectivity when no statistics are available.
+ *
+ * It is the same value used by PostgreSQL for its geometric operators.
+ *
+ */
+#define GEOEXT_DEFAULT_SEL 0.005
+
+
+/*
+ * Layout of the stanumbers array for GEOEXT_STATISTIC_KIND_2D_GRID.
+ *
+ * The header is followed by nx * ny cell values. Each cell holds the
+ * fraction of the non-null sampled values whose bounding box center falls
+ * into the cell. The same layout is used for geo_point, geo_box and
+ * geo_polygon columns. The extent is the one of the centers, rounded outward
+ * to float4.
+ *
+ */
+enum geo_stats_slot
+{
+  GEO_STATS_XMIN,        /* Extent of the bounding box centers. */
+  GEO_STATS_YMIN,
+  GEO_STATS_XMAX,
+  GEO_STATS_YMAX,
+  GEO_STATS_AVG_WIDTH,   /* Average width of the bounding boxes.  */
+  GEO_STATS_AVG_HEIGHT,  /* Average height of the bounding boxes. */
+  GEO_STATS_NX,          /* Number of columns in the grid. */
+  GEO_STATS_NY,          /* Number of rows in the grid.    */
+  GEO_STATS_HDR_SIZE
+};
+
+
+/*
+ * \brief Estimates the fraction of rows of a variable satisfying "var op query".
+ *
+ * \param vardata  The variable being restricted (from examine_variable).
+ * \param strategy The R-tree strategy number of the operator.
+ * \param query    The constant bounding box on the right side of the operator.
+ *
+ * \return The selectivity, or GEOEXT_DEFAULT_SEL if there are no statistics.
+ *
+ */
+Selectivity geo_estimate_selectivity(VariableStatData *vardata,
+                                     StrategyNumber strategy,
+                                     const struct geo_box *query);
+
+
+/*
+ * The types whose bounding box geo_datum_bbox knows how to compute.
+ *
+ */
+enum geo_datum_kind
+{
+  GEO_DATUM_UNKNOWN,
+  GEO_DATUM_POINT,       /* geo_point.                     */
+  GEO_DATUM_CPOINT,      /* geo_cpoint.                    */
+  GEO_DATUM_BOX,         /* geo_box.                       */
+  GEO_DATUM_BOX4,        /* geo_box4.                      */
+  GEO_DATUM_POLYGON      /* geo_polygon or geo_linestring. */
+};
+
+
+/*
+ * \brief Tells which of our types a type OID is.
+ *
+ * The OIDs of our types are only known once the extension is installed:
+ * they are looked up by name in the schema of a function of the extension,
+ * once, and then compared with typid. A type with the same name in another
+ * schema is not one of ours.
+ *
+ * \param typid   The type OID.
+ * \param sibling The OID of any function of the extension, e.g. the caller.
+ *
+ * \return The kind of the type, or GEO_DATUM_UNKNOWN for any other type.
+ *
+ */
+enum geo_datum_kind geo_datum_kind(Oid typid, Oid sibling);
+
+
+/*
+ * \brief Computes the bounding box of a geo_point, geo_box or geo_polygon datum.
+ *
+ * \param d    The datum.
+ * \param kind The kind of its type, from geo_datum_kind.
+ * \param box  The output bounding box.
+ *
+ * \return false, leaving box unchanged, if kind is GEO_DATUM_UNKNOWN.
+ *
+ */
+bool geo_datum_bbox(Datum d, enum geo_datum_kind kind, struct geo_box *box);
+
+
+/*
+ * \brief Returns the R-tree strategy number for one of our operators.
+ *
+ * \return InvalidStrategy if the operator is not a spatial one.
+ *
+ */
+StrategyNumber geo_operator_strategy(Oid opno);
+
+
+/*
+ * \brief Returns the strategy of "b op a" given the strategy of "a op b".
+ *
+ * \return InvalidStrategy if no operator commutes with it.
+ *
+ */
+StrategyNumber geo_commute_strategy(StrategyNumber strategy);
+
+
+/*
+ * Statistics collection (typanalyze).
+ *
+ */
+extern Datum geo_box_analyze(PG_FUNCTION_ARGS);
+extern Datum geo_point_analyze(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_analyze(PG_FUNCTION_ARGS);
+
+
+/*
+ * Restriction and join selectivity estimators.
+ *
+ */
+extern Datum geo_box_sel(PG_FUNCTION_ARGS);
+extern Datum geo_box_joinsel(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_SELFUNCS_H__ */
@@ -0,0 +1,1360 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_spatial_join.c
+ *
+ * \brief A CustomScan provider for spatial joins between polygons and points.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/*
+ * How the join works:
+ *
+ * The node has two children: the probe side, producing the points, and the
+ * build side, producing the polygons.
+ *
+ * - Build: the polygons are read into memory (a copy of each tuple and of
+ *   the detoasted polygon). Their bounding boxes define the extent of a
+ *   uniform grid with about one cell per polygon. Each polygon is listed in
+ *   all the cells its bounding box overlaps. The cell lists are stored in
+ *   a single array (cell_items) indexed by cell_start, so that the lists of
+ *   a cell are contiguous in memory.
+ *
+ * - Probe: the points are read in batches of up to work_mem. A point falls
+ *   into a single cell, so there is no duplicate elimination. The
+ *   candidates of the cell are filtered by their bounding box, and the
+ *   (polygon, point) pairs left are sorted by polygon and then by the y of
+ *   the point. The exact test then runs once per polygon of the batch,
+ *   over all its points (points_in_polygon), and the matching pairs are
+ *   returned one by one.
+ *
+ * - Partitioning: if the polygons do not fit in work_mem, they are moved to
+ *   a tuplestore as soon as they overflow it, and the rest of the build
+ *   side goes there too. Their extent is then split into kx * ky tiles
+ *   with about half of work_mem of polygons each, as in the Partition Based
+ *   Spatial-Merge join: a polygon goes to every tile its bounding box
+ *   overlaps and a point to the single tile it falls into, so that there
+ *   are still no duplicates. Both sides are written to one tuplestore per
+ *   tile, and each tile is then joined in memory as above. A tile holding
+ *   too many large polygons may still exceed work_mem.
+ *
+ * The scan tuple of the node is the concatenation of the tuples of the
+ * probe and the build children (see custom_scan_tlist). The other join
+ * clauses, if any, are evaluated by ExecScan on it, as well as the
+ * projection.
+ *
+ */
+
+/* GeoExtension */
+#include "geo_spatial_join.h"
+#include "geo_box.h"
+#include "geo_counters.h"
+#include "geo_point.h"
+#include "geo_polygon.h"
+#include "algorithms.h"
+
+
+/* PostgreSQL */
+#include <access/htup_details.h>
+#include <executor/executor.h>
+#include <miscadmin.h>
+#include <nodes/extensible.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <optimizer/optimizer.h>
+#include <optimizer/pathnode.h>
+#include <optimizer/paths.h>
+#include <optimizer/restrictinfo.h>
+#include <utils/lsyscache.h>
+#include <utils/memutils.h>
+#include <utils/tuplestore.h>
+
+
+/* C Standard Library */
+#include <math.h>
+
+
+/*
+ * Utility macros.
+ */
+
+/* expected number of polygons tested for each point */
+#define GEOEXT_SPATIAL_JOIN_CANDIDATES 2.0
+
+/* limit on the number of (cell, polygon) pairs per polygon in the grid */
+#define GEOEXT_SPATIAL_JOIN_MAX_CELLS_PER_ITEM 16
+
+/* initial number of points and of candidate pairs of a batch */
+#define GEOEXT_SPATIAL_JOIN_BATCH_INITIAL 1024
+
+/* limit on the number of tiles along each axis when the polygons are partitioned */
+#define GEOEXT_SPATIAL_JOIN_MAX_TILES 32
+
+/* the memory taken by a polygon loaded from the build side */
+#define GEOEXT_SPATIAL_JOIN_ITEM_BYTES(tuple, poly) \
+  ((Size) (tuple)->t_len + VARSIZE(poly) + sizeof(struct geo_spatial_join_item))
+
+
+/*
+ * A polygon loaded from the build side.
+ */
+struct geo_spatial_join_item
+{
+  struct geo_box box;         /* The bounding box of the polygon. */
+  struct geo_polygon *poly;   /* The detoasted polygon.           */
+  MinimalTuple tuple;         /* The build side tuple.            */
+};
+
+
+/*
+ * A candidate pair of a batch: a polygon and a point of the batch.
+ */
+struct geo_spatial_join_pair
+{
+  int item;                   /* Index in items.                  */
+  int point;                  /* Index in the batch.              */
+};
+
+
+/*
+ * The execution state of a spatial join.
+ */
+struct geo_spatial_join_state
+{
+  CustomScanState css;            /* Must be the first field!                       */
+
+  PlanState *probe_ps;            /* The child producing the points.                */
+  PlanState *build_ps;            /* The child producing the polygons.              */
+
+  AttrNumber probe_attno;         /* The point column in the probe tuples.          */
+  AttrNumber build_attno;         /* The polygon column in the build tuples.        */
+  int probe_natts;                /* Number of columns of the probe tuples.         */
+
+  TupleTableSlot *probe_slot;     /* Used to deform a probe tuple of the batch.     */
+  TupleTableSlot *build_slot;     /* Used to deform a build tuple.                  */
+
+  MemoryContext grid_cxt;         /* Where the grid and the polygons live.          */
+  bool built;                     /* Has the grid been built?                       */
+
+  struct geo_spatial_join_item *items;  /* The polygons.                            */
+  int nitems;
+  int maxitems;
+
+  struct geo_box extent;          /* The extent of the grid.                        */
+  int nx;                         /* Number of columns of the grid.                 */
+  int ny;                         /* Number of rows of the grid.                    */
+  double cw;                      /* Width of a cell.                               */
+  double ch;                      /* Height of a cell.                              */
+  int *cell_start;                /* Cell c lists cell_items[cell_start[c] .. cell_start[c+1]-1]. */
+  int *cell_items;                /* Indexes in items.                              */
+
+  MemoryContext batch_cxt;        /* Where the current batch lives.                 */
+  MinimalTuple *batch_tuples;     /* The probe tuples of the batch.                 */
+  struct coord2d *batch_pts;      /* Their points.                                  */
+  int nbatch;
+  int maxbatch;
+
+  struct geo_spatial_join_pair *pairs;  /* The candidates, then the matches.        */
+  int npairs;
+  int maxpairs;
+  int nmatches;
+  int next_match;                 /* The next match to return.                      */
+  bool probe_done;                /* Has the probe side been exhausted?             */
+
+  MemoryContext part_cxt;         /* Where the tuplestores live.                    */
+  Tuplestorestate *build_all;     /* The build side, once it overflows work_mem.    */
+  Size build_bytes;               /* The memory it would take.                      */
+  struct geo_box part_extent;     /* The extent of all the polygons.                */
+  int npart;                      /* Number of tiles, or 0 if not partitioned.      */
+  int kx;                         /* Number of columns of tiles.                    */
+  int ky;                         /* Number of rows of tiles.                       */
+  double pw;                      /* Width of a tile.                               */
+  double ph;                      /* Height of a tile.                              */
+  Tuplestorestate **build_parts;  /* The polygons of each tile.                     */
+  Tuplestorestate **probe_parts;  /* The points of each tile.                       */
+  int part;                       /* The tile being joined.                         */
+};
+
+
+/*
+ * Path, plan and executor methods.
+ */
+static Plan *geo_spatial_join_plan(PlannerInfo *root, RelOptInfo *rel,
+                                   CustomPath *best_path, List *tlist,
+                                   List *clauses, List *custom_plans);
+
+static Node *geo_spatial_join_create_state(CustomScan *cscan);
+
+static void geo_spatial_join_begin(CustomScanState *node, EState *estate, int eflags);
+
+static TupleTableSlot *geo_spatial_join_exec(CustomScanState *node);
+
+static void geo_spatial_join_end(CustomScanState *node);
+
+static void geo_spatial_join_rescan(CustomScanState *node);
+
+
+static const CustomPathMethods geo_spatial_join_path_methods =
+{
+  .CustomName = "GeoSpatialJoin",
+  .PlanCustomPath = geo_spatial_join_plan
+};
+
+static const CustomScanMethods geo_spatial_join_scan_methods =
+{
+  .CustomName = "GeoSpatialJoin",
+  .CreateCustomScanState = geo_spatial_join_create_state
+};
+
+static const CustomExecMethods geo_spatial_join_exec_methods =
+{
+  .CustomName = "GeoSpatialJoin",
+  .BeginCustomScan = geo_spatial_join_begin,
+  .ExecCustomScan = geo_spatial_join_exec,
+  .EndCustomScan = geo_spatial_join_end,
+  .ReScanCustomScan = geo_spatial_join_rescan
+};
+
+
+bool geoext_enable_spatial_join = true;
+
+int geoext_spatial_join_grid_size = GEOEXT_SPATIAL_JOIN_MAX_GRID_SIZE;
+
+
+static set_join_pathlist_hook_type prev_set_join_pathlist_hook = NULL;
+
+
+/*
+ * Planning.
+ */
+
+/* Tells if a clause is a call to contains(geo_polygon, geo_point) */
+static bool
+is_contains_call(Node *clause)
+{
+  FmgrInfo finfo;
+
+  if (!IsA(clause, FuncExpr) || list_length(((FuncExpr *) clause)->args) != 2)
+    return false;
+
+/* look at the C function, whatever the SQL name or schema */
+  fmgr_info(((FuncExpr *) clause)->funcid, &finfo);
+
+  return finfo.fn_addr == geo_polygon_contains_point;
+}
+
+
+static CustomPath *
+make_spatial_join_path(PlannerInfo *root, RelOptInfo *joinrel,
+                       Path *probe, Path *build,
+                       FuncExpr *spatial, List *others)
+{
+  CustomPath *cpath = makeNode(CustomPath);
+
+  QualCost others_cost;
+
+  Cost contains_cost = get_func_cost(spatial->funcid) * cpu_operator_cost;
+
+  Cost build_cost, probe_cost;
+
+  double rows = joinrel->rows;
+
+  double build_bytes = build->rows * (build->pathtarget->width +
+                                      MAXALIGN(SizeofMinimalTupleHeader) +
+                                      sizeof(struct geo_spatial_join_item));
+
+/* a partial path only produces the rows of its share of the points */
+  if (probe->parallel_workers > 0 && probe->parent->rows > 0)
+    rows = clamp_row_est(rows * probe->rows / probe->parent->rows);
+
+  cost_qual_eval(&others_cost, others, root);
+
+  build_cost = build->total_cost +
+               build->rows * (cpu_tuple_cost + GEOEXT_SPATIAL_JOIN_CANDIDATES * cpu_operator_cost);
+
+/*
+  polygons that do not fit in work_mem are written and read twice (all of
+  them, then by tile) and the points once, before the first row comes out
+ */
+  if (build_bytes > work_mem * 1024.0)
+  {
+    double build_pages = ceil(build_bytes / BLCKSZ);
+    double probe_pages = ceil(probe->rows * (probe->pathtarget->width +
+                                             MAXALIGN(SizeofMinimalTupleHeader)) / BLCKSZ);
+
+    build_cost += seq_page_cost * (4.0 * build_pages + 2.0 * probe_pages) +
+                  (build->rows + probe->rows) * cpu_tuple_cost;
+  }
+
+  probe_cost = (probe->total_cost - probe->startup_cost) +
+               probe->rows * (cpu_operator_cost + GEOEXT_SPATIAL_JOIN_CANDIDATES * contains_cost) +
+               rows * (cpu_tuple_cost + others_cost.per_tuple + joinrel->reltarget->cost.per_tuple);
+
+  cpath->path.pathtype = T_CustomScan;
+  cpath->path.parent = joinrel;
+  cpath->path.pathtarget = joinrel->reltarget;
+  cpath->path.param_info = NULL;
+  cpath->path.parallel_aware = false;
+  cpath->path.parallel_safe = joinrel->consider_parallel &&
+                              probe->parallel_safe && build->parallel_safe;
+  cpath->path.parallel_workers = probe->parallel_workers;
+  cpath->path.rows = rows;
+  cpath->path.startup_cost = build_cost + probe->startup_cost + others_cost.startup;
+  cpath->path.total_cost = cpath->path.startup_cost + probe_cost;
+  cpath->path.pathkeys = NIL;
+
+#ifdef CUSTOMPATH_SUPPORT_PROJECTION
+  cpath->flags = CUSTOMPATH_SUPPORT_PROJECTION;
+#else
+  cpath->flags = 0;
+#endif
+
+  cpath->custom_paths = list_make2(probe, build);
+  cpath->custom_private = list_make2(spatial, others);
+  cpath->methods = &geo_spatial_join_path_methods;
+
+  return cpath;
+}
+
+
+static void
+geo_spatial_join_pathlist(PlannerInfo *root,
+                          RelOptInfo *joinrel,
+                          RelOptInfo *outerrel,
+                          RelOptInfo *innerrel,
+                          JoinType jointype,
+                          JoinPathExtraData *extra)
+{
+  FuncExpr *spatial = NULL;
+
+  List *others = NIL;
+
+  ListCell *lc;
+
+  Node *polyarg, *ptarg;
+
+  Relids polyrelids, ptrelids;
+
+  RelOptInfo *probe_rel, *build_rel;
+
+  Path *probe_path, *build_path;
+
+  if (prev_set_join_pathlist_hook)
+    prev_set_join_pathlist_hook(root, joinrel, outerrel, innerrel, jointype, extra);
+
+  if (!geoext_enable_spatial_join || jointype != JOIN_INNER)
+    return;
+
+  foreach(lc, extra->restrictlist)
+  {
+    RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+/* we do not handle gating quals */
+    if (rinfo->pseudoconstant)
+      return;
+
+    if (spatial == NULL && is_contains_call((Node *) rinfo->clause))
+      spatial = (FuncExpr *) rinfo->clause;
+    else
+      others = lappend(others, rinfo);
+  }
+
+  if (spatial == NULL)
+    return;
+
+  polyarg = strip_implicit_coercions((Node *) linitial(spatial->args));
+  ptarg = strip_implicit_coercions((Node *) lsecond(spatial->args));
+
+/* the arguments are looked up in the child target lists */
+  if (!IsA(polyarg, Var) || !IsA(ptarg, Var))
+    return;
+
+  polyrelids = pull_varnos(root, polyarg);
+  ptrelids = pull_varnos(root, ptarg);
+
+  if (bms_is_subset(ptrelids, outerrel->relids) && bms_is_subset(polyrelids, innerrel->relids))
+  {
+    probe_rel = outerrel;
+    build_rel = innerrel;
+  }
+  else if (bms_is_subset(ptrelids, innerrel->relids) && bms_is_subset(polyrelids, outerrel->relids))
+  {
+    probe_rel = innerrel;
+    build_rel = outerrel;
+  }
+  else
+    return;
+
+  probe_path = probe_rel->cheapest_total_path;
+  build_path = build_rel->cheapest_total_path;
+
+  if (probe_path == NULL || build_path == NULL ||
+      PATH_REQ_OUTER(probe_path) != NULL || PATH_REQ_OUTER(build_path) != NULL)
+    return;
+
+  add_path(joinrel, (Path *) make_spatial_join_path(root, joinrel, probe_path, build_path,
+                                                    spatial, others));
+
+/*
+  parallel plan: the points come from a partial path and each worker
+  reads all the polygons into its own grid
+ */
+  if (joinrel->consider_parallel && build_path->parallel_safe &&
+      probe_rel->partial_pathlist != NIL)
+  {
+    Path *partial = (Path *) linitial(probe_rel->partial_pathlist);
+
+    if (PATH_REQ_OUTER(partial) == NULL)
+      add_partial_path(joinrel, (Path *) make_spatial_join_path(root, joinrel, partial, build_path,
+                                                                spatial, others));
+  }
+}
+
+
+/* Finds the position of an expression in a target list */
+static AttrNumber
+find_tlist_attno(List *tlist, Node *expr)
+{
+  ListCell *lc;
+
+  foreach(lc, tlist)
+  {
+    TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+    if (equal(tle->expr, expr))
+      return tle->resno;
+  }
+
+  elog(ERROR, "could not find spatial join key in the target list of a child plan");
+
+  return InvalidAttrNumber;
+}
+
+
+static Plan *
+geo_spatial_join_plan(PlannerInfo *root, RelOptInfo *rel,
+                      CustomPath *best_path, List *tlist,
+                      List *clauses, List *custom_plans)
+{
+  CustomScan *cscan = makeNode(CustomScan);
+
+  Plan *probe_plan = (Plan *) linitial(custom_plans);
+  Plan *build_plan = (Plan *) lsecond(custom_plans);
+
+  FuncExpr *spatial = (FuncExpr *) linitial(best_path->custom_private);
+  List *others = (List *) lsecond(best_path->custom_private);
+
+  AttrNumber probe_attno = find_tlist_attno(probe_plan->targetlist,
+                                            strip_implicit_coercions((Node *) lsecond(spatial->args)));
+  AttrNumber build_attno = find_tlist_attno(build_plan->targetlist,
+                                            strip_implicit_coercions((Node *) linitial(spatial->args)));
+
+  List *scan_tlist = NIL;
+
+  AttrNumber resno = 1;
+
+  ListCell *lc;
+
+/* the scan tuple is the probe tuple followed by the build tuple */
+  foreach(lc, probe_plan->targetlist)
+  {
+    TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+    scan_tlist = lappend(scan_tlist, makeTargetEntry((Expr *) copyObject(tle->expr), resno++, NULL, false));
+  }
+
+  foreach(lc, build_plan->targetlist)
+  {
+    TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+    scan_tlist = lappend(scan_tlist, makeTargetEntry((Expr *) copyObject(tle->expr), resno++, NULL, false));
+  }
+
+  cscan->scan.plan.targetlist = tlist;
+  cscan->scan.plan.qual = extract_actual_clauses(others, false);
+  cscan->scan.scanrelid = 0;
+  cscan->flags = best_path->flags;
+  cscan->custom_plans = custom_plans;
+  cscan->custom_exprs = NIL;
+  cscan->custom_private = list_make3(makeInteger(probe_attno),
+                                     makeInteger(build_attno),
+                                     makeInteger(list_length(probe_plan->targetlist)));
+  cscan->custom_scan_tlist = scan_tlist;
+  cscan->methods = &geo_spatial_join_scan_methods;
+
+  return &cscan->scan.plan;
+}
+
+
+/*
+ * Execution.
+ */
+
+static Node *
+geo_spatial_join_create_state(CustomScan *cscan)
+{
+  struct geo_spatial_join_state *s =
+    (struct geo_spatial_join_state *) palloc0(sizeof(struct geo_spatial_join_state));
+
+  NodeSetTag(s, T_CustomScanState);
+
+  s->css.methods = &geo_spatial_join_exec_methods;
+
+  return (Node *) s;
+}
+
+
+static void
+geo_spatial_join_begin(CustomScanState *node, EState *estate, int eflags)
+{
+  struct geo_spatial_join_state *s = (struct geo_spatial_join_state *) node;
+
+  CustomScan *cscan = (CustomScan *) node->ss.ps.plan;
+
+  Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+  s->probe_attno = intVal(linitial(cscan->custom_private));
+  s->build_attno = intVal(lsecond(cscan->custom_private));
+  s->probe_natts = intVal(lthird(cscan->custom_private));
+
+  s->probe_ps = ExecInitNode((Plan *) linitial(cscan->custom_plans), estate, eflags);
+  s->build_ps = ExecInitNode((Plan *) lsecond(cscan->custom_plans), estate, eflags);
+
+/* let EXPLAIN show the children */
+  node->custom_ps = list_make2(s->probe_ps, s->build_ps);
+
+  s->probe_slot = ExecInitExtraTupleSlot(estate, ExecGetResultType(s->probe_ps),
+                                         &TTSOpsMinimalTuple);
+
+  s->build_slot = ExecInitExtraTupleSlot(estate, ExecGetResultType(s->build_ps),
+                                         &TTSOpsMinimalTuple);
+
+  s->grid_cxt = AllocSetContextCreate(estate->es_query_cxt,
+                                      "GeoSpatialJoin grid",
+                                      ALLOCSET_DEFAULT_SIZES);
+
+  s->batch_cxt = AllocSetContextCreate(estate->es_query_cxt,
+                                       "GeoSpatialJoin batch",
+                                       ALLOCSET_DEFAULT_SIZES);
+
+  s->part_cxt = AllocSetContextCreate(estate->es_query_cxt,
+                                      "GeoSpatialJoin partitions",
+                                      ALLOCSET_DEFAULT_SIZES);
+
+  s->built = false;
+  s->probe_done = false;
+}
+
+
+static inline int
+grid_col(const struct geo_spatial_join_state *s, double x)
+{
+  int i = (s->cw > 0.0) ? (int) ((x - s->extent.low.x) / s->cw) : 0;
+
+  return Max(0, Min(s->nx - 1, i));
+}
+
+
+static inline int
+grid_row(const struct geo_spatial_join_state *s, double y)
+{
+  int j = (s->ch > 0.0) ? (int) ((y - s->extent.low.y) / s->ch) : 0;
+
+  return Max(0, Min(s->ny - 1, j));
+}
+
+
+static inline int
+part_col(const struct geo_spatial_join_state *s, double x)
+{
+  int i = (s->pw > 0.0) ? (int) ((x - s->part_extent.low.x) / s->pw) : 0;
+
+  return Max(0, Min(s->kx - 1, i));
+}
+
+
+static inline int
+part_row(const struct geo_spatial_join_state *s, double y)
+{
+  int j = (s->ph > 0.0) ? (int) ((y - s->part_extent.low.y) / s->ph) : 0;
+
+  return Max(0, Min(s->ky - 1, j));
+}
+
+
+/* Number of (cell, polygon) pairs of a grid with the given number of cells per axis */
+static double
+grid_count_refs(struct geo_spatial_join_state *s, int side)
+{
+  double refs = 0.0;
+
+  s->nx = s->ny = side;
+  s->cw = (s->extent.high.x - s->extent.low.x) / side;
+  s->ch = (s->extent.high.y - s->extent.low.y) / side;
+
+  for (int i = 0; i < s->nitems; ++i)
+  {
+    const struct geo_box *b = &s->items[i].box;
+
+    refs += (double) (grid_col(s, b->high.x) - grid_col(s, b->low.x) + 1) *
+            (grid_row(s, b->high.y) - grid_row(s, b->low.y) + 1);
+  }
+
+  return refs;
+}
+
+
+/* Reads the next build tuple, from the child or from a tuplestore */
+static TupleTableSlot *
+fetch_build(struct geo_spatial_join_state *s, Tuplestorestate *source)
+{
+  if (source == NULL)
+    return ExecProcNode(s->build_ps);
+
+  if (!tuplestore_gettupleslot(source, true, false, s->build_slot))
+    return NULL;
+
+  return s->build_slot;
+}
+
+
+/*
+ * Detoasts the polygon of a build tuple and computes its bounding box.
+ * Returns NULL for the polygons that cannot match any point.
+ */
+static struct geo_polygon *
+build_polygon(struct geo_spatial_join_state *s, TupleTableSlot *slot, struct geo_box *box)
+{
+  struct geo_polygon *poly;
+
+  bool isnull;
+
+  Datum value = slot_getattr(slot, s->build_attno, &isnull);
+
+  if (isnull)
+    return NULL;
+
+  if (VARATT_IS_EXTENDED(DatumGetPointer(value)))
+    geo_counter_add(GEO_COUNTER_DETOAST, 1);
+
+  poly = (struct geo_polygon *) PG_DETOAST_DATUM_COPY(value);
+
+  if (poly->npts < 1)
+  {
+    pfree(poly);
+    return NULL;
+  }
+
+  mbr(poly->coords, poly->npts, &box->low, &box->high);
+
+  if (!isfinite(box->low.x) || !isfinite(box->low.y) ||
+      !isfinite(box->high.x) || !isfinite(box->high.y))
+  {
+    pfree(poly);
+    return NULL;
+  }
+
+  return poly;
+}
+
+
+static void
+extend_extent(struct geo_box *extent, const struct geo_box *box)
+{
+  extent->low.x = Min(extent->low.x, box->low.x);
+  extent->low.y = Min(extent->low.y, box->low.y);
+  extent->high.x = Max(extent->high.x, box->high.x);
+  extent->high.y = Max(extent->high.y, box->high.y);
+}
+
+
+/* Moves the polygons loaded so far to build_all */
+static void
+geo_spatial_join_spill(struct geo_spatial_join_state *s)
+{
+  MemoryContext old_context = MemoryContextSwitchTo(s->part_cxt);
+
+  s->build_all = tuplestore_begin_heap(false, false, work_mem);
+
+  MemoryContextSwitchTo(old_context);
+
+  s->part_extent = s->items[0].box;
+  s->build_bytes = 0;
+
+  for (int i = 0; i < s->nitems; ++i)
+  {
+    ExecStoreMinimalTuple(s->items[i].tuple, s->build_slot, false);
+
+    tuplestore_puttupleslot(s->build_all, s->build_slot);
+
+    extend_extent(&s->part_extent, &s->items[i].box);
+
+    s->build_bytes += GEOEXT_SPATIAL_JOIN_ITEM_BYTES(s->items[i].tuple, s->items[i].poly);
+  }
+
+  ExecClearTuple(s->build_slot);
+
+  MemoryContextReset(s->grid_cxt);
+
+  s->items = NULL;
+  s->nitems = s->maxitems = 0;
+}
+
+
+/*
+ * Loads the polygons of the child (source is NULL) or of a tile into
+ * items. When the ones of the child overflow work_mem, they are moved to
+ * build_all, and so is the rest of the child.
+ */
+static void
+geo_spatial_join_load(struct geo_spatial_join_state *s, Tuplestorestate *source)
+{
+  MemoryContext old_context = MemoryContextSwitchTo(s->grid_cxt);
+
+  Size bytes = 0;
+
+  for (;;)
+  {
+    TupleTableSlot *slot = fetch_build(s, source);
+
+    struct geo_spatial_join_item *item;
+
+    struct geo_polygon *poly;
+
+    struct geo_box box;
+
+    if (TupIsNull(slot))
+      break;
+
+    poly = build_polygon(s, slot, &box);
+
+    if (poly == NULL)
+      continue;
+
+    if (s->build_all != NULL)
+    {
+      bool should_free;
+
+      MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
+
+      tuplestore_puttupleslot(s->build_all, slot);
+
+      extend_extent(&s->part_extent, &box);
+
+      s->build_bytes += GEOEXT_SPATIAL_JOIN_ITEM_BYTES(tuple, poly);
+
+      if (should_free)
+        pfree(tuple);
+
+      pfree(poly);
+
+      continue;
+    }
+
+    if (s->nitems == s->maxitems)
+    {
+      s->maxitems = (s->maxitems == 0) ? 1024 : 2 * s->maxitems;
+
+      if (s->items == NULL)
+        s->items = (struct geo_spatial_join_item *)
+          MemoryContextAllocHuge(s->grid_cxt, s->maxitems * sizeof(struct geo_spatial_join_item));
+      else
+        s->items = (struct geo_spatial_join_item *)
+          repalloc_huge(s->items, s->maxitems * sizeof(struct geo_spatial_join_item));
+    }
+
+    item = &s->items[s->nitems];
+
+    item->box = box;
+    item->poly = poly;
+    item->tuple = ExecCopySlotMinimalTuple(slot);
+
+    ++(s->nitems);
+
+    bytes += GEOEXT_SPATIAL_JOIN_ITEM_BYTES(item->tuple, poly);
+
+    if (source == NULL && bytes > (Size) work_mem * 1024L)
+      geo_spatial_join_spill(s);
+  }
+
+  MemoryContextSwitchTo(old_context);
+}
+
+
+/* Builds the grid over the polygons in items */
+static void
+geo_spatial_join_make_grid(struct geo_spatial_join_state *s)
+{
+  MemoryContext old_context;
+
+  int side, ncells, *next;
+
+  double refs;
+
+  if (s->nitems == 0)
+    return;
+
+  old_context = MemoryContextSwitchTo(s->grid_cxt);
+
+/* about one cell per polygon, fewer if the polygons span too many cells */
+  s->extent = s->items[0].box;
+
+  for (int i = 1; i < s->nitems; ++i)
+    extend_extent(&s->extent, &s->items[i].box);
+
+  side = (int) ceil(sqrt((double) s->nitems));
+  side = Max(1, Min(geoext_spatial_join_grid_size, side));
+
+  refs = grid_count_refs(s, side);
+
+  while (side > 1 && refs > (double) GEOEXT_SPATIAL_JOIN_MAX_CELLS_PER_ITEM * s->nitems)
+  {
+    side /= 2;
+    refs = grid_count_refs(s, side);
+  }
+
+/* bucket the polygons by cell (counting sort) */
+  ncells = s->nx * s->ny;
+
+  s->cell_start = (int *) palloc0((ncells + 1) * sizeof(int));
+  s->cell_items = (int *) MemoryContextAllocHuge(s->grid_cxt, (Size) refs * sizeof(int));
+
+  for (int i = 0; i < s->nitems; ++i)
+  {
+    const struct geo_box *b = &s->items[i].box;
+
+    for (int r = grid_row(s, b->low.y); r <= grid_row(s, b->high.y); ++r)
+      for (int c = grid_col(s, b->low.x); c <= grid_col(s, b->high.x); ++c)
+        ++(s->cell_start[r * s->nx + c + 1]);
+  }
+
+  for (int c = 0; c < ncells; ++c)
+    s->cell_start[c + 1] += s->cell_start[c];
+
+  next = (int *) palloc(ncells * sizeof(int));
+
+  memcpy(next, s->cell_start, ncells * sizeof(int));
+
+  for (int i = 0; i < s->nitems; ++i)
+  {
+    const struct geo_box *b = &s->items[i].box;
+
+    CHECK_FOR_INTERRUPTS();
+
+    for (int r = grid_row(s, b->low.y); r <= grid_row(s, b->high.y); ++r)
+      for (int c = grid_col(s, b->low.x); c <= grid_col(s, b->high.x); ++c)
+        s->cell_items[next[r * s->nx + c]++] = i;
+  }
+
+  pfree(next);
+
+  MemoryContextSwitchTo(old_context);
+}
+
+
+/*
+ * Splits build_all and the probe side into tiles, one tuplestore per tile
+ * and side.
+ */
+static void
+geo_spatial_join_partition(struct geo_spatial_join_state *s)
+{
+  MemoryContext old_context = MemoryContextSwitchTo(s->part_cxt);
+
+  double ntiles = ceil(2.0 * s->build_bytes / (work_mem * 1024.0));
+
+  int side = (int) ceil(sqrt(ntiles));
+
+  int maxkb;
+
+  side = Max(2, Min(GEOEXT_SPATIAL_JOIN_MAX_TILES, side));
+
+  s->kx = s->ky = side;
+  s->npart = side * side;
+  s->pw = (s->part_extent.high.x - s->part_extent.low.x) / side;
+  s->ph = (s->part_extent.high.y - s->part_extent.low.y) / side;
+
+/* all the tiles of a side are written at once: they share work_mem */
+  maxkb = Max(64, work_mem / s->npart);
+
+  s->build_parts = (Tuplestorestate **) palloc(s->npart * sizeof(Tuplestorestate *));
+  s->probe_parts = (Tuplestorestate **) palloc(s->npart * sizeof(Tuplestorestate *));
+
+  for (int t = 0; t < s->npart; ++t)
+  {
+    s->build_parts[t] = tuplestore_begin_heap(false, false, maxkb);
+    s->probe_parts[t] = tuplestore_begin_heap(false, false, maxkb);
+  }
+
+  MemoryContextSwitchTo(old_context);
+
+/* a polygon goes to every tile its bounding box overlaps */
+  for (;;)
+  {
+    TupleTableSlot *slot = fetch_build(s, s->build_all);
+
+    struct geo_polygon *poly;
+
+    struct geo_box box;
+
+    if (TupIsNull(slot))
+      break;
+
+    CHECK_FOR_INTERRUPTS();
+
+    poly = build_polygon(s, slot, &box);
+
+    if (poly == NULL)
+      continue;
+
+    for (int r = part_row(s, box.low.y); r <= part_row(s, box.high.y); ++r)
+      for (int c = part_col(s, box.low.x); c <= part_col(s, box.high.x); ++c)
+        tuplestore_puttupleslot(s->build_parts[r * s->kx + c], slot);
+
+    pfree(poly);
+  }
+
+  tuplestore_end(s->build_all);
+  s->build_all = NULL;
+
+/* a point goes to the single tile it falls into */
+  for (;;)
+  {
+    TupleTableSlot *slot = ExecProcNode(s->probe_ps);
+
+    struct coord2d pt;
+
+    bool isnull;
+
+    Datum value;
+
+    if (TupIsNull(slot))
+      break;
+
+    value = slot_getattr(slot, s->probe_attno, &isnull);
+
+    if (isnull)
+      continue;
+
+    pt = DatumGetGeoPointTypeP(value)->coord;
+
+    if (!(pt.x >= s->part_extent.low.x && pt.x <= s->part_extent.high.x &&
+          pt.y >= s->part_extent.low.y && pt.y <= s->part_extent.high.y))
+      continue;
+
+    tuplestore_puttupleslot(s->probe_parts[part_row(s, pt.y) * s->kx + part_col(s, pt.x)], slot);
+  }
+}
+
+
+/* Releases the grid and the polygons */
+static void
+geo_spatial_join_reset_grid(struct geo_spatial_join_state *s)
+{
+  MemoryContextReset(s->grid_cxt);
+
+  s->items = NULL;
+  s->nitems = s->maxitems = 0;
+  s->cell_start = s->cell_items = NULL;
+}
+
+
+/* Releases the tuplestores of the tiles */
+static void
+geo_spatial_join_reset_parts(struct geo_spatial_join_state *s)
+{
+  if (s->build_all != NULL)
+    tuplestore_end(s->build_all);
+
+  for (int t = 0; t < s->npart; ++t)
+  {
+    tuplestore_end(s->build_parts[t]);
+    tuplestore_end(s->probe_parts[t]);
+  }
+
+  MemoryContextReset(s->part_cxt);
+
+  s->build_all = NULL;
+  s->build_parts = s->probe_parts = NULL;
+  s->npart = 0;
+}
+
+
+/* Loads the polygons of a tile and rewinds its points */
+static void
+geo_spatial_join_load_part(struct geo_spatial_join_state *s, int part)
+{
+  geo_spatial_join_reset_grid(s);
+
+  s->part = part;
+
+  tuplestore_rescan(s->build_parts[part]);
+
+  geo_spatial_join_load(s, s->build_parts[part]);
+
+  geo_spatial_join_make_grid(s);
+
+  tuplestore_rescan(s->probe_parts[part]);
+
+  s->probe_done = false;
+}
+
+
+static void
+geo_spatial_join_build(struct geo_spatial_join_state *s)
+{
+  geo_spatial_join_load(s, NULL);
+
+  s->built = true;
+
+  if (s->build_all == NULL)
+  {
+    geo_spatial_join_make_grid(s);
+    return;
+  }
+
+  geo_spatial_join_partition(s);
+
+/* next() goes on with the first tile */
+  s->part = -1;
+  s->probe_done = true;
+}
+
+
+/* Orders the candidate pairs by polygon and then by the y of the point */
+static int
+geo_spatial_join_pair_cmp(const void *a, const void *b, void *arg)
+{
+  const struct geo_spatial_join_pair *p = (const struct geo_spatial_join_pair *) a;
+  const struct geo_spatial_join_pair *q = (const struct geo_spatial_join_pair *) b;
+
+  const struct coord2d *pts = (const struct coord2d *) arg;
+
+  if (p->item != q->item)
+    return (p->item < q->item) ? -1 : 1;
+
+  if (pts[p->point].y != pts[q->point].y)
+    return (pts[p->point].y < pts[q->point].y) ? -1 : 1;
+
+  return 0;
+}
+
+
+/* Reads the next probe tuple, from the child or from the current tile */
+static TupleTableSlot *
+fetch_probe(struct geo_spatial_join_state *s)
+{
+  if (s->npart == 0)
+    return ExecProcNode(s->probe_ps);
+
+  if (!tuplestore_gettupleslot(s->probe_parts[s->part], true, false, s->probe_slot))
+    return NULL;
+
+  return s->probe_slot;
+}
+
+
+/*
+ * Reads the next batch of points, up to work_mem, and leaves its matches
+ * in pairs. The batch may have no matches even if the probe side is not
+ * exhausted.
+ */
+static void
+geo_spatial_join_batch(struct geo_spatial_join_state *s)
+{
+  MemoryContext old_context;
+
+  struct coord2d *coords;
+
+  unsigned char *inside;
+
+  Size batch_bytes = 0;
+
+  int maxrun = 0;
+
+  MemoryContextReset(s->batch_cxt);
+
+  old_context = MemoryContextSwitchTo(s->batch_cxt);
+
+  s->maxbatch = s->maxpairs = GEOEXT_SPATIAL_JOIN_BATCH_INITIAL;
+  s->batch_tuples = (MinimalTuple *) palloc(s->maxbatch * sizeof(MinimalTuple));
+  s->batch_pts = (struct coord2d *) palloc(s->maxbatch * sizeof(struct coord2d));
+  s->pairs = (struct geo_spatial_join_pair *) palloc(s->maxpairs * sizeof(struct geo_spatial_join_pair));
+  s->nbatch = s->npairs = s->nmatches = s->next_match = 0;
+
+/* the points and their candidates */
+  while (batch_bytes < (Size) work_mem * 1024L)
+  {
+    TupleTableSlot *slot = fetch_probe(s);
+
+    struct coord2d pt;
+
+    bool isnull;
+
+    Datum value;
+
+    int cell;
+
+    if (TupIsNull(slot))
+    {
+      s->probe_done = true;
+      break;
+    }
+
+    value = slot_getattr(slot, s->probe_attno, &isnull);
+
+    if (isnull)
+      continue;
+
+    pt = DatumGetGeoPointTypeP(value)->coord;
+
+/* the negated tests also discard NaN coordinates */
+    if (!(pt.x >= s->extent.low.x && pt.x <= s->extent.high.x &&
+          pt.y >= s->extent.low.y && pt.y <= s->extent.high.y))
+      continue;
+
+    cell = grid_row(s, pt.y) * s->nx + grid_col(s, pt.x);
+
+    for (int pos = s->cell_start[cell]; pos < s->cell_start[cell + 1]; ++pos)
+    {
+      int i = s->cell_items[pos];
+
+      if (pt.x < s->items[i].box.low.x || pt.x > s->items[i].box.high.x ||
+          pt.y < s->items[i].box.low.y || pt.y > s->items[i].box.high.y)
+        continue;
+
+      if (s->npairs == s->maxpairs)
+      {
+        s->maxpairs *= 2;
+        s->pairs = (struct geo_spatial_join_pair *)
+          repalloc_huge(s->pairs, s->maxpairs * sizeof(struct geo_spatial_join_pair));
+      }
+
+      s->pairs[s->npairs].item = i;
+      s->pairs[s->npairs].point = s->nbatch;
+      ++(s->npairs);
+    }
+
+/* a point without candidates is not kept */
+    if (s->npairs == 0 || s->pairs[s->npairs - 1].point != s->nbatch)
+      continue;
+
+    if (s->nbatch == s->maxbatch)
+    {
+      s->maxbatch *= 2;
+      s->batch_tuples = (MinimalTuple *) repalloc_huge(s->batch_tuples, s->maxbatch * sizeof(MinimalTuple));
+      s->batch_pts = (struct coord2d *) repalloc_huge(s->batch_pts, s->maxbatch * sizeof(struct coord2d));
+    }
+
+    s->batch_tuples[s->nbatch] = ExecCopySlotMinimalTuple(slot);
+    s->batch_pts[s->nbatch] = pt;
+
+    batch_bytes += s->batch_tuples[s->nbatch]->t_len + sizeof(MinimalTuple) + sizeof(struct coord2d);
+
+    ++(s->nbatch);
+  }
+
+  if (s->npairs == 0)
+  {
+    MemoryContextSwitchTo(old_context);
+    return;
+  }
+
+  qsort_arg(s->pairs, s->npairs, sizeof(struct geo_spatial_join_pair),
+            geo_spatial_join_pair_cmp, s->batch_pts);
+
+  for (int first = 0, last; first < s->npairs; first = last)
+  {
+    for (last = first + 1; last < s->npairs && s->pairs[last].item == s->pairs[first].item; ++last)
+      ;
+
+    maxrun = Max(maxrun, last - first);
+  }
+
+  coords = (struct coord2d *) palloc(maxrun * sizeof(struct coord2d));
+  inside = (unsigned char *) palloc(maxrun);
+
+/* the refinement: one pass over the edges of a polygon for all its points */
+  for (int first = 0, last; first < s->npairs; first = last)
+  {
+    struct geo_polygon *poly = s->items[s->pairs[first].item].poly;
+
+    CHECK_FOR_INTERRUPTS();
+
+    for (last = first; last < s->npairs && s->pairs[last].item == s->pairs[first].item; ++last)
+      coords[last - first] = s->batch_pts[s->pairs[last].point];
+
+    geo_counter_add(GEO_COUNTER_POINT_IN_POLYGON, last - first);
+    geo_counter_add(GEO_COUNTER_PIP_EDGE_TESTS, poly->npts - 1);
+
+    points_in_polygon(coords, last - first, poly->coords, poly->npts, inside);
+
+/* the matches are moved to the front, never past the pairs still to test */
+    for (int k = first; k < last; ++k)
+      if (inside[k - first])
+        s->pairs[s->nmatches++] = s->pairs[k];
+  }
+
+  MemoryContextSwitchTo(old_context);
+}
+
+
+/* Fills the scan tuple with the given probe tuple followed by the given build tuple */
+static TupleTableSlot *
+geo_spatial_join_store(struct geo_spatial_join_state *s,
+                       MinimalTuple probe_tuple,
+                       struct geo_spatial_join_item *item)
+{
+  TupleTableSlot *scan_slot = s->css.ss.ss_ScanTupleSlot;
+
+  int nbuild = scan_slot->tts_tupleDescriptor->natts - s->probe_natts;
+
+  ExecClearTuple(scan_slot);
+
+  ExecStoreMinimalTuple(probe_tuple, s->probe_slot, false);
+
+  slot_getallattrs(s->probe_slot);
+
+  memcpy(scan_slot->tts_values, s->probe_slot->tts_values, s->probe_natts * sizeof(Datum));
+  memcpy(scan_slot->tts_isnull, s->probe_slot->tts_isnull, s->probe_natts * sizeof(bool));
+
+  ExecStoreMinimalTuple(item->tuple, s->build_slot, false);
+
+  slot_getallattrs(s->build_slot);
+
+  memcpy(scan_slot->tts_values + s->probe_natts, s->build_slot->tts_values, nbuild * sizeof(Datum));
+  memcpy(scan_slot->tts_isnull + s->probe_natts, s->build_slot->tts_isnull, nbuild * sizeof(bool));
+
+  return ExecStoreVirtualTuple(scan_slot);
+}
+
+
+static TupleTableSlot *
+geo_spatial_join_next(ScanState *ss)
+{
+  struct geo_spatial_join_state *s = (struct geo_spatial_join_state *) ss;
+
+  if (!s->built)
+    geo_spatial_join_build(s);
+
+  for (;;)
+  {
+    if (s->next_match < s->nmatches)
+    {
+      struct geo_spatial_join_pair *pair = &s->pairs[s->next_match++];
+
+      return geo_spatial_join_store(s, s->batch_tuples[pair->point], &s->items[pair->item]);
+    }
+
+    if (!s->probe_done && s->nitems > 0)
+    {
+      geo_spatial_join_batch(s);
+      continue;
+    }
+
+    if (s->part + 1 >= s->npart)
+      return ExecClearTuple(ss->ss_ScanTupleSlot);
+
+    geo_spatial_join_load_part(s, s->part + 1);
+  }
+}
+
+
+/* There is no EvalPlanQual support for joins: a tuple is never rechecked */
+static bool
+geo_spatial_join_recheck(ScanState *ss, TupleTableSlot *slot)
+{
+  return true;
+}
+
+
+static TupleTableSlot *
+geo_spatial_join_exec(CustomScanState *node)
+{
+  return ExecScan(&node->ss,
+                  (ExecScanAccessMtd) geo_spatial_join_next,
+                  (ExecScanRecheckMtd) geo_spatial_join_recheck);
+}
+
+
+static void
+geo_spatial_join_end(CustomScanState *node)
+{
+  struct geo_spatial_join_state *s = (struct geo_spatial_join_state *) node;
+
+  ExecEndNode(s->probe_ps);
+  ExecEndNode(s->build_ps);
+
+/* the tuplestores may hold temporary files */
+  geo_spatial_join_reset_parts(s);
+
+  MemoryContextDelete(s->grid_cxt);
+}
+
+
+static void
+geo_spatial_join_rescan(CustomScanState *node)
+{
+  struct geo_spatial_join_state *s = (struct geo_spatial_join_state *) node;
+
+/*
+  the grid is kept unless the polygons may change, or they were
+  partitioned: then the points have to be partitioned again and the build
+  side is read again too
+ */
+  if (s->build_ps->chgParam != NULL || s->npart > 0)
+  {
+    geo_spatial_join_reset_parts(s);
+    geo_spatial_join_reset_grid(s);
+
+    if (s->build_ps->chgParam == NULL)
+      ExecReScan(s->build_ps);
+
+    s->built = false;
+  }
+
+/* if chgParam is set, the child will be rescanned by ExecProcNode */
+  if (s->probe_ps->chgParam == NULL)
+    ExecReScan(s->probe_ps);
+
+  MemoryContextReset(s->batch_cxt);
+
+  s->nbatch = s->npairs = s->nmatches = s->next_match = 0;
+  s->probe_done = false;
+}
+
+
+void
+geo_spatial_join_init(void)
+{
+  RegisterCustomScanMethods(&geo_spatial_join_scan_methods);
+
+  prev_set_join_pathlist_hook = set_join_pathlist_hook;
+  set_join_pathlist_hook = geo_spatial_join_pathlist;
+}
@@ -0,0 +1,83 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_spatial_join.h
+ *
+ * \brief A CustomScan provider for spatial joins between polygons and points.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+
+#ifndef __GEOEXT_GEO_SPATIAL_JOIN_H__
+#define __GEOEXT_GEO_SPATIAL_JOIN_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+
+
+/*
+ * Upper limit of geoext.spatial_join_grid_size.
+ */
+#define GEOEXT_SPATIAL_JOIN_MAX_GRID_SIZE 1024
+
+
+/* GUC geoext.enable_spatial_join */
+extern bool geoext_enable_spatial_join;
+
+
+/*
+ * GUC geoext.spatial_join_grid_size: maximum number of cells along each
+ * axis of the grid built over the polygons of a spatial join. The grid
+ * has about one cell per polygon, up to this limit.
+ */
+extern int geoext_spatial_join_grid_size;
+
+
+/*
+ * \brief Registers the spatial join path generator and its executor methods.
+ *
+ * It must be called from _PG_init.
+ *
+ * The planner offers a "GeoSpatialJoin" custom join for inner joins whose
+ * condition has a contains(geo_polygon, geo_point) call with a column of
+ * each side as arguments. The polygons are assigned to the cells of a
+ * uniform grid over their bounding boxes. Then, each point looks for the
+ * cell it falls into and runs the exact point in polygon test only against
+ * the polygons of that cell.
+ *
+ * The polygons are always loaded into the grid, whichever side of the
+ * join they come from. If they do not fit in work_mem, both sides are
+ * first split into spatial tiles written to temporary files, and each
+ * tile is joined on its own. In parallel plans, the points are read by a
+ * partial scan and each worker builds its own copy of the grid.
+ *
+ */
+void geo_spatial_join_init(void);
+
+#endif  /* __GEOEXT_GEO_SPATIAL_JOIN_H__ */
@@ -0,0 +1,884 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_stbox.c
+ *
+ * \brief Spatio-temporal boxes and their R-tree GiST opclasses.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExtension */
+#include "geo_stbox.h"
+#include "algorithms.h"
+#include "geo_counters.h"
+#include "geo_point.h"
+#include "hexutils.h"
+#include "trajectory.h"
+
+
+/* PostgreSQL */
+#include <access/gist.h>
+#include <access/stratnum.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/float.h>
+
+
+/* C Standard Library */
+#include <math.h>
+#include <string.h>
+
+
+/*
+ * Utility macros.
+ */
+#define GEOEXT_GEOSTBOX_SIZE ( sizeof(struct geo_stbox) )
+#define GEOEXT_GEOSTBOX_HEX_LEN ( 2 * GEOEXT_GEOSTBOX_SIZE )
+
+
+/*
+ * Auxiliary functions.
+ *
+ */
+static inline bool
+stbox_overlap(const struct geo_stbox *a, const struct geo_stbox *b)
+{
+  return (a->box.low.x <= b->box.high.x) && (a->box.high.x >= b->box.low.x) &&
+         (a->box.low.y <= b->box.high.y) && (a->box.high.y >= b->box.low.y) &&
+         (a->tmin <= b->tmax) && (a->tmax >= b->tmin);
+}
+
+
+static inline bool
+stbox_contain(const struct geo_stbox *a, const struct geo_stbox *b)
+{
+  return (a->box.low.x <= b->box.low.x) && (a->box.high.x >= b->box.high.x) &&
+         (a->box.low.y <= b->box.low.y) && (a->box.high.y >= b->box.high.y) &&
+         (a->tmin <= b->tmin) && (a->tmax >= b->tmax);
+}
+
+
+static inline bool
+stbox_same(const struct geo_stbox *a, const struct geo_stbox *b)
+{
+  return (a->box.low.x == b->box.low.x) && (a->box.high.x == b->box.high.x) &&
+         (a->box.low.y == b->box.low.y) && (a->box.high.y == b->box.high.y) &&
+         (a->tmin == b->tmin) && (a->tmax == b->tmax);
+}
+
+
+/*
+ * Distance in space between two boxes that share an instant, or infinity
+ * if their time intervals are disjoint.
+ */
+static inline double
+stbox_distance(const struct geo_stbox *a, const struct geo_stbox *b)
+{
+  double dx, dy;
+
+  if((a->tmin > b->tmax) || (a->tmax < b->tmin))
+    return get_float8_infinity();
+
+  dx = Max(Max(a->box.low.x - b->box.high.x, b->box.low.x - a->box.high.x), 0.0);
+  dy = Max(Max(a->box.low.y - b->box.high.y, b->box.low.y - a->box.high.y), 0.0);
+
+  return sqrt(dx * dx + dy * dy);
+}
+
+
+static inline void
+stbox_adjust(struct geo_stbox *u, const struct geo_stbox *b)
+{
+  u->box.low.x = Min(u->box.low.x, b->box.low.x);
+  u->box.low.y = Min(u->box.low.y, b->box.low.y);
+  u->box.high.x = Max(u->box.high.x, b->box.high.x);
+  u->box.high.y = Max(u->box.high.y, b->box.high.y);
+  u->tmin = Min(u->tmin, b->tmin);
+  u->tmax = Max(u->tmax, b->tmax);
+}
+
+
+/* extent along an axis: 0 is x, 1 is y and 2 is time, in seconds */
+static inline double
+stbox_extent(const struct geo_stbox *b, int axis)
+{
+  switch(axis)
+  {
+    case 0:
+      return b->box.high.x - b->box.low.x;
+    case 1:
+      return b->box.high.y - b->box.low.y;
+    default:
+      return (double) (b->tmax - b->tmin) / USECS_PER_SEC;
+  }
+}
+
+
+static inline double
+stbox_volume(const struct geo_stbox *b)
+{
+  return stbox_extent(b, 0) * stbox_extent(b, 1) * stbox_extent(b, 2);
+}
+
+
+static inline double
+stbox_margin(const struct geo_stbox *b)
+{
+  return stbox_extent(b, 0) + stbox_extent(b, 1) + stbox_extent(b, 2);
+}
+
+
+/* volume of the intersection of two boxes, zero if they are disjoint */
+static inline double
+stbox_overlap_volume(const struct geo_stbox *a, const struct geo_stbox *b)
+{
+  double dx = Min(a->box.high.x, b->box.high.x) - Max(a->box.low.x, b->box.low.x);
+  double dy = Min(a->box.high.y, b->box.high.y) - Max(a->box.low.y, b->box.low.y);
+  double dt = (double) (Min(a->tmax, b->tmax) - Max(a->tmin, b->tmin)) / USECS_PER_SEC;
+
+  if((dx < 0.0) || (dy < 0.0) || (dt < 0.0))
+    return 0.0;
+
+  return dx * dy * dt;
+}
+
+
+/* lower and upper bounds of a box along an axis */
+static inline void
+stbox_axis(const struct geo_stbox *b, int axis, double *lo, double *hi)
+{
+  switch(axis)
+  {
+    case 0:
+      *lo = b->box.low.x;
+      *hi = b->box.high.x;
+      break;
+    case 1:
+      *lo = b->box.low.y;
+      *hi = b->box.high.y;
+      break;
+    default:
+      *lo = (double) b->tmin;
+      *hi = (double) b->tmax;
+  }
+}
+
+
+/*
+ * Extent of the fixes of a trajectory.
+ *
+ * \return false if the trajectory has no fixes.
+ *
+ */
+static bool
+geo_trajectory_extent(ArrayType *traj, struct geo_stbox *result)
+{
+  const struct geo_trajc_elem *elems;
+
+  int n;
+
+  if(ARR_NDIM(traj) == 0)
+    return false;
+
+  if((ARR_NDIM(traj) != 1) || ARR_HASNULL(traj))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("a trajectory must be a one-dimensional array without nulls")));
+
+  elems = (const struct geo_trajc_elem*) ARR_DATA_PTR(traj);
+
+  n = ARR_DIMS(traj)[0];
+
+  if(n == 0)
+    return false;
+
+  result->box.low = result->box.high = elems[0].point_elem.coord;
+  result->tmin = result->tmax = elems[0].time_elem;
+
+  for(int i = 1; i < n; ++i)
+  {
+    const struct coord2d *c = &elems[i].point_elem.coord;
+
+    result->box.low.x = Min(result->box.low.x, c->x);
+    result->box.low.y = Min(result->box.low.y, c->y);
+    result->box.high.x = Max(result->box.high.x, c->x);
+    result->box.high.y = Max(result->box.high.y, c->y);
+    result->tmin = Min(result->tmin, elems[i].time_elem);
+    result->tmax = Max(result->tmax, elems[i].time_elem);
+  }
+
+  return true;
+}
+
+
+/*
+ * I/O Functions for the geo_stbox data type
+ *
+ */
+PG_FUNCTION_INFO_V1(geo_stbox_in);
+
+Datum
+geo_stbox_in(PG_FUNCTION_ARGS)
+{
+  char *str = PG_GETARG_CSTRING(0);
+
+  struct geo_stbox *stbox = (struct geo_stbox*) palloc(sizeof(struct geo_stbox));
+
+  if (strlen(str) != GEOEXT_GEOSTBOX_HEX_LEN)
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+            errmsg("invalid input syntax for type %s: \"%s\"",
+            "geo_stbox", str)));
+
+  hex2binary(str, GEOEXT_GEOSTBOX_HEX_LEN, (char*)stbox);
+
+  PG_RETURN_GEOSTBOX_TYPE_P(stbox);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_out);
+
+Datum
+geo_stbox_out(PG_FUNCTION_ARGS)
+{
+  struct geo_stbox *stbox = PG_GETARG_GEOSTBOX_TYPE_P(0);
+
+/* alloc a buffer for hex-string plus a trailing '\0' */
+  char *hstr = palloc(GEOEXT_GEOSTBOX_HEX_LEN + 1);
+
+  binary2hex((char*)stbox, GEOEXT_GEOSTBOX_SIZE, hstr);
+
+  PG_RETURN_CSTRING(hstr);
+}
+
+
+/*
+ * Constructors
+ *
+ */
+PG_FUNCTION_INFO_V1(geo_stbox_make);
+
+Datum
+geo_stbox_make(PG_FUNCTION_ARGS)
+{
+  struct geo_box *box = PG_GETARG_GEOBOX_TYPE_P(0);
+
+  Timestamp tmin = PG_GETARG_TIMESTAMP(1);
+  Timestamp tmax = PG_GETARG_TIMESTAMP(2);
+
+  struct geo_stbox *stbox = (struct geo_stbox*) palloc(sizeof(struct geo_stbox));
+
+  if(tmin > tmax)
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("the start of the time interval must not be after its end")));
+
+  stbox->box.low.x = Min(box->low.x, box->high.x);
+  stbox->box.low.y = Min(box->low.y, box->high.y);
+  stbox->box.high.x = Max(box->low.x, box->high.x);
+  stbox->box.high.y = Max(box->low.y, box->high.y);
+  stbox->tmin = tmin;
+  stbox->tmax = tmax;
+
+  PG_RETURN_GEOSTBOX_TYPE_P(stbox);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_from_point);
+
+Datum
+geo_stbox_from_point(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  Timestamp t = PG_GETARG_TIMESTAMP(1);
+
+  struct geo_stbox *stbox = (struct geo_stbox*) palloc(sizeof(struct geo_stbox));
+
+  stbox->box.low = pt->coord;
+  stbox->box.high = pt->coord;
+  stbox->tmin = t;
+  stbox->tmax = t;
+
+  PG_RETURN_GEOSTBOX_TYPE_P(stbox);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_from_trajectory);
+
+Datum
+geo_stbox_from_trajectory(PG_FUNCTION_ARGS)
+{
+  ArrayType *traj = PG_GETARG_ARRAYTYPE_P(0);
+
+  struct geo_stbox *stbox = (struct geo_stbox*) palloc(sizeof(struct geo_stbox));
+
+  if(!geo_trajectory_extent(traj, stbox))
+    PG_RETURN_NULL();
+
+  PG_RETURN_GEOSTBOX_TYPE_P(stbox);
+}
+
+
+/*
+ * Operators
+ *
+ */
+PG_FUNCTION_INFO_V1(geo_stbox_overlap);
+
+Datum
+geo_stbox_overlap(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(stbox_overlap(PG_GETARG_GEOSTBOX_TYPE_P(0), PG_GETARG_GEOSTBOX_TYPE_P(1)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_contain);
+
+Datum
+geo_stbox_contain(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(stbox_contain(PG_GETARG_GEOSTBOX_TYPE_P(0), PG_GETARG_GEOSTBOX_TYPE_P(1)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_contained);
+
+Datum
+geo_stbox_contained(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(stbox_contain(PG_GETARG_GEOSTBOX_TYPE_P(1), PG_GETARG_GEOSTBOX_TYPE_P(0)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_same);
+
+Datum
+geo_stbox_same(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_BOOL(stbox_same(PG_GETARG_GEOSTBOX_TYPE_P(0), PG_GETARG_GEOSTBOX_TYPE_P(1)));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_distance);
+
+Datum
+geo_stbox_distance(PG_FUNCTION_ARGS)
+{
+  PG_RETURN_FLOAT8(stbox_distance(PG_GETARG_GEOSTBOX_TYPE_P(0), PG_GETARG_GEOSTBOX_TYPE_P(1)));
+}
+
+
+/*
+ * Distance in space between a trajectory and a geo_stbox while they share
+ * an instant: the trajectory moves in a straight line between consecutive
+ * fixes, which are sorted by time (see at_time). Each segment is clipped
+ * to the time interval of the box and its distance to the box is the one
+ * of the clipped piece. Infinity if they never share an instant.
+ */
+static double
+geo_trajectory_stbox_window_distance(ArrayType *traj, const struct geo_stbox *query)
+{
+  const struct geo_trajc_elem *elems;
+
+  double result = get_float8_infinity();
+
+  int n;
+
+  if(ARR_NDIM(traj) == 0)
+    return result;
+
+  if((ARR_NDIM(traj) != 1) || ARR_HASNULL(traj))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("a trajectory must be a one-dimensional array without nulls")));
+
+  elems = (const struct geo_trajc_elem*) ARR_DATA_PTR(traj);
+
+  n = ARR_DIMS(traj)[0];
+
+  if((n == 1) && (elems[0].time_elem >= query->tmin) && (elems[0].time_elem <= query->tmax))
+    return segment_box_distance(&elems[0].point_elem.coord, &elems[0].point_elem.coord,
+                                &query->box.low, &query->box.high);
+
+  for(int i = 1; (i < n) && (result > 0.0); ++i)
+  {
+    const struct geo_trajc_elem *e0 = &elems[i - 1];
+    const struct geo_trajc_elem *e1 = &elems[i];
+
+    Timestamp ta = Max(e0->time_elem, query->tmin);
+    Timestamp tb = Min(e1->time_elem, query->tmax);
+
+    struct coord2d pa, pb;
+
+    if(ta > tb)
+      continue;
+
+    pa = e0->point_elem.coord;
+    pb = e1->point_elem.coord;
+
+/* the positions at the ends of the time window */
+    if(e1->time_elem > e0->time_elem)
+    {
+      double fa = (double) (ta - e0->time_elem) / (double) (e1->time_elem - e0->time_elem);
+      double fb = (double) (tb - e0->time_elem) / (double) (e1->time_elem - e0->time_elem);
+
+      pa.x = e0->point_elem.coord.x + fa * (e1->point_elem.coord.x - e0->point_elem.coord.x);
+      pa.y = e0->point_elem.coord.y + fa * (e1->point_elem.coord.y - e0->point_elem.coord.y);
+      pb.x = e0->point_elem.coord.x + fb * (e1->point_elem.coord.x - e0->point_elem.coord.x);
+      pb.y = e0->point_elem.coord.y + fb * (e1->point_elem.coord.y - e0->point_elem.coord.y);
+    }
+
+    result = Min(result, segment_box_distance(&pa, &pb, &query->box.low, &query->box.high));
+  }
+
+  return result;
+}
+
+
+/*
+ * traj && stbox: the trajectory is inside the box at some instant of its
+ * time interval. traj <-> stbox: the shortest distance between them during
+ * that interval.
+ */
+PG_FUNCTION_INFO_V1(geo_trajectory_stbox_overlap);
+
+Datum
+geo_trajectory_stbox_overlap(PG_FUNCTION_ARGS)
+{
+  ArrayType *traj = PG_GETARG_ARRAYTYPE_P(0);
+
+  struct geo_stbox *query = PG_GETARG_GEOSTBOX_TYPE_P(1);
+
+  struct geo_stbox extent;
+
+/* the extent is a cheap filter */
+  if(!geo_trajectory_extent(traj, &extent) || !stbox_overlap(&extent, query))
+    PG_RETURN_BOOL(false);
+
+  PG_RETURN_BOOL(geo_trajectory_stbox_window_distance(traj, query) == 0.0);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_trajectory_stbox_distance);
+
+Datum
+geo_trajectory_stbox_distance(PG_FUNCTION_ARGS)
+{
+  ArrayType *traj = PG_GETARG_ARRAYTYPE_P(0);
+
+  struct geo_stbox *query = PG_GETARG_GEOSTBOX_TYPE_P(1);
+
+  PG_RETURN_FLOAT8(geo_trajectory_stbox_window_distance(traj, query));
+}
+
+
+/*
+ * R-tree GiST support.
+ *
+ * The keys of the leaves and of the inner nodes are geo_stbox, so the same
+ * methods serve geo_stbox columns and trajectories. The key of a
+ * trajectory is the extent of its fixes, which is lossy: its consistent
+ * and distance methods ask for a recheck.
+ *
+ */
+PG_FUNCTION_INFO_V1(geo_stbox_gist_consistent);
+
+Datum
+geo_stbox_gist_consistent(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_stbox *query = PG_GETARG_GEOSTBOX_TYPE_P(1);
+
+  StrategyNumber strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+
+  bool *recheck = (bool *) PG_GETARG_POINTER(4);
+
+  struct geo_stbox *key = DatumGetGeoSTBoxTypeP(entry->key);
+
+  bool retval;
+
+  geo_counter_add(GEO_COUNTER_GIST_CONSISTENT, 1);
+
+/* the operators are defined on the boxes, so the leaves are exact */
+  *recheck = false;
+
+  switch(strategy)
+  {
+    case RTOverlapStrategyNumber:
+      retval = stbox_overlap(key, query);
+      break;
+    case RTSameStrategyNumber:
+      retval = GIST_LEAF(entry) ? stbox_same(key, query) : stbox_contain(key, query);
+      break;
+    case RTContainsStrategyNumber:
+      retval = stbox_contain(key, query);
+      break;
+    case RTContainedByStrategyNumber:
+      retval = GIST_LEAF(entry) ? stbox_contain(query, key) : stbox_overlap(key, query);
+      break;
+    default:
+      elog(ERROR, "unrecognized strategy number: %d", strategy);
+      retval = false;
+  }
+
+  PG_RETURN_BOOL(retval);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_gist_union);
+
+Datum
+geo_stbox_gist_union(PG_FUNCTION_ARGS)
+{
+  GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+
+  int *sizep = (int *) PG_GETARG_POINTER(1);
+
+  struct geo_stbox *pageunion = (struct geo_stbox *) palloc(sizeof(struct geo_stbox));
+
+  geo_counter_add(GEO_COUNTER_GIST_UNION, 1);
+
+  memcpy(pageunion, DatumGetGeoSTBoxTypeP(entryvec->vector[0].key), sizeof(struct geo_stbox));
+
+  for(int i = 1; i < entryvec->n; ++i)
+    stbox_adjust(pageunion, DatumGetGeoSTBoxTypeP(entryvec->vector[i].key));
+
+  *sizep = sizeof(struct geo_stbox);
+
+  PG_RETURN_POINTER(pageunion);
+}
+
+
+/*
+ * The penalty is the growth of the volume (area x duration). Fixes and
+ * flat boxes have no volume, so the growth of the margin breaks the ties.
+ */
+PG_FUNCTION_INFO_V1(geo_stbox_gist_penalty);
+
+Datum
+geo_stbox_gist_penalty(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *origentry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  GISTENTRY *newentry = (GISTENTRY *) PG_GETARG_POINTER(1);
+
+  float *penalty = (float *) PG_GETARG_POINTER(2);
+
+  struct geo_stbox *orig = DatumGetGeoSTBoxTypeP(origentry->key);
+
+  struct geo_stbox unionbox = *orig;
+
+  double growth;
+
+  geo_counter_add(GEO_COUNTER_GIST_PENALTY, 1);
+
+  stbox_adjust(&unionbox, DatumGetGeoSTBoxTypeP(newentry->key));
+
+  growth = stbox_volume(&unionbox) - stbox_volume(orig);
+
+  if(growth <= 0.0)
+    growth = stbox_margin(&unionbox) - stbox_margin(orig);
+
+  *penalty = (float) growth;
+
+  PG_RETURN_POINTER(penalty);
+}
+
+
+/* computes the union of the entries listed in list into *unionbox */
+static void
+stbox_union_list(GistEntryVector *entryvec, OffsetNumber *list, int n,
+                 struct geo_stbox *unionbox)
+{
+  memcpy(unionbox, DatumGetGeoSTBoxTypeP(entryvec->vector[list[0]].key), sizeof(struct geo_stbox));
+
+  for(int i = 1; i < n; ++i)
+    stbox_adjust(unionbox, DatumGetGeoSTBoxTypeP(entryvec->vector[list[i]].key));
+}
+
+
+static Datum
+stbox_split_side(GistEntryVector *entryvec, OffsetNumber *list, int n)
+{
+  struct geo_stbox *unionbox = (struct geo_stbox *) palloc(sizeof(struct geo_stbox));
+
+  stbox_union_list(entryvec, list, n, unionbox);
+
+  return PointerGetDatum(unionbox);
+}
+
+
+/*
+ * The linear split of Ang & Tan used by geo_box_picksplit, extended to
+ * the time axis: each entry goes to the side of the page union it is
+ * nearer to along x, y and t. We keep the axis with the most even
+ * distribution, breaking ties by the smallest overlap.
+ */
+PG_FUNCTION_INFO_V1(geo_stbox_gist_picksplit);
+
+Datum
+geo_stbox_gist_picksplit(PG_FUNCTION_ARGS)
+{
+  GistEntryVector *entryvec = (GistEntryVector *) PG_GETARG_POINTER(0);
+
+  GIST_SPLITVEC *v = (GIST_SPLITVEC *) PG_GETARG_POINTER(1);
+
+  OffsetNumber maxoff = entryvec->n - 1;
+
+  OffsetNumber *lists[3][2];
+
+  int counts[3][2] = { { 0, 0 }, { 0, 0 }, { 0, 0 } };
+
+  int best = -1;
+
+  double best_overlap = 0.0;
+
+  OffsetNumber *left, *right;
+
+  int nleft, nright;
+
+  struct geo_stbox pageunion;
+
+  OffsetNumber i;
+
+  instr_time start;
+
+  Size nbytes = (maxoff + 2) * sizeof(OffsetNumber);
+
+  geo_counter_start(&start);
+
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    lists[axis][0] = (OffsetNumber *) palloc(nbytes);
+    lists[axis][1] = (OffsetNumber *) palloc(nbytes);
+  }
+
+  memcpy(&pageunion, DatumGetGeoSTBoxTypeP(entryvec->vector[FirstOffsetNumber].key), sizeof(struct geo_stbox));
+
+  for(i = OffsetNumberNext(FirstOffsetNumber); i <= maxoff; i = OffsetNumberNext(i))
+    stbox_adjust(&pageunion, DatumGetGeoSTBoxTypeP(entryvec->vector[i].key));
+
+  for(i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+  {
+    struct geo_stbox *cur = DatumGetGeoSTBoxTypeP(entryvec->vector[i].key);
+
+    for(int axis = 0; axis < 3; ++axis)
+    {
+      double ulo, uhi, lo, hi;
+
+      stbox_axis(&pageunion, axis, &ulo, &uhi);
+      stbox_axis(cur, axis, &lo, &hi);
+
+      if((lo - ulo) < (uhi - hi))
+        lists[axis][0][counts[axis][0]++] = i;
+      else
+        lists[axis][1][counts[axis][1]++] = i;
+    }
+  }
+
+  for(int axis = 0; axis < 3; ++axis)
+  {
+    double overlap;
+
+    struct geo_stbox u0, u1;
+
+/* a split with an empty side is not a split */
+    if((counts[axis][0] == 0) || (counts[axis][1] == 0))
+      continue;
+
+    stbox_union_list(entryvec, lists[axis][0], counts[axis][0], &u0);
+    stbox_union_list(entryvec, lists[axis][1], counts[axis][1], &u1);
+
+    overlap = stbox_overlap_volume(&u0, &u1);
+
+    if((best == -1) ||
+       (Max(counts[axis][0], counts[axis][1]) < Max(counts[best][0], counts[best][1])) ||
+       ((Max(counts[axis][0], counts[axis][1]) == Max(counts[best][0], counts[best][1])) &&
+        (overlap < best_overlap)))
+    {
+      best = axis;
+      best_overlap = overlap;
+    }
+  }
+
+  if(best != -1)
+  {
+    left = lists[best][0]; nleft = counts[best][0];
+    right = lists[best][1]; nright = counts[best][1];
+  }
+  else
+  {
+/* all the entries are identical or nested: just split them in half */
+    nleft = nright = 0;
+
+    left = lists[0][0];
+    right = lists[0][1];
+
+    for(i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
+    {
+      if(i <= (maxoff + 1) / 2)
+        left[nleft++] = i;
+      else
+        right[nright++] = i;
+    }
+  }
+
+  v->spl_left = left;
+  v->spl_nleft = nleft;
+  v->spl_ldatum = stbox_split_side(entryvec, left, nleft);
+
+  v->spl_right = right;
+  v->spl_nright = nright;
+  v->spl_rdatum = stbox_split_side(entryvec, right, nright);
+
+  geo_counter_stop(GEO_COUNTER_GIST_PICKSPLIT, &start);
+
+  PG_RETURN_POINTER(v);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_stbox_gist_same);
+
+Datum
+geo_stbox_gist_same(PG_FUNCTION_ARGS)
+{
+  struct geo_stbox *first = PG_GETARG_GEOSTBOX_TYPE_P(0);
+
+  struct geo_stbox *second = PG_GETARG_GEOSTBOX_TYPE_P(1);
+
+  bool *result = (bool *) PG_GETARG_POINTER(2);
+
+  *result = stbox_same(first, second);
+
+  PG_RETURN_POINTER(result);
+}
+
+
+/*
+ * Nearest in space at a time: the distance of a key to the query is the
+ * distance in space if they share an instant. It is a lower bound for the
+ * entries below an inner node and exact on the leaves.
+ */
+PG_FUNCTION_INFO_V1(geo_stbox_gist_distance);
+
+Datum
+geo_stbox_gist_distance(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_stbox *query = PG_GETARG_GEOSTBOX_TYPE_P(1);
+
+  bool *recheck = (bool *) PG_GETARG_POINTER(4);
+
+  *recheck = false;
+
+  PG_RETURN_FLOAT8(stbox_distance(DatumGetGeoSTBoxTypeP(entry->key), query));
+}
+
+
+/*
+ * The extent of a trajectory overlaps the query whenever the trajectory
+ * does, and its distance is a lower bound: the heap tuples are rechecked
+ * with the exact operators.
+ */
+PG_FUNCTION_INFO_V1(geo_trajectory_gist_consistent);
+
+Datum
+geo_trajectory_gist_consistent(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_stbox *query = PG_GETARG_GEOSTBOX_TYPE_P(1);
+
+  StrategyNumber strategy = (StrategyNumber) PG_GETARG_UINT16(2);
+
+  bool *recheck = (bool *) PG_GETARG_POINTER(4);
+
+  geo_counter_add(GEO_COUNTER_GIST_CONSISTENT, 1);
+
+  if(strategy != RTOverlapStrategyNumber)
+    elog(ERROR, "unrecognized strategy number: %d", strategy);
+
+  *recheck = true;
+
+  PG_RETURN_BOOL(stbox_overlap(DatumGetGeoSTBoxTypeP(entry->key), query));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_trajectory_gist_distance);
+
+Datum
+geo_trajectory_gist_distance(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  struct geo_stbox *query = PG_GETARG_GEOSTBOX_TYPE_P(1);
+
+  bool *recheck = (bool *) PG_GETARG_POINTER(4);
+
+  *recheck = GIST_LEAF(entry);
+
+  PG_RETURN_FLOAT8(stbox_distance(DatumGetGeoSTBoxTypeP(entry->key), query));
+}
+
+
+PG_FUNCTION_INFO_V1(geo_trajectory_gist_compress);
+
+Datum
+geo_trajectory_gist_compress(PG_FUNCTION_ARGS)
+{
+  GISTENTRY *entry = (GISTENTRY *) PG_GETARG_POINTER(0);
+
+  GISTENTRY *retval = entry;
+
+  if(entry->leafkey)
+  {
+    ArrayType *traj = DatumGetArrayTypeP(entry->key);
+
+    struct geo_stbox *stbox = (struct geo_stbox*) palloc(sizeof(struct geo_stbox));
+
+/*
+ * an empty trajectory gets an inverted box: it does not overlap anything
+ * and leaves the unions unchanged
+ */
+    if(!geo_trajectory_extent(traj, stbox))
+    {
+      stbox->box.low.x = stbox->box.low.y = get_float8_infinity();
+      stbox->box.high.x = stbox->box.high.y = -get_float8_infinity();
+      stbox->tmin = DT_NOEND;
+      stbox->tmax = DT_NOBEGIN;
+    }
+
+    retval = (GISTENTRY *) palloc(sizeof(GISTENTRY));
+
+    gistentryinit(*retval, PointerGetDatum(stbox),
+                  entry->rel, entry->page, entry->offset, false);
+  }
+
+  PG_RETURN_POINTER(retval);
+}
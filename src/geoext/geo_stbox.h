@@ -0,0 +1,112 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_stbox.h
+ *
+ * \brief A geo_stbox is a spatio-temporal box: a geo_box and a time interval.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_STBOX_H__
+#define __GEOEXT_GEO_STBOX_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+#include <utils/timestamp.h>
+
+/* GeoExt */
+#include "geo_box.h"
+
+
+/*
+ * A geo_stbox bounds a set of positions in space and time.
+ *
+ * It is the key of the spatio-temporal GiST opclasses: a fix (a geo_point
+ * at a timestamp) has a degenerate geo_stbox and a trajectory is indexed
+ * by the extent of its fixes.
+ *
+ * It is a fixed-size data type in PostgreSQL with a double-alignment.
+ *
+ */
+struct geo_stbox
+{
+  struct geo_box box;  /* Spatial extent.                 */
+  Timestamp tmin;      /* Temporal extent: [tmin, tmax]. */
+  Timestamp tmax;
+};
+
+
+/*
+ * geo_stbox is a fixed-size pass-by-reference type.
+ *
+ * Below we have the fmgr interface macros for dealing with a geo_stbox.
+ *
+ */
+#define DatumGetGeoSTBoxTypeP(X)      ((struct geo_stbox*) DatumGetPointer(X))
+#define PG_GETARG_GEOSTBOX_TYPE_P(n)  DatumGetGeoSTBoxTypeP(PG_GETARG_DATUM(n))
+#define PG_RETURN_GEOSTBOX_TYPE_P(x)  PG_RETURN_POINTER(x)
+
+
+/*
+ * geo_stbox operations.
+ *
+ */
+extern Datum geo_stbox_in(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_out(PG_FUNCTION_ARGS);
+
+extern Datum geo_stbox_make(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_from_point(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_from_trajectory(PG_FUNCTION_ARGS);
+
+extern Datum geo_stbox_overlap(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_contain(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_contained(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_same(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_distance(PG_FUNCTION_ARGS);
+
+extern Datum geo_trajectory_stbox_overlap(PG_FUNCTION_ARGS);
+extern Datum geo_trajectory_stbox_distance(PG_FUNCTION_ARGS);
+
+
+/*
+ * R-tree GiST index support (the keys are geo_stbox)
+ *
+ */
+extern Datum geo_stbox_gist_consistent(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_gist_union(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_gist_penalty(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_gist_picksplit(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_gist_same(PG_FUNCTION_ARGS);
+extern Datum geo_stbox_gist_distance(PG_FUNCTION_ARGS);
+extern Datum geo_trajectory_gist_consistent(PG_FUNCTION_ARGS);
+extern Datum geo_trajectory_gist_distance(PG_FUNCTION_ARGS);
+extern Datum geo_trajectory_gist_compress(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_STBOX_H__ */
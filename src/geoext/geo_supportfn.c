@@ -0,0 +1,406 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_supportfn.c
+ *
+ * \brief Planner support functions for spatial predicates.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/*
+ * contains() and dwithin() are plain functions, so the planner can not use
+ * an index for them by itself. The support functions below answer the
+ * planner requests:
+ *
+ * - SupportRequestIndexCondition: if an argument is the key of a GiST index
+ *   built with one of our opclasses, we return an "&&" condition between the
+ *   indexed column and a box computed from the other arguments. The condition
+ *   is lossy, so the planner keeps the original call as a recheck.
+ *
+ * - SupportRequestSelectivity: estimated from the grid histogram of the
+ *   column (see geo_selfuncs.c).
+ *
+ * - SupportRequestCost: the cost of the point in polygon test grows with
+ *   the number of vertices of the polygon.
+ *
+ */
+
+/* GeoExtension */
+#include "geo_supportfn.h"
+#include "geo_box.h"
+#include "geo_point.h"
+#include "geo_polygon.h"
+#include "geo_selfuncs.h"
+#include "algorithms.h"
+
+
+/* PostgreSQL */
+#include <catalog/pg_am.h>
+#include <catalog/pg_type.h>
+#include <nodes/makefuncs.h>
+#include <nodes/nodeFuncs.h>
+#include <nodes/pathnodes.h>
+#include <nodes/supportnodes.h>
+#include <nodes/value.h>
+#include <optimizer/optimizer.h>
+#include <parser/parse_func.h>
+#include <utils/lsyscache.h>
+#include <utils/selfuncs.h>
+
+
+/* C Standard Library */
+#include <math.h>
+
+
+/*
+ * Auxiliary functions.
+ */
+
+/*
+ * Looks for a function with the given name and argument types in the
+ * schema of another function of this extension.
+ */
+static Oid
+geo_lookup_function(Oid sibling, const char *name, int nargs, const Oid *argtypes)
+{
+  char *nspname = get_namespace_name(get_func_namespace(sibling));
+
+  List *qualname = list_make2(makeString(nspname), makeString(pstrdup(name)));
+
+  return LookupFuncName(qualname, nargs, argtypes, true);
+}
+
+
+/*
+ * Builds the index condition "indexarg && boxfunc(boxargs)".
+ *
+ * The operator is taken from the opfamily of the index column, so that we
+ * only answer for our R-tree GiST opclasses.
+ */
+static List*
+geo_make_overlap_indexqual(SupportRequestIndexCondition *req, Node *indexarg,
+                           const char *boxfunc, List *boxargs)
+{
+  Oid argtypes[2];
+
+  int nargs = 0;
+
+  ListCell *lc;
+
+  Oid funcid, boxtype, opno;
+
+  Expr *boxexpr;
+
+  Assert(list_length(boxargs) <= 2);
+
+  if (req->index->relam != GIST_AM_OID)
+    return NIL;
+
+  foreach(lc, boxargs)
+    argtypes[nargs++] = exprType((Node *) lfirst(lc));
+
+  funcid = geo_lookup_function(req->funcid, boxfunc, nargs, argtypes);
+
+  if (!OidIsValid(funcid))
+    return NIL;
+
+  boxtype = get_func_rettype(funcid);
+
+  opno = get_opfamily_member(req->opfamily, req->index->opcintype[req->indexcol],
+                             boxtype, RTOverlapStrategyNumber);
+
+  if (!OidIsValid(opno))
+    return NIL;
+
+  boxexpr = (Expr *) makeFuncExpr(funcid, boxtype, boxargs,
+                                  InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+
+  req->lossy = true;
+
+  return list_make1(make_opclause(opno, BOOLOID, false,
+                                  (Expr *) indexarg, boxexpr,
+                                  InvalidOid, InvalidOid));
+}
+
+
+/*
+ * Estimates the fraction of rows for which "var && box(constant)" holds,
+ * with the box enlarged by expand_by on each side.
+ *
+ * *varonleft and *constval tell the caller where the variable is and the
+ * value of the constant, so that it can refine the estimate.
+ */
+static Selectivity
+geo_bbox_selectivity(PlannerInfo *root, Oid funcid, Node *left, Node *right, int varRelid,
+                     double expand_by, bool *varonleft, Datum *constval)
+{
+  VariableStatData vardata;
+
+  Node *other = NULL;
+
+  struct geo_box query;
+
+  Selectivity selec;
+
+  if (!get_restriction_variable(root, list_make2(left, right), varRelid,
+                                &vardata, &other, varonleft))
+    return GEOEXT_DEFAULT_SEL;
+
+  if (!IsA(other, Const))
+  {
+    ReleaseVariableStats(vardata);
+    return GEOEXT_DEFAULT_SEL;
+  }
+
+  if (((Const *) other)->constisnull)
+  {
+    ReleaseVariableStats(vardata);
+    return 0.0;
+  }
+
+  *constval = ((Const *) other)->constvalue;
+
+  if (!geo_datum_bbox(*constval, geo_datum_kind(((Const *) other)->consttype, funcid), &query))
+  {
+    ReleaseVariableStats(vardata);
+    return GEOEXT_DEFAULT_SEL;
+  }
+
+  query.high.x += expand_by;
+  query.high.y += expand_by;
+  query.low.x -= expand_by;
+  query.low.y -= expand_by;
+
+  selec = geo_estimate_selectivity(&vardata, RTOverlapStrategyNumber, &query);
+
+  ReleaseVariableStats(vardata);
+
+  return selec;
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_contains_support);
+
+Datum
+geo_polygon_contains_support(PG_FUNCTION_ARGS)
+{
+  Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+  if (IsA(rawreq, SupportRequestIndexCondition))
+  {
+    SupportRequestIndexCondition *req = (SupportRequestIndexCondition *) rawreq;
+
+    List *args = NIL;
+
+    Node *indexarg, *other;
+
+    if (!IsA(req->node, FuncExpr))
+      PG_RETURN_POINTER(NULL);
+
+    args = ((FuncExpr *) req->node)->args;
+
+    if (list_length(args) != 2)
+      PG_RETURN_POINTER(NULL);
+
+    indexarg = (Node *) list_nth(args, req->indexarg);
+    other = (Node *) list_nth(args, 1 - req->indexarg);
+
+    if (!is_pseudo_constant_for_index(req->root, other, req->index))
+      PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(geo_make_overlap_indexqual(req, indexarg, "bbox",
+                                                 list_make1(other)));
+  }
+
+  if (IsA(rawreq, SupportRequestSelectivity))
+  {
+    SupportRequestSelectivity *req = (SupportRequestSelectivity *) rawreq;
+
+    bool varonleft = true;
+
+    Datum constval = (Datum) 0;
+
+/* no statistics for joins yet: use the same default of the operators */
+    if (req->is_join || list_length(req->args) != 2)
+    {
+      req->selectivity = GEOEXT_DEFAULT_SEL;
+      PG_RETURN_POINTER(req);
+    }
+
+    req->selectivity = geo_bbox_selectivity(req->root, req->funcid,
+                                            linitial(req->args), lsecond(req->args),
+                                            req->varRelid, 0.0,
+                                            &varonleft, &constval);
+
+/*
+  points inside the bounding box of a constant polygon: assume they are
+  evenly spread, so only a fraction area(polygon) / area(box) is inside it
+ */
+    if (!varonleft && constval != (Datum) 0)
+    {
+      struct geo_polygon *poly = DatumGetGeoPolygonTypeP(constval);
+
+      struct geo_box box;
+
+      double box_area;
+
+      mbr(poly->coords, poly->npts, &box.low, &box.high);
+
+      box_area = (box.high.x - box.low.x) * (box.high.y - box.low.y);
+
+      if (box_area > 0.0 && poly->npts >= 4)
+        req->selectivity *= Min(1.0, area(poly->coords, poly->npts) / box_area);
+    }
+
+    CLAMP_PROBABILITY(req->selectivity);
+
+    PG_RETURN_POINTER(req);
+  }
+
+  if (IsA(rawreq, SupportRequestCost))
+  {
+    SupportRequestCost *req = (SupportRequestCost *) rawreq;
+
+    Node *polyarg;
+
+    struct geo_polygon *poly;
+
+    if (req->node == NULL || !IsA(req->node, FuncExpr))
+      PG_RETURN_POINTER(NULL);
+
+    polyarg = (Node *) linitial(((FuncExpr *) req->node)->args);
+
+/* only a constant polygon tells us its number of vertices */
+    if (!IsA(polyarg, Const) || ((Const *) polyarg)->constisnull)
+      PG_RETURN_POINTER(NULL);
+
+    poly = DatumGetGeoPolygonTypeP(((Const *) polyarg)->constvalue);
+
+    req->startup = 0.0;
+    req->per_tuple = poly->npts * cpu_operator_cost;
+
+    PG_RETURN_POINTER(req);
+  }
+
+  PG_RETURN_POINTER(NULL);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_dwithin_support);
+
+Datum
+geo_point_dwithin_support(PG_FUNCTION_ARGS)
+{
+  Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+  if (IsA(rawreq, SupportRequestIndexCondition))
+  {
+    SupportRequestIndexCondition *req = (SupportRequestIndexCondition *) rawreq;
+
+    List *args = NIL;
+
+    Node *indexarg, *other, *radius;
+
+    if (!IsA(req->node, FuncExpr))
+      PG_RETURN_POINTER(NULL);
+
+    args = ((FuncExpr *) req->node)->args;
+
+    if (list_length(args) != 3 || req->indexarg > 1)
+      PG_RETURN_POINTER(NULL);
+
+    indexarg = (Node *) list_nth(args, req->indexarg);
+    other = (Node *) list_nth(args, 1 - req->indexarg);
+    radius = (Node *) lthird(args);
+
+    if (!is_pseudo_constant_for_index(req->root, other, req->index) ||
+        !is_pseudo_constant_for_index(req->root, radius, req->index))
+      PG_RETURN_POINTER(NULL);
+
+    PG_RETURN_POINTER(geo_make_overlap_indexqual(req, indexarg, "expand",
+                                                 list_make2(other, radius)));
+  }
+
+  if (IsA(rawreq, SupportRequestSelectivity))
+  {
+    SupportRequestSelectivity *req = (SupportRequestSelectivity *) rawreq;
+
+    Node *radius;
+
+    bool varonleft = true;
+
+    Datum constval = (Datum) 0;
+
+    if (req->is_join || list_length(req->args) != 3)
+    {
+      req->selectivity = GEOEXT_DEFAULT_SEL;
+      PG_RETURN_POINTER(req);
+    }
+
+    radius = estimate_expression_value(req->root, (Node *) lthird(req->args));
+
+    if (!IsA(radius, Const) || ((Const *) radius)->constisnull)
+    {
+      req->selectivity = GEOEXT_DEFAULT_SEL;
+      PG_RETURN_POINTER(req);
+    }
+
+/* the circle covers pi/4 of its bounding square */
+    req->selectivity = (M_PI / 4.0) *
+                       geo_bbox_selectivity(req->root, req->funcid,
+                                            linitial(req->args), lsecond(req->args),
+                                            req->varRelid,
+                                            DatumGetFloat8(((Const *) radius)->constvalue),
+                                            &varonleft, &constval);
+
+    CLAMP_PROBABILITY(req->selectivity);
+
+    PG_RETURN_POINTER(req);
+  }
+
+  PG_RETURN_POINTER(NULL);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_cpoint_support);
+
+Datum
+geo_cpoint_support(PG_FUNCTION_ARGS)
+{
+  Node *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+  if (IsA(rawreq, SupportRequestSimplify))
+  {
+    SupportRequestSimplify *req = (SupportRequestSimplify *) rawreq;
+
+    geo_cpoint_check_args(req->fcall->args);
+  }
+
+  PG_RETURN_POINTER(NULL);
+}
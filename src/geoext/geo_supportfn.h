@@ -0,0 +1,78 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_supportfn.h
+ *
+ * \brief Planner support functions for spatial predicates.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+
+#ifndef __GEOEXT_GEO_SUPPORTFN_H__
+#define __GEOEXT_GEO_SUPPORTFN_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+
+/*
+ * Planner support for contains(geo_polygon, geo_point).
+ *
+ * When one of the arguments is an indexed column and the other one is a
+ * constant (or a value from the outer side of a nested loop), the call is
+ * turned into a lossy "&&" index condition against the bounding box of the
+ * other argument. The original call is kept as a recheck filter.
+ *
+ * It also provides selectivity and cost estimates.
+ *
+ */
+extern Datum geo_polygon_contains_support(PG_FUNCTION_ARGS);
+
+
+/*
+ * Planner support for dwithin(geo_point, geo_point, float8).
+ *
+ * The call is turned into "indexed_point && expand(other_point, r)".
+ *
+ */
+extern Datum geo_point_dwithin_support(PG_FUNCTION_ARGS);
+
+
+/*
+ * Planner support for the comparisons and distance() of geo_cpoint.
+ *
+ * On SupportRequestSimplify the typmods of the two arguments are checked,
+ * so a query mixing two SRIDs fails at plan time, even if the call is only
+ * used as an index condition and never evaluated.
+ *
+ */
+extern Datum geo_cpoint_support(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_SUPPORTFN_H__ */
@@ -0,0 +1,170 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_transform.c
+ *
+ * \brief Coordinate transformation between the built-in projections.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+/* GeoExt */
+#include "geo_transform.h"
+#include "algorithms.h"
+#include "geo_linestring.h"
+#include "geo_point.h"
+#include "geo_polygon.h"
+
+
+/*
+ * The parameters of the projections used by this backend, looked up by
+ * SRID. The series coefficients are computed once per SRID.
+ */
+#define GEO_PROJECTION_CACHE_SIZE 16
+
+static struct geo_projection geo_projection_cache[GEO_PROJECTION_CACHE_SIZE];
+
+static int geo_projection_cache_used = 0;
+
+static int geo_projection_cache_next = 0;
+
+
+/*
+ * Copies the parameters of a projection to proj. The copy stays valid when
+ * a later lookup replaces the cache entry; an SRID that is not supported
+ * never enters the cache.
+ */
+static void
+geo_projection_lookup(int32 srid, struct geo_projection *proj)
+{
+  for (int i = 0; i < geo_projection_cache_used; ++i)
+  {
+    if (geo_projection_cache[i].srid == srid)
+    {
+      *proj = geo_projection_cache[i];
+      return;
+    }
+  }
+
+  if (!geo_projection_init(proj, srid))
+  {
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+             errmsg("SRID %d is not supported by transform", srid),
+             errhint("The supported SRIDs are 4326, 3857, 4087 and the WGS84 UTM zones (32601-32660, 32701-32760).")));
+  }
+
+/* round-robin replacement once the cache is full */
+  geo_projection_cache[geo_projection_cache_next] = *proj;
+
+  geo_projection_cache_next = (geo_projection_cache_next + 1) % GEO_PROJECTION_CACHE_SIZE;
+
+  if (geo_projection_cache_used < GEO_PROJECTION_CACHE_SIZE)
+    ++geo_projection_cache_used;
+}
+
+
+/*
+ * Converts the coordinates in place, through longitude and latitude.
+ */
+static void
+geo_transform_coords(int32 srid, int32 target_srid, struct coord2d *coords, int npts)
+{
+  struct geo_projection from;
+  struct geo_projection to;
+
+  if (srid == target_srid)
+    return;
+
+  geo_projection_lookup(srid, &from);
+  geo_projection_lookup(target_srid, &to);
+
+  geo_projection_inverse(&from, coords, npts);
+
+  geo_projection_forward(&to, coords, npts);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_point_transform);
+
+Datum
+geo_point_transform(PG_FUNCTION_ARGS)
+{
+  struct geo_point *pt = PG_GETARG_GEOPOINT_TYPE_P(0);
+
+  int32 target_srid = PG_GETARG_INT32(1);
+
+  struct geo_point *result = (struct geo_point*) palloc(sizeof(struct geo_point));
+
+  *result = *pt;
+
+  geo_transform_coords(pt->srid, target_srid, &result->coord, 1);
+
+  result->srid = target_srid;
+
+  PG_RETURN_GEOPOINT_TYPE_P(result);
+}
+
+
+/*
+ * geo_linestring and geo_polygon share their layout: the copy made by the
+ * detoast is converted in place.
+ */
+
+PG_FUNCTION_INFO_V1(geo_linestring_transform);
+
+Datum
+geo_linestring_transform(PG_FUNCTION_ARGS)
+{
+  struct geo_linestring *line = (struct geo_linestring*) PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(0));
+
+  int32 target_srid = PG_GETARG_INT32(1);
+
+  geo_transform_coords(line->srid, target_srid, line->coords, line->npts);
+
+  line->srid = target_srid;
+
+  PG_RETURN_GEOLINESTRING_TYPE_P(line);
+}
+
+
+PG_FUNCTION_INFO_V1(geo_polygon_transform);
+
+Datum
+geo_polygon_transform(PG_FUNCTION_ARGS)
+{
+  struct geo_polygon *poly = (struct geo_polygon*) PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(0));
+
+  int32 target_srid = PG_GETARG_INT32(1);
+
+  geo_transform_coords(poly->srid, target_srid, poly->coords, poly->npts);
+
+  poly->srid = target_srid;
+
+  PG_RETURN_GEOPOLYGON_TYPE_P(poly);
+}
@@ -0,0 +1,55 @@
+/*
+  Copyright (C) 2017 National Institute For Space Research (INPE) - Brazil.
+
+  This file is part of pg_geoext, a simple PostgreSQL extension for
+  for teaching spatial database classes.
+
+  pg_geoext is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 3 as
+  published by the Free Software Foundation.
+
+  pg_geoext is distributed  "AS-IS" in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY OF ANY KIND; without even the implied warranty
+  of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+  GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with pg_geoext. See LICENSE. If not, write to
+  Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
+ */
+
+/*!
+ *
+ * \file geoext/geo_transform.h
+ *
+ * \brief Coordinate transformation between the built-in projections.
+ *
+ * \author Gilberto Ribeiro de Queiroz
+ * \author Fabiana Zioti
+ *
+ * \date 2017
+ *
+ * \copyright GNU Lesser Public License version 3
+ *
+ */
+
+#ifndef __GEOEXT_GEO_TRANSFORM_H__
+#define __GEOEXT_GEO_TRANSFORM_H__
+
+/* PostgreSQL */
+#include <postgres.h>
+#include <fmgr.h>
+
+
+/*
+ * transform(geometry, srid) converts the coordinates between WGS84
+ * longitude and latitude (4326), Web Mercator (3857), the WGS84 UTM zones
+ * (326xx and 327xx) and the World Equidistant Cylindrical (4087), with the
+ * kernels of algorithms.c. No external projection library is used.
+ *
+ */
+extern Datum geo_point_transform(PG_FUNCTION_ARGS);
+extern Datum geo_linestring_transform(PG_FUNCTION_ARGS);
+extern Datum geo_polygon_transform(PG_FUNCTION_ARGS);
+
+#endif  /* __GEOEXT_GEO_TRANSFORM_H__ */
@@ -24,6 +24,37 @@
 \echo Use "CREATE EXTENSION geoext" to load this file. \quit
 
 
+--
+-- Note on function attributes:
+--
+-- The C functions below are IMMUTABLE STRICT PARALLEL SAFE unless stated
+-- otherwise: their result only depends on their arguments. Some keep
+-- backend-local caches keyed by their arguments (the projections of
+-- transform(), the prepared polygons of contains()) or bump the counters
+-- of geoext_stats; neither changes a result. The exceptions are:
+--   - to_str(): STABLE, they depend on geoext.wkt_precision;
+--   - geoext_pin_fences() and geoext_unpin_fences(): VOLATILE PARALLEL
+--     UNSAFE, they write shared memory; geoext_unpin_fences() takes no
+--     argument and is not STRICT;
+--   - fence_hits(): VOLATILE PARALLEL RESTRICTED, it may reload the
+--     pinned fences through SPI;
+--   - geoext_stats() and geoext_stats_reset(): VOLATILE PARALLEL
+--     RESTRICTED, they read and reset the counters.
+-- Functions called only by the server (typanalyze, selectivity, GiST and
+-- planner support, triggers) omit the volatility.
+--
+-- COST is given in units of cpu_operator_cost. The values are order of
+-- magnitude estimates, not measurements of each function:
+--   1 (default): fixed-size comparisons and constructors;
+--   5-10: text I/O of fixed-size types, small constant work on varlenas;
+--   20-50: a pass over the vertices of a geo_linestring or geo_polygon;
+--   500: pairwise segment tests (quadratic in the number of vertices).
+-- bench_algorithms (build/cmake) gives 0.5 to 2 ns per vertex for length,
+-- area and point_in_polygon, so a pass over a few hundred vertices takes
+-- about as long as 20 to 50 calls of a fixed-size comparison operator.
+--
+
+
 ----------------------------------------
 ----------------------------------------
 -- Introduces the geo_point Data Type --
@@ -40,25 +71,46 @@ CREATE TYPE geo_point;
 --
 -- Point Input/Output Functions
 --
-CREATE OR REPLACE FUNCTION geo_point_in(cstring)
+CREATE OR REPLACE FUNCTION geo_point_in(cstring, oid, int4)
     RETURNS geo_point
     AS 'MODULE_PATHNAME', 'geo_point_in'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
 
 CREATE OR REPLACE FUNCTION geo_point_out(geo_point)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_point_out'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
 
-CREATE OR REPLACE FUNCTION geo_point_recv(internal)
+CREATE OR REPLACE FUNCTION geo_point_recv(internal, oid, int4)
     RETURNS geo_point
     AS 'MODULE_PATHNAME','geo_point_recv'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_point_send(geo_point)
     RETURNS bytea
     AS 'MODULE_PATHNAME', 'geo_point_send'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_analyze(internal)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_point_analyze'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+
+--
+-- The typmod of the point columns is their SRID, as in geo_point(4326)
+--
+CREATE OR REPLACE FUNCTION geo_srid_typmod_in(cstring[])
+    RETURNS int4
+    AS 'MODULE_PATHNAME', 'geo_srid_typmod_in'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_srid_typmod_out(int4)
+    RETURNS cstring
+    AS 'MODULE_PATHNAME', 'geo_srid_typmod_out'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 
 --
@@ -67,59 +119,63 @@ CREATE OR REPLACE FUNCTION geo_point_send(geo_point)
 CREATE OR REPLACE FUNCTION point_from_text(cstring)
     RETURNS geo_point
     AS 'MODULE_PATHNAME', 'geo_point_from_text'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
 
+-- The to_str() functions are STABLE: their text depends on the setting
+-- geoext.wkt_precision.
 CREATE OR REPLACE FUNCTION to_str(geo_point)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_point_to_str'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C STABLE STRICT PARALLEL SAFE
+    COST 10;
 
 CREATE OR REPLACE FUNCTION distance(geo_point, geo_point)
     RETURNS float8
     AS 'MODULE_PATHNAME', 'geo_point_distance'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION same_position(record, cstring, geo_point)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_point_same_position'
-    LANGUAGE C;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 --
 -- Point Operators to interface to B-tree
 --
 CREATE OR REPLACE FUNCTION geo_point_cmp(geo_point, geo_point)
     RETURNS int4
     AS 'MODULE_PATHNAME', 'geo_point_cmp'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_point_eq(geo_point, geo_point)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_point_eq'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_point_ne(geo_point, geo_point)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_point_ne'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_point_lt(geo_point, geo_point)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_point_lt'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_point_gt(geo_point, geo_point)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_point_gt'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_point_le(geo_point, geo_point)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_point_le'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_point_ge(geo_point, geo_point)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_point_ge'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 
 --
@@ -131,11 +187,50 @@ CREATE TYPE geo_point
     output = geo_point_out,
     receive = geo_point_recv,
     send = geo_point_send,
+    typmod_in = geo_srid_typmod_in,
+    typmod_out = geo_srid_typmod_out,
+    analyze = geo_point_analyze,
     internallength = 24,
     alignment = double
 );
 
 
+--
+-- Storing a value in a geo_point(srid) column checks its SRID
+--
+CREATE OR REPLACE FUNCTION geo_point(geo_point, int4, bool)
+    RETURNS geo_point
+    AS 'MODULE_PATHNAME', 'geo_point_enforce_typmod'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE CAST (geo_point AS geo_point)
+    WITH FUNCTION geo_point(geo_point, int4, bool) AS IMPLICIT;
+
+
+--
+-- Geodesic distances for longitude and latitude coordinates, in meters:
+-- on a sphere (haversine, the mean Earth radius by default) and on the
+-- WGS84 ellipsoid (Karney's method, which converges for every pair of
+-- points and is accurate to a few nanometres). The array variant returns
+-- the distances from a point to each element, NULL for the NULL elements.
+--
+CREATE OR REPLACE FUNCTION distance_sphere(geo_point, geo_point, radius float8 DEFAULT 6371008.8)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_point_distance_sphere'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION distance_sphere(geo_point, geo_point[], radius float8 DEFAULT 6371008.8)
+    RETURNS float8[]
+    AS 'MODULE_PATHNAME', 'geo_point_distance_sphere_array'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION distance_spheroid(geo_point, geo_point)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_point_distance_spheroid'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+
 --
 -- Create operators to interface geo_point to B-tree index
 --
@@ -219,6 +314,229 @@ CREATE OPERATOR CLASS btree_geo_point_ops
         FUNCTION        1       geo_point_cmp(geo_point, geo_point);
 
 
+------------------------------------------
+------------------------------------------
+-- Introduces the geo_cpoint Data Type --
+------------------------------------------
+------------------------------------------
+
+--
+-- A geo_cpoint is a geo_point that keeps only its coordinates (16 bytes
+-- instead of 24): the SRID is the typmod of the column, e.g.
+--
+--   CREATE TABLE fixes (id int8, location geo_cpoint(4326));
+--
+-- Inserting a geo_point checks its SRID against the column, and a
+-- geo_cpoint column is read as a geo_point with the SRID of the column.
+-- A geo_cpoint whose SRID is not known, such as the result of a function,
+-- must be cast explicitly to geo_cpoint(srid) before it is stored in a
+-- column or read as a geo_point; otherwise it is an error.
+--
+-- The comparisons and distance() of two geo_cpoint check the typmods of
+-- their arguments: mixing two columns with different SRIDs is an error,
+-- raised when the query is planned.
+--
+CREATE TYPE geo_cpoint;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_in(cstring, oid, int4)
+    RETURNS geo_cpoint
+    AS 'MODULE_PATHNAME', 'geo_cpoint_in'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_out(geo_cpoint)
+    RETURNS cstring
+    AS 'MODULE_PATHNAME', 'geo_cpoint_out'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_recv(internal)
+    RETURNS geo_cpoint
+    AS 'MODULE_PATHNAME', 'geo_cpoint_recv'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_send(geo_cpoint)
+    RETURNS bytea
+    AS 'MODULE_PATHNAME', 'geo_cpoint_send'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_analyze(internal)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_point_analyze'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE TYPE geo_cpoint
+(
+    input = geo_cpoint_in,
+    output = geo_cpoint_out,
+    receive = geo_cpoint_recv,
+    send = geo_cpoint_send,
+    typmod_in = geo_srid_typmod_in,
+    typmod_out = geo_srid_typmod_out,
+    analyze = geo_cpoint_analyze,
+    internallength = 16,
+    alignment = double
+);
+
+
+--
+-- Casts: the SRID moves between the value and the typmod
+--
+CREATE OR REPLACE FUNCTION geo_cpoint(geo_cpoint, int4, bool)
+    RETURNS geo_cpoint
+    AS 'MODULE_PATHNAME', 'geo_cpoint_enforce_typmod'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint(geo_point, int4, bool)
+    RETURNS geo_cpoint
+    AS 'MODULE_PATHNAME', 'geo_cpoint_from_geo_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point(geo_cpoint)
+    RETURNS geo_point
+    AS 'MODULE_PATHNAME', 'geo_cpoint_to_geo_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE CAST (geo_cpoint AS geo_cpoint)
+    WITH FUNCTION geo_cpoint(geo_cpoint, int4, bool) AS IMPLICIT;
+
+CREATE CAST (geo_point AS geo_cpoint)
+    WITH FUNCTION geo_cpoint(geo_point, int4, bool) AS ASSIGNMENT;
+
+CREATE CAST (geo_cpoint AS geo_point)
+    WITH FUNCTION geo_point(geo_cpoint) AS IMPLICIT;
+
+
+--
+-- Compact Point Operators
+--
+CREATE OR REPLACE FUNCTION geo_cpoint_support(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_cpoint_support'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION distance(geo_cpoint, geo_cpoint)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_cpoint_distance'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_cmp(geo_cpoint, geo_cpoint)
+    RETURNS int4
+    AS 'MODULE_PATHNAME', 'geo_cpoint_cmp'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_eq(geo_cpoint, geo_cpoint)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_cpoint_eq'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_ne(geo_cpoint, geo_cpoint)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_cpoint_ne'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_lt(geo_cpoint, geo_cpoint)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_cpoint_lt'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_gt(geo_cpoint, geo_cpoint)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_cpoint_gt'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_le(geo_cpoint, geo_cpoint)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_cpoint_le'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_ge(geo_cpoint, geo_cpoint)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_cpoint_ge'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_cpoint_support;
+
+CREATE OPERATOR =
+(
+    LEFTARG = geo_cpoint,
+    RIGHTARG = geo_cpoint,
+    PROCEDURE = geo_cpoint_eq,
+    COMMUTATOR = '=',
+    NEGATOR = '<>',
+    RESTRICT = eqsel,
+    JOIN = eqjoinsel
+);
+
+CREATE OPERATOR <>
+(
+    LEFTARG = geo_cpoint,
+    RIGHTARG = geo_cpoint,
+    PROCEDURE = geo_cpoint_ne,
+    COMMUTATOR = '<>',
+    NEGATOR = '=',
+    RESTRICT = neqsel,
+    JOIN = neqjoinsel
+);
+
+CREATE OPERATOR <
+(
+    LEFTARG = geo_cpoint,
+    RIGHTARG = geo_cpoint,
+    PROCEDURE = geo_cpoint_lt,
+    COMMUTATOR = >,
+    NEGATOR = >=,
+    RESTRICT = scalarltsel,
+    JOIN = scalarltjoinsel
+);
+
+CREATE OPERATOR >
+(
+    LEFTARG = geo_cpoint,
+    RIGHTARG = geo_cpoint,
+    PROCEDURE = geo_cpoint_gt,
+    COMMUTATOR = <,
+    NEGATOR = <=,
+    RESTRICT = scalargtsel,
+    JOIN = scalargtjoinsel
+);
+
+CREATE OPERATOR <=
+(
+    LEFTARG = geo_cpoint,
+    RIGHTARG = geo_cpoint,
+    PROCEDURE = geo_cpoint_le,
+    COMMUTATOR = >=,
+    NEGATOR = >,
+    RESTRICT = scalarlesel,
+    JOIN = scalarlejoinsel
+);
+
+CREATE OPERATOR >=
+(
+    LEFTARG = geo_cpoint,
+    RIGHTARG = geo_cpoint,
+    PROCEDURE = geo_cpoint_ge,
+    COMMUTATOR = <=,
+    NEGATOR = <,
+    RESTRICT = scalargesel,
+    JOIN = scalargejoinsel
+);
+
+CREATE OPERATOR CLASS btree_geo_cpoint_ops
+    DEFAULT FOR TYPE geo_cpoint USING btree AS
+        OPERATOR        1       <  ,
+        OPERATOR        2       <= ,
+        OPERATOR        3       =  ,
+        OPERATOR        4       >= ,
+        OPERATOR        5       >  ,
+        FUNCTION        1       geo_cpoint_cmp(geo_cpoint, geo_cpoint);
+
+
 ---------------------------------------------
 ---------------------------------------------
 -- ??????????????????????????????????????? --
@@ -253,22 +571,26 @@ CREATE TYPE geo_linestring;
 CREATE OR REPLACE FUNCTION geo_linestring_in(cstring)
     RETURNS geo_linestring
     AS 'MODULE_PATHNAME', 'geo_linestring_in'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION geo_linestring_out(geo_linestring)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_linestring_out'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION geo_linestring_recv(internal)
     RETURNS geo_linestring
     AS 'MODULE_PATHNAME','geo_linestring_recv'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
 
 CREATE OR REPLACE FUNCTION geo_linestring_send(geo_linestring)
     RETURNS bytea
     AS 'MODULE_PATHNAME', 'geo_linestring_send'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
 
 
 --
@@ -277,54 +599,124 @@ CREATE OR REPLACE FUNCTION geo_linestring_send(geo_linestring)
 CREATE OR REPLACE FUNCTION linestring_from_text(cstring)
     RETURNS geo_linestring
     AS 'MODULE_PATHNAME', 'geo_linestring_from_text'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION to_str(geo_linestring)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_linestring_to_str'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C STABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION is_closed(geo_linestring)
     RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_linestring_is_closed'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION length(geo_linestring)
     RETURNS float8
     AS 'MODULE_PATHNAME', 'geo_linestring_length'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+-- the length in meters of a line of longitude and latitude coordinates
+CREATE OR REPLACE FUNCTION length_sphere(geo_linestring, radius float8 DEFAULT 6371008.8)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_linestring_length_sphere'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+--
+-- Simplification: simplify() is Douglas-Peucker, the tolerance is a
+-- distance; simplify_vw() is Visvalingam-Whyatt, the tolerance is an area.
+-- Both keep the end points.
+--
+CREATE OR REPLACE FUNCTION simplify(geo_linestring, tolerance float8)
+    RETURNS geo_linestring
+    AS 'MODULE_PATHNAME', 'geo_linestring_simplify'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100;
+
+CREATE OR REPLACE FUNCTION simplify_vw(geo_linestring, tolerance float8)
+    RETURNS geo_linestring
+    AS 'MODULE_PATHNAME', 'geo_linestring_simplify_vw'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100;
 
 CREATE OR REPLACE FUNCTION linestring_make_v2(geo_point_pair)
     RETURNS geo_linestring
     AS 'MODULE_PATHNAME', 'geo_linestring_make_v2'
-    LANGUAGE C STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION boundary_v1(geo_linestring)
     RETURNS geo_point_pair
     AS 'MODULE_PATHNAME', 'geo_linestring_boundary_v1'
-    LANGUAGE C STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION boundary_v2(geo_linestring)
     RETURNS SETOF geo_point
     AS 'MODULE_PATHNAME', 'geo_linestring_boundary_v2'
-    LANGUAGE C STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 
 CREATE FUNCTION geo_linestring_boundary_points(geo_linestring)
     RETURNS float8[]
     AS 'MODULE_PATHNAME', 'geo_linestring_boundary_points'
-    LANGUAGE C IMMUTABLE;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
 
 CREATE OR REPLACE FUNCTION geo_linestring_make(float8[], float8[])
     RETURNS geo_linestring
     AS 'MODULE_PATHNAME', 'geo_linestring_make'
-    LANGUAGE C STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+CREATE OR REPLACE FUNCTION make_linestring(float8[])
+    RETURNS geo_linestring
+    AS 'MODULE_PATHNAME', 'geo_linestring_make_interleaved'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
 
 CREATE OR REPLACE FUNCTION geo_linestring_intersection(IN geo_linestring,
     OUT x float8, OUT y float8)
     RETURNS SETOF record
     AS 'MODULE_PATHNAME', 'geo_linestring_intersection'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 500;
+
+
+--
+-- LineString vertex editing
+--
+-- These functions work on an expanded in-memory representation, so that
+-- PL/pgSQL loops like "line := add_point(line, pt)" do not copy the whole
+-- geometry at each step. The flat value is only built when it is stored.
+--
+CREATE OR REPLACE FUNCTION geo_expanded_support(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_expanded_support'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION add_point(geo_linestring, geo_point)
+    RETURNS geo_linestring
+    AS 'MODULE_PATHNAME', 'geo_linestring_add_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5
+    SUPPORT geo_expanded_support;
+
+CREATE OR REPLACE FUNCTION set_point(geo_linestring, int4, geo_point)
+    RETURNS geo_linestring
+    AS 'MODULE_PATHNAME', 'geo_linestring_set_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5
+    SUPPORT geo_expanded_support;
+
+CREATE OR REPLACE FUNCTION remove_point(geo_linestring, int4)
+    RETURNS geo_linestring
+    AS 'MODULE_PATHNAME', 'geo_linestring_remove_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10
+    SUPPORT geo_expanded_support;
 
 
 --
@@ -361,22 +753,31 @@ CREATE TYPE geo_polygon;
 CREATE OR REPLACE FUNCTION geo_polygon_in(cstring)
     RETURNS geo_polygon
     AS 'MODULE_PATHNAME', 'geo_polygon_in'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION geo_polygon_out(geo_polygon)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_polygon_out'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION geo_polygon_recv(internal)
     RETURNS geo_polygon
     AS 'MODULE_PATHNAME','geo_polygon_recv'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
 
 CREATE OR REPLACE FUNCTION geo_polygon_send(geo_polygon)
     RETURNS bytea
     AS 'MODULE_PATHNAME', 'geo_polygon_send'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+CREATE OR REPLACE FUNCTION geo_polygon_analyze(internal)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_polygon_analyze'
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 
 ---
@@ -385,27 +786,73 @@ CREATE OR REPLACE FUNCTION geo_polygon_send(geo_polygon)
 CREATE OR REPLACE FUNCTION polygon_from_text(cstring)
     RETURNS geo_polygon
     AS 'MODULE_PATHNAME', 'geo_polygon_from_text'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION to_str(geo_polygon)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_polygon_to_str'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C STABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION contains(geo_polygon, geo_point)
-    RETURNS cstring
+    RETURNS boolean
     AS 'MODULE_PATHNAME', 'geo_polygon_contains_point'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
 
 CREATE OR REPLACE FUNCTION area(geo_polygon)
     RETURNS float8
     AS 'MODULE_PATHNAME', 'geo_polygon_area'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+CREATE OR REPLACE FUNCTION geo_polygon_make(float8[], float8[])
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_make'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
 
 CREATE OR REPLACE FUNCTION perimeter(geo_polygon)
     RETURNS float8
     AS 'MODULE_PATHNAME', 'geo_polygon_perimeter'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+--
+-- Visvalingam-Whyatt simplification of the ring: the vertices whose
+-- triangle with their neighbours has an area below the tolerance are
+-- removed, unless that would make the ring cross itself.
+--
+CREATE OR REPLACE FUNCTION simplify_preserve_topology(geo_polygon, tolerance float8)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_simplify_preserve_topology'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100;
+
+--
+-- Polygon vertex editing (see the LineString ones above)
+--
+CREATE OR REPLACE FUNCTION add_point(geo_polygon, geo_point)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_add_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5
+    SUPPORT geo_expanded_support;
+
+CREATE OR REPLACE FUNCTION set_point(geo_polygon, int4, geo_point)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_set_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5
+    SUPPORT geo_expanded_support;
+
+CREATE OR REPLACE FUNCTION remove_point(geo_polygon, int4)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_remove_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10
+    SUPPORT geo_expanded_support;
 
 --
 -- Register the geo_linestring Data Type
@@ -416,12 +863,44 @@ CREATE TYPE geo_polygon
     output = geo_polygon_out,
     receive = geo_polygon_recv,
     send = geo_polygon_send,
+    analyze = geo_polygon_analyze,
     internallength = variable,
     storage = extended,
     alignment = double
 );
 
 
+--
+-- Vertex and segment dumps of LineStrings and Polygons
+--
+-- One row is produced per call, from binary values: no text is formatted
+-- or parsed along the way.
+--
+CREATE OR REPLACE FUNCTION dump_points(geo_linestring)
+    RETURNS TABLE(path int4, pt geo_point)
+    AS 'MODULE_PATHNAME', 'geo_dump_points'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+CREATE OR REPLACE FUNCTION dump_points(geo_polygon)
+    RETURNS TABLE(path int4, pt geo_point)
+    AS 'MODULE_PATHNAME', 'geo_dump_points'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+CREATE OR REPLACE FUNCTION dump_segments(geo_linestring)
+    RETURNS TABLE(path int4, first geo_point, second geo_point)
+    AS 'MODULE_PATHNAME', 'geo_dump_segments'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+CREATE OR REPLACE FUNCTION dump_segments(geo_polygon)
+    RETURNS TABLE(path int4, first geo_point, second geo_point)
+    AS 'MODULE_PATHNAME', 'geo_dump_segments'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+
 ----------------------------------------
 ----------------------------------------
 -- Introduces the trajectory_elem Data Type --
@@ -439,17 +918,19 @@ CREATE TYPE geo_trajc_elem;
 CREATE OR REPLACE FUNCTION trajectory_elem_in(cstring)
     RETURNS geo_trajc_elem
     AS 'MODULE_PATHNAME', 'trajectory_elem_in'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
 
 CREATE OR REPLACE FUNCTION trajectory_elem_out(geo_trajc_elem)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'trajectory_elem_out'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
 
 CREATE OR REPLACE FUNCTION get_trajectory_elem(timestamp, geo_point)
     RETURNS geo_trajc_elem
     AS 'MODULE_PATHNAME','get_trajectory_elem'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 
 --
@@ -467,12 +948,14 @@ CREATE TYPE geo_trajc_elem(
 CREATE OR REPLACE FUNCTION trajectory_to_array(geo_trajc_elem[], timestamp, geo_point)
     RETURNS geo_trajc_elem[]
     AS 'MODULE_PATHNAME','trajectory_to_array'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
 
 CREATE OR REPLACE FUNCTION trajectory_to_array_final(geo_trajc_elem[])
     RETURNS geo_trajc_elem[]
     AS 'MODULE_PATHNAME', 'trajectory_to_array_final'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
 
 -- just for test
 -- deveria dar um erro
@@ -483,9 +966,31 @@ CREATE AGGREGATE array_trajectory_agg(timestamp, geo_point)
   SFUNC = trajectory_to_array,
   STYPE = geo_trajc_elem[],
   initcond = '{}',
-  FINALFUNC = trajectory_to_array_final
+  FINALFUNC = trajectory_to_array_final,
+  PARALLEL = SAFE
 );
 
+--
+-- Positions of a trajectory, i.e. a geo_trajc_elem[] sorted by time as
+-- returned by array_trajectory_agg. Between two fixes the position is
+-- linearly interpolated; at_time is NULL out of the time span.
+--
+-- Both run a binary search on the times. Trajectories stored with
+-- "ALTER TABLE ... ALTER COLUMN ... SET STORAGE EXTERNAL" are read by
+-- slices, so only the TOAST chunks of the probed fixes are fetched.
+--
+CREATE OR REPLACE FUNCTION at_time(geo_trajc_elem[], timestamp)
+    RETURNS geo_point
+    AS 'MODULE_PATHNAME', 'trajectory_at_time'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+CREATE OR REPLACE FUNCTION slice(geo_trajc_elem[], tsrange)
+    RETURNS geo_trajc_elem[]
+    AS 'MODULE_PATHNAME', 'trajectory_slice'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
 
 ----------------------------------------
 ----------------------------------------
@@ -505,12 +1010,19 @@ CREATE TYPE geo_box;
 CREATE OR REPLACE FUNCTION geo_box_in(cstring)
     RETURNS geo_box
     AS 'MODULE_PATHNAME', 'geo_box_in'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
 
 CREATE OR REPLACE FUNCTION geo_box_out(geo_box)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_box_out'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE OR REPLACE FUNCTION geo_box_analyze(internal)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_box_analyze'
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 --
 -- Box Operators
@@ -518,12 +1030,14 @@ CREATE OR REPLACE FUNCTION geo_box_out(geo_box)
 CREATE OR REPLACE FUNCTION box_from_text(cstring)
     RETURNS geo_box
     AS 'MODULE_PATHNAME', 'geo_box_from_text'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
 
 CREATE OR REPLACE FUNCTION to_str(geo_box)
     RETURNS cstring
     AS 'MODULE_PATHNAME', 'geo_box_to_str'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C STABLE STRICT PARALLEL SAFE
+    COST 10;
 
 
 --
@@ -533,42 +1047,79 @@ CREATE OR REPLACE FUNCTION to_str(geo_box)
 CREATE FUNCTION geo_box_contain(geo_box, geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_contain'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION geo_box_contained(geo_box, geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_contained'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION geo_box_left(geo_box,geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_left'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION geo_box_same(geo_box, geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_same'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION geo_box_right(geo_box, geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_right'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION geo_box_below(geo_box, geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_below'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION geo_box_above(geo_box, geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_above'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 CREATE FUNCTION geo_box_overlap(geo_box, geo_box)
     RETURNS bool
     AS 'MODULE_PATHNAME','geo_box_overlap'
-    LANGUAGE C IMMUTABLE STRICT;
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION geo_box_overleft(geo_box, geo_box)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box_overleft'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION geo_box_overright(geo_box, geo_box)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box_overright'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION geo_box_overbelow(geo_box, geo_box)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box_overbelow'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION geo_box_overabove(geo_box, geo_box)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box_overabove'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+
+--
+-- Selectivity estimators for the spatial operators
+--
+-- They use the 2D grid histogram collected by geo_box_analyze and
+-- geo_point_analyze.
+--
+CREATE OR REPLACE FUNCTION geo_box_sel(internal, oid, internal, integer)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_box_sel'
+    LANGUAGE C STABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box_joinsel(internal, oid, internal, smallint, internal)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_box_joinsel'
+    LANGUAGE C STABLE STRICT PARALLEL SAFE;
 
 --
 -- Register the geo_box Data Type
@@ -578,6 +1129,7 @@ CREATE TYPE geo_box(
     output = geo_box_out,
     --receive = geo_box_recv,
     --send = geo_box_send,
+    analyze = geo_box_analyze,
     internallength = 32,
     alignment = double
 );
@@ -592,8 +1144,18 @@ CREATE OPERATOR <<
   PROCEDURE = geo_box_left,
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 2 RTOverLeftStrategyNumber
+CREATE OPERATOR &<
+(
+  PROCEDURE = geo_box_overleft,
+  LEFTARG = geo_box,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 -- 3 RTOverlapStrategyNumber
@@ -602,8 +1164,18 @@ CREATE OPERATOR &&
   PROCEDURE = geo_box_overlap,
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 4 RTOverRightStrategyNumber
+CREATE OPERATOR &>
+(
+  PROCEDURE = geo_box_overright,
+  LEFTARG = geo_box,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 -- 5 RTRightStrategyNumber
@@ -613,8 +1185,8 @@ CREATE OPERATOR >>
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
   --COMMUTATOR = << ,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 -- 6 RTSameStrategyNumber
@@ -624,8 +1196,8 @@ CREATE OPERATOR ~=
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
   --COMMUTATOR =  ,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 -- 7 RTContainsStrategyNumber
@@ -634,8 +1206,8 @@ CREATE OPERATOR @>
   PROCEDURE = geo_box_contain,
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 -- 8 RTContainedByStrategyNumber
@@ -644,8 +1216,18 @@ CREATE OPERATOR <@
   PROCEDURE = geo_box_contained,
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 9 RTOverBelowStrategyNumber
+CREATE OPERATOR &<|
+(
+  PROCEDURE = geo_box_overbelow,
+  LEFTARG = geo_box,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 --10 RTBelowStrategyNumber
@@ -655,8 +1237,8 @@ CREATE OPERATOR <<|
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
   COMMUTATOR = |>>,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 -- 11 RTAboveStrategyNumber
@@ -666,8 +1248,38 @@ CREATE OPERATOR |>>
   LEFTARG = geo_box,
   RIGHTARG = geo_box,
   COMMUTATOR = <<| ,
-  RESTRICT = areasel,
-  JOIN = areajoinsel
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 12 RTOverAboveStrategyNumber
+CREATE OPERATOR |&>
+(
+  PROCEDURE = geo_box_overabove,
+  LEFTARG = geo_box,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 13 RTOldContainsStrategyNumber (same as @>)
+CREATE OPERATOR ~
+(
+  PROCEDURE = geo_box_contain,
+  LEFTARG = geo_box,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 14 RTOldContainedByStrategyNumber (same as <@)
+CREATE OPERATOR @
+(
+  PROCEDURE = geo_box_contained,
+  LEFTARG = geo_box,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
 );
 
 
@@ -678,37 +1290,42 @@ CREATE OPERATOR |>>
 CREATE OR REPLACE FUNCTION geo_box_consistent(internal, geo_box, smallint, oid, internal)
     RETURNS bool
     AS 'MODULE_PATHNAME', 'geo_box_consistent'
-    LANGUAGE C STRICT;
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_box_union(internal, internal)
     RETURNS geo_box
     AS 'MODULE_PATHNAME', 'geo_box_union'
-    LANGUAGE C STRICT;
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_box_compress(internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'geo_box_compress'
-    LANGUAGE C STRICT;
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_box_decompress(internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'geo_box_decompress'
-    LANGUAGE C STRICT;
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box_fetch(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_box_fetch'
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION geo_box_penalty(internal, internal, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'geo_box_penalty'
-    LANGUAGE C STRICT;
+    LANGUAGE C STRICT PARALLEL SAFE;
 
-/*CREATE OR REPLACE FUNCTION geo_box_picksplit(internal, internal)
+CREATE OR REPLACE FUNCTION geo_box_picksplit(internal, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'geo_box_picksplit'
-    LANGUAGE C STRICT;*/
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 CREATE OR REPLACE FUNCTION g_box_same(geo_box, geo_box, internal)
     RETURNS internal
     AS 'MODULE_PATHNAME', 'g_box_same'
-    LANGUAGE C STRICT;
+    LANGUAGE C STRICT PARALLEL SAFE;
 
 
 --
@@ -718,19 +1335,1181 @@ CREATE OR REPLACE FUNCTION g_box_same(geo_box, geo_box, internal)
 CREATE OPERATOR CLASS gist_gbox_ops
     DEFAULT FOR TYPE geo_box USING gist AS
         OPERATOR        1        <<  ,
+        OPERATOR        2        &<  ,
       	OPERATOR        3        &&  ,
+        OPERATOR        4        &>  ,
       	OPERATOR        5        >>	 ,
         OPERATOR	      6	       ~=  ,
         OPERATOR        7        @>  ,
         OPERATOR        8        <@  ,
+        OPERATOR        9        &<| ,
       	OPERATOR        10       <<| ,
       	OPERATOR        11       |>> ,
+        OPERATOR        12       |&> ,
+        OPERATOR        13       ~   ,
+        OPERATOR        14       @   ,
 
         FUNCTION  1 geo_box_consistent(internal, geo_box, smallint, oid, internal),
       	FUNCTION	2	geo_box_union (internal, internal),
       	FUNCTION	3	geo_box_compress (internal),
       	FUNCTION	4	geo_box_decompress (internal),
       	FUNCTION	5	geo_box_penalty (internal, internal, internal),
-      	--FUNCTION	6	geo_box_picksplit (internal, internal),
-      	FUNCTION	7	g_box_same (geo_box, geo_box, internal);
+      	FUNCTION	6	geo_box_picksplit (internal, internal),
+      	FUNCTION	7	g_box_same (geo_box, geo_box, internal),
+      	FUNCTION	9	geo_box_fetch (internal);
       	--FUNCTION	8	geo_box_distance (internal, cube, smallint, oid, internal);
+
+
+--------------------------------------------------------
+--------------------------------------------------------
+-- R-tree GiST index for geo_point and geo_polygon --
+--------------------------------------------------------
+--------------------------------------------------------
+
+--
+-- Bounding boxes
+--
+CREATE OR REPLACE FUNCTION bbox(geo_point)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_point_bbox'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION bbox(geo_polygon)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_polygon_bbox'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+CREATE OR REPLACE FUNCTION expand(geo_point, float8)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_point_expand'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+
+--
+-- Operators between the indexed types and their keys
+--
+CREATE FUNCTION geo_point_box_overlap(geo_point, geo_box)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_point_box_overlap'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE FUNCTION geo_polygon_box_overlap(geo_polygon, geo_box)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_polygon_box_overlap'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 10;
+
+-- 3 RTOverlapStrategyNumber
+CREATE OPERATOR &&
+(
+  PROCEDURE = geo_point_box_overlap,
+  LEFTARG = geo_point,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 3 RTOverlapStrategyNumber
+CREATE FUNCTION geo_cpoint_box_overlap(geo_cpoint, geo_box)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_cpoint_box_overlap'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- 3 RTOverlapStrategyNumber
+CREATE OPERATOR &&
+(
+  PROCEDURE = geo_cpoint_box_overlap,
+  LEFTARG = geo_cpoint,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+-- 3 RTOverlapStrategyNumber
+CREATE OPERATOR &&
+(
+  PROCEDURE = geo_polygon_box_overlap,
+  LEFTARG = geo_polygon,
+  RIGHTARG = geo_box,
+  RESTRICT = geo_box_sel,
+  JOIN = geo_box_joinsel
+);
+
+
+---
+-- Define GiST methods: the keys of geo_cpoint and geo_polygon are geo_box,
+-- so we only need the compress methods and the consistent method is the
+-- one of geo_box. A geo_point is its own leaf key: the internal keys are
+-- float4 boxes of the same 24 bytes, and the opclass has its own methods.
+---
+CREATE OR REPLACE FUNCTION geo_point_gist_consistent(internal, geo_point, smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_point_gist_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_gist_compress(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_point_gist_compress'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_gist_fetch(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_point_gist_fetch'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_gist_union(internal, internal)
+    RETURNS geo_point
+    AS 'MODULE_PATHNAME', 'geo_point_gist_union'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_gist_penalty(internal, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_point_gist_penalty'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_gist_picksplit(internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_point_gist_picksplit'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_gist_same(geo_point, geo_point, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_point_gist_same'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_gist_consistent(internal, geo_cpoint, smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_point_gist_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_gist_compress(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_cpoint_gist_compress'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cpoint_gist_fetch(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_cpoint_gist_fetch'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_polygon_gist_consistent(internal, geo_polygon, smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_polygon_gist_compress(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_polygon_gist_compress'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+
+--
+-- Create operator classes for geo_point and geo_polygon to interface to R-tree index
+--
+-- The leaf keys are the points, SRID included: they are exact and can be
+-- fetched by index-only scans.
+CREATE OPERATOR CLASS gist_geo_point_ops
+    DEFAULT FOR TYPE geo_point USING gist AS
+        OPERATOR        3        && (geo_point, geo_box),
+
+        FUNCTION  1 geo_point_gist_consistent(internal, geo_point, smallint, oid, internal),
+        FUNCTION  2 geo_point_gist_union (internal, internal),
+        FUNCTION  3 geo_point_gist_compress (internal),
+        FUNCTION  5 geo_point_gist_penalty (internal, internal, internal),
+        FUNCTION  6 geo_point_gist_picksplit (internal, internal),
+        FUNCTION  7 geo_point_gist_same (geo_point, geo_point, internal),
+        FUNCTION  9 geo_point_gist_fetch (internal),
+        STORAGE geo_point;
+
+-- The keys of a geo_cpoint index are the ones of gist_geo_point_ops (the
+-- leaf key is the point with a zero SRID), so both indexes have the same
+-- size and share the support functions but compress and fetch.
+CREATE OPERATOR CLASS gist_geo_cpoint_ops
+    DEFAULT FOR TYPE geo_cpoint USING gist AS
+        OPERATOR        3        && (geo_cpoint, geo_box),
+
+        FUNCTION  1 geo_cpoint_gist_consistent(internal, geo_cpoint, smallint, oid, internal),
+        FUNCTION  2 geo_point_gist_union (internal, internal),
+        FUNCTION  3 geo_cpoint_gist_compress (internal),
+        FUNCTION  5 geo_point_gist_penalty (internal, internal, internal),
+        FUNCTION  6 geo_point_gist_picksplit (internal, internal),
+        FUNCTION  7 geo_point_gist_same (geo_point, geo_point, internal),
+        FUNCTION  9 geo_cpoint_gist_fetch (internal),
+        STORAGE geo_point;
+
+CREATE OPERATOR CLASS gist_geo_polygon_ops
+    DEFAULT FOR TYPE geo_polygon USING gist AS
+        OPERATOR        3        && (geo_polygon, geo_box),
+
+        FUNCTION  1 geo_polygon_gist_consistent(internal, geo_polygon, smallint, oid, internal),
+        FUNCTION  2 geo_box_union (internal, internal),
+        FUNCTION  3 geo_polygon_gist_compress (internal),
+        FUNCTION  5 geo_box_penalty (internal, internal, internal),
+        FUNCTION  6 geo_box_picksplit (internal, internal),
+        FUNCTION  7 g_box_same (geo_box, geo_box, internal),
+        STORAGE geo_box;
+
+
+--
+-- Planner support: contains() and dwithin() become lossy index
+-- conditions on the opclasses above, e.g.
+--   contains(poly, pt) => pt && bbox(poly)
+--   dwithin(pt1, pt2, r) => pt1 && expand(pt2, r)
+--
+CREATE OR REPLACE FUNCTION geo_polygon_contains_support(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_polygon_contains_support'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_dwithin_support(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_point_dwithin_support'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+ALTER FUNCTION contains(geo_polygon, geo_point)
+    SUPPORT geo_polygon_contains_support;
+
+CREATE OR REPLACE FUNCTION dwithin(geo_point, geo_point, float8)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_point_dwithin'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    SUPPORT geo_point_dwithin_support;
+
+
+---------------------------------------------
+---------------------------------------------
+-- Compact R-tree GiST keys (geo_box4)     --
+---------------------------------------------
+---------------------------------------------
+
+--
+-- A geo_box4 is a geo_box rounded outward to float4: 16 bytes instead of
+-- 32, so about 290 keys fit in a page instead of 185. The searches are
+-- lossy and the heap value is rechecked. These opclasses are not the
+-- default ones:
+--
+--   CREATE INDEX ON places USING gist (location gist_geo_point4_ops);
+--
+DROP TYPE IF EXISTS geo_box4;
+CREATE TYPE geo_box4;
+
+CREATE OR REPLACE FUNCTION geo_box4_in(cstring)
+    RETURNS geo_box4
+    AS 'MODULE_PATHNAME', 'geo_box4_in'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box4_out(geo_box4)
+    RETURNS cstring
+    AS 'MODULE_PATHNAME', 'geo_box4_out'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE TYPE geo_box4
+(
+    input = geo_box4_in,
+    output = geo_box4_out,
+    internallength = 16,
+    alignment = int4
+);
+
+CREATE OR REPLACE FUNCTION geo_box4_gist_consistent(internal, geo_box, smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point4_gist_consistent(internal, geo_point, smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_polygon4_gist_consistent(internal, geo_polygon, smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box4_gist_compress(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_compress'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_point_gist_compress4(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_point_gist_compress4'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_polygon_gist_compress4(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_polygon_gist_compress4'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box4_gist_union(internal, internal)
+    RETURNS geo_box4
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_union'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box4_gist_penalty(internal, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_penalty'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box4_gist_picksplit(internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_picksplit'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_box4_gist_same(geo_box4, geo_box4, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_box4_gist_same'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OPERATOR CLASS gist_geo_box4_ops
+    FOR TYPE geo_box USING gist AS
+        OPERATOR        1        <<  ,
+        OPERATOR        2        &<  ,
+        OPERATOR        3        &&  ,
+        OPERATOR        4        &>  ,
+        OPERATOR        5        >>  ,
+        OPERATOR        6        ~=  ,
+        OPERATOR        7        @>  ,
+        OPERATOR        8        <@  ,
+        OPERATOR        9        &<| ,
+        OPERATOR        10       <<| ,
+        OPERATOR        11       |>> ,
+        OPERATOR        12       |&> ,
+        OPERATOR        13       ~   ,
+        OPERATOR        14       @   ,
+
+        FUNCTION  1 geo_box4_gist_consistent(internal, geo_box, smallint, oid, internal),
+        FUNCTION  2 geo_box4_gist_union (internal, internal),
+        FUNCTION  3 geo_box4_gist_compress (internal),
+        FUNCTION  5 geo_box4_gist_penalty (internal, internal, internal),
+        FUNCTION  6 geo_box4_gist_picksplit (internal, internal),
+        FUNCTION  7 geo_box4_gist_same (geo_box4, geo_box4, internal),
+        STORAGE geo_box4;
+
+CREATE OPERATOR CLASS gist_geo_point4_ops
+    FOR TYPE geo_point USING gist AS
+        OPERATOR        3        && (geo_point, geo_box),
+
+        FUNCTION  1 geo_point4_gist_consistent(internal, geo_point, smallint, oid, internal),
+        FUNCTION  2 geo_box4_gist_union (internal, internal),
+        FUNCTION  3 geo_point_gist_compress4 (internal),
+        FUNCTION  5 geo_box4_gist_penalty (internal, internal, internal),
+        FUNCTION  6 geo_box4_gist_picksplit (internal, internal),
+        FUNCTION  7 geo_box4_gist_same (geo_box4, geo_box4, internal),
+        STORAGE geo_box4;
+
+CREATE OPERATOR CLASS gist_geo_polygon4_ops
+    FOR TYPE geo_polygon USING gist AS
+        OPERATOR        3        && (geo_polygon, geo_box),
+
+        FUNCTION  1 geo_polygon4_gist_consistent(internal, geo_polygon, smallint, oid, internal),
+        FUNCTION  2 geo_box4_gist_union (internal, internal),
+        FUNCTION  3 geo_polygon_gist_compress4 (internal),
+        FUNCTION  5 geo_box4_gist_penalty (internal, internal, internal),
+        FUNCTION  6 geo_box4_gist_picksplit (internal, internal),
+        FUNCTION  7 geo_box4_gist_same (geo_box4, geo_box4, internal),
+        STORAGE geo_box4;
+
+
+---------------------------------------------
+---------------------------------------------
+-- Introduces the geo_stbox Data Type --
+---------------------------------------------
+---------------------------------------------
+
+--
+-- A geo_stbox is a geo_box with a time interval. It is the key of the
+-- spatio-temporal GiST opclasses, so that "what passed in this box
+-- between 08:00 and 09:00" is a single index scan:
+--
+--   CREATE INDEX ON fixes USING gist (stbox(location, ts));
+--   SELECT * FROM fixes
+--    WHERE stbox(location, ts) && stbox(box_from_text('BOX(-46 -23, -47 -24)'),
+--                                       '2017-05-01 08:00', '2017-05-01 09:00');
+--
+--   CREATE INDEX ON tracks USING gist (traj);   -- a geo_trajc_elem[]
+--   SELECT * FROM tracks WHERE traj && stbox(...);
+--
+-- The distance operator <-> is the distance in space between boxes that
+-- share an instant (infinity otherwise), so the nearest objects to a place
+-- at a given time are found with ORDER BY key <-> stbox(pt, t).
+--
+-- For a trajectory (fixes sorted by time, with straight lines between
+-- them), traj && stbox tells if it was inside the box at some instant of
+-- the time interval of the box, and traj <-> stbox is its shortest
+-- distance to the box during that interval.
+--
+DROP TYPE IF EXISTS geo_stbox;
+CREATE TYPE geo_stbox;
+
+CREATE OR REPLACE FUNCTION geo_stbox_in(cstring)
+    RETURNS geo_stbox
+    AS 'MODULE_PATHNAME', 'geo_stbox_in'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE OR REPLACE FUNCTION geo_stbox_out(geo_stbox)
+    RETURNS cstring
+    AS 'MODULE_PATHNAME', 'geo_stbox_out'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE TYPE geo_stbox
+(
+    input = geo_stbox_in,
+    output = geo_stbox_out,
+    internallength = 48,
+    alignment = double
+);
+
+
+--
+-- Constructors
+--
+CREATE OR REPLACE FUNCTION stbox(geo_box, timestamp, timestamp)
+    RETURNS geo_stbox
+    AS 'MODULE_PATHNAME', 'geo_stbox_make'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION stbox(geo_point, timestamp)
+    RETURNS geo_stbox
+    AS 'MODULE_PATHNAME', 'geo_stbox_from_point'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION stbox(geo_trajc_elem[])
+    RETURNS geo_stbox
+    AS 'MODULE_PATHNAME', 'geo_stbox_from_trajectory'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+
+--
+-- Operators
+--
+CREATE OR REPLACE FUNCTION geo_stbox_overlap(geo_stbox, geo_stbox)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_stbox_overlap'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_contain(geo_stbox, geo_stbox)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_stbox_contain'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_contained(geo_stbox, geo_stbox)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_stbox_contained'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_same(geo_stbox, geo_stbox)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_stbox_same'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_distance(geo_stbox, geo_stbox)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_stbox_distance'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_trajectory_stbox_overlap(geo_trajc_elem[], geo_stbox)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_trajectory_stbox_overlap'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+CREATE OR REPLACE FUNCTION geo_trajectory_stbox_distance(geo_trajc_elem[], geo_stbox)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_trajectory_stbox_distance'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 20;
+
+-- 3 RTOverlapStrategyNumber
+CREATE OPERATOR &&
+(
+  PROCEDURE = geo_stbox_overlap,
+  LEFTARG = geo_stbox,
+  RIGHTARG = geo_stbox,
+  COMMUTATOR = &&,
+  RESTRICT = areasel,
+  JOIN = areajoinsel
+);
+
+-- 6 RTSameStrategyNumber
+CREATE OPERATOR ~=
+(
+  PROCEDURE = geo_stbox_same,
+  LEFTARG = geo_stbox,
+  RIGHTARG = geo_stbox,
+  COMMUTATOR = ~=,
+  RESTRICT = eqsel,
+  JOIN = eqjoinsel
+);
+
+-- 7 RTContainsStrategyNumber
+CREATE OPERATOR @>
+(
+  PROCEDURE = geo_stbox_contain,
+  LEFTARG = geo_stbox,
+  RIGHTARG = geo_stbox,
+  COMMUTATOR = <@,
+  RESTRICT = contsel,
+  JOIN = contjoinsel
+);
+
+-- 8 RTContainedByStrategyNumber
+CREATE OPERATOR <@
+(
+  PROCEDURE = geo_stbox_contained,
+  LEFTARG = geo_stbox,
+  RIGHTARG = geo_stbox,
+  COMMUTATOR = @>,
+  RESTRICT = contsel,
+  JOIN = contjoinsel
+);
+
+-- 15 RTKNNSearchStrategyNumber
+CREATE OPERATOR <->
+(
+  PROCEDURE = geo_stbox_distance,
+  LEFTARG = geo_stbox,
+  RIGHTARG = geo_stbox,
+  COMMUTATOR = <->
+);
+
+-- 3 RTOverlapStrategyNumber
+CREATE OPERATOR &&
+(
+  PROCEDURE = geo_trajectory_stbox_overlap,
+  LEFTARG = geo_trajc_elem[],
+  RIGHTARG = geo_stbox,
+  RESTRICT = areasel,
+  JOIN = areajoinsel
+);
+
+-- 15 RTKNNSearchStrategyNumber
+CREATE OPERATOR <->
+(
+  PROCEDURE = geo_trajectory_stbox_distance,
+  LEFTARG = geo_trajc_elem[],
+  RIGHTARG = geo_stbox
+);
+
+
+---
+-- Define GiST methods: geo_stbox columns and trajectories share most of
+-- them. A trajectory is compressed to the extent of its fixes, so its
+-- index scans recheck the rows with the exact operators.
+---
+CREATE OR REPLACE FUNCTION geo_stbox_gist_consistent(internal, geo_stbox, smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_stbox_gist_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_gist_union(internal, internal)
+    RETURNS geo_stbox
+    AS 'MODULE_PATHNAME', 'geo_stbox_gist_union'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_gist_penalty(internal, internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_stbox_gist_penalty'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_gist_picksplit(internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_stbox_gist_picksplit'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_gist_same(geo_stbox, geo_stbox, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_stbox_gist_same'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_stbox_gist_distance(internal, geo_stbox, smallint, oid, internal)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_stbox_gist_distance'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_trajectory_gist_consistent(internal, geo_trajc_elem[], smallint, oid, internal)
+    RETURNS bool
+    AS 'MODULE_PATHNAME', 'geo_trajectory_gist_consistent'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_trajectory_gist_distance(internal, geo_trajc_elem[], smallint, oid, internal)
+    RETURNS float8
+    AS 'MODULE_PATHNAME', 'geo_trajectory_gist_distance'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_trajectory_gist_compress(internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_trajectory_gist_compress'
+    LANGUAGE C STRICT PARALLEL SAFE;
+
+
+--
+-- Create operator classes for geo_stbox and trajectories to interface to R-tree index
+--
+CREATE OPERATOR CLASS gist_geo_stbox_ops
+    DEFAULT FOR TYPE geo_stbox USING gist AS
+        OPERATOR        3        &&  ,
+        OPERATOR        6        ~=  ,
+        OPERATOR        7        @>  ,
+        OPERATOR        8        <@  ,
+        OPERATOR        15       <-> (geo_stbox, geo_stbox) FOR ORDER BY float_ops,
+
+        FUNCTION  1 geo_stbox_gist_consistent(internal, geo_stbox, smallint, oid, internal),
+        FUNCTION  2 geo_stbox_gist_union (internal, internal),
+        FUNCTION  5 geo_stbox_gist_penalty (internal, internal, internal),
+        FUNCTION  6 geo_stbox_gist_picksplit (internal, internal),
+        FUNCTION  7 geo_stbox_gist_same (geo_stbox, geo_stbox, internal),
+        FUNCTION  8 geo_stbox_gist_distance (internal, geo_stbox, smallint, oid, internal);
+
+CREATE OPERATOR CLASS gist_geo_trajectory_ops
+    DEFAULT FOR TYPE geo_trajc_elem[] USING gist AS
+        OPERATOR        3        && (geo_trajc_elem[], geo_stbox),
+        OPERATOR        15       <-> (geo_trajc_elem[], geo_stbox) FOR ORDER BY float_ops,
+
+        FUNCTION  1 geo_trajectory_gist_consistent(internal, geo_trajc_elem[], smallint, oid, internal),
+        FUNCTION  2 geo_stbox_gist_union (internal, internal),
+        FUNCTION  3 geo_trajectory_gist_compress (internal),
+        FUNCTION  5 geo_stbox_gist_penalty (internal, internal, internal),
+        FUNCTION  6 geo_stbox_gist_picksplit (internal, internal),
+        FUNCTION  7 geo_stbox_gist_same (geo_stbox, geo_stbox, internal),
+        FUNCTION  8 geo_trajectory_gist_distance (internal, geo_trajc_elem[], smallint, oid, internal),
+        STORAGE geo_stbox;
+
+
+-------------------------------------------
+-------------------------------------------
+-- Introduces the geo_cell Data Type --
+-------------------------------------------
+-------------------------------------------
+
+--
+-- A geo_cell is a cell of a quadtree over [-180, 180] x [-90, 90] with
+-- 30 levels, stored as a 64-bit Hilbert key whose integer order follows the
+-- Hilbert curve. Its text form is 'level/position'.
+--
+-- A B-tree over the leaf keys answers window queries as range scans:
+--
+--   CREATE INDEX ON t (hilbert_key(location));
+--
+--   SELECT t.*
+--     FROM t, cells_covering(box_from_text('BOX(-46 -23, -47 -24)'), 12) c
+--    WHERE hilbert_key(location) BETWEEN c.range_min AND c.range_max
+--      AND location && box_from_text('BOX(-46 -23, -47 -24)');
+--
+-- The ranges of cells_covering are given in leaf keys, so the index must
+-- be built on the default level 30. Points outside the domain are clamped
+-- to the border cells, and so are the boxes given to cells_covering: a box
+-- wholly outside the domain is covered by the border cells its points fall
+-- into. The && recheck keeps the answer exact.
+--
+DROP TYPE IF EXISTS geo_cell;
+CREATE TYPE geo_cell;
+
+CREATE OR REPLACE FUNCTION geo_cell_in(cstring)
+    RETURNS geo_cell
+    AS 'MODULE_PATHNAME', 'geo_cell_in'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE OR REPLACE FUNCTION geo_cell_out(geo_cell)
+    RETURNS cstring
+    AS 'MODULE_PATHNAME', 'geo_cell_out'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE OR REPLACE FUNCTION geo_cell_recv(internal)
+    RETURNS geo_cell
+    AS 'MODULE_PATHNAME', 'geo_cell_recv'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cell_send(geo_cell)
+    RETURNS bytea
+    AS 'MODULE_PATHNAME', 'geo_cell_send'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE TYPE geo_cell
+(
+    input = geo_cell_in,
+    output = geo_cell_out,
+    receive = geo_cell_recv,
+    send = geo_cell_send,
+    internallength = 8,
+    passedbyvalue,
+    alignment = double
+);
+
+
+--
+-- Cell Operators
+--
+CREATE OR REPLACE FUNCTION hilbert_key(geo_point, level int4 DEFAULT 30)
+    RETURNS geo_cell
+    AS 'MODULE_PATHNAME', 'geo_point_hilbert_key'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE OR REPLACE FUNCTION geohash(geo_point, precision int4 DEFAULT 12)
+    RETURNS text
+    AS 'MODULE_PATHNAME', 'geo_point_geohash'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE OR REPLACE FUNCTION level(geo_cell)
+    RETURNS int4
+    AS 'MODULE_PATHNAME', 'geo_cell_level'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION cell_bbox(geo_cell)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_cell_bbox'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 5;
+
+CREATE OR REPLACE FUNCTION range_min(geo_cell)
+    RETURNS geo_cell
+    AS 'MODULE_PATHNAME', 'geo_cell_range_min'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION range_max(geo_cell)
+    RETURNS geo_cell
+    AS 'MODULE_PATHNAME', 'geo_cell_range_max'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION cells_covering(geo_box, level int4 DEFAULT 16)
+    RETURNS TABLE(range_min geo_cell, range_max geo_cell)
+    AS 'MODULE_PATHNAME', 'geo_box_cells_covering'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100 ROWS 16;
+
+
+--
+-- Cell Operators to interface to B-tree
+--
+CREATE OR REPLACE FUNCTION geo_cell_cmp(geo_cell, geo_cell)
+    RETURNS int4
+    AS 'MODULE_PATHNAME', 'geo_cell_cmp'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cell_eq(geo_cell, geo_cell)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_cell_eq'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cell_ne(geo_cell, geo_cell)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_cell_ne'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cell_lt(geo_cell, geo_cell)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_cell_lt'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cell_gt(geo_cell, geo_cell)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_cell_gt'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cell_le(geo_cell, geo_cell)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_cell_le'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_cell_ge(geo_cell, geo_cell)
+    RETURNS boolean
+    AS 'MODULE_PATHNAME', 'geo_cell_ge'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OPERATOR =
+(
+    LEFTARG = geo_cell,
+    RIGHTARG = geo_cell,
+    PROCEDURE = geo_cell_eq,
+    COMMUTATOR = =,
+    NEGATOR = <>,
+    RESTRICT = eqsel,
+    JOIN = eqjoinsel,
+    MERGES
+);
+
+CREATE OPERATOR <>
+(
+    LEFTARG = geo_cell,
+    RIGHTARG = geo_cell,
+    PROCEDURE = geo_cell_ne,
+    COMMUTATOR = <>,
+    NEGATOR = =,
+    RESTRICT = neqsel,
+    JOIN = neqjoinsel
+);
+
+CREATE OPERATOR <
+(
+    LEFTARG = geo_cell,
+    RIGHTARG = geo_cell,
+    PROCEDURE = geo_cell_lt,
+    COMMUTATOR = >,
+    NEGATOR = >=,
+    RESTRICT = scalarltsel,
+    JOIN = scalarltjoinsel
+);
+
+CREATE OPERATOR >
+(
+    LEFTARG = geo_cell,
+    RIGHTARG = geo_cell,
+    PROCEDURE = geo_cell_gt,
+    COMMUTATOR = <,
+    NEGATOR = <=,
+    RESTRICT = scalargtsel,
+    JOIN = scalargtjoinsel
+);
+
+CREATE OPERATOR <=
+(
+    LEFTARG = geo_cell,
+    RIGHTARG = geo_cell,
+    PROCEDURE = geo_cell_le,
+    COMMUTATOR = >=,
+    NEGATOR = >,
+    RESTRICT = scalarlesel,
+    JOIN = scalarlejoinsel
+);
+
+CREATE OPERATOR >=
+(
+    LEFTARG = geo_cell,
+    RIGHTARG = geo_cell,
+    PROCEDURE = geo_cell_ge,
+    COMMUTATOR = <=,
+    NEGATOR = <,
+    RESTRICT = scalargesel,
+    JOIN = scalargejoinsel
+);
+
+
+--
+-- Create an operator class for geo_cell to interface to B-tree index
+--
+-- The keys compare as int8, so the sort support of int8 is reused.
+--
+CREATE OPERATOR CLASS btree_geo_cell_ops
+    DEFAULT FOR TYPE geo_cell USING btree AS
+        OPERATOR        1       <  ,
+        OPERATOR        2       <= ,
+        OPERATOR        3       =  ,
+        OPERATOR        4       >= ,
+        OPERATOR        5       >  ,
+        FUNCTION        1       geo_cell_cmp(geo_cell, geo_cell),
+        FUNCTION        2       btint8sortsupport(internal);
+
+
+----------------------------------------
+----------------------------------------
+-- Convex hull --
+----------------------------------------
+----------------------------------------
+
+--
+-- convex_hull(geometry) is the polygon of the convex hull of the vertices
+-- (NULL if they are all collinear) and min_area_rect(geometry) the
+-- smallest rectangle, at any orientation, that encloses them. Both take
+-- O(n log n) time; the ring of a polygon does not need to be simple.
+--
+-- If the caller knows that the ring of a polygon is simple, e.g. because it
+-- was validated when loaded, "simple => true" computes the hull in O(n)
+-- with Melkman's algorithm. The ring is not checked: the hull of a ring
+-- that self-intersects may then miss vertices.
+--
+CREATE OR REPLACE FUNCTION convex_hull(geo_linestring)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_linestring_convex_hull'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100;
+
+CREATE OR REPLACE FUNCTION convex_hull(geo_polygon, simple bool DEFAULT false)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_convex_hull'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100;
+
+CREATE OR REPLACE FUNCTION min_area_rect(geo_linestring)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_linestring_min_area_rect'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100;
+
+CREATE OR REPLACE FUNCTION min_area_rect(geo_polygon, simple bool DEFAULT false)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_min_area_rect'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 100;
+
+
+----------------------------------------
+----------------------------------------
+-- Aggregates --
+----------------------------------------
+----------------------------------------
+
+--
+-- extent(geometry) is the geo_box of all the values, centroid_agg(geo_point)
+-- the mean of the points and convex_hull_agg(geo_point) the polygon of
+-- their convex hull (NULL if they are all collinear). They can run in
+-- parallel: each worker reduces its rows and the leader combines the
+-- partial states. convex_hull_agg keeps only the hull of the points seen
+-- so far, not all the rows.
+--
+CREATE OR REPLACE FUNCTION geo_extent_transfn(geo_box, geo_point)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_extent_point_transfn'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_extent_transfn(geo_box, geo_box)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_extent_box_transfn'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_extent_transfn(geo_box, geo_linestring)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_extent_linestring_transfn'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_extent_transfn(geo_box, geo_polygon)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_extent_polygon_transfn'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_extent_combine(geo_box, geo_box)
+    RETURNS geo_box
+    AS 'MODULE_PATHNAME', 'geo_extent_combine'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE AGGREGATE extent(geo_point)
+(
+  SFUNC = geo_extent_transfn,
+  STYPE = geo_box,
+  COMBINEFUNC = geo_extent_combine,
+  PARALLEL = SAFE
+);
+
+CREATE AGGREGATE extent(geo_box)
+(
+  SFUNC = geo_extent_transfn,
+  STYPE = geo_box,
+  COMBINEFUNC = geo_extent_combine,
+  PARALLEL = SAFE
+);
+
+CREATE AGGREGATE extent(geo_linestring)
+(
+  SFUNC = geo_extent_transfn,
+  STYPE = geo_box,
+  COMBINEFUNC = geo_extent_combine,
+  PARALLEL = SAFE
+);
+
+CREATE AGGREGATE extent(geo_polygon)
+(
+  SFUNC = geo_extent_transfn,
+  STYPE = geo_box,
+  COMBINEFUNC = geo_extent_combine,
+  PARALLEL = SAFE
+);
+
+CREATE OR REPLACE FUNCTION geo_centroid_transfn(internal, geo_point)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_centroid_transfn'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_centroid_combine(internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_centroid_combine'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_centroid_serialize(internal)
+    RETURNS bytea
+    AS 'MODULE_PATHNAME', 'geo_centroid_serialize'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_centroid_deserialize(bytea, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_centroid_deserialize'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_centroid_final(internal)
+    RETURNS geo_point
+    AS 'MODULE_PATHNAME', 'geo_centroid_final'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE AGGREGATE centroid_agg(geo_point)
+(
+  SFUNC = geo_centroid_transfn,
+  STYPE = internal,
+  SSPACE = 48,
+  FINALFUNC = geo_centroid_final,
+  COMBINEFUNC = geo_centroid_combine,
+  SERIALFUNC = geo_centroid_serialize,
+  DESERIALFUNC = geo_centroid_deserialize,
+  PARALLEL = SAFE
+);
+
+CREATE OR REPLACE FUNCTION geo_hull_transfn(internal, geo_point)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_hull_transfn'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_hull_combine(internal, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_hull_combine'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_hull_serialize(internal)
+    RETURNS bytea
+    AS 'MODULE_PATHNAME', 'geo_hull_serialize'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_hull_deserialize(bytea, internal)
+    RETURNS internal
+    AS 'MODULE_PATHNAME', 'geo_hull_deserialize'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION geo_hull_final(internal)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_hull_final'
+    LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE AGGREGATE convex_hull_agg(geo_point)
+(
+  SFUNC = geo_hull_transfn,
+  STYPE = internal,
+  FINALFUNC = geo_hull_final,
+  COMBINEFUNC = geo_hull_combine,
+  SERIALFUNC = geo_hull_serialize,
+  DESERIALFUNC = geo_hull_deserialize,
+  PARALLEL = SAFE
+);
+
+
+----------------------------------------
+----------------------------------------
+-- Coordinate transformation --
+----------------------------------------
+----------------------------------------
+
+--
+-- transform(geometry, srid) converts the coordinates with the built-in
+-- projections: 4326 (WGS84 longitude and latitude), 3857 (Web Mercator),
+-- 32601-32660 and 32701-32760 (WGS84 UTM zones) and 4087 (World
+-- Equidistant Cylindrical). Any other SRID is an error.
+--
+CREATE OR REPLACE FUNCTION transform(geo_point, int4)
+    RETURNS geo_point
+    AS 'MODULE_PATHNAME', 'geo_point_transform'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+CREATE OR REPLACE FUNCTION transform(geo_linestring, int4)
+    RETURNS geo_linestring
+    AS 'MODULE_PATHNAME', 'geo_linestring_transform'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
+
+CREATE OR REPLACE FUNCTION transform(geo_polygon, int4)
+    RETURNS geo_polygon
+    AS 'MODULE_PATHNAME', 'geo_polygon_transform'
+    LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE
+    COST 50;
+
+
+----------------------------------------
+----------------------------------------
+-- Pinned geofences --
+----------------------------------------
+----------------------------------------
+
+--
+-- geoext_pin_fences loads the polygons of a table into shared memory, as a
+-- packed R-tree over their boxes and one over the edges of each polygon,
+-- and fence_hits returns the ids of the polygons that contain a point. It
+-- requires geoext in shared_preload_libraries; only one table, of one
+-- database, is pinned at a time, and fence_hits fails in the other
+-- databases. The index is reloaded by the first fence_hits call after a
+-- change to the table is committed, with the privileges of the role that
+-- pinned it, if the table has the trigger:
+--
+--   SELECT geoext_pin_fences('zones', 'id', 'geom');
+--
+--   CREATE TRIGGER zones_fences
+--     AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON zones
+--     FOR EACH STATEMENT EXECUTE FUNCTION geoext_fences_changed();
+--
+--   SELECT v.id, fence_hits(v.location) FROM vehicles v;
+--
+-- The trigger also sends a notification with the table name on the
+-- geoext_fences channel. The index size is the fence_index_bytes row of
+-- geoext_stats.
+--
+CREATE FUNCTION geoext_pin_fences(fences regclass,
+                                  id_column name DEFAULT 'id',
+                                  geom_column name DEFAULT 'geom')
+    RETURNS int4
+    AS 'MODULE_PATHNAME', 'geoext_pin_fences'
+    LANGUAGE C VOLATILE STRICT PARALLEL UNSAFE;
+
+CREATE FUNCTION geoext_unpin_fences()
+    RETURNS void
+    AS 'MODULE_PATHNAME', 'geoext_unpin_fences'
+    LANGUAGE C VOLATILE PARALLEL UNSAFE;
+
+REVOKE ALL ON FUNCTION geoext_pin_fences(regclass, name, name) FROM PUBLIC;
+REVOKE ALL ON FUNCTION geoext_unpin_fences() FROM PUBLIC;
+
+CREATE FUNCTION geoext_fences_changed()
+    RETURNS trigger
+    AS 'MODULE_PATHNAME', 'geoext_fences_changed'
+    LANGUAGE C;
+
+-- fence_hits may reload the index through SPI into shared memory, so it
+-- is neither STABLE nor safe in a parallel worker.
+CREATE FUNCTION fence_hits(geo_point)
+    RETURNS int8[]
+    AS 'MODULE_PATHNAME', 'geo_fence_hits'
+    LANGUAGE C VOLATILE STRICT PARALLEL RESTRICTED;
+
+
+----------------------------------------
+----------------------------------------
+-- Hot-path counters --
+----------------------------------------
+----------------------------------------
+
+--
+-- Counts (and, with geoext.track_timing = on, times in milliseconds) of
+-- the GiST support calls, detoasts, point in polygon tests, WKT parsing,
+-- trajectory aggregation, the prepared polygon cache of contains() and
+-- fence_hits. The counts are shared by all backends when geoext is in
+-- shared_preload_libraries; otherwise they are the ones of the current
+-- session. The last row, fence_index_bytes, is the size of the pinned
+-- geofences.
+--
+CREATE FUNCTION geoext_stats(OUT counter text,
+                             OUT calls int8,
+                             OUT total_time float8,
+                             OUT stats_reset timestamptz)
+    RETURNS SETOF record
+    AS 'MODULE_PATHNAME', 'geoext_stats'
+    LANGUAGE C VOLATILE PARALLEL RESTRICTED;
+
+CREATE VIEW geoext_stats AS
+    SELECT * FROM geoext_stats();
+
+CREATE FUNCTION geoext_stats_reset()
+    RETURNS void
+    AS 'MODULE_PATHNAME', 'geoext_stats_reset'
+    LANGUAGE C VOLATILE PARALLEL RESTRICTED;
+
+REVOKE ALL ON FUNCTION geoext_stats_reset() FROM PUBLIC;
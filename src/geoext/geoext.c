@@ -37,6 +37,15 @@
 /* PostgreSQL */
 #include <postgres.h>
 #include <fmgr.h>
+#include <utils/guc.h>
+
+
+/* GeoExt */
+#include "geo_counters.h"
+#include "geo_fence.h"
+#include "geo_prepared.h"
+#include "geo_spatial_join.h"
+#include "wkt.h"
 
 
 /* Prototype definitions */
@@ -55,6 +64,72 @@ PG_MODULE_MAGIC;
 void _PG_init()
 {
   /*elog(NOTICE, "GeoExtension initialized!");*/
+
+  DefineCustomIntVariable("geoext.prepared_cache_size",
+                          "Number of out-of-line polygons kept detoasted by each call of contains().",
+                          "Zero disables the cache.",
+                          &geoext_prepared_cache_size,
+                          4,
+                          0, 1024,
+                          PGC_USERSET,
+                          0,
+                          NULL, NULL, NULL);
+
+  DefineCustomIntVariable("geoext.wkt_precision",
+                          "Number of decimal places of the coordinates in WKT output.",
+                          "-1 gives the shortest text that reads back to the same value.",
+                          &geoext_wkt_precision,
+                          -1,
+                          -1, 17,
+                          PGC_USERSET,
+                          0,
+                          NULL, NULL, NULL);
+
+  DefineCustomBoolVariable("geoext.track_counters",
+                           "Counts the calls of the GeoExt hot paths.",
+                           "The counts are shown by the geoext_stats view.",
+                           &geoext_track_counters,
+                           true,
+                           PGC_SUSET,
+                           0,
+                           NULL, NULL, NULL);
+
+  DefineCustomBoolVariable("geoext.track_timing",
+                           "Collects the time spent in the GeoExt hot paths.",
+                           "The time is shown by the geoext_stats view. "
+                           "It adds two clock readings to each timed call.",
+                           &geoext_track_timing,
+                           false,
+                           PGC_SUSET,
+                           0,
+                           NULL, NULL, NULL);
+
+  DefineCustomBoolVariable("geoext.enable_spatial_join",
+                           "Enables the planner's use of the GeoSpatialJoin custom join.",
+                           NULL,
+                           &geoext_enable_spatial_join,
+                           true,
+                           PGC_USERSET,
+                           0,
+                           NULL, NULL, NULL);
+
+  DefineCustomIntVariable("geoext.spatial_join_grid_size",
+                          "Maximum number of cells along each axis of a spatial join grid.",
+                          "The grid has about one cell per polygon, up to this limit.",
+                          &geoext_spatial_join_grid_size,
+                          GEOEXT_SPATIAL_JOIN_MAX_GRID_SIZE,
+                          1, GEOEXT_SPATIAL_JOIN_MAX_GRID_SIZE,
+                          PGC_USERSET,
+                          0,
+                          NULL, NULL, NULL);
+
+  MarkGUCPrefixReserved("geoext");
+
+  geo_counters_init();
+
+  geo_spatial_join_init();
+
+  geo_fence_init();
 }
 
 
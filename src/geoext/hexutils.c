@@ -41,7 +41,7 @@
 #include <assert.h>
 
 
-static char hex_table[]={"0123456789ABCDEF" };
+static const char hex_table[]={"0123456789ABCDEF" };
 
 
 /*
@@ -0,0 +1,72 @@
+--
+-- geo_cpoint: the SRID is the typmod of the column
+--
+CREATE FUNCTION explain_scan(query text) RETURNS text
+LANGUAGE plpgsql AS $$
+DECLARE
+  ln text;
+BEGIN
+  FOR ln IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+    IF ln LIKE '%Scan%' THEN
+      RETURN ltrim(ln, ' ->');
+    END IF;
+  END LOOP;
+  RETURN NULL;
+END;
+$$;
+
+CREATE TABLE cpoints (id int4, location geo_cpoint(4326));
+
+-- the SRID of a geo_point must be the one of the column
+INSERT INTO cpoints VALUES (0, point_from_text('POINT(0 0)'));
+
+-- a geo_cpoint of unknown SRID must be cast explicitly
+INSERT INTO cpoints VALUES (0, point_from_text('POINT(0 0)')::geo_cpoint);
+
+INSERT INTO cpoints
+  SELECT i, point_from_text(format('POINT(%s %s)', i % 10, i / 10)::cstring)::geo_cpoint::geo_cpoint(4326)
+    FROM generate_series(0, 99) AS i;
+
+-- a constant cast is folded by the planner
+INSERT INTO cpoints VALUES (100, point_from_text('POINT(20 20)')::geo_cpoint::geo_cpoint(4326));
+
+SELECT id, to_str(location) AS location_wkt FROM cpoints WHERE id IN (23, 100) ORDER BY id;
+
+-- read as a geo_point, a value takes the SRID of its column
+SELECT count(*) FROM cpoints WHERE location = point_from_text('POINT(3 2)');
+
+-- the values of columns with different SRIDs can not be compared
+CREATE TABLE cpoints_local (id int4, location geo_cpoint(0));
+
+INSERT INTO cpoints_local VALUES (1, point_from_text('POINT(3 2)'));
+
+SELECT count(*) FROM cpoints a JOIN cpoints_local b ON a.location = b.location;
+SELECT distance(a.location, b.location) FROM cpoints a, cpoints_local b;
+
+SELECT count(*) AS matches FROM cpoints a JOIN cpoints b ON a.location = b.location;
+
+SELECT distance(a.location, b.location) AS distance
+  FROM cpoints a, cpoints b WHERE a.id = 0 AND b.id = 34;
+
+-- the GiST keys are the ones of geo_point and hold the whole value
+CREATE INDEX cpoints_location_idx ON cpoints USING gist (location);
+
+VACUUM ANALYZE cpoints;
+
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+
+SELECT explain_scan($$
+  SELECT to_str(location) FROM cpoints
+   WHERE location && box_from_text('BOX(4 5, 2 3)') ORDER BY location
+$$) AS scan;
+
+SELECT to_str(location) AS location_wkt FROM cpoints
+ WHERE location && box_from_text('BOX(4 5, 2 3)') ORDER BY location;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE cpoints;
+DROP TABLE cpoints_local;
+DROP FUNCTION explain_scan(text);
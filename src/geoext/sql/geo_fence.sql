@@ -0,0 +1,53 @@
+--
+-- Pinned geofences: fence_hits sees a change to the table once the
+-- transaction that made it commits. They require geoext in
+-- shared_preload_libraries; otherwise every call fails, as in
+-- expected/geo_fence_1.out.
+--
+CREATE TABLE fences (id int8, geom geo_polygon);
+
+INSERT INTO fences VALUES
+  (1, polygon_from_text('POLYGON((0 0, 10 0, 10 10, 0 10, 0 0))')),
+  (2, polygon_from_text('POLYGON((5 5, 15 5, 15 15, 5 15, 5 5))'));
+
+CREATE TRIGGER fences_changed
+  AFTER INSERT OR UPDATE OR DELETE OR TRUNCATE ON fences
+  FOR EACH STATEMENT EXECUTE FUNCTION geoext_fences_changed();
+
+CREATE TABLE probes (name text, location geo_point);
+
+INSERT INTO probes VALUES
+  ('a', point_from_text('POINT(2 2)')),
+  ('b', point_from_text('POINT(7 7)')),
+  ('c', point_from_text('POINT(20 20)'));
+
+SELECT geoext_pin_fences('fences', 'id', 'geom');
+
+SELECT name, array(SELECT h FROM unnest(fence_hits(location)) AS h ORDER BY h) AS fence_ids
+  FROM probes ORDER BY name;
+
+-- a change is not seen before it is committed, nor after a rollback
+BEGIN;
+INSERT INTO fences VALUES (3, polygon_from_text('POLYGON((18 18, 25 18, 25 25, 18 25, 18 18))'));
+SELECT name, array(SELECT h FROM unnest(fence_hits(location)) AS h ORDER BY h) AS fence_ids
+  FROM probes ORDER BY name;
+ROLLBACK;
+
+SELECT name, array(SELECT h FROM unnest(fence_hits(location)) AS h ORDER BY h) AS fence_ids
+  FROM probes ORDER BY name;
+
+-- the first call after the commit reloads the index
+INSERT INTO fences VALUES (3, polygon_from_text('POLYGON((18 18, 25 18, 25 25, 18 25, 18 18))'));
+
+SELECT name, array(SELECT h FROM unnest(fence_hits(location)) AS h ORDER BY h) AS fence_ids
+  FROM probes ORDER BY name;
+
+DELETE FROM fences WHERE id = 1;
+
+SELECT name, array(SELECT h FROM unnest(fence_hits(location)) AS h ORDER BY h) AS fence_ids
+  FROM probes ORDER BY name;
+
+SELECT geoext_unpin_fences();
+
+DROP TABLE fences;
+DROP TABLE probes;
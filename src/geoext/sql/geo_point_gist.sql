@@ -0,0 +1,44 @@
+--
+-- GiST on geo_point: the leaf keys are the points, so the index answers
+-- index-only scans through its fetch method
+--
+CREATE FUNCTION explain_scan(query text) RETURNS text
+LANGUAGE plpgsql AS $$
+DECLARE
+  ln text;
+BEGIN
+  FOR ln IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+    IF ln LIKE '%Scan%' THEN
+      RETURN ltrim(ln, ' ->');
+    END IF;
+  END LOOP;
+  RETURN NULL;
+END;
+$$;
+
+CREATE TABLE points (id int4, location geo_point);
+
+INSERT INTO points
+  SELECT i, point_from_text(format('POINT(%s %s)', i % 10, i / 10)::cstring)
+    FROM generate_series(0, 99) AS i;
+
+CREATE INDEX points_location_idx ON points USING gist (location);
+
+VACUUM ANALYZE points;
+
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+
+SELECT explain_scan($$
+  SELECT to_str(location) FROM points
+   WHERE location && box_from_text('BOX(4 5, 2 3)') ORDER BY location
+$$) AS scan;
+
+SELECT to_str(location) AS location_wkt FROM points
+ WHERE location && box_from_text('BOX(4 5, 2 3)') ORDER BY location;
+
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+DROP TABLE points;
+DROP FUNCTION explain_scan(text);
@@ -0,0 +1,74 @@
+--
+-- The GeoSpatialJoin custom join of contains(geo_polygon, geo_point)
+--
+CREATE FUNCTION explain_has(query text, node text) RETURNS bool
+LANGUAGE plpgsql AS $$
+DECLARE
+  ln text;
+BEGIN
+  FOR ln IN EXECUTE 'EXPLAIN (COSTS OFF) ' || query LOOP
+    IF position(node IN ln) > 0 THEN
+      RETURN true;
+    END IF;
+  END LOOP;
+  RETURN false;
+END;
+$$;
+
+-- 900 overlapping squares of side 2 and the centers of the 1024 unit
+-- cells of [0, 32] x [0, 32]: the points of the last row and column are
+-- in no square
+CREATE TABLE zones (id int4, geom geo_polygon);
+
+INSERT INTO zones
+  SELECT 30 * j + i,
+         polygon_from_text(format('POLYGON((%s %s, %s %s, %s %s, %s %s, %s %s))',
+                                  i, j, i + 2, j, i + 2, j + 2, i, j + 2, i, j)::cstring)
+    FROM generate_series(0, 29) AS i, generate_series(0, 29) AS j;
+
+CREATE TABLE sites (id int4, location geo_point);
+
+INSERT INTO sites
+  SELECT 32 * y + x, point_from_text(format('POINT(%s %s)', x + 0.5, y + 0.5)::cstring)
+    FROM generate_series(0, 31) AS x, generate_series(0, 31) AS y;
+
+ANALYZE zones;
+ANALYZE sites;
+
+SET max_parallel_workers_per_gather = 0;
+
+SELECT explain_has($$
+  SELECT z.id, s.id FROM zones z JOIN sites s ON contains(z.geom, s.location)
+$$, 'Custom Scan (GeoSpatialJoin)') AS spatial_join;
+
+SELECT count(*) AS pairs, sum(z.id::int8 * 1024 + s.id) AS checksum
+  FROM zones z JOIN sites s ON contains(z.geom, s.location);
+
+-- the polygons do not fit in work_mem: both sides are split into tiles
+SET work_mem = '64kB';
+
+SELECT explain_has($$
+  SELECT z.id, s.id FROM zones z JOIN sites s ON contains(z.geom, s.location)
+$$, 'Custom Scan (GeoSpatialJoin)') AS spatial_join;
+
+SELECT count(*) AS pairs, sum(z.id::int8 * 1024 + s.id) AS checksum
+  FROM zones z JOIN sites s ON contains(z.geom, s.location);
+
+RESET work_mem;
+
+-- the same pairs without the custom join
+SET geoext.enable_spatial_join = off;
+
+SELECT explain_has($$
+  SELECT z.id, s.id FROM zones z JOIN sites s ON contains(z.geom, s.location)
+$$, 'Custom Scan (GeoSpatialJoin)') AS spatial_join;
+
+SELECT count(*) AS pairs, sum(z.id::int8 * 1024 + s.id) AS checksum
+  FROM zones z JOIN sites s ON contains(z.geom, s.location);
+
+RESET geoext.enable_spatial_join;
+RESET max_parallel_workers_per_gather;
+
+DROP TABLE zones;
+DROP TABLE sites;
+DROP FUNCTION explain_has(text, text);
@@ -0,0 +1,39 @@
+--
+-- geo_stbox: a geo_box with a time interval
+--
+CREATE TABLE stboxes (id int4, key geo_stbox);
+
+INSERT INTO stboxes VALUES
+  (1, stbox(box_from_text('BOX(10 10, 0 0)'), '2017-05-01 08:00', '2017-05-01 09:00')),
+  (2, stbox(box_from_text('BOX(30 30, 13 14)'), '2017-05-01 08:00', '2017-05-01 09:00')),
+  (3, stbox(box_from_text('BOX(10 10, 0 0)'), '2017-05-01 10:00', '2017-05-01 11:00')),
+  (4, stbox(point_from_text('POINT(5 5)'), '2017-05-01 08:30'));
+
+SELECT b.id,
+       a.key && b.key AS overlaps,
+       a.key @> b.key AS contains,
+       a.key <@ b.key AS within,
+       a.key ~= b.key AS same,
+       a.key <-> b.key AS distance
+  FROM stboxes a, stboxes b
+ WHERE a.id = 1
+ ORDER BY b.id;
+
+SELECT stbox(box_from_text('BOX(1 1, 0 0)'), '2017-05-01 09:00', '2017-05-01 08:00');
+
+-- the same answers from the GiST index
+CREATE INDEX stboxes_key_idx ON stboxes USING gist (key);
+
+SET enable_seqscan = off;
+
+SELECT id FROM stboxes
+ WHERE key && stbox(box_from_text('BOX(6 6, 4 4)'), '2017-05-01 08:15', '2017-05-01 08:45')
+ ORDER BY id;
+
+SELECT id FROM stboxes
+ ORDER BY key <-> stbox(point_from_text('POINT(12 12)'), '2017-05-01 08:30')
+ LIMIT 3;
+
+RESET enable_seqscan;
+
+DROP TABLE stboxes;
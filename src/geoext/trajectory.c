@@ -39,6 +39,7 @@ Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
 #include "algorithms.h"
 #include "trajectory.h"
 #include "hexutils.h"
+#include "geo_counters.h"
 
 /* PostgreSQL */
 #include <libpq/pqformat.h>
@@ -47,6 +48,8 @@ Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
 #include <catalog/pg_type.h>
 #include <utils/lsyscache.h> /*construct ArrayType*/
 #include <parser/parse_type.h> /*get oid from typname*/
+#include <access/detoast.h> /* VARATT_EXTERNAL_GET_POINTER */
+#include <utils/rangetypes.h>
 
 
 /*
@@ -63,12 +66,6 @@ Gilberto Ribeiro de Queiroz at <gribeiro@dpi.inpe.br>.
 #define GEOEXT_MIN_GEOTRAJCE_HEX_LEN \
 (2 * (sizeof(Timestamp) + sizeof(struct geo_point) ))
 
-inline
-contruct_array_internal(int typlen, int typbyval, int typalign)
-{
-
-};
-
 PG_FUNCTION_INFO_V1(trajectory_elem_in);
 
 Datum
@@ -196,8 +193,9 @@ PG_FUNCTION_INFO_V1(trajectory_to_array);
 Datum
 trajectory_to_array(PG_FUNCTION_ARGS)
 {
+  instr_time start;
 
-  elog(NOTICE, "trajectory_to_array CALL");
+  geo_counter_start(&start);
 
   /* Agregate array result*/
   ArrayType *result_array;
@@ -238,15 +236,13 @@ trajectory_to_array(PG_FUNCTION_ARGS)
 
   // float8 isnull = PG_GETARG_FLOAT8(0);
 
-  elog(NOTICE, "isnull %d", isnull);
-
 
   // If argument 0 (agg_state) is null this is the first value provided to the aggregate.
   if(isnull) {
 
-    elog(NOTICE, "eh null");
     result_array = construct_array(&datum_element, 1, element_type, typlen, typbyval, typalign);
     /*elog(NOTICE, "construct_array ok");*/
+    geo_counter_stop(GEO_COUNTER_TRAJECTORY_ADD, &start);
     PG_RETURN_ARRAYTYPE_P(result_array);
 
   }
@@ -263,33 +259,319 @@ trajectory_to_array(PG_FUNCTION_ARGS)
   /*elog(NOTICE, "concat ok");
   elog(NOTICE, "return result");*/
 
+  geo_counter_stop(GEO_COUNTER_TRAJECTORY_ADD, &start);
+
   PG_RETURN_ARRAYTYPE_P(result_array);
 
 }
 
+/*
+ * Sorting and searching of trajectories.
+ *
+ * A trajectory is a one-dimensional geo_trajc_elem[] without nulls, sorted
+ * by time, as built by array_trajectory_agg. The elements have a fixed
+ * size that is a multiple of their alignment, so the i-th one starts at
+ * i * sizeof(struct geo_trajc_elem) from the array data and can be read
+ * from a TOASTed value with a slice fetch.
+ *
+ */
+static int
+geo_trajc_elem_cmp(const void *a, const void *b)
+{
+  Timestamp ta = ((const struct geo_trajc_elem*) a)->time_elem;
+  Timestamp tb = ((const struct geo_trajc_elem*) b)->time_elem;
+
+  if(ta < tb)
+    return -1;
+  else if(ta > tb)
+    return 1;
+  else
+    return 0;
+}
+
+
 PG_FUNCTION_INFO_V1(trajectory_to_array_final);
 
 Datum
 trajectory_to_array_final(PG_FUNCTION_ARGS)
 {
-  elog(NOTICE, "trajectory_to_array_final CALL");
+  instr_time start;
 
-  ArrayType *array_in;
-  ArrayType *array_out_order;
+/* the transition state can not be changed, so we sort a copy */
+  ArrayType *array = PG_GETARG_ARRAYTYPE_P_COPY(0);
 
-  /* variables for "deconstructed" array*/
-  Datum *datums_time;
+  geo_counter_start(&start);
 
-  bool *nulls_time;
-  int count_time;
+  if((ARR_NDIM(array) == 1) && !ARR_HASNULL(array))
+    qsort(ARR_DATA_PTR(array), ARR_DIMS(array)[0],
+          sizeof(struct geo_trajc_elem), geo_trajc_elem_cmp);
 
-  int16 typlen;
-  bool typbyval;
-  char typalign;
+  geo_counter_stop(GEO_COUNTER_TRAJECTORY_FINAL, &start);
+
+  PG_RETURN_ARRAYTYPE_P(array);
+}
+
+
+/*
+ * Reads the elements of a trajectory.
+ *
+ * Trajectories stored out of line and uncompressed (STORAGE EXTERNAL) are
+ * read by slices: a binary search only fetches the TOAST chunks of the
+ * elements it probes. The other ones are detoasted as a whole.
+ *
+ */
+struct geo_trajectory_reader
+{
+  Datum datum;           /* The trajectory, possibly toasted.                   */
+  const char *data;      /* The elements of a detoasted trajectory, or NULL.    */
+  int32 data_offset;     /* Offset of the elements in the data of a slice.      */
+  int nelems;            /* Number of elements.                                 */
+  Oid elemtype;          /* Type of the elements.                               */
+};
+
+
+static void
+geo_trajectory_reader_init(struct geo_trajectory_reader *rd, Datum d)
+{
+  struct varlena *raw = (struct varlena *) DatumGetPointer(d);
+
+  ArrayType *array = NULL;
+
+  rd->datum = d;
+  rd->data = NULL;
+
+  if(VARATT_IS_EXTERNAL_ONDISK(raw))
+  {
+    struct varatt_external toast_pointer;
+
+    VARATT_EXTERNAL_GET_POINTER(toast_pointer, raw);
+
+    if(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+    {
+/* the header of a one-dimensional array without nulls */
+      array = (ArrayType *) PG_DETOAST_DATUM_SLICE(d, 0, ARR_OVERHEAD_NONULLS(1) - VARHDRSZ);
+
+      if((VARSIZE(array) == ARR_OVERHEAD_NONULLS(1)) &&
+         (ARR_NDIM(array) == 1) && !ARR_HASNULL(array))
+      {
+        rd->data_offset = ARR_OVERHEAD_NONULLS(1) - VARHDRSZ;
+        rd->nelems = ARR_DIMS(array)[0];
+        rd->elemtype = ARR_ELEMTYPE(array);
+
+        return;
+      }
+    }
+  }
+
+  array = DatumGetArrayTypeP(d);
+
+  if((ARR_NDIM(array) > 1) || ARR_HASNULL(array))
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("a trajectory must be a one-dimensional array without nulls")));
+
+  rd->data = ARR_DATA_PTR(array);
+  rd->data_offset = 0;
+  rd->nelems = (ARR_NDIM(array) == 0) ? 0 : ARR_DIMS(array)[0];
+  rd->elemtype = ARR_ELEMTYPE(array);
+}
+
+
+/* copies the elements [first, first + count) to elems */
+static void
+geo_trajectory_read(struct geo_trajectory_reader *rd, int first, int count,
+                    struct geo_trajc_elem *elems)
+{
+  Size offset = (Size) first * sizeof(struct geo_trajc_elem);
+  Size len = (Size) count * sizeof(struct geo_trajc_elem);
+
+  if(rd->data != NULL)
+  {
+    memcpy(elems, rd->data + offset, len);
+  }
+  else
+  {
+    struct varlena *slice = PG_DETOAST_DATUM_SLICE(rd->datum, rd->data_offset + offset, len);
+
+    if(VARSIZE(slice) - VARHDRSZ != len)
+      elog(ERROR, "truncated trajectory slice");
+
+/* VARDATA is not double aligned */
+    memcpy(elems, VARDATA(slice), len);
+
+    pfree(slice);
+  }
+}
+
+
+static inline Timestamp
+geo_trajectory_time(struct geo_trajectory_reader *rd, int i)
+{
+  struct geo_trajc_elem e;
+
+  geo_trajectory_read(rd, i, 1, &e);
+
+  return e.time_elem;
+}
+
+
+/*
+ * Returns the first element with a time greater than t, or greater or
+ * equal to t when inclusive is set.
+ */
+static int
+geo_trajectory_search(struct geo_trajectory_reader *rd, Timestamp t, bool inclusive)
+{
+  int lo = 0;
+  int hi = rd->nelems;
+
+  while(lo < hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+
+    Timestamp tm = geo_trajectory_time(rd, mid);
+
+    if(inclusive ? (tm < t) : (tm <= t))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+
+/* linear interpolation of the position at time t, with a->time_elem < t < b->time_elem */
+static void
+geo_trajc_elem_interpolate(const struct geo_trajc_elem *a,
+                           const struct geo_trajc_elem *b,
+                           Timestamp t, struct geo_trajc_elem *result)
+{
+  double f = (double) (t - a->time_elem) / (double) (b->time_elem - a->time_elem);
+
+  result->time_elem = t;
+  result->point_elem.coord.x = a->point_elem.coord.x + f * (b->point_elem.coord.x - a->point_elem.coord.x);
+  result->point_elem.coord.y = a->point_elem.coord.y + f * (b->point_elem.coord.y - a->point_elem.coord.y);
+  result->point_elem.srid = a->point_elem.srid;
+  result->point_elem.dummy = 0;
+}
+
+
+PG_FUNCTION_INFO_V1(trajectory_at_time);
+
+Datum
+trajectory_at_time(PG_FUNCTION_ARGS)
+{
+  Timestamp t = PG_GETARG_TIMESTAMP(1);
+
+  struct geo_trajectory_reader rd;
+
+  struct geo_trajc_elem e[2];
+
+  struct geo_trajc_elem pos;
+
+  struct geo_point *result = NULL;
+
+  int k;
+
+  geo_trajectory_reader_init(&rd, PG_GETARG_DATUM(0));
+
+  k = geo_trajectory_search(&rd, t, true);
+
+/* out of the time span of the trajectory */
+  if(k == rd.nelems)
+    PG_RETURN_NULL();
+
+  geo_trajectory_read(&rd, k, 1, &e[1]);
+
+  pos = e[1];
+
+  if(e[1].time_elem != t)
+  {
+    if(k == 0)
+      PG_RETURN_NULL();
+
+    geo_trajectory_read(&rd, k - 1, 1, &e[0]);
+
+    geo_trajc_elem_interpolate(&e[0], &e[1], t, &pos);
+  }
+
+  result = (struct geo_point*) palloc(sizeof(struct geo_point));
+
+  *result = pos.point_elem;
+
+  PG_RETURN_GEOPOINT_TYPE_P(result);
+}
+
+
+PG_FUNCTION_INFO_V1(trajectory_slice);
+
+Datum
+trajectory_slice(PG_FUNCTION_ARGS)
+{
+  RangeType *range = PG_GETARG_RANGE_P(1);
+
+  TypeCacheEntry *typcache = range_get_typcache(fcinfo, RangeTypeGetOid(range));
+
+  RangeBound lower, upper;
+  bool empty;
+
+  struct geo_trajectory_reader rd;
+
+  struct geo_trajc_elem *elems = NULL;
+  struct geo_trajc_elem *result = NULL;
+
+  Datum *datums = NULL;
+
+  int lo, hi, first, last;
+  int count = 0;
+
+  geo_trajectory_reader_init(&rd, PG_GETARG_DATUM(0));
+
+  range_deserialize(typcache, range, &lower, &upper, &empty);
+
+  if(empty || (rd.nelems == 0))
+    PG_RETURN_ARRAYTYPE_P(construct_empty_array(rd.elemtype));
+
+/* the fixes in the range are [lo, hi) */
+  lo = lower.infinite ? 0 :
+       geo_trajectory_search(&rd, DatumGetTimestamp(lower.val), lower.inclusive);
+
+  hi = upper.infinite ? rd.nelems :
+       geo_trajectory_search(&rd, DatumGetTimestamp(upper.val), !upper.inclusive);
+
+/* read them in one go, with a neighbour on each side for the interpolation */
+  first = Max(Min(lo, hi) - 1, 0);
+  last = Min(Max(lo, hi) + 1, rd.nelems);
+
+  elems = (struct geo_trajc_elem*) palloc((last - first) * sizeof(struct geo_trajc_elem));
+
+  geo_trajectory_read(&rd, first, last - first, elems);
+
+  result = (struct geo_trajc_elem*) palloc((Max(hi - lo, 0) + 2) * sizeof(struct geo_trajc_elem));
+
+/* an inclusive bound between two fixes becomes an interpolated position */
+  if(!lower.infinite && lower.inclusive && (lo > 0) && (lo < rd.nelems) &&
+     (elems[lo - first].time_elem != DatumGetTimestamp(lower.val)))
+    geo_trajc_elem_interpolate(&elems[lo - 1 - first], &elems[lo - first],
+                               DatumGetTimestamp(lower.val), &result[count++]);
+
+  for(int i = lo; i < hi; ++i)
+    result[count++] = elems[i - first];
+
+  if(!upper.infinite && upper.inclusive && (hi > 0) && (hi < rd.nelems) &&
+     (elems[hi - 1 - first].time_elem != DatumGetTimestamp(upper.val)) &&
+     (lower.infinite || (DatumGetTimestamp(lower.val) != DatumGetTimestamp(upper.val))))
+    geo_trajc_elem_interpolate(&elems[hi - 1 - first], &elems[hi - first],
+                               DatumGetTimestamp(upper.val), &result[count++]);
+
+  if(count == 0)
+    PG_RETURN_ARRAYTYPE_P(construct_empty_array(rd.elemtype));
 
-  array_in = PG_GETARG_ARRAYTYPE_P(0);
+  datums = (Datum*) palloc(count * sizeof(Datum));
 
-  elog(NOTICE, "get argument");
+  for(int i = 0; i < count; ++i)
+    datums[i] = PointerGetDatum(&result[i]);
 
-  PG_RETURN_ARRAYTYPE_P(array_in);
+  PG_RETURN_ARRAYTYPE_P(construct_array(datums, count, rd.elemtype,
+                                        sizeof(struct geo_trajc_elem), false, TYPALIGN_DOUBLE));
 }
@@ -69,8 +69,6 @@ struct geo_trajc_elem
  *
  */
 
-inline contruct_array_internal(int typlen, int typbyval, int typalign);
-
 extern Datum trajectory_elem_in(PG_FUNCTION_ARGS);
 extern Datum trajectory_elem_out(PG_FUNCTION_ARGS);
 extern Datum get_trajectory_elem(PG_FUNCTION_ARGS);
@@ -78,4 +76,8 @@ extern Datum get_trajectory_elem(PG_FUNCTION_ARGS);
 extern Datum trajectory_to_array(PG_FUNCTION_ARGS);
 extern Datum trajectory_to_array_final(PG_FUNCTION_ARGS);
 
+/* positions of a trajectory sorted by time */
+extern Datum trajectory_at_time(PG_FUNCTION_ARGS);
+extern Datum trajectory_slice(PG_FUNCTION_ARGS);
+
 #endif  /* __GEOEXT_H__ */
@@ -39,6 +39,7 @@
 
 /* GeoExt */
 #include "wkt.h"
+#include "geo_counters.h"
 
 
 /* PostgreSQL */
@@ -75,6 +76,9 @@
 #define GEOEXT_GEOM_COLLECTION_DELIM ','
 
 
+int geoext_wkt_precision = -1;
+
+
 /*
  * \brief Count the number of coordinates in a sequence represented as a string.
  *
@@ -98,6 +102,43 @@ int coord_count(char *s)
 }
 
 
+/*
+ * \brief Converts a coordinate value to a string.
+ *
+ * With a negative geoext.wkt_precision, the shortest string that reads back
+ * to the same double is produced. Otherwise, the value is rounded to that
+ * many decimal places and the trailing zeros are dropped.
+ *
+ */
+static char*
+coord_value_encode(double v)
+{
+  char *str, *end;
+
+  if (geoext_wkt_precision < 0 || isnan(v) || isinf(v))
+    return float8out_internal(v);
+
+  str = psprintf("%.*f", geoext_wkt_precision, v);
+
+  if (strchr(str, '.') != NULL)
+  {
+    end = str + strlen(str) - 1;
+
+    while (*end == '0')
+      *end-- = '\0';
+
+    if (*end == '.')
+      *end = '\0';
+  }
+
+/* do not print a negative zero */
+  if (strcmp(str, "-0") == 0)
+    return pstrdup("0");
+
+  return str;
+}
+
+
 /*
  * \brief Extracts a coordinate pair from a string.
  *
@@ -200,9 +241,13 @@ coord2d_sequence_decode(char *str,
 
 void geo_point_wkt_decode(char *str, struct geo_point* pt)
 {
+  instr_time start;
+
 /* search for the occurence of: 'POINT' */
   char *cp = strcasestr(str, GEOEXT_GEOPOINT_WKT_TOKEN);
 
+  geo_counter_start(&start);
+
 /* if the substring 'POINT' is not found in the text, we have an invalid WKT */
   if (!PointerIsValid(cp))
     ereport(ERROR,
@@ -258,21 +303,27 @@ void geo_point_wkt_decode(char *str, struct geo_point* pt)
  */
   pt->srid = 0;
   pt->dummy = 0;
+
+  geo_counter_stop(GEO_COUNTER_WKT_PARSE, &start);
 }
 
 
 char* geo_point_wkt_encode(struct geo_point *pt)
 {
+  instr_time start;
+
   StringInfoData str;
 
+  geo_counter_start(&start);
+
   initStringInfo(&str);
 
   appendStringInfoString(&str, GEOEXT_GEOPOINT_WKT_TOKEN);
 
   appendStringInfoChar(&str, GEOEXT_GEOM_LDELIM);
 
-  char *xstr = float8out_internal(pt->coord.x);
-  char *ystr = float8out_internal(pt->coord.y);
+  char *xstr = coord_value_encode(pt->coord.x);
+  char *ystr = coord_value_encode(pt->coord.y);
 
   appendStringInfo(&str, "%s %s", xstr, ystr);
 
@@ -281,14 +332,20 @@ char* geo_point_wkt_encode(struct geo_point *pt)
 
   appendStringInfoChar(&str, GEOEXT_GEOM_RDELIM);
 
+  geo_counter_stop(GEO_COUNTER_WKT_OUTPUT, &start);
+
   return str.data;
 }
 
 void geo_box_wkt_decode(char *str, struct geo_box *gbox)
 {
+  instr_time start;
+
   /* search for the occurence of: 'BOX' */
   char *cp = strcasestr(str, GEOEXT_GEOBOX_WKT_TOKEN);
 
+  geo_counter_start(&start);
+
   /* if the substring 'BOX' is not found in the text, we have an invalid WKT */
   if (!PointerIsValid(cp))
     ereport(ERROR,
@@ -349,13 +406,17 @@ void geo_box_wkt_decode(char *str, struct geo_box *gbox)
             errmsg("invalid input syntax for type %s: \"%s\"",
             "geo_box", str)));
 
-
+  geo_counter_stop(GEO_COUNTER_WKT_PARSE, &start);
 }
 
 char* geo_box_wkt_encode(struct geo_box *gbox)
 {
+  instr_time start;
+
   StringInfoData str;
 
+  geo_counter_start(&start);
+
   initStringInfo(&str);
 
   /*elog(NOTICE, "geo_box_wkt_encode");*/
@@ -364,13 +425,13 @@ char* geo_box_wkt_encode(struct geo_box *gbox)
 
   appendStringInfoChar(&str, GEOEXT_GEOM_LDELIM);
 
-  char *hxstr = float8out_internal(gbox->high.x);
-  char *hystr = float8out_internal(gbox->high.y);
+  char *hxstr = coord_value_encode(gbox->high.x);
+  char *hystr = coord_value_encode(gbox->high.y);
 
   appendStringInfo(&str, "%s %s", hxstr, hystr);
 
-  char *lxstr = float8out_internal(gbox->low.x);
-  char *lystr = float8out_internal(gbox->low.y);
+  char *lxstr = coord_value_encode(gbox->low.x);
+  char *lystr = coord_value_encode(gbox->low.y);
 
   appendStringInfoString(&str, ", ");
 
@@ -383,14 +444,20 @@ char* geo_box_wkt_encode(struct geo_box *gbox)
 
   appendStringInfoChar(&str, GEOEXT_GEOM_RDELIM);
 
+  geo_counter_stop(GEO_COUNTER_WKT_OUTPUT, &start);
+
   return str.data;
 }
 
 void geo_linestring_wkt_decode(char *str, struct geo_linestring* lstr)
 {
+  instr_time start;
+
 /* search for the occurence of: 'LINESTRING' */
   char *cp = strcasestr(str, GEOEXT_GEOLINESTRING_WKT_TOKEN);
 
+  geo_counter_start(&start);
+
 /* if the substring 'LINESTRING' is not found in the text, we have an invalid WKT */
   if (!PointerIsValid(cp))
     ereport(ERROR,
@@ -422,13 +489,19 @@ void geo_linestring_wkt_decode(char *str, struct geo_linestring* lstr)
  */
   lstr->srid = 0;
   lstr->dummy = 0;
+
+  geo_counter_stop(GEO_COUNTER_WKT_PARSE, &start);
 }
 
 
 char* geo_linestring_wkt_encode(struct geo_linestring *line)
 {
+  instr_time start;
+
   StringInfoData str;
 
+  geo_counter_start(&start);
+
   initStringInfo(&str);
 
   appendStringInfoString(&str, GEOEXT_GEOLINESTRING_WKT_TOKEN);
@@ -440,8 +513,8 @@ char* geo_linestring_wkt_encode(struct geo_linestring *line)
     if(i != 0)
       appendStringInfoString(&str, ", ");
 
-    char *xstr = float8out_internal(line->coords[i].x);
-    char *ystr = float8out_internal(line->coords[i].y);
+    char *xstr = coord_value_encode(line->coords[i].x);
+    char *ystr = coord_value_encode(line->coords[i].y);
 
     appendStringInfo(&str, "%s %s", xstr, ystr);
 
@@ -451,14 +524,20 @@ char* geo_linestring_wkt_encode(struct geo_linestring *line)
 
   appendStringInfoChar(&str, GEOEXT_GEOM_RDELIM);
 
+  geo_counter_stop(GEO_COUNTER_WKT_OUTPUT, &start);
+
   return str.data;
 }
 
 void geo_polygon_wkt_decode(char *str, struct geo_polygon *poly)
 {
+  instr_time start;
+
 /* search for the occurence of: 'POLYGON' */
   char *cp = strcasestr(str, GEOEXT_GEOPOLYGON_WKT_TOKEN);
 
+  geo_counter_start(&start);
+
 /* if the substring 'POLYGON' is not found in the text, we have an invalid WKT */
   if (!PointerIsValid(cp))
     ereport(ERROR,
@@ -524,13 +603,19 @@ void geo_polygon_wkt_decode(char *str, struct geo_polygon *poly)
  */
   poly->dummy = 0;
   poly->srid = 0;
+
+  geo_counter_stop(GEO_COUNTER_WKT_PARSE, &start);
 }
 
 
 char* geo_polygon_wkt_encode(struct geo_polygon *poly)
 {
+  instr_time start;
+
   StringInfoData str;
 
+  geo_counter_start(&start);
+
   initStringInfo(&str);
 
   appendStringInfoString(&str, GEOEXT_GEOPOLYGON_WKT_TOKEN);
@@ -543,8 +628,8 @@ char* geo_polygon_wkt_encode(struct geo_polygon *poly)
     if(i != 0)
       appendStringInfoString(&str, ", ");
 
-    char *xstr = float8out_internal(poly->coords[i].x);
-    char *ystr = float8out_internal(poly->coords[i].y);
+    char *xstr = coord_value_encode(poly->coords[i].x);
+    char *ystr = coord_value_encode(poly->coords[i].y);
 
     appendStringInfo(&str, "%s %s", xstr, ystr);
 
@@ -555,5 +640,7 @@ char* geo_polygon_wkt_encode(struct geo_polygon *poly)
   appendStringInfoChar(&str, GEOEXT_GEOM_RDELIM);
   appendStringInfoChar(&str, GEOEXT_GEOM_RDELIM);
 
+  geo_counter_stop(GEO_COUNTER_WKT_OUTPUT, &start);
+
   return str.data;
 }
@@ -48,6 +48,14 @@
 #include "geo_box.h"
 
 
+/*
+ * GUC geoext.wkt_precision: number of decimal places of the coordinates in
+ * WKT output, or -1 for the shortest exact representation.
+ *
+ */
+extern int geoext_wkt_precision;
+
+
 /*
  * \brief Count the number of coordinates in a sequence represented as a string.
  *
@@ -41,6 +41,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <math.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -62,6 +63,8 @@ void test_euclidian_distance();
 
 void test_point_in_polygon();
 
+void test_points_in_polygon();
+
 void test_hex_encoding_decoding();
 
 void test_lengh();
@@ -72,6 +75,28 @@ void test_text_mode();
 
 void test_binary_mode();
 
+void test_hilbert();
+
+void test_geohash();
+
+void test_simplify();
+
+void test_float4_rounding();
+
+void test_box_insert_penalty();
+
+void test_packed_rtree();
+
+void test_geodesic_distance();
+
+void test_projections();
+
+void test_convex_hull();
+
+void test_min_area_rect();
+
+void test_segment_box_distance();
+
 void SwapInt32(int32_t *v);
 
 void SwapDouble(char *v);
@@ -92,6 +117,30 @@ int main()
 
   test_binary_mode();
 
+  test_hilbert();
+
+  test_geohash();
+
+  test_simplify();
+
+  test_float4_rounding();
+
+  test_box_insert_penalty();
+
+  test_packed_rtree();
+
+  test_geodesic_distance();
+
+  test_projections();
+
+  test_convex_hull();
+
+  test_min_area_rect();
+
+  test_segment_box_distance();
+
+  test_points_in_polygon();
+
   return EXIT_SUCCESS;
 }
 
@@ -371,6 +420,39 @@ void test_point_in_polygon()
 }
 
 
+/* a batch on a lattice that hits the vertices and the edges of a concave ring */
+void test_points_in_polygon()
+{
+  struct coord2d poly [] = { { 0.0, 0.0 }, { 8.0, 0.0 }, { 8.0, 8.0 }, { 4.0, 3.0 },
+                             { 0.0, 8.0 }, { 2.0, 4.0 }, { 0.0, 0.0 } };
+
+  int num_vertices = sizeof(poly) / sizeof(struct coord2d);
+
+  struct coord2d pts[21 * 21];
+
+  unsigned char inside[21 * 21];
+
+  int npts = 0, ninside = 0, agree = 1;
+
+  for(int j = 0; j < 21; ++j)
+    for(int i = 0; i < 21; ++i, ++npts)
+    {
+      pts[npts].x = -1.0 + 0.5 * i;
+      pts[npts].y = -1.0 + 0.5 * j;
+    }
+
+  points_in_polygon(pts, npts, poly, num_vertices, inside);
+
+  for(int i = 0; i < npts; ++i)
+  {
+    ninside += inside[i];
+    agree = agree && (inside[i] == point_in_polygon(&pts[i], poly, num_vertices));
+  }
+
+  printf("Points in polygon: %d, as point_in_polygon? %s\n", ninside, (agree ? "yes" : "no"));
+}
+
+
 void test_hex_encoding_decoding()
 {
   struct coord2d pt1 = { 5.0, 2.0 };
@@ -590,6 +672,176 @@ void test_binary_mode()
   PQfinish(conn);
 }
 
+void test_hilbert()
+{
+/* the order 1 curve visits (0,0), (0,1), (1,1), (1,0) */
+  for(uint64_t d = 0; d < 4; ++d)
+  {
+    uint32_t x, y;
+
+    hilbert_d2xy(1, d, &x, &y);
+
+    printf("d = %d: (%u, %u)\n", (int) d, x, y);
+  }
+
+/* round trip and prefix property: the cell of a coarser curve is the position shifted right */
+  {
+    int ok = 1;
+
+    for(uint32_t x = 0; x < 64; x += 3)
+    {
+      for(uint32_t y = 0; y < 64; y += 5)
+      {
+        uint64_t d = hilbert_xy2d(6, x, y);
+
+        uint32_t rx, ry;
+
+        hilbert_d2xy(6, d, &rx, &ry);
+
+        if((rx != x) || (ry != y) || ((d >> 4) != hilbert_xy2d(4, x >> 2, y >> 2)))
+          ok = 0;
+      }
+    }
+
+    printf("Hilbert round trip and prefix? %s\n", (ok ? "yes" : "no"));
+  }
+}
+
+
+void test_geohash()
+{
+  char hash[GEOHASH_MAX_PRECISION + 1];
+
+/* expected: ezs42 */
+  geohash_encode(-5.6, 42.6, 5, hash);
+
+  printf("%s\n", hash);
+
+/* expected: u4pruydqqvj */
+  geohash_encode(10.40744, 57.64911, 11, hash);
+
+  printf("%s\n", hash);
+}
+
+
+void test_simplify()
+{
+  struct coord2d line[] = { {0.0, 0.0}, {1.0, 0.1}, {2.0, -0.1}, {3.0, 5.0},
+                            {4.0, 6.0}, {5.0, 7.0}, {6.0, 8.1}, {7.0, 9.0},
+                            {8.0, 9.0}, {9.0, 9.0} };
+
+  int num_vertices = sizeof(line) / sizeof(struct coord2d);
+
+  struct coord2d result[sizeof(line) / sizeof(struct coord2d)];
+
+/* expected: (0, 0) (2, -0.1) (3, 5) (7, 9) (9, 9) */
+  {
+    void *scratch = malloc(douglas_peucker_scratch_size(num_vertices));
+
+    int n = douglas_peucker(line, num_vertices, 0.5, result, scratch);
+
+    for(int i = 0; i < n; ++i)
+      printf("(%g, %g) ", result[i].x, result[i].y);
+
+    printf("\n");
+
+    free(scratch);
+  }
+
+/* expected: (0, 0) (10, 0.01) (5, 0): the spike past the end is kept */
+  {
+    struct coord2d spike[] = { {0.0, 0.0}, {10.0, 0.01}, {5.0, 0.0} };
+
+    void *scratch = malloc(douglas_peucker_scratch_size(3));
+
+    int n = douglas_peucker(spike, 3, 0.5, result, scratch);
+
+    for(int i = 0; i < n; ++i)
+      printf("(%g, %g) ", result[i].x, result[i].y);
+
+    printf("\n");
+
+    free(scratch);
+  }
+
+/* expected: (0, 0) (10.4, 0.4) (10, 0): 0.4 across and past the end, 0.57 away */
+  {
+    struct coord2d corner[] = { {0.0, 0.0}, {10.4, 0.4}, {10.0, 0.0} };
+
+    void *scratch = malloc(douglas_peucker_scratch_size(3));
+
+    int n = douglas_peucker(corner, 3, 0.5, result, scratch);
+
+    for(int i = 0; i < n; ++i)
+      printf("(%g, %g) ", result[i].x, result[i].y);
+
+    printf("\n");
+
+    free(scratch);
+  }
+
+/* a zigzag whose farthest vertex is always next to the start: all kept */
+  {
+    int nzigzag = 20000;
+
+    struct coord2d *zigzag = (struct coord2d*) malloc(nzigzag * sizeof(struct coord2d));
+    struct coord2d *out = (struct coord2d*) malloc(nzigzag * sizeof(struct coord2d));
+
+    void *scratch = malloc(douglas_peucker_scratch_size(nzigzag));
+
+    for(int i = 0; i < nzigzag; ++i)
+    {
+      zigzag[i].x = i;
+      zigzag[i].y = ((i % 2) ? -1.0 : 1.0) * (nzigzag - i);
+    }
+
+    printf("zigzag: %d of %d vertices kept\n",
+           douglas_peucker(zigzag, nzigzag, 0.5, out, scratch), nzigzag);
+
+    free(scratch);
+    free(out);
+    free(zigzag);
+  }
+
+/* expected: (0, 0) (2, -0.1) (3, 5) (7, 9) (9, 9) */
+  {
+    void *scratch = malloc(visvalingam_whyatt_scratch_size(num_vertices));
+
+    int n = visvalingam_whyatt(line, num_vertices, 0.5, 0, 1, result, scratch);
+
+    for(int i = 0; i < n; ++i)
+      printf("(%g, %g) ", result[i].x, result[i].y);
+
+    printf("\n");
+
+    free(scratch);
+  }
+
+/* (12, 0.3) is in the triangle of (10, 0): only the second run keeps (10, 0) */
+  {
+    struct coord2d ring[] = { {0.0, 0.0}, {10.0, 0.0}, {20.0, 1.0}, {20.0, 10.0},
+                              {13.0, 10.0}, {12.0, 0.3}, {11.0, 10.0}, {0.0, 10.0},
+                              {0.0, 0.0} };
+
+    int nring = sizeof(ring) / sizeof(struct coord2d);
+
+    void *scratch = malloc(visvalingam_whyatt_scratch_size(nring));
+
+    for(int preserve_topology = 0; preserve_topology < 2; ++preserve_topology)
+    {
+      int n = visvalingam_whyatt(ring, nring, 6.0, 1, preserve_topology, result, scratch);
+
+      for(int i = 0; i < n; ++i)
+        printf("(%g, %g) ", result[i].x, result[i].y);
+
+      printf("\n");
+    }
+
+    free(scratch);
+  }
+}
+
+
 void SwapInt32(int32_t *v)
 {
   char vIn[4], vOut[4];
@@ -623,3 +875,459 @@ void SwapDouble(char *v)
   v[4] = v3;
 }
 
+
+
+void test_float4_rounding()
+{
+  double values[] = { 0.1, -0.1, 1.0, -45.123456789, 179.99999999, 1.0e300, -1.0e300 };
+
+  int ok = 1;
+
+  for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+  {
+    float lo = float4_round_down(values[i]);
+    float hi = float4_round_up(values[i]);
+
+/* the float interval must contain the value and be at most one ulp wide */
+    if(((double) lo > values[i]) || ((double) hi < values[i]) ||
+       ((lo != hi) && (nextafterf(lo, HUGE_VALF) != hi)))
+      ok = 0;
+  }
+
+  printf("float4 rounding is conservative? %s\n", (ok ? "yes" : "no"));
+
+/* exactly representable values are kept: expected 1 and -0.5 */
+  printf("%g %g\n", (double) float4_round_down(1.0), (double) float4_round_up(-0.5));
+}
+
+
+void test_box_insert_penalty()
+{
+  struct coord2d pt = { 5.0, 0.0 };
+
+/* a horizontal line, a big box that covers the point, and a small one that does not */
+  struct coord2d line_low = { 0.0, 0.0 }, line_high = { 4.0, 0.0 };
+  struct coord2d big_low = { -10.0, -10.0 }, big_high = { 10.0, 10.0 };
+  struct coord2d small_low = { 6.0, 1.0 }, small_high = { 7.0, 2.0 };
+
+  float line = box_insert_penalty(&line_low, &line_high, &pt, &pt);
+  float big = box_insert_penalty(&big_low, &big_high, &pt, &pt);
+  float small = box_insert_penalty(&small_low, &small_high, &pt, &pt);
+
+/* expected: covering < margin growth < area growth */
+  printf("R* penalty order? %s\n", ((big < line) && (line < small)) ? "yes" : "no");
+
+/* a collinear point is no longer a tie with the line itself */
+  printf("degenerate keys ranked? %s\n",
+         (box_insert_penalty(&line_low, &line_high, &line_high, &line_high) < line) ? "yes" : "no");
+}
+
+
+static void count_item(int32_t item, void *arg)
+{
+  ++(*(int*) arg);
+}
+
+
+void test_packed_rtree()
+{
+/* a star-shaped ring with 200 spikes */
+  enum { NPTS = 401 };
+
+  struct coord2d ring[NPTS];
+  struct coord2d edges[2 * (NPTS - 1)];
+
+  struct packed_rtree tree;
+
+  int32_t nboxes;
+
+  struct coord2d *boxes;
+  int32_t *indices;
+  void *scratch;
+
+  int agree = 1;
+
+  for(int i = 0; i < NPTS - 1; ++i)
+  {
+    double a = 8.0 * atan(1.0) * i / (NPTS - 1);
+    double r = (i % 2) ? 10.0 : 4.0;
+
+    ring[i].x = r * cos(a);
+    ring[i].y = r * sin(a);
+  }
+
+  ring[NPTS - 1] = ring[0];
+
+  for(int i = 0; i < NPTS - 1; ++i)
+  {
+    edges[2 * i].x = fmin(ring[i].x, ring[i + 1].x);
+    edges[2 * i].y = fmin(ring[i].y, ring[i + 1].y);
+    edges[2 * i + 1].x = fmax(ring[i].x, ring[i + 1].x);
+    edges[2 * i + 1].y = fmax(ring[i].y, ring[i + 1].y);
+  }
+
+  nboxes = packed_rtree_init(&tree, NPTS - 1, 16);
+
+  boxes = malloc(2 * nboxes * sizeof(struct coord2d));
+  indices = malloc(nboxes * sizeof(int32_t));
+  scratch = malloc(packed_rtree_scratch_size(NPTS - 1));
+
+  packed_rtree_build(&tree, edges, boxes, indices, scratch);
+
+  for(double x = -11.0; x <= 11.0; x += 0.37)
+  {
+    for(double y = -11.0; y <= 11.0; y += 0.41)
+    {
+      struct coord2d pt = { x, y };
+
+      if(packed_point_in_ring(&tree, boxes, indices, ring, &pt) != point_in_polygon(&pt, ring, NPTS))
+        agree = 0;
+    }
+  }
+
+  printf("packed R-tree point in polygon agrees? %s\n", (agree ? "yes" : "no"));
+
+/* a window query returns the same edges as a linear scan */
+  {
+    struct coord2d qlow = { 2.0, -1.0 }, qhigh = { 11.0, 3.0 };
+
+    int found = 0, expected = 0;
+
+    packed_rtree_search(&tree, boxes, indices, &qlow, &qhigh, count_item, &found);
+
+    for(int i = 0; i < NPTS - 1; ++i)
+      if(edges[2 * i].x <= qhigh.x && edges[2 * i + 1].x >= qlow.x &&
+         edges[2 * i].y <= qhigh.y && edges[2 * i + 1].y >= qlow.y)
+        ++expected;
+
+    printf("window query: %d edges, expected %d\n", found, expected);
+  }
+
+  free(boxes);
+  free(indices);
+  free(scratch);
+}
+
+
+void test_geodesic_distance()
+{
+/* Flinders Peak to Buninyong, the example of Vincenty (1975): 54972.271 m */
+  struct coord2d flinders = { 144.0 + 25.0 / 60.0 + 29.52440 / 3600.0, -(37.0 + 57.0 / 60.0 + 3.72030 / 3600.0) };
+  struct coord2d buninyong = { 143.0 + 55.0 / 60.0 + 35.38390 / 3600.0, -(37.0 + 39.0 / 60.0 + 10.15610 / 3600.0) };
+
+  struct coord2d equator[3] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 2.0, 0.0 } };
+
+  struct coord2d antipode = { 179.7, 0.5 };
+
+  struct coord2d antipodes[2] = { { 0.0, 56.320923501171 }, { 179.664747671772880215, -56.320923501171 } };
+
+  double batch[3];
+
+  printf("geodesic: %.3f m (54972.271)\n", geodesic_distance(&flinders, &buninyong, GEO_WGS84_A, GEO_WGS84_F));
+
+  printf("one degree on the WGS84 equator: %.2f m (111319.49)\n", geodesic_distance(&equator[0], &equator[1], GEO_WGS84_A, GEO_WGS84_F));
+
+  printf("one degree on the sphere: %.2f m (111195.08)\n", haversine_distance(&equator[0], &equator[1], GEO_EARTH_MEAN_RADIUS));
+
+  printf("nearly antipodal: %.3f m (19944127.421)\n", geodesic_distance(&equator[0], &antipode, GEO_WGS84_A, GEO_WGS84_F));
+
+  printf("antipodal across the equator: %.3f m (19993558.287)\n", geodesic_distance(&antipodes[0], &antipodes[1], GEO_WGS84_A, GEO_WGS84_F));
+
+  haversine_distances(&equator[0], equator, sizeof(struct coord2d), 3, GEO_EARTH_MEAN_RADIUS, batch);
+
+  printf("batch agrees? %s\n", (batch[0] == 0.0 &&
+                                batch[1] == haversine_distance(&equator[0], &equator[1], GEO_EARTH_MEAN_RADIUS) &&
+                                batch[2] == haversine_distance(&equator[0], &equator[2], GEO_EARTH_MEAN_RADIUS)) ? "yes" : "no");
+
+  printf("length on the sphere: %.2f m (222390.16)\n", haversine_length(equator, 3, GEO_EARTH_MEAN_RADIUS));
+}
+
+
+void test_projections()
+{
+  struct geo_projection proj;
+
+  struct coord2d c[4];
+
+  double err = 0.0;
+
+/* Web Mercator: the corners of the square map */
+  geo_projection_init(&proj, 3857);
+
+  c[0].x = 180.0; c[0].y = 85.051128779806592;
+  geo_projection_forward(&proj, c, 1);
+
+  printf("web mercator corner: %.2f %.2f (20037508.34 20037508.34)\n", c[0].x, c[0].y);
+
+/* UTM 23S, on the central meridian at 45S: 500000 and 10000000 - k0 * M(45) */
+  geo_projection_init(&proj, 32723);
+
+  c[0].x = -45.0; c[0].y = -45.0;
+  geo_projection_forward(&proj, c, 1);
+
+  printf("utm 23S: %.3f %.3f (500000.000 5017049.600)\n", c[0].x, c[0].y);
+
+/* equidistant cylindrical: half the equator and a quarter meridian */
+  geo_projection_init(&proj, 4087);
+
+  c[0].x = 180.0; c[0].y = 90.0;
+  geo_projection_forward(&proj, c, 1);
+
+  printf("equidistant cylindrical: %.2f %.2f (20037508.34 10001965.73)\n", c[0].x, c[0].y);
+
+/* round trips through every supported kind */
+  {
+    const int srids[] = { 3857, 4087, 32618, 32723, 32660 };
+
+    for(int k = 0; k < 5; ++k)
+    {
+      struct coord2d orig[4] = { { -74.0, 40.7 }, { -76.9, 0.1 }, { 175.5, -33.2 }, { 179.0, 60.0 } };
+
+      geo_projection_init(&proj, srids[k]);
+
+/* the UTM points are moved into the zone */
+      for(int i = 0; i < 4; ++i)
+      {
+        if(proj.kind == GEO_PROJECTION_TRANSVERSE_MERCATOR)
+          orig[i].x = proj.lon0 * 180.0 / (4.0 * atan(1.0)) + (i - 1.5);
+
+        c[i] = orig[i];
+      }
+
+      geo_projection_forward(&proj, c, 4);
+      geo_projection_inverse(&proj, c, 4);
+
+      for(int i = 0; i < 4; ++i)
+        err = fmax(err, fmax(fabs(c[i].x - orig[i].x), fabs(c[i].y - orig[i].y)));
+    }
+  }
+
+  printf("projection round trips below 1e-9 degrees? %s\n", (err < 1.0e-9) ? "yes" : "no");
+
+  printf("unknown SRID rejected? %s\n", geo_projection_init(&proj, 2193) ? "no" : "yes");
+}
+
+
+void test_convex_hull()
+{
+/* the corners of a square, points on its edges, inside it and repeated */
+  struct coord2d pts[] = { { 5.0, 5.0 }, { 0.0, 0.0 }, { 10.0, 0.0 }, { 5.0, 0.0 },
+                           { 10.0, 10.0 }, { 2.0, 7.0 }, { 0.0, 10.0 }, { 0.0, 5.0 },
+                           { 10.0, 10.0 }, { 0.0, 0.0 } };
+
+  struct coord2d line[] = { { 2.0, 2.0 }, { 0.0, 0.0 }, { 1.0, 1.0 }, { 2.0, 2.0 } };
+
+  struct coord2d hull[11];
+
+  int n = convex_hull(pts, 10, hull);
+
+  printf("convex hull: %d vertices (4):", n);
+
+  for(int i = 0; i < n; ++i)
+    printf(" (%g %g)", hull[i].x, hull[i].y);
+
+  printf("\n");
+
+  printf("collinear points: %d (2)\n", convex_hull(line, 4, hull));
+
+/* Melkman on a simple ring agrees with the monotone chain */
+  {
+    enum { NPTS = 301 };
+
+    struct coord2d ring[NPTS], pts[NPTS], h1[NPTS + 1], h2[2 * NPTS];
+
+    int n1, n2, agree;
+
+    for(int i = 0; i < NPTS - 1; ++i)
+    {
+      double a = 8.0 * atan(1.0) * i / (NPTS - 1);
+      double r = 5.0 + 3.0 * cos(7.0 * a) + ((i % 3) ? 0.0 : 1.5);
+
+      ring[i].x = r * cos(a);
+      ring[i].y = r * sin(a);
+    }
+
+    ring[NPTS - 1] = ring[0];
+
+    memcpy(pts, ring, (NPTS - 1) * sizeof(struct coord2d));
+
+    n1 = convex_hull(pts, NPTS - 1, h1);
+    n2 = convex_hull_simple_ring(ring, NPTS, h2);
+
+/* the same vertices, maybe starting at another one */
+    agree = (n1 == n2);
+
+    if(agree)
+    {
+      int off = 0;
+
+      while((off < n2) && !equals(&h2[off], &h1[0]))
+        ++off;
+
+      for(int i = 0; i < n1; ++i)
+        if(!equals(&h1[i], &h2[(i + off) % n2]))
+          agree = 0;
+    }
+
+    printf("melkman agrees with the monotone chain? %s (%d vertices)\n", agree ? "yes" : "no", n2);
+  }
+
+/* a ring whose first vertices are collinear */
+  {
+    struct coord2d ring[] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 2.0, 0.0 }, { 2.0, 2.0 }, { 1.0, 1.0 }, { 0.0, 2.0 }, { 0.0, 0.0 } };
+
+    struct coord2d h[14];
+
+    printf("melkman with collinear start: %d vertices (4)\n", convex_hull_simple_ring(ring, 7, h));
+  }
+
+/* a self-intersecting ring: Melkman misses a vertex, the monotone chain does not */
+  {
+    struct coord2d ring[] = { { 3.0, 6.0 }, { 17.0, 15.0 }, { 13.0, 15.0 }, { 6.0, 12.0 }, { 9.0, 1.0 }, { 2.0, 7.0 }, { 3.0, 6.0 } };
+
+    struct coord2d pts[7], h[8];
+
+    int n, inside = 1;
+
+    memcpy(pts, ring, sizeof(ring));
+
+    n = convex_hull(pts, 7, h);
+
+/* every vertex of the ring is on the left of (or on) every hull edge */
+    for(int i = 0; i < 7; ++i)
+      for(int j = 0; j < n; ++j)
+      {
+        const struct coord2d *a = &h[j];
+        const struct coord2d *b = &h[(j + 1) % n];
+
+        if(((b->x - a->x) * (ring[i].y - a->y) - (b->y - a->y) * (ring[i].x - a->x)) < 0.0)
+          inside = 0;
+      }
+
+    printf("hull of a self-intersecting ring: %d vertices (6), encloses the ring? %s\n", n, inside ? "yes" : "no");
+  }
+}
+
+
+void test_min_area_rect()
+{
+/* a rectangle of 4 x 1 rotated by 30 degrees, plus points inside it */
+  enum { NPTS = 40 };
+
+  struct coord2d pts[NPTS], hull[NPTS + 1], rect[4];
+
+  double c = cos(4.0 * atan(1.0) / 6.0), s = sin(4.0 * atan(1.0) / 6.0);
+
+  double area, brute = HUGE_VAL;
+
+  int n;
+
+  for(int i = 0; i < NPTS; ++i)
+  {
+    double u = (i < 4) ? ((i == 1 || i == 2) ? 4.0 : 0.0) : fmod(i * 0.37, 4.0);
+    double v = (i < 4) ? ((i >= 2) ? 1.0 : 0.0) : fmod(i * 0.61, 1.0);
+
+    pts[i].x = 10.0 + u * c - v * s;
+    pts[i].y = -3.0 + u * s + v * c;
+  }
+
+  n = convex_hull(pts, NPTS, hull);
+
+  area = min_area_rect(hull, n, rect);
+
+  printf("min area rect of a rotated 4 x 1 rectangle: %.6f (4)\n", area);
+
+/* the same as checking every edge direction */
+  for(int i = 0; i < n; ++i)
+  {
+    double dx = hull[(i + 1) % n].x - hull[i].x, dy = hull[(i + 1) % n].y - hull[i].y;
+
+    double len = sqrt(dx * dx + dy * dy);
+
+    double umin = HUGE_VAL, umax = -HUGE_VAL, vmax = 0.0;
+
+    for(int k = 0; k < n; ++k)
+    {
+      double u = ((hull[k].x - hull[i].x) * dx + (hull[k].y - hull[i].y) * dy) / len;
+      double v = (-(hull[k].x - hull[i].x) * dy + (hull[k].y - hull[i].y) * dx) / len;
+
+      umin = fmin(umin, u);
+      umax = fmax(umax, u);
+      vmax = fmax(vmax, v);
+    }
+
+    brute = fmin(brute, (umax - umin) * vmax);
+  }
+
+/* random hull */
+  {
+    struct coord2d rnd[500], rh[501], rr[4];
+
+    double best = HUGE_VAL, got;
+
+    int m;
+
+    srand(7);
+
+    for(int i = 0; i < 500; ++i)
+    {
+      rnd[i].x = (double) rand() / RAND_MAX * 10.0;
+      rnd[i].y = (double) rand() / RAND_MAX * 3.0 + rnd[i].x * 0.5;
+    }
+
+    m = convex_hull(rnd, 500, rh);
+
+    got = min_area_rect(rh, m, rr);
+
+    for(int i = 0; i < m; ++i)
+    {
+      double dx = rh[(i + 1) % m].x - rh[i].x, dy = rh[(i + 1) % m].y - rh[i].y;
+
+      double len = sqrt(dx * dx + dy * dy);
+
+      double umin = HUGE_VAL, umax = -HUGE_VAL, vmax = 0.0;
+
+      for(int k = 0; k < m; ++k)
+      {
+        double u = ((rh[k].x - rh[i].x) * dx + (rh[k].y - rh[i].y) * dy) / len;
+        double v = (-(rh[k].x - rh[i].x) * dy + (rh[k].y - rh[i].y) * dx) / len;
+
+        umin = fmin(umin, u);
+        umax = fmax(umax, u);
+        vmax = fmax(vmax, v);
+      }
+
+      best = fmin(best, (umax - umin) * vmax);
+    }
+
+    printf("rotating calipers agree with brute force? %s\n",
+           (fabs(area - brute) < 1.0e-9 && fabs(got - best) < 1.0e-9 * best) ? "yes" : "no");
+  }
+}
+
+
+void test_segment_box_distance()
+{
+  struct coord2d low = { 0.0, 0.0 }, high = { 10.0, 10.0 };
+
+/* crosses the box without an end point inside it */
+  struct coord2d a1 = { -5.0, 5.0 }, b1 = { 15.0, 5.0 };
+
+/* touches a corner */
+  struct coord2d a2 = { 10.0, 10.0 }, b2 = { 20.0, 20.0 };
+
+/* passes by the corner (10 10) */
+  struct coord2d a3 = { 12.0, 8.0 }, b3 = { 8.0, 16.0 };
+
+/* parallel to a side, outside */
+  struct coord2d a4 = { -3.0, -1.0 }, b4 = { 13.0, -1.0 };
+
+/* a single point */
+  struct coord2d a5 = { 13.0, 14.0 };
+
+  printf("segment crossing a box: %g (0)\n", segment_box_distance(&a1, &b1, &low, &high));
+  printf("segment touching a corner: %g (0)\n", segment_box_distance(&a2, &b2, &low, &high));
+  printf("segment passing by a corner: %.6f (%.6f)\n", segment_box_distance(&a3, &b3, &low, &high), 2.0 / sqrt(5.0));
+  printf("segment parallel to a side: %g (1)\n", segment_box_distance(&a4, &b4, &low, &high));
+  printf("point outside a box: %g (5)\n", segment_box_distance(&a5, &a5, &low, &high));
+}